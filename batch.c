@@ -0,0 +1,489 @@
+#include "batch.h"
+#include "bmp.h"
+#include "bonus_mosaic.h"
+#include "extra_filters.h"
+#include "frame_pool.h"
+#include "parallel.h"
+#include "profile.h"
+#include "stream.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <glob.h>
+#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+
+// Список файлов
+
+typedef struct {
+    char* input;               // Входной файл
+    char* output;              // Выходной файл
+    BatchStatus status;        // Результат
+    double seconds;            // Время обработки
+} BatchItem;
+
+typedef struct {
+    BatchItem* items;
+    int count;
+    int capacity;
+} BatchList;
+
+// Общее состояние рабочих
+
+typedef struct {
+    FilterPipeline* pipeline;  // Общий конвейер (только чтение)
+    BatchList* list;
+    atomic_int next;           // Следующий необработанный файл
+    int done;                  // Обработано файлов (под report_mutex)
+    pthread_mutex_t report_mutex;
+    FILE* report;              // Вывод прогресса (stdout до подавления)
+} BatchContext;
+
+// Вспомогательные функции
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+const char* batch_status_text(BatchStatus status) {
+    switch (status) {
+        case BATCH_OK:            return "успешно";
+        case BATCH_FAILED_LOAD:   return "ошибка загрузки";
+        case BATCH_FAILED_FILTER: return "ошибка применения фильтров";
+        case BATCH_FAILED_SAVE:   return "ошибка сохранения";
+        case BATCH_FAILED_STREAM: return "ошибка потоковой обработки";
+        case BATCH_FAILED_NAME:   return "имя результата совпадает с предыдущим файлом";
+        default:                  return "не обработан";
+    }
+}
+
+static const char* path_basename(const char* path) {
+    const char* slash = strrchr(path, '/');
+    return slash ? slash + 1 : path;
+}
+
+static bool has_bmp_suffix(const char* name) {
+    size_t len = strlen(name);
+    return len >= 4 && strcasecmp(name + len - 4, ".bmp") == 0;
+}
+
+static int compare_strings(const void* a, const void* b) {
+    return strcmp(*(const char* const*)a, *(const char* const*)b);
+}
+
+static bool list_add(BatchList* list, const char* input) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 64;
+        BatchItem* items = (BatchItem*)realloc(list->items, capacity * sizeof(BatchItem));
+        if (!items) {
+            fprintf(stderr, "Ошибка выделения памяти для списка файлов\n");
+            return false;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+
+    BatchItem* item = &list->items[list->count];
+    item->input = strdup(input);
+    item->output = NULL;
+    item->status = BATCH_PENDING;
+    item->seconds = 0.0;
+    if (!item->input) {
+        fprintf(stderr, "Ошибка выделения памяти для списка файлов\n");
+        return false;
+    }
+
+    list->count++;
+    return true;
+}
+
+static void list_free(BatchList* list) {
+    for (int i = 0; i < list->count; i++) {
+        free(list->items[i].input);
+        free(list->items[i].output);
+    }
+    free(list->items);
+}
+
+// Сбор входных файлов
+
+static bool collect_glob(BatchList* list, const char* pattern) {
+    glob_t matches;
+    int rc = glob(pattern, 0, NULL, &matches);
+    if (rc == GLOB_NOMATCH) {
+        fprintf(stderr, "Ошибка: нет файлов по шаблону '%s'\n", pattern);
+        return false;
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Ошибка разбора шаблона '%s'\n", pattern);
+        return false;
+    }
+
+    bool ok = true;
+    for (size_t i = 0; i < matches.gl_pathc && ok; i++) {
+        ok = list_add(list, matches.gl_pathv[i]);
+    }
+
+    globfree(&matches);
+    return ok;
+}
+
+static bool collect_directory(BatchList* list, const char* path) {
+    DIR* dir = opendir(path);
+    if (!dir) {
+        fprintf(stderr, "Ошибка открытия каталога '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+
+    // Имена сортируются, чтобы порядок отчета не зависел от файловой системы
+    char** names = NULL;
+    size_t count = 0, capacity = 0;
+    bool ok = true;
+    struct dirent* entry;
+
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.' || !has_bmp_suffix(entry->d_name)) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            char** grown = (char**)realloc(names, capacity * sizeof(char*));
+            if (!grown) { ok = false; break; }
+            names = grown;
+        }
+
+        names[count] = strdup(entry->d_name);
+        if (!names[count]) { ok = false; break; }
+        count++;
+    }
+    closedir(dir);
+
+    if (!ok) {
+        fprintf(stderr, "Ошибка выделения памяти для списка файлов\n");
+    }
+
+    qsort(names, count, sizeof(char*), compare_strings);
+
+    for (size_t i = 0; i < count; i++) {
+        if (ok) {
+            size_t length = strlen(path) + strlen(names[i]) + 2;
+            char* full = (char*)malloc(length);
+            if (full) {
+                snprintf(full, length, "%s/%s", path, names[i]);
+                ok = list_add(list, full);
+                free(full);
+            } else {
+                ok = false;
+            }
+        }
+        free(names[i]);
+    }
+    free(names);
+
+    return ok;
+}
+
+static bool collect_list_file(BatchList* list, const char* path) {
+    FILE* file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Ошибка открытия списка файлов '%s': %s\n", path, strerror(errno));
+        return false;
+    }
+
+    char line[4096];
+    bool ok = true;
+
+    while (ok && fgets(line, sizeof(line), file)) {
+        string_trim(line);
+        if (line[0] == '\0' || line[0] == '#') continue;
+        ok = list_add(list, line);
+    }
+
+    fclose(file);
+    return ok;
+}
+
+static bool collect_inputs(BatchList* list, const char* source) {
+    struct stat st;
+
+    if (strpbrk(source, "*?[")) {
+        return collect_glob(list, source);
+    }
+    if (stat(source, &st) != 0) {
+        fprintf(stderr, "Ошибка: источник файлов не существует: %s\n", source);
+        return false;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return collect_directory(list, source);
+    }
+    return collect_list_file(list, source);
+}
+
+// Имена выходных файлов: OUTDIR/<имя входного>
+// Повтор имени - ошибка для всех файлов, кроме первого
+
+static bool assign_outputs(BatchList* list, const char* output_dir) {
+    for (int i = 0; i < list->count; i++) {
+        const char* name = path_basename(list->items[i].input);
+        size_t length = strlen(output_dir) + strlen(name) + 2;
+
+        list->items[i].output = (char*)malloc(length);
+        if (!list->items[i].output) {
+            fprintf(stderr, "Ошибка выделения памяти для списка файлов\n");
+            return false;
+        }
+        snprintf(list->items[i].output, length, "%s/%s", output_dir, name);
+    }
+
+    char** names = (char**)malloc(list->count * sizeof(char*));
+    if (!names) {
+        fprintf(stderr, "Ошибка выделения памяти для списка файлов\n");
+        return false;
+    }
+
+    // Равные имена после сортировки стоят рядом; из каждой группы
+    // обрабатывается файл, раньше всех стоящий в списке
+    for (int i = 0; i < list->count; i++) {
+        names[i] = list->items[i].output;
+    }
+    qsort(names, list->count, sizeof(char*), compare_strings);
+
+    for (int i = 1; i < list->count; i++) {
+        bool group_start = strcmp(names[i], names[i - 1]) == 0 &&
+                           (i == 1 || strcmp(names[i - 1], names[i - 2]) != 0);
+        if (!group_start) continue;
+
+        bool first = true;
+        for (int j = 0; j < list->count; j++) {
+            if (strcmp(list->items[j].output, names[i]) != 0) continue;
+            if (!first) list->items[j].status = BATCH_FAILED_NAME;
+            first = false;
+        }
+    }
+
+    free(names);
+    return true;
+}
+
+// Обработка одного файла тем же путем, что и в одиночном режиме
+
+BatchStatus batch_process_file(FilterPipeline* pipeline, const char* input, const char* output,
+                               BatchTimings* timings) {
+    ProfileSpan span;
+    BatchTimings local;
+    if (!timings) timings = &local;
+    memset(timings, 0, sizeof(*timings));
+    double start = now_seconds();
+
+    // Результат поверх входа (каталог результатов - каталог входов)
+    // потоковая запись затерла бы: тогда изображение загружается целиком
+    if (pipeline->streaming && stream_supported(pipeline) && !file_same(input, output) &&
+        file_regular_or_missing(output)) {
+        // Чтение, фильтры и запись идут вместе полосами
+        profile_begin(&span);
+        bool ok = stream_run(pipeline, input, output);
+        profile_end(&span, "stream", "stream_run", input, 0);
+        timings->filters = now_seconds() - start;
+        return ok ? BATCH_OK : BATCH_FAILED_STREAM;
+    }
+
+    if (pipeline_use_u8(pipeline)) {
+        profile_begin(&span);
+        Image8* image = bmp_load8(input);
+        timings->load = now_seconds() - start;
+        if (!image) return BATCH_FAILED_LOAD;
+        profile_end(&span, "io", "bmp_load8", input, (uint64_t)image->width * image->height);
+
+        BatchStatus status = BATCH_OK;
+        start = now_seconds();
+        if (pipeline->count > 0 && !pipeline_apply_u8(pipeline, image)) {
+            status = BATCH_FAILED_FILTER;
+        } else {
+            timings->filters = now_seconds() - start;
+            start = now_seconds();
+            profile_begin(&span);
+            if (!bmp_save8(output, image)) status = BATCH_FAILED_SAVE;
+            profile_end(&span, "io", "bmp_save8", output, (uint64_t)image->width * image->height);
+            timings->save = now_seconds() - start;
+        }
+
+        image8_free(image);
+        return status;
+    }
+
+    profile_begin(&span);
+    Image* image = bmp_load(input);
+    timings->load = now_seconds() - start;
+    if (!image) return BATCH_FAILED_LOAD;
+    profile_end(&span, "io", "bmp_load", input, (uint64_t)image->width * image->height);
+
+    BatchStatus status = BATCH_OK;
+    start = now_seconds();
+    if (pipeline->count > 0 && !pipeline_apply(pipeline, image)) {
+        status = BATCH_FAILED_FILTER;
+    } else {
+        timings->filters = now_seconds() - start;
+        start = now_seconds();
+        profile_begin(&span);
+        if (!bmp_save(output, image)) status = BATCH_FAILED_SAVE;
+        profile_end(&span, "io", "bmp_save", output, (uint64_t)image->width * image->height);
+        timings->save = now_seconds() - start;
+    }
+
+    image_free(image);
+    return status;
+}
+
+static void* batch_worker(void* arg) {
+    BatchContext* ctx = (BatchContext*)arg;
+
+    // Свой пул кадров на поток: буферы переходят от файла к файлу
+    FramePool* pool = frame_pool_create(FRAME_POOL_FRAMES);
+    frame_pool_bind(pool);
+
+    for (;;) {
+        int index = atomic_fetch_add(&ctx->next, 1);
+        if (index >= ctx->list->count) break;
+
+        BatchItem* item = &ctx->list->items[index];
+        if (item->status == BATCH_PENDING) {
+            double start = now_seconds();
+            item->status = batch_process_file(ctx->pipeline, item->input, item->output, NULL);
+            item->seconds = now_seconds() - start;
+        }
+
+        pthread_mutex_lock(&ctx->report_mutex);
+        ctx->done++;
+        fprintf(ctx->report, "[%d/%d] %s %s", ctx->done, ctx->list->count,
+                item->status == BATCH_OK ? "✅" : "❌", item->input);
+        if (item->status == BATCH_OK) {
+            fprintf(ctx->report, " (%.2f с)\n", item->seconds);
+        } else {
+            fprintf(ctx->report, ": %s\n", batch_status_text(item->status));
+        }
+        fflush(ctx->report);
+        pthread_mutex_unlock(&ctx->report_mutex);
+    }
+
+    frame_pool_bind(NULL);
+    frame_pool_destroy(pool);
+    return NULL;
+}
+
+// Пакетная обработка
+
+int batch_run(FilterPipeline* pipeline, const char* source, const char* output_dir) {
+    if (!pipeline || !source || !output_dir) {
+        fprintf(stderr, "Ошибка: некорректные параметры пакетной обработки\n");
+        return -1;
+    }
+
+    BatchList list = {NULL, 0, 0};
+    if (!collect_inputs(&list, source) || !assign_outputs(&list, output_dir)) {
+        list_free(&list);
+        return -1;
+    }
+
+    if (list.count == 0) {
+        fprintf(stderr, "Ошибка: список входных файлов пуст: %s\n", source);
+        list_free(&list);
+        return -1;
+    }
+
+    if (!directory_create(output_dir)) {
+        fprintf(stderr, "Ошибка создания каталога результатов '%s': %s\n",
+                output_dir, strerror(errno));
+        list_free(&list);
+        return -1;
+    }
+
+    // Количество одновременно обрабатываемых файлов
+    int jobs = pipeline->jobs > 0 ? pipeline->jobs : parallel_get_threads();
+    if (jobs > list.count) jobs = list.count;
+
+    if (pipeline->count > 0) {
+        pipeline_print(pipeline);
+    }
+    if (pipeline->allow_u8 && !pipeline_use_u8(pipeline)) {
+        printf("ℹ️  Не все фильтры поддерживают 8-битный режим, "
+               "изображения будут обработаны во float\n");
+    }
+    printf("\n📦 Пакетная обработка: %d файлов -> %s (файлов одновременно: %d)\n",
+           list.count, output_dir, jobs);
+
+    BatchContext ctx;
+    ctx.pipeline = pipeline;
+    ctx.list = &list;
+    atomic_init(&ctx.next, 0);
+    ctx.done = 0;
+    pthread_mutex_init(&ctx.report_mutex, NULL);
+
+    // Журналы фильтров разных файлов перемешались бы: stdout подавляется,
+    // прогресс пишется в исходный поток, ошибки (stderr) видны как обычно
+    int saved_stdout = stdout_suppress();
+    FILE* report = NULL;
+    if (saved_stdout >= 0) {
+        int report_fd = dup(saved_stdout);
+        report = report_fd >= 0 ? fdopen(report_fd, "w") : NULL;
+        if (!report && report_fd >= 0) close(report_fd);
+    }
+    ctx.report = report ? report : stderr;
+
+    tile_set_sharing_begin();
+    glass_map_sharing_begin();
+    double start = now_seconds();
+
+    // Текущий поток - один из рабочих
+    pthread_t* threads = (pthread_t*)malloc((size_t)jobs * sizeof(pthread_t));
+    int started = 0;
+    if (threads) {
+        for (int i = 1; i < jobs; i++) {
+            if (pthread_create(&threads[started], NULL, batch_worker, &ctx) != 0) break;
+            started++;
+        }
+    }
+    batch_worker(&ctx);
+    for (int i = 0; i < started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    free(threads);
+
+    double elapsed = now_seconds() - start;
+    tile_set_sharing_end();
+    glass_map_sharing_end();
+
+    if (report) fclose(report);
+    stdout_restore(saved_stdout);
+    pthread_mutex_destroy(&ctx.report_mutex);
+
+    // Отчет
+    int failed = 0;
+    for (int i = 0; i < list.count; i++) {
+        if (list.items[i].status != BATCH_OK) failed++;
+    }
+
+    printf("\n📋 Отчет пакетной обработки\n");
+    printf("========================================\n");
+    for (int i = 0; i < list.count; i++) {
+        const BatchItem* item = &list.items[i];
+        if (item->status == BATCH_OK) {
+            printf("✅ %s -> %s (%.2f с)\n", item->input, item->output, item->seconds);
+        } else {
+            printf("❌ %s: %s\n", item->input, batch_status_text(item->status));
+        }
+    }
+    printf("========================================\n");
+    printf("Всего: %d, успешно: %d, с ошибками: %d, время: %.2f с\n",
+           list.count, list.count - failed, failed, elapsed);
+
+    list_free(&list);
+    return failed;
+}
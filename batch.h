@@ -0,0 +1,48 @@
+// Пакетная обработка
+//  Один конвейер фильтров применяется к списку входных файлов:
+//  аргументы разбираются один раз, наборы плиток мозаики загружаются
+//  один раз и общие для всех файлов. Файлы обрабатываются параллельно
+//  (-jobs N), в памяти одновременно не больше N изображений.
+//  Источник списка: файл со списком путей (по одному на строку,
+//  '#' - комментарий), каталог (все *.bmp) или шаблон ("in/*.bmp").
+//  Результат: OUTDIR/<имя входного файла>, в конце - отчет по файлам.
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include "pipeline.h"
+
+// Результат обработки файла
+
+typedef enum {
+    BATCH_PENDING,             // Не обработан
+    BATCH_OK,                  // Успешно
+    BATCH_FAILED_LOAD,         // Ошибка загрузки
+    BATCH_FAILED_FILTER,       // Ошибка применения фильтров
+    BATCH_FAILED_SAVE,         // Ошибка сохранения
+    BATCH_FAILED_STREAM,       // Ошибка потоковой обработки
+    BATCH_FAILED_NAME          // Имя результата совпадает с другим файлом
+} BatchStatus;
+
+// Время этапов обработки файла, с
+//  При потоковой обработке чтение и запись входят в filters
+
+typedef struct {
+    double load;               // Чтение
+    double filters;            // Фильтры
+    double save;               // Запись
+} BatchTimings;
+
+// Обработка всех файлов источника source с сохранением в output_dir
+// Возвращает количество файлов с ошибками или -1, если список не получен
+int batch_run(FilterPipeline* pipeline, const char* source, const char* output_dir);
+
+// Обработка одного файла тем же путем, что и в одиночном режиме
+// (потоковый, 8-битный или обычный); timings может быть NULL
+BatchStatus batch_process_file(FilterPipeline* pipeline, const char* input, const char* output,
+                               BatchTimings* timings);
+
+// Описание результата для отчета
+const char* batch_status_text(BatchStatus status);
+
+#endif
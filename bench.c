@@ -0,0 +1,628 @@
+// Бенчмарк ImageCraft
+//  make bench && ./image_craft_bench [параметры]
+//
+//  Генерирует синтетические изображения заданных размеров и измеряет
+//  bmp_load/bmp_save, каждый фильтр по отдельности и типовые цепочки.
+//  Время - CLOCK_MONOTONIC, до замеров выполняются прогревочные прогоны,
+//  входное изображение копируется перед каждым прогоном вне замера.
+//  Журнал фильтров (stdout) подавляется, результат - CSV или JSON
+//  в stdout или файл, прогресс - в stderr.
+//
+//  Параметры:
+//    --sizes 1,4,16     Размеры изображений в мегапикселях (до 100 и больше)
+//    --reps N           Замеров на случай (5)
+//    --warmup N         Прогревочных прогонов (1)
+//    --format csv|json  Формат результата (csv)
+//    --output FILE      Файл результата (stdout)
+//    --only TEXT        Только случаи, в имени которых есть TEXT
+//    --threads N        Количество потоков (0 - по числу ядер)
+//    --quiet            Без прогресса в stderr
+
+#include "bmp.h"
+#include "filters.h"
+#include "image.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "simd.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+// Константы
+
+#define MAX_SIZES 16
+#define MAX_STEPS 4
+#define TILE_SIZE "16"             // Плитка мозаики
+#define TILE_GRID 32               // Атлас плиток TILE_GRID x TILE_GRID
+#define TILES_ARG "@tiles.bmp"     // Подставляется путь к атласу плиток
+#define KERNEL5_ARG "@kernel5.txt" // Неразделимое ядро 5x5 (прямая свертка)
+#define KERNEL9_ARG "@kernel9.txt" // Разделимое ядро 9x9
+#define KERNEL31_ARG "@kernel31.txt" // Неразделимое ядро 31x31 (БПФ)
+// Аргументы с '@' - файлы во временном каталоге бенчмарка
+
+// Описание случаев
+
+typedef enum {
+    BENCH_LOAD,                    // bmp_load
+    BENCH_SAVE,                    // bmp_save
+    BENCH_LOAD8,                   // bmp_load8
+    BENCH_SAVE8,                   // bmp_save8
+    BENCH_FILTER,                  // Конвейер над Image
+    BENCH_FILTER8                  // Конвейер над Image8
+} BenchKind;
+
+typedef struct {
+    FilterType type;
+    const char* args[2];
+    int arg_count;
+} BenchStep;
+
+typedef struct {
+    const char* name;              // Имя в отчете
+    const char* group;             // codec, filter, filter8, chain, chain8
+    BenchKind kind;
+    BenchStep steps[MAX_STEPS];
+    int step_count;
+} BenchCase;
+
+static const BenchCase bench_cases[] = {
+    {"bmp_load",     "codec",   BENCH_LOAD,    {{0}}, 0},
+    {"bmp_save",     "codec",   BENCH_SAVE,    {{0}}, 0},
+    {"bmp_load8",    "codec",   BENCH_LOAD8,   {{0}}, 0},
+    {"bmp_save8",    "codec",   BENCH_SAVE8,   {{0}}, 0},
+
+    {"crop",         "filter",  BENCH_FILTER,  {{FILTER_CROP, {"800", "600"}, 2}}, 1},
+    {"resize",       "filter",  BENCH_FILTER,  {{FILTER_RESIZE, {"800", "600"}, 2}}, 1},
+    {"gs",           "filter",  BENCH_FILTER,  {{FILTER_GRAYSCALE, {0}, 0}}, 1},
+    {"neg",          "filter",  BENCH_FILTER,  {{FILTER_NEGATIVE, {0}, 0}}, 1},
+    {"sharp",        "filter",  BENCH_FILTER,  {{FILTER_SHARPEN, {0}, 0}}, 1},
+    {"edge",         "filter",  BENCH_FILTER,  {{FILTER_EDGE, {"0.1"}, 1}}, 1},
+    {"med3",         "filter",  BENCH_FILTER,  {{FILTER_MEDIAN, {"3"}, 1}}, 1},
+    {"med7",         "filter",  BENCH_FILTER,  {{FILTER_MEDIAN, {"7"}, 1}}, 1},
+    {"blur2",        "filter",  BENCH_FILTER,  {{FILTER_BLUR, {"2"}, 1}}, 1},
+    {"blur8",        "filter",  BENCH_FILTER,  {{FILTER_BLUR, {"8"}, 1}}, 1},
+    {"fblur8",       "filter",  BENCH_FILTER,  {{FILTER_BLUR_FAST, {"8"}, 1}}, 1},
+    {"conv5",        "filter",  BENCH_FILTER,  {{FILTER_CONV, {KERNEL5_ARG}, 1}}, 1},
+    {"conv9_sep",    "filter",  BENCH_FILTER,  {{FILTER_CONV, {KERNEL9_ARG}, 1}}, 1},
+    {"conv31",       "filter",  BENCH_FILTER,  {{FILTER_CONV, {KERNEL31_ARG}, 1}}, 1},
+    {"crystallize",  "filter",  BENCH_FILTER,  {{FILTER_CRYSTALLIZE, {"16"}, 1}}, 1},
+    {"glass",        "filter",  BENCH_FILTER,  {{FILTER_GLASS, {"3"}, 1}}, 1},
+    {"mosaic",       "filter",  BENCH_FILTER,  {{FILTER_MOSAIC, {TILE_SIZE, TILES_ARG}, 2}}, 1},
+
+    {"crop_u8",      "filter8", BENCH_FILTER8, {{FILTER_CROP, {"800", "600"}, 2}}, 1},
+    {"gs_u8",        "filter8", BENCH_FILTER8, {{FILTER_GRAYSCALE, {0}, 0}}, 1},
+    {"neg_u8",       "filter8", BENCH_FILTER8, {{FILTER_NEGATIVE, {0}, 0}}, 1},
+    {"sharp_u8",     "filter8", BENCH_FILTER8, {{FILTER_SHARPEN, {0}, 0}}, 1},
+    {"edge_u8",      "filter8", BENCH_FILTER8, {{FILTER_EDGE, {"0.1"}, 1}}, 1},
+    {"med3_u8",      "filter8", BENCH_FILTER8, {{FILTER_MEDIAN, {"3"}, 1}}, 1},
+
+    {"gs+neg+sharp", "chain",   BENCH_FILTER,
+        {{FILTER_GRAYSCALE, {0}, 0}, {FILTER_NEGATIVE, {0}, 0}, {FILTER_SHARPEN, {0}, 0}}, 3},
+    // После размытия значения вне сетки 1/255: медиана идет во float
+    {"blur2+med3+crop", "chain", BENCH_FILTER,
+        {{FILTER_BLUR, {"2"}, 1}, {FILTER_MEDIAN, {"3"}, 1}, {FILTER_CROP, {"800", "600"}, 2}}, 3},
+    {"neg+gs+neg",   "chain",   BENCH_FILTER,
+        {{FILTER_NEGATIVE, {0}, 0}, {FILTER_GRAYSCALE, {0}, 0}, {FILTER_NEGATIVE, {0}, 0}}, 3},
+    {"sharp+edge",   "chain",   BENCH_FILTER,
+        {{FILTER_SHARPEN, {0}, 0}, {FILTER_EDGE, {"0.1"}, 1}}, 2},
+    {"sharp+blur2+edge", "chain", BENCH_FILTER,
+        {{FILTER_SHARPEN, {0}, 0}, {FILTER_BLUR, {"2"}, 1}, {FILTER_EDGE, {"0.1"}, 1}}, 3},
+    {"gs+neg+sharp_u8", "chain8", BENCH_FILTER8,
+        {{FILTER_GRAYSCALE, {0}, 0}, {FILTER_NEGATIVE, {0}, 0}, {FILTER_SHARPEN, {0}, 0}}, 3},
+};
+
+#define BENCH_CASE_COUNT (int)(sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+// Параметры запуска
+
+typedef struct {
+    double sizes[MAX_SIZES];       // Мегапикселей
+    int size_count;
+    int reps;
+    int warmup;
+    bool json;
+    const char* output;
+    const char* only;
+    bool quiet;
+} BenchOptions;
+
+// Результат случая
+
+typedef struct {
+    double min;
+    double median;
+    double mean;
+} BenchStats;
+
+// Вспомогательные функции
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static uint32_t xorshift32(uint32_t* state) {
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+// Компонента на сетке k/255, как после bmp_load
+static float synth_channel(float v) {
+    return (float)color_channel_to_u8(v) / 255.0f;
+}
+
+// Синтетическое изображение: градиенты, крупные блоки и шум,
+// чтобы медиана и границы работали не на однородных данных
+static Image* synth_image(uint32_t width, uint32_t height, uint32_t seed) {
+    Image* image = image_create(width, height);
+    if (!image) return NULL;
+
+    uint32_t state = seed ? seed : 1;
+    for (uint32_t y = 0; y < height; y++) {
+        Color* row = image->data + (size_t)y * width;
+        for (uint32_t x = 0; x < width; x++) {
+            float noise = (float)(xorshift32(&state) & 0xFF) / 255.0f;
+            float block = (((x / 64) ^ (y / 64)) & 1) ? 0.25f : 0.0f;
+            row[x].r = synth_channel(0.6f * x / width + block + 0.15f * noise);
+            row[x].g = synth_channel(0.6f * y / height + 0.25f * noise);
+            row[x].b = synth_channel(0.5f - block + 0.35f * noise);
+        }
+    }
+
+    return image;
+}
+
+// Атлас плиток мозаики: TILE_GRID² плиток разного среднего цвета
+static bool synth_tiles(const char* path) {
+    int tile = atoi(TILE_SIZE);
+    uint32_t side = (uint32_t)(tile * TILE_GRID);
+    Image* atlas = synth_image(side, side, 12345);
+    if (!atlas) return false;
+
+    for (uint32_t y = 0; y < side; y++) {
+        for (uint32_t x = 0; x < side; x++) {
+            uint32_t tx = x / tile, ty = y / tile;
+            Color* c = &atlas->data[(size_t)y * side + x];
+            c->r = 0.5f * c->r + 0.5f * (float)tx / TILE_GRID;
+            c->g = 0.5f * c->g + 0.5f * (float)ty / TILE_GRID;
+            c->b = 0.5f * c->b + 0.5f * (float)((tx + ty) % TILE_GRID) / TILE_GRID;
+        }
+    }
+
+    bool ok = bmp_save(path, atlas);
+    image_free(atlas);
+    return ok;
+}
+
+// Ядро свертки size x size в текстовом формате -conv
+//  separable: гауссово ядро (ранг 1), иначе - псевдослучайное
+static bool synth_kernel(const char* work_dir, const char* arg, int size, bool separable) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", work_dir, arg + 1);
+
+    FILE* file = fopen(path, "w");
+    if (!file) return false;
+
+    uint32_t state = (uint32_t)size * 2654435761u;
+    float sum = 0.0f;
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            float weight;
+            if (separable) {
+                float dy = (float)(y - size / 2), dx = (float)(x - size / 2);
+                weight = expf(-(dx * dx + dy * dy) / (float)size);
+            } else {
+                state = state * 1664525u + 1013904223u;
+                weight = (float)(state >> 8) / 16777216.0f - 0.25f;
+            }
+            sum += weight;
+            fprintf(file, "%g ", weight);
+        }
+        fprintf(file, "\n");
+    }
+    fprintf(file, "/ %g\n", sum);
+
+    return fclose(file) == 0;
+}
+
+static void remove_work_file(const char* work_dir, const char* arg) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%s", work_dir, arg + 1);
+    unlink(path);
+}
+
+static Image8* image8_copy(const Image8* src) {
+    Image8* copy = image8_create(src->width, src->height);
+    if (copy) {
+        memcpy(copy->data, src->data, (size_t)src->width * src->height * sizeof(BMPixel));
+    }
+    return copy;
+}
+
+static FilterPipeline* build_pipeline(const BenchCase* bench, const char* work_dir) {
+    FilterPipeline* pipeline = pipeline_create();
+    if (!pipeline) return NULL;
+
+    for (int i = 0; i < bench->step_count; i++) {
+        const BenchStep* step = &bench->steps[i];
+        char* args[2];
+        char paths[2][600];
+        for (int a = 0; a < step->arg_count; a++) {
+            args[a] = (char*)step->args[a];
+            if (args[a][0] == '@') {
+                snprintf(paths[a], sizeof(paths[a]), "%s/%s", work_dir, args[a] + 1);
+                args[a] = paths[a];
+            }
+        }
+        if (!pipeline_add_filter(pipeline, step->type, step->arg_count ? args : NULL,
+                                 step->arg_count)) {
+            pipeline_destroy(pipeline);
+            return NULL;
+        }
+    }
+
+    // Ресурсы шагов (ядра, наборы плиток) готовятся до замеров
+    if (!pipeline_compile(pipeline)) {
+        pipeline_destroy(pipeline);
+        return NULL;
+    }
+
+    return pipeline;
+}
+
+// Один прогон случая; возвращает время или отрицательное число при ошибке
+
+typedef struct {
+    const Image* source;           // Исходное изображение
+    const Image8* source8;         // Исходное 8-битное изображение
+    const char* bmp_path;          // Файл для bmp_load/bmp_save
+    FilterPipeline* pipeline;      // Конвейер случая
+} BenchInput;
+
+static double run_once(const BenchCase* bench, const BenchInput* input) {
+    double start, elapsed;
+    bool ok = false;
+
+    switch (bench->kind) {
+        case BENCH_LOAD: {
+            start = now_seconds();
+            Image* image = bmp_load(input->bmp_path);
+            elapsed = now_seconds() - start;
+            ok = image != NULL;
+            image_free(image);
+            break;
+        }
+        case BENCH_SAVE:
+            start = now_seconds();
+            ok = bmp_save(input->bmp_path, input->source);
+            elapsed = now_seconds() - start;
+            break;
+        case BENCH_LOAD8: {
+            start = now_seconds();
+            Image8* image = bmp_load8(input->bmp_path);
+            elapsed = now_seconds() - start;
+            ok = image != NULL;
+            image8_free(image);
+            break;
+        }
+        case BENCH_SAVE8:
+            start = now_seconds();
+            ok = bmp_save8(input->bmp_path, input->source8);
+            elapsed = now_seconds() - start;
+            break;
+        case BENCH_FILTER: {
+            Image* image = image_copy(input->source);
+            if (!image) return -1.0;
+            start = now_seconds();
+            ok = pipeline_apply(input->pipeline, image);
+            elapsed = now_seconds() - start;
+            image_free(image);
+            break;
+        }
+        case BENCH_FILTER8: {
+            Image8* image = image8_copy(input->source8);
+            if (!image) return -1.0;
+            start = now_seconds();
+            ok = pipeline_apply_u8(input->pipeline, image);
+            elapsed = now_seconds() - start;
+            image8_free(image);
+            break;
+        }
+        default:
+            return -1.0;
+    }
+
+    return ok ? elapsed : -1.0;
+}
+
+static bool run_case(const BenchCase* bench, const BenchInput* input,
+                     const BenchOptions* options, BenchStats* stats) {
+    for (int i = 0; i < options->warmup; i++) {
+        if (run_once(bench, input) < 0.0) return false;
+    }
+
+    double* times = (double*)malloc((size_t)options->reps * sizeof(double));
+    if (!times) return false;
+
+    double sum = 0.0;
+    for (int i = 0; i < options->reps; i++) {
+        times[i] = run_once(bench, input);
+        if (times[i] < 0.0) {
+            free(times);
+            return false;
+        }
+        sum += times[i];
+    }
+
+    qsort(times, options->reps, sizeof(double), compare_doubles);
+    stats->min = times[0];
+    stats->median = (options->reps % 2) ? times[options->reps / 2]
+                  : 0.5 * (times[options->reps / 2 - 1] + times[options->reps / 2]);
+    stats->mean = sum / options->reps;
+
+    free(times);
+    return true;
+}
+
+// Разбор параметров
+
+static bool parse_sizes(const char* text, BenchOptions* options) {
+    options->size_count = 0;
+    const char* p = text;
+
+    while (*p) {
+        char* end;
+        double mp = strtod(p, &end);
+        if (end == p || mp <= 0.0 || options->size_count == MAX_SIZES) return false;
+        options->sizes[options->size_count++] = mp;
+        p = end;
+        if (*p == ',') p++;
+        else if (*p) return false;
+    }
+
+    return options->size_count > 0;
+}
+
+static void print_usage(void) {
+    fprintf(stderr, "Использование: image_craft_bench [--sizes 1,4,16] [--reps N] "
+            "[--warmup N]\n"
+            "                [--format csv|json] [--output FILE] [--only TEXT] "
+            "[--threads N] [--quiet]\n");
+}
+
+static bool parse_options(int argc, char** argv, BenchOptions* options) {
+    options->sizes[0] = 1.0;
+    options->sizes[1] = 4.0;
+    options->sizes[2] = 16.0;
+    options->size_count = 3;
+    options->reps = 5;
+    options->warmup = 1;
+    options->json = false;
+    options->output = NULL;
+    options->only = NULL;
+    options->quiet = false;
+
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+        const char* value = (i + 1 < argc) ? argv[i + 1] : NULL;
+
+        if (strcmp(arg, "--help") == 0) {
+            return false;
+        }
+        if (strcmp(arg, "--quiet") == 0) {
+            options->quiet = true;
+            continue;
+        }
+        if (!value) {
+            fprintf(stderr, "Ошибка: параметр %s требует значение\n", arg);
+            return false;
+        }
+
+        if (strcmp(arg, "--sizes") == 0) {
+            if (!parse_sizes(value, options)) {
+                fprintf(stderr, "Ошибка: некорректный список размеров: %s\n", value);
+                return false;
+            }
+        } else if (strcmp(arg, "--reps") == 0 && is_numeric(value) && atoi(value) > 0) {
+            options->reps = atoi(value);
+        } else if (strcmp(arg, "--warmup") == 0 && is_numeric(value)) {
+            options->warmup = atoi(value);
+        } else if (strcmp(arg, "--format") == 0 &&
+                   (strcmp(value, "csv") == 0 || strcmp(value, "json") == 0)) {
+            options->json = strcmp(value, "json") == 0;
+        } else if (strcmp(arg, "--output") == 0) {
+            options->output = value;
+        } else if (strcmp(arg, "--only") == 0) {
+            options->only = value;
+        } else if (strcmp(arg, "--threads") == 0 && is_numeric(value)) {
+            parallel_set_threads(atoi(value));
+        } else {
+            fprintf(stderr, "Ошибка: неизвестный параметр или значение: %s %s\n", arg, value);
+            return false;
+        }
+        i++;
+    }
+
+    return true;
+}
+
+// Вывод результата
+
+static void report_begin(FILE* out, const BenchOptions* options) {
+    if (options->json) {
+        fprintf(out, "{\n  \"threads\": %d,\n  \"simd\": \"%s\",\n  \"reps\": %d,\n"
+                "  \"warmup\": %d,\n  \"results\": [",
+                parallel_get_threads(), simd_level_name(simd_level()),
+                options->reps, options->warmup);
+    } else {
+        fprintf(out, "case,group,width,height,megapixels,threads,simd,reps,"
+                "min_s,median_s,mean_s,mp_per_s,ns_per_pixel,status\n");
+    }
+}
+
+static void report_row(FILE* out, const BenchOptions* options, bool first,
+                       const BenchCase* bench, uint32_t width, uint32_t height,
+                       const BenchStats* stats, bool ok) {
+    double pixels = (double)width * height;
+    double mp_per_s = ok ? pixels / 1e6 / stats->median : 0.0;
+    double ns_per_pixel = ok ? stats->median * 1e9 / pixels : 0.0;
+
+    if (options->json) {
+        fprintf(out, "%s\n    {\"case\": \"%s\", \"group\": \"%s\", \"width\": %u, "
+                "\"height\": %u, \"megapixels\": %.3f, ",
+                first ? "" : ",", bench->name, bench->group, width, height, pixels / 1e6);
+        if (ok) {
+            fprintf(out, "\"min_s\": %.6f, \"median_s\": %.6f, \"mean_s\": %.6f, "
+                    "\"mp_per_s\": %.3f, \"ns_per_pixel\": %.3f, \"status\": \"ok\"}",
+                    stats->min, stats->median, stats->mean, mp_per_s, ns_per_pixel);
+        } else {
+            fprintf(out, "\"status\": \"error\"}");
+        }
+    } else {
+        fprintf(out, "%s,%s,%u,%u,%.3f,%d,%s,%d,", bench->name, bench->group,
+                width, height, pixels / 1e6, parallel_get_threads(),
+                simd_level_name(simd_level()), options->reps);
+        if (ok) {
+            fprintf(out, "%.6f,%.6f,%.6f,%.3f,%.3f,ok\n", stats->min, stats->median,
+                    stats->mean, mp_per_s, ns_per_pixel);
+        } else {
+            fprintf(out, ",,,,,error\n");
+        }
+    }
+    fflush(out);
+}
+
+static void report_end(FILE* out, const BenchOptions* options) {
+    if (options->json) {
+        fprintf(out, "\n  ]\n}\n");
+    }
+}
+
+// Основная функция
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    if (!parse_options(argc, argv, &options)) {
+        print_usage();
+        return 1;
+    }
+
+    // Временный каталог для файлов BMP и атласа плиток
+    const char* tmp = getenv("TMPDIR");
+    char work_dir[512];
+    snprintf(work_dir, sizeof(work_dir), "%s/imagecraft-bench-XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(work_dir)) {
+        fprintf(stderr, "Ошибка создания временного каталога %s\n", work_dir);
+        return 1;
+    }
+
+    char bmp_path[600], tiles_path[600];
+    snprintf(bmp_path, sizeof(bmp_path), "%s/image.bmp", work_dir);
+    snprintf(tiles_path, sizeof(tiles_path), "%s/%s", work_dir, TILES_ARG + 1);
+
+    // Атлас плиток временный: кэш плиток не засоряется
+    setenv("IMAGECRAFT_CACHE_DIR", "off", 0);
+
+    // Журнал фильтров в stdout подавляется; результат - в исходный stdout
+    int saved_stdout = stdout_suppress();
+    FILE* out = NULL;
+    if (options.output) {
+        out = fopen(options.output, "w");
+    } else if (saved_stdout >= 0) {
+        int out_fd = dup(saved_stdout);
+        out = out_fd >= 0 ? fdopen(out_fd, "w") : NULL;
+    }
+    if (!out) {
+        stdout_restore(saved_stdout);
+        fprintf(stderr, "Ошибка открытия вывода результата\n");
+        rmdir(work_dir);
+        return 1;
+    }
+
+    int failures = 0;
+    bool first_row = true;
+    bool tiles_ready = synth_tiles(tiles_path);
+    if (!tiles_ready) {
+        fprintf(stderr, "Ошибка создания атласа плиток, мозаика пропускается\n");
+    }
+    if (!synth_kernel(work_dir, KERNEL5_ARG, 5, false) ||
+        !synth_kernel(work_dir, KERNEL9_ARG, 9, true) ||
+        !synth_kernel(work_dir, KERNEL31_ARG, 31, false)) {
+        fprintf(stderr, "Ошибка создания ядер свертки\n");
+    }
+
+    report_begin(out, &options);
+
+    for (int s = 0; s < options.size_count; s++) {
+        double pixels = options.sizes[s] * 1e6;
+        uint32_t width = (uint32_t)lround(sqrt(pixels * 4.0 / 3.0));
+        uint32_t height = (uint32_t)lround(width * 0.75);
+        if (width == 0) width = 1;
+        if (height == 0) height = 1;
+
+        Image* source = synth_image(width, height, width * 2654435761u);
+        Image8* source8 = source ? image8_from_image(source) : NULL;
+        if (!source || !source8 || !bmp_save(bmp_path, source)) {
+            fprintf(stderr, "Ошибка создания изображения %ux%u\n", width, height);
+            image_free(source);
+            image8_free(source8);
+            failures++;
+            continue;
+        }
+
+        for (int c = 0; c < BENCH_CASE_COUNT; c++) {
+            const BenchCase* bench = &bench_cases[c];
+            if (options.only && !strstr(bench->name, options.only)) continue;
+            if (!tiles_ready && bench->step_count && bench->steps[0].type == FILTER_MOSAIC) continue;
+
+            if (!options.quiet) {
+                fprintf(stderr, "%-18s %ux%u (%.1f МП)...\n", bench->name, width, height,
+                        pixels / 1e6);
+            }
+
+            BenchInput input = {source, source8, bmp_path, NULL};
+            if (bench->step_count > 0) {
+                input.pipeline = build_pipeline(bench, work_dir);
+            }
+
+            BenchStats stats = {0.0, 0.0, 0.0};
+            bool ok = (bench->step_count == 0 || input.pipeline) &&
+                      run_case(bench, &input, &options, &stats);
+            if (!ok) failures++;
+
+            report_row(out, &options, first_row, bench, width, height, &stats, ok);
+            first_row = false;
+            pipeline_destroy(input.pipeline);
+        }
+
+        image_free(source);
+        image8_free(source8);
+    }
+
+    report_end(out, &options);
+    fclose(out);
+    stdout_restore(saved_stdout);
+
+    unlink(bmp_path);
+    unlink(tiles_path);
+    remove_work_file(work_dir, KERNEL5_ARG);
+    remove_work_file(work_dir, KERNEL9_ARG);
+    remove_work_file(work_dir, KERNEL31_ARG);
+    rmdir(work_dir);
+    parallel_shutdown();
+
+    return failures == 0 ? 0 : 1;
+}
@@ -1,9 +1,15 @@
 #include "bmp.h"
+#include "parallel.h"
+#include "simd.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 // Константы для работы с BMP
 
@@ -12,132 +18,361 @@
 #define BMP_BITS_PER_PIXEL 24       // 24-битный формат
 #define BMP_COMPRESSION_BI_RGB 0    // Без сжатия
 
-// Загрузка BMP изображения
+// Проверка заголовков BMP для файла размером file_length байт
+//  Массив пикселей должен целиком помещаться в файл
 
-Image* bmp_load(const char* filename) {
-    if (!filename) {
-        fprintf(stderr, "Ошибка: имя файла не указано\n");
-        return NULL;
+static bool bmp_check_headers(const char* filename,
+                              const BMPFileHeader* file_header,
+                              const BMPInfoHeader* info_header,
+                              size_t file_length) {
+    // Проверка сигнатуры
+    if (file_header->bfType != BMP_SIGNATURE) {
+        fprintf(stderr, "Ошибка: файл '%s' не является BMP (сигнатура: 0x%04X)\n", 
+                filename, file_header->bfType);
+        return false;
     }
     
-    FILE* file = fopen(filename, "rb");
-    if (!file) {
-        fprintf(stderr, "Ошибка открытия файла '%s': %s\n", filename, strerror(errno));
-        return NULL;
+    // Проверка формата (должен быть 24-битный без сжатия)
+    if (info_header->biBitCount != BMP_BITS_PER_PIXEL) {
+        fprintf(stderr, "Ошибка: неподдерживаемый формат BMP (%u бит на пиксель)\n", 
+                info_header->biBitCount);
+        fprintf(stderr, "Требуется: 24-битный BMP\n");
+        return false;
     }
     
-    // Чтение заголовков
-    BMPFileHeader file_header;
-    BMPInfoHeader info_header;
+    if (info_header->biCompression != BMP_COMPRESSION_BI_RGB) {
+        fprintf(stderr, "Ошибка: BMP файл сжат (сжатие: %u)\n", info_header->biCompression);
+        fprintf(stderr, "Требуется: несжатый BMP (BI_RGB)\n");
+        return false;
+    }
     
-    if (fread(&file_header, sizeof(BMPFileHeader), 1, file) != 1) {
-        fprintf(stderr, "Ошибка чтения BMPFileHeader из '%s'\n", filename);
-        fclose(file);
-        return NULL;
+    // Проверка размеров
+    if (info_header->biWidth <= 0 || info_header->biHeight == 0 ||
+        info_header->biHeight == INT32_MIN) {
+        fprintf(stderr, "Ошибка: некорректные размеры BMP: %dx%d\n", 
+                info_header->biWidth, info_header->biHeight);
+        return false;
     }
     
-    if (fread(&info_header, sizeof(BMPInfoHeader), 1, file) != 1) {
-        fprintf(stderr, "Ошибка чтения BMPInfoHeader из '%s'\n", filename);
-        fclose(file);
+    uint32_t width = (uint32_t)info_header->biWidth;
+    uint32_t height = (uint32_t)abs(info_header->biHeight);
+    size_t pixel_bytes = bmp_row_stride_size(width) * height;
+    if (file_header->bfOffBits > file_length ||
+        pixel_bytes > file_length - file_header->bfOffBits) {
+        fprintf(stderr, "Ошибка: файл '%s' усечен (ожидалось %zu байт данных пикселей)\n",
+                filename, pixel_bytes);
+        return false;
+    }
+    
+    return true;
+}
+
+// Заполнение заголовков BMP для изображения width x height (снизу вверх)
+//  Возвращает false, если размер файла не помещается в поля заголовка
+
+static bool bmp_fill_headers(uint32_t width, uint32_t height,
+                             BMPFileHeader* file_header, BMPInfoHeader* info_header) {
+    // Вычисление размера строки с учетом выравнивания
+    size_t image_size = bmp_row_stride_size(width) * height;
+    if (image_size > UINT32_MAX - BMP_HEADER_SIZE) {
+        fprintf(stderr, "Ошибка: изображение %ux%u слишком велико для BMP\n", width, height);
+        return false;
+    }
+    
+    *file_header = (BMPFileHeader){
+        .bfType = BMP_SIGNATURE,
+        .bfSize = BMP_HEADER_SIZE + (uint32_t)image_size,
+        .bfReserved1 = 0,
+        .bfReserved2 = 0,
+        .bfOffBits = BMP_HEADER_SIZE
+    };
+    
+    *info_header = (BMPInfoHeader){
+        .biSize = sizeof(BMPInfoHeader),
+        .biWidth = (int32_t)width,
+        .biHeight = (int32_t)height,  // Положительное = снизу вверх
+        .biPlanes = 1,
+        .biBitCount = BMP_BITS_PER_PIXEL,
+        .biCompression = BMP_COMPRESSION_BI_RGB,
+        .biSizeImage = (uint32_t)image_size,
+        .biXPelsPerMeter = 0,
+        .biYPelsPerMeter = 0,
+        .biClrUsed = 0,
+        .biClrImportant = 0
+    };
+    
+    return true;
+}
+
+// Создание файла размером file_size с резервированием места
+//  Возвращает дескриптор или -1; sized = false, если размер задать нельзя
+//  (не обычный файл: /dev/stdout, канал) - тогда файл пишется подряд write()
+
+static int bmp_create_sized(const char* filename, uint32_t file_size, bool* sized) {
+    int fd = open(filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0 && errno == EACCES) {
+        fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC, 0644);  // Только запись
+    }
+    if (fd < 0) {
+        fprintf(stderr, "Ошибка создания файла '%s': %s\n", filename, strerror(errno));
+        return -1;
+    }
+    
+    // ftruncate создает разреженный файл: место резервируется заранее,
+    // чтобы нехватка диска была ошибкой, а не SIGBUS при записи в отображение
+    struct stat st;
+    *sized = (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && ftruncate(fd, file_size) == 0);
+    if (!*sized) {
+        return fd;
+    }
+    
+    int err = posix_fallocate(fd, 0, file_size);
+    if (err == ENOSPC || err == EFBIG) {
+        fprintf(stderr, "Ошибка записи файла '%s': %s\n", filename, strerror(err));
+        close(fd);
+        return -1;
+    }
+    
+    return fd;
+}
+
+// Отображение файла BMP в память
+
+typedef struct {
+    uint8_t* base;              // Начало отображения (или буфера)
+    size_t length;              // Размер отображения
+    int fd;                     // Файл для записи буфера (-1 - отображение)
+} BMPMapping;
+
+// Открытие BMP файла для чтения через mmap и проверка заголовков
+//  Возвращает указатель на массив пикселей (bfOffBits) или NULL
+
+static const uint8_t* bmp_map_input(const char* filename, BMPMapping* map,
+                                    BMPInfoHeader* info_header) {
+    if (!filename) {
+        fprintf(stderr, "Ошибка: имя файла не указано\n");
         return NULL;
     }
     
-    // Проверка сигнатуры
-    if (file_header.bfType != BMP_SIGNATURE) {
-        fprintf(stderr, "Ошибка: файл '%s' не является BMP (сигнатура: 0x%04X)\n", 
-                filename, file_header.bfType);
-        fclose(file);
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Ошибка открытия файла '%s': %s\n", filename, strerror(errno));
         return NULL;
     }
     
-    // Проверка формата (должен быть 24-битный без сжатия)
-    if (info_header.biBitCount != BMP_BITS_PER_PIXEL) {
-        fprintf(stderr, "Ошибка: неподдерживаемый формат BMP (%u бит на пиксель)\n", 
-                info_header.biBitCount);
-        fprintf(stderr, "Требуется: 24-битный BMP\n");
-        fclose(file);
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        fprintf(stderr, "Ошибка: '%s' не является обычным файлом\n", filename);
+        close(fd);
         return NULL;
     }
     
-    if (info_header.biCompression != BMP_COMPRESSION_BI_RGB) {
-        fprintf(stderr, "Ошибка: BMP файл сжат (сжатие: %u)\n", info_header.biCompression);
-        fprintf(stderr, "Требуется: несжатый BMP (BI_RGB)\n");
-        fclose(file);
+    size_t length = (size_t)st.st_size;
+    if (length < BMP_HEADER_SIZE) {
+        fprintf(stderr, "Ошибка чтения заголовков BMP из '%s'\n", filename);
+        close(fd);
         return NULL;
     }
     
-    // Проверка размеров
-    if (info_header.biWidth <= 0 || info_header.biHeight == 0) {
-        fprintf(stderr, "Ошибка: некорректные размеры BMP: %dx%d\n", 
-                info_header.biWidth, info_header.biHeight);
-        fclose(file);
+    void* base = mmap(NULL, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);  // Отображение остается действительным после закрытия
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "Ошибка отображения файла '%s': %s\n", filename, strerror(errno));
         return NULL;
     }
     
-    // Высота может быть отрицательной (пиксели сверху вниз)
-    uint32_t width = (uint32_t)abs(info_header.biWidth);
-    uint32_t height = (uint32_t)abs(info_header.biHeight);
-    bool top_down = (info_header.biHeight < 0);  // Отрицательная высота = сверху вниз
+    map->base = (uint8_t*)base;
+    map->length = length;
+    map->fd = -1;
     
-    // Создание изображения
-    Image* image = image_create(width, height);
-    if (!image) {
-        fclose(file);
+    // Заголовки упакованы и не выровнены - копируем
+    BMPFileHeader file_header;
+    memcpy(&file_header, map->base, sizeof(BMPFileHeader));
+    memcpy(info_header, map->base + sizeof(BMPFileHeader), sizeof(BMPInfoHeader));
+    
+    if (!bmp_check_headers(filename, &file_header, info_header, length)) {
+        munmap(map->base, map->length);
         return NULL;
     }
     
-    // Вычисление размера строки с учетом выравнивания
-    uint32_t row_stride = bmp_row_stride(width);
-    uint32_t padding = row_stride - (width * 3);
+    const uint8_t* pixels = map->base + file_header.bfOffBits;
+    madvise(map->base, map->length, MADV_SEQUENTIAL);
     
-    // Переход к данным пикселей
-    if (fseek(file, file_header.bfOffBits, SEEK_SET) != 0) {
-        fprintf(stderr, "Ошибка: не удалось перейти к данным пикселей\n");
-        image_free(image);
-        fclose(file);
+    return pixels;
+}
+
+// Создание BMP файла width x height (снизу вверх) и отображение его в память
+//  Возвращает указатель на массив пикселей (выравнивание строк уже нулевое)
+
+static uint8_t* bmp_map_output(const char* filename, uint32_t width, uint32_t height,
+                               BMPMapping* map, uint32_t* file_size_out) {
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+    if (!bmp_fill_headers(width, height, &file_header, &info_header)) {
         return NULL;
     }
+    uint32_t file_size = file_header.bfSize;
     
-    // Выделение буфера для чтения строки
-    uint8_t* row_buffer = (uint8_t*)malloc(row_stride);
-    if (!row_buffer) {
-        fprintf(stderr, "Ошибка выделения памяти для буфера строки\n");
-        image_free(image);
-        fclose(file);
+    bool sized = false;
+    int fd = bmp_create_sized(filename, file_size, &sized);
+    if (fd < 0) {
         return NULL;
     }
     
-    // Чтение данных пикселей
-    for (uint32_t y = 0; y < height; y++) {
-        if (fread(row_buffer, 1, row_stride, file) != row_stride) {
-            fprintf(stderr, "Ошибка чтения строки %u из BMP\n", y);
-            free(row_buffer);
-            image_free(image);
-            fclose(file);
+    void* base = sized ? mmap(NULL, file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                       : MAP_FAILED;
+    if (base != MAP_FAILED) {
+        close(fd);
+        map->fd = -1;
+    } else {
+        // Отобразить нельзя: файл собирается в памяти и пишется при завершении
+        base = calloc(1, file_size);
+        if (!base) {
+            fprintf(stderr, "Ошибка выделения памяти для файла '%s'\n", filename);
+            close(fd);
             return NULL;
         }
-        
-        // Определение координаты Y в зависимости от порядка строк
-        uint32_t image_y = top_down ? y : (height - 1 - y);
-        
-        // Преобразование BGR в Color
-        for (uint32_t x = 0; x < width; x++) {
-            uint8_t b = row_buffer[x * 3 + 0];
-            uint8_t g = row_buffer[x * 3 + 1];
-            uint8_t r = row_buffer[x * 3 + 2];
-            
-            Color color = {
-                .r = (float)r / 255.0f,
-                .g = (float)g / 255.0f,
-                .b = (float)b / 255.0f
-            };
-            
-            image_set_pixel(image, x, image_y, color);
+        map->fd = fd;
+    }
+    
+    map->base = (uint8_t*)base;
+    map->length = file_size;
+    
+    memcpy(map->base, &file_header, sizeof(BMPFileHeader));
+    memcpy(map->base + sizeof(BMPFileHeader), &info_header, sizeof(BMPInfoHeader));
+    
+    *file_size_out = file_size;
+    return map->base + BMP_HEADER_SIZE;
+}
+
+// Завершение записи: снятие отображения или запись буфера
+//  Как и при fclose, данные остаются в страничном кэше без fsync
+
+// Последовательная запись блока целиком (write может записать меньше)
+static bool bmp_write_full(int fd, const uint8_t* buffer, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, buffer, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer += n;
+        length -= (size_t)n;
+    }
+    return true;
+}
+
+static bool bmp_unmap_output(const char* filename, BMPMapping* map) {
+    if (map->fd >= 0) {
+        bool ok = bmp_write_full(map->fd, map->base, map->length);
+        if (!ok) {
+            fprintf(stderr, "Ошибка записи файла '%s': %s\n", filename, strerror(errno));
         }
+        free(map->base);
+        return (close(map->fd) == 0) && ok;
     }
     
-    free(row_buffer);
-    fclose(file);
+    if (munmap(map->base, map->length) != 0) {
+        fprintf(stderr, "Ошибка записи файла '%s': %s\n", filename, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+// Преобразование строк между массивом пикселей BMP и изображением
+//  Строки независимы, поэтому обрабатываются полосами параллельно
+
+typedef struct {
+    uint8_t* pixels;            // Массив пикселей BMP
+    size_t row_stride;          // Размер строки файла с выравниванием
+    bool top_down;              // Порядок строк в файле
+    Image* image;               // Изображение float (или NULL)
+    Image8* image8;             // 8-битное изображение (или NULL)
+} BMPRowsBand;
+
+// Строка файла для строки изображения y
+static inline uint8_t* bmp_file_row(const BMPRowsBand* band, uint32_t height, uint32_t y) {
+    uint32_t file_y = band->top_down ? y : (height - 1 - y);
+    return band->pixels + (size_t)file_y * band->row_stride;
+}
+
+static void bmp_decode_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BMPRowsBand* band = (BMPRowsBand*)ctx;
+    Image* image = band->image;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        simd_bgr_to_rgbf(bmp_file_row(band, image->height, y),
+                         (float*)(image->data + (size_t)y * image->width),
+                         image->width);
+    }
+}
+
+static void bmp_encode_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BMPRowsBand* band = (BMPRowsBand*)ctx;
+    Image* image = band->image;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        simd_rgbf_to_bgr((const float*)(image->data + (size_t)y * image->width),
+                         bmp_file_row(band, image->height, y),
+                         image->width);
+    }
+}
+
+// Для 8-битного представления строки файла уже в формате BMPixel
+
+static void bmp_copy_in_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BMPRowsBand* band = (BMPRowsBand*)ctx;
+    Image8* image = band->image8;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        memcpy(image->data + (size_t)y * image->width,
+               bmp_file_row(band, image->height, y),
+               (size_t)image->width * sizeof(BMPixel));
+    }
+}
+
+static void bmp_copy_out_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BMPRowsBand* band = (BMPRowsBand*)ctx;
+    Image8* image = band->image8;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        memcpy(bmp_file_row(band, image->height, y),
+               image->data + (size_t)y * image->width,
+               (size_t)image->width * sizeof(BMPixel));
+    }
+}
+
+// Загрузка BMP изображения
+
+Image* bmp_load(const char* filename) {
+    BMPMapping map;
+    BMPInfoHeader info_header;
+    
+    const uint8_t* pixels = bmp_map_input(filename, &map, &info_header);
+    if (!pixels) {
+        return NULL;
+    }
+    
+    // Высота может быть отрицательной (пиксели сверху вниз)
+    uint32_t width = (uint32_t)info_header.biWidth;
+    uint32_t height = (uint32_t)abs(info_header.biHeight);
+    
+    // Создание изображения (все строки заполняются из файла)
+    Image* image = image_create_uninit(width, height);
+    if (!image) {
+        munmap(map.base, map.length);
+        return NULL;
+    }
+    
+    // Строки только читаются, отображение открыто на чтение
+    BMPRowsBand band = {
+        .pixels = (uint8_t*)pixels,
+        .row_stride = bmp_row_stride_size(width),
+        .top_down = (info_header.biHeight < 0),  // Отрицательная высота = сверху вниз
+        .image = image,
+        .image8 = NULL
+    };
+    parallel_for_rows(height, bmp_decode_band, &band);
+    
+    munmap(map.base, map.length);
     
     printf("✅ Загружено BMP: %s (%ux%u, 24-бит)\n", filename, width, height);
     return image;
@@ -151,100 +386,323 @@ bool bmp_save(const char* filename, const Image* image) {
         return false;
     }
     
-    FILE* file = fopen(filename, "wb");
-    if (!file) {
-        fprintf(stderr, "Ошибка создания файла '%s': %s\n", filename, strerror(errno));
+    BMPMapping map;
+    uint32_t file_size = 0;
+    
+    uint8_t* pixels = bmp_map_output(filename, image->width, image->height, &map, &file_size);
+    if (!pixels) {
         return false;
     }
     
-    uint32_t width = image->width;
-    uint32_t height = image->height;
+    // Запись данных пикселей (снизу вверх)
+    BMPRowsBand band = {
+        .pixels = pixels,
+        .row_stride = bmp_row_stride_size(image->width),
+        .top_down = false,
+        .image = (Image*)image,
+        .image8 = NULL
+    };
+    parallel_for_rows(image->height, bmp_encode_band, &band);
     
-    // Вычисление размера строки с учетом выравнивания
-    uint32_t row_stride = bmp_row_stride(width);
-    uint32_t padding = row_stride - (width * 3);
-    uint32_t image_size = row_stride * height;
-    uint32_t file_size = BMP_HEADER_SIZE + image_size;
+    if (!bmp_unmap_output(filename, &map)) {
+        return false;
+    }
     
-    // Заполнение заголовков
-    BMPFileHeader file_header = {
-        .bfType = BMP_SIGNATURE,
-        .bfSize = file_size,
-        .bfReserved1 = 0,
-        .bfReserved2 = 0,
-        .bfOffBits = BMP_HEADER_SIZE
+    printf("✅ Сохранено BMP: %s (%ux%u, %u байт)\n", 
+           filename, image->width, image->height, file_size);
+    return true;
+}
+
+// Загрузка BMP в 8-битное представление
+//  Строки файла уже в формате BMPixel, преобразование не требуется
+
+Image8* bmp_load8(const char* filename) {
+    BMPMapping map;
+    BMPInfoHeader info_header;
+    
+    const uint8_t* pixels = bmp_map_input(filename, &map, &info_header);
+    if (!pixels) {
+        return NULL;
+    }
+    
+    uint32_t width = (uint32_t)info_header.biWidth;
+    uint32_t height = (uint32_t)abs(info_header.biHeight);
+    
+    Image8* image = image8_create(width, height);
+    if (!image) {
+        munmap(map.base, map.length);
+        return NULL;
+    }
+    
+    BMPRowsBand band = {
+        .pixels = (uint8_t*)pixels,
+        .row_stride = bmp_row_stride_size(width),
+        .top_down = (info_header.biHeight < 0),
+        .image = NULL,
+        .image8 = image
     };
+    parallel_for_rows(height, bmp_copy_in_band, &band);
     
-    BMPInfoHeader info_header = {
-        .biSize = sizeof(BMPInfoHeader),
-        .biWidth = (int32_t)width,
-        .biHeight = (int32_t)height,  // Положительное = снизу вверх
-        .biPlanes = 1,
-        .biBitCount = BMP_BITS_PER_PIXEL,
-        .biCompression = BMP_COMPRESSION_BI_RGB,
-        .biSizeImage = image_size,
-        .biXPelsPerMeter = 0,
-        .biYPelsPerMeter = 0,
-        .biClrUsed = 0,
-        .biClrImportant = 0
+    munmap(map.base, map.length);
+    
+    printf("✅ Загружено BMP: %s (%ux%u, 24-бит, 8-битный режим)\n", filename, width, height);
+    return image;
+}
+
+// Сохранение 8-битного изображения в BMP
+
+bool bmp_save8(const char* filename, const Image8* image) {
+    if (!filename || !image || !image->data) {
+        fprintf(stderr, "Ошибка: некорректные параметры для сохранения\n");
+        return false;
+    }
+    
+    BMPMapping map;
+    uint32_t file_size = 0;
+    
+    uint8_t* pixels = bmp_map_output(filename, image->width, image->height, &map, &file_size);
+    if (!pixels) {
+        return false;
+    }
+    
+    // Запись строк снизу вверх
+    BMPRowsBand band = {
+        .pixels = pixels,
+        .row_stride = bmp_row_stride_size(image->width),
+        .top_down = false,
+        .image = NULL,
+        .image8 = (Image8*)image
     };
+    parallel_for_rows(image->height, bmp_copy_out_band, &band);
+    
+    if (!bmp_unmap_output(filename, &map)) {
+        return false;
+    }
     
-    // Запись заголовков
-    if (fwrite(&file_header, sizeof(BMPFileHeader), 1, file) != 1 ||
-        fwrite(&info_header, sizeof(BMPInfoHeader), 1, file) != 1) {
+    printf("✅ Сохранено BMP: %s (%ux%u, %u байт)\n", 
+           filename, image->width, image->height, file_size);
+    return true;
+}
+
+// Построчный доступ к BMP файлу
+
+// Чтение и запись блока целиком (вызовы могут вернуть меньше байт)
+
+static bool bmp_pread_full(int fd, uint8_t* buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pread(fd, buffer, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+static bool bmp_pwrite_full(int fd, const uint8_t* buffer, size_t length, uint64_t offset) {
+    while (length > 0) {
+        ssize_t n = pwrite(fd, buffer, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        buffer += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Буфер строк файла на count строк (выравнивание строк остается нулевым)
+static bool bmp_stream_reserve(BMPStream* stream, uint32_t count) {
+    if (count <= stream->buffer_rows) {
+        return true;
+    }
+    
+    uint8_t* buffer = (uint8_t*)calloc((size_t)count, stream->row_stride);
+    if (!buffer) {
+        fprintf(stderr, "Ошибка выделения памяти для буфера строк BMP\n");
+        return false;
+    }
+    
+    free(stream->buffer);
+    stream->buffer = buffer;
+    stream->buffer_rows = count;
+    return true;
+}
+
+// Смещение в файле первой из строк изображения [y, y + count)
+static uint64_t bmp_stream_offset(const BMPStream* stream, uint32_t y, uint32_t count) {
+    uint32_t file_y = stream->top_down ? y : stream->height - y - count;
+    return stream->pixel_offset + (uint64_t)file_y * stream->row_stride;
+}
+
+BMPStream* bmp_stream_open(const char* filename) {
+    if (!filename) {
+        fprintf(stderr, "Ошибка: имя файла не указано\n");
+        return NULL;
+    }
+    
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "Ошибка открытия файла '%s': %s\n", filename, strerror(errno));
+        return NULL;
+    }
+    
+    struct stat st;
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+    
+    if (fstat(fd, &st) != 0 ||
+        !bmp_pread_full(fd, (uint8_t*)&file_header, sizeof(file_header), 0) ||
+        !bmp_pread_full(fd, (uint8_t*)&info_header, sizeof(info_header), sizeof(file_header))) {
+        fprintf(stderr, "Ошибка чтения заголовков BMP из '%s'\n", filename);
+        close(fd);
+        return NULL;
+    }
+    
+    if (!bmp_check_headers(filename, &file_header, &info_header, (size_t)st.st_size)) {
+        close(fd);
+        return NULL;
+    }
+    
+    BMPStream* stream = (BMPStream*)calloc(1, sizeof(BMPStream));
+    if (!stream) {
+        fprintf(stderr, "Ошибка выделения памяти для потока BMP\n");
+        close(fd);
+        return NULL;
+    }
+    
+    stream->fd = fd;
+    stream->width = (uint32_t)info_header.biWidth;
+    stream->height = (uint32_t)abs(info_header.biHeight);
+    stream->top_down = (info_header.biHeight < 0);
+    stream->row_stride = bmp_row_stride_size(stream->width);
+    stream->pixel_offset = file_header.bfOffBits;
+    
+    posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return stream;
+}
+
+BMPStream* bmp_stream_create(const char* filename, uint32_t width, uint32_t height) {
+    if (!filename || width == 0 || height == 0) {
+        fprintf(stderr, "Ошибка: некорректные параметры для сохранения\n");
+        return NULL;
+    }
+    
+    BMPFileHeader file_header;
+    BMPInfoHeader info_header;
+    if (!bmp_fill_headers(width, height, &file_header, &info_header)) {
+        return NULL;
+    }
+    
+    // Полосы пишутся по смещениям, поэтому нужен обычный файл нужного размера
+    bool sized = false;
+    int fd = bmp_create_sized(filename, file_header.bfSize, &sized);
+    if (fd < 0) {
+        return NULL;
+    }
+    if (!sized) {
+        fprintf(stderr, "Ошибка: '%s' не является обычным файлом, запись полосами невозможна\n",
+                filename);
+        close(fd);
+        return NULL;
+    }
+    
+    if (!bmp_pwrite_full(fd, (const uint8_t*)&file_header, sizeof(file_header), 0) ||
+        !bmp_pwrite_full(fd, (const uint8_t*)&info_header, sizeof(info_header),
+                         sizeof(file_header))) {
         fprintf(stderr, "Ошибка записи заголовков BMP\n");
-        fclose(file);
+        close(fd);
+        return NULL;
+    }
+    
+    BMPStream* stream = (BMPStream*)calloc(1, sizeof(BMPStream));
+    if (!stream) {
+        fprintf(stderr, "Ошибка выделения памяти для потока BMP\n");
+        close(fd);
+        return NULL;
+    }
+    
+    stream->fd = fd;
+    stream->width = width;
+    stream->height = height;
+    stream->top_down = false;
+    stream->row_stride = bmp_row_stride_size(width);
+    stream->pixel_offset = BMP_HEADER_SIZE;
+    
+    return stream;
+}
+
+bool bmp_stream_read(BMPStream* stream, uint32_t y, uint32_t count, Color* rows) {
+    if (!stream || !rows || count == 0 || y + count > stream->height) {
+        fprintf(stderr, "Ошибка: некорректный диапазон строк BMP\n");
         return false;
     }
     
-    // Выделение буфера для записи строки
-    uint8_t* row_buffer = (uint8_t*)malloc(row_stride);
-    if (!row_buffer) {
-        fprintf(stderr, "Ошибка выделения памяти для буфера строки\n");
-        fclose(file);
+    if (!bmp_stream_reserve(stream, count)) {
         return false;
     }
     
-    // Заполнение буфера нулями (для padding)
-    memset(row_buffer, 0, row_stride);
+    // Строки [y, y + count) лежат в файле подряд, в прямом или обратном порядке
+    if (!bmp_pread_full(stream->fd, stream->buffer, (size_t)count * stream->row_stride,
+                        bmp_stream_offset(stream, y, count))) {
+        fprintf(stderr, "Ошибка чтения строк %u-%u из BMP\n", y, y + count - 1);
+        return false;
+    }
     
-    // Запись данных пикселей (снизу вверх)
-    for (uint32_t y = 0; y < height; y++) {
-        // Координата Y для BMP (снизу вверх)
-        uint32_t image_y = height - 1 - y;
-        
-        // Заполнение буфера BGR данными
-        for (uint32_t x = 0; x < width; x++) {
-            const Color* color = image_get_pixel_const(image, x, image_y);
-            if (!color) {
-                free(row_buffer);
-                fclose(file);
-                return false;
-            }
-            
-            // Преобразование Color в BGR
-            BMPixel pixel = color_to_bmpixel(*color);
-            row_buffer[x * 3 + 0] = pixel.b;  // Blue
-            row_buffer[x * 3 + 1] = pixel.g;  // Green
-            row_buffer[x * 3 + 2] = pixel.r;  // Red
-        }
-        
-        // Запись строки с padding
-        if (fwrite(row_buffer, 1, row_stride, file) != row_stride) {
-            fprintf(stderr, "Ошибка записи строки %u в BMP\n", y);
-            free(row_buffer);
-            fclose(file);
-            return false;
-        }
+    // Полоса как отдельное изображение высотой count
+    Image strip = { .data = rows, .width = stream->width, .height = count };
+    BMPRowsBand band = {
+        .pixels = stream->buffer,
+        .row_stride = stream->row_stride,
+        .top_down = stream->top_down,
+        .image = &strip,
+        .image8 = NULL
+    };
+    parallel_for_rows(count, bmp_decode_band, &band);
+    
+    return true;
+}
+
+bool bmp_stream_write(BMPStream* stream, uint32_t y, uint32_t count, const Color* rows) {
+    if (!stream || !rows || count == 0 || y + count > stream->height) {
+        fprintf(stderr, "Ошибка: некорректный диапазон строк BMP\n");
+        return false;
     }
     
-    free(row_buffer);
-    fclose(file);
+    if (!bmp_stream_reserve(stream, count)) {
+        return false;
+    }
+    
+    Image strip = { .data = (Color*)rows, .width = stream->width, .height = count };
+    BMPRowsBand band = {
+        .pixels = stream->buffer,
+        .row_stride = stream->row_stride,
+        .top_down = stream->top_down,
+        .image = &strip,
+        .image8 = NULL
+    };
+    parallel_for_rows(count, bmp_encode_band, &band);
+    
+    if (!bmp_pwrite_full(stream->fd, stream->buffer, (size_t)count * stream->row_stride,
+                         bmp_stream_offset(stream, y, count))) {
+        fprintf(stderr, "Ошибка записи строк %u-%u в BMP: %s\n",
+                y, y + count - 1, strerror(errno));
+        return false;
+    }
     
-    printf("✅ Сохранено BMP: %s (%ux%u, %u байт)\n", filename, width, height, file_size);
     return true;
 }
 
+bool bmp_stream_close(BMPStream* stream) {
+    if (!stream) return false;
+    
+    bool ok = (close(stream->fd) == 0);
+    free(stream->buffer);
+    free(stream);
+    return ok;
+}
+
 // Проверка формата BMP файла
 
 bool bmp_validate(const char* filename) {
@@ -5,6 +5,7 @@
 
 #include "image.h"
 #include <stdint.h>
+#include <stddef.h>
 #include <stdbool.h>
 
 // Структуры BMP файла
@@ -45,6 +46,42 @@ Image* bmp_load(const char* filename);
 // Сохранение изображения в BMP файл
 bool bmp_save(const char* filename, const Image* image);
 
+// Загрузка BMP файла в 8-битное представление (без преобразования в float)
+Image8* bmp_load8(const char* filename);
+
+// Сохранение 8-битного изображения в BMP файл
+bool bmp_save8(const char* filename, const Image8* image);
+
+// Построчный доступ к BMP файлу (потоковая обработка)
+//  Строки читаются и пишутся полосами через pread/pwrite, файл в память
+//  не загружается: расход памяти зависит от ширины полосы, а не от высоты
+
+typedef struct {
+    int fd;                   // Дескриптор файла
+    uint32_t width;           // Ширина изображения
+    uint32_t height;          // Высота изображения
+    bool top_down;            // Порядок строк в файле (сверху вниз)
+    size_t row_stride;        // Размер строки файла с выравниванием
+    uint64_t pixel_offset;    // Смещение массива пикселей (bfOffBits)
+    uint8_t* buffer;          // Буфер строк файла
+    uint32_t buffer_rows;     // Емкость буфера в строках
+} BMPStream;
+
+// Открытие BMP файла для чтения строк
+BMPStream* bmp_stream_open(const char* filename);
+
+// Создание BMP файла width x height для записи строк
+BMPStream* bmp_stream_create(const char* filename, uint32_t width, uint32_t height);
+
+// Чтение строк изображения [y, y + count) в rows (width * count пикселей)
+bool bmp_stream_read(BMPStream* stream, uint32_t y, uint32_t count, Color* rows);
+
+// Запись строк изображения [y, y + count) из rows
+bool bmp_stream_write(BMPStream* stream, uint32_t y, uint32_t count, const Color* rows);
+
+// Закрытие файла и освобождение потока
+bool bmp_stream_close(BMPStream* stream);
+
 // Проверка формата BMP файла
 bool bmp_validate(const char* filename);
 
@@ -57,4 +94,9 @@ static inline uint32_t bmp_row_stride(uint32_t width) {
     return ((width * 3 + 3) / 4) * 4;
 }
 
+// То же в size_t (для смещений в больших файлах)
+static inline size_t bmp_row_stride_size(uint32_t width) {
+    return (((size_t)width * 3 + 3) / 4) * 4;
+}
+
 #endif 
\ No newline at end of file
@@ -1,10 +1,12 @@
 #include "bonus_mosaic.h"
 #include "bmp.h"
+#include "tile_cache.h"
 #include "utils.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <pthread.h>
 
 // Вспомогательные функции
 
@@ -78,6 +80,19 @@ TileSet* load_tile_set(const char* filename, int tile_size) {
     printf("🔄 Загрузка плиток из: %s (размер: %dx%d)\n", 
            filename, tile_size, tile_size);
     
+    // Готовый набор из кэша
+    TileSet* cached = tile_cache_load(filename, tile_size);
+    if (cached && !tile_set_build_nodes(cached)) {
+        fprintf(stderr, "Ошибка выделения памяти для индекса плиток\n");
+        free_tile_set(cached);
+        return NULL;
+    }
+    if (cached) {
+        printf("✅ Загружено %d плиток размером %dx%d из кэша\n", 
+               cached->count, tile_size, tile_size);
+        return cached;
+    }
+    
     // Загружаем изображение с плитками
     Image* tile_image = bmp_load(filename);
     if (!tile_image) {
@@ -108,59 +123,28 @@ TileSet* load_tile_set(const char* filename, int tile_size) {
     printf("Найдено плиток: %d (%d x %d)\n", total_tiles, tiles_x, tiles_y);
     
     // Создаем набор плиток
-    TileSet* tile_set = (TileSet*)malloc(sizeof(TileSet));
+    TileSet* tile_set = tile_set_create(total_tiles, tile_size);
     if (!tile_set) {
         fprintf(stderr, "Ошибка выделения памяти для набора плиток\n");
         image_free(tile_image);
         return NULL;
     }
     
-    tile_set->tiles = (Image**)malloc(total_tiles * sizeof(Image*));
-    if (!tile_set->tiles) {
-        fprintf(stderr, "Ошибка выделения памяти для массива плиток\n");
-        free(tile_set);
-        image_free(tile_image);
-        return NULL;
-    }
-    
-    tile_set->count = total_tiles;
-    tile_set->tile_size = tile_size;
-    
-    // Вырезаем отдельные плитки
+    // Вырезаем отдельные плитки: строки плитки копируются целиком
     int tile_index = 0;
     
     for (int ty = 0; ty < tiles_y; ty++) {
         for (int tx = 0; tx < tiles_x; tx++) {
             uint32_t start_x = tx * tile_size;
             uint32_t start_y = ty * tile_size;
+            Image* tile = &tile_set->tiles[tile_index];
             
-            // Создаем плитку
-            Image* tile = image_create(tile_size, tile_size);
-            if (!tile) {
-                fprintf(stderr, "Ошибка создания плитки %d\n", tile_index);
-                // Освобождаем уже созданные плитки
-                for (int i = 0; i < tile_index; i++) {
-                    image_free(tile_set->tiles[i]);
-                }
-                free(tile_set->tiles);
-                free(tile_set);
-                image_free(tile_image);
-                return NULL;
-            }
-            
-            // Копируем данные
             for (uint32_t y = 0; y < (uint32_t)tile_size; y++) {
-                for (uint32_t x = 0; x < (uint32_t)tile_size; x++) {
-                    const Color* src_pixel = image_get_pixel_const(
-                        tile_image, start_x + x, start_y + y);
-                    
-                    if (src_pixel) {
-                        image_set_pixel(tile, x, y, *src_pixel);
-                    }
-                }
+                memcpy(tile->data + (size_t)y * tile_size,
+                       tile_image->data + (size_t)(start_y + y) * tile_image->width + start_x,
+                       tile_size * sizeof(Color));
             }
             
-            tile_set->tiles[tile_index] = tile;
             tile_index++;
         }
     }
@@ -168,6 +152,15 @@ TileSet* load_tile_set(const char* filename, int tile_size) {
     // Освобождаем исходное изображение
     image_free(tile_image);
     
+    // Средние цвета и индекс для поиска
+    if (!tile_set_build_index(tile_set)) {
+        fprintf(stderr, "Ошибка выделения памяти для индекса плиток\n");
+        free_tile_set(tile_set);
+        return NULL;
+    }
+    
+    tile_cache_store(tile_set, filename);
+    
     printf("✅ Загружено %d плиток размером %dx%d\n", 
            total_tiles, tile_size, tile_size);
     
@@ -176,19 +169,506 @@ TileSet* load_tile_set(const char* filename, int tile_size) {
 
 // Освобождение набора плиток
 
+TileSet* tile_set_create(int count, int tile_size) {
+    if (count <= 0 || tile_size <= 0) {
+        return NULL;
+    }
+    
+    TileSet* tile_set = (TileSet*)calloc(1, sizeof(TileSet));
+    if (!tile_set) {
+        return NULL;
+    }
+    
+    size_t tile_pixels = (size_t)tile_size * tile_size;
+    tile_set->count = count;
+    tile_set->tile_size = tile_size;
+    tile_set->tiles = (Image*)malloc(count * sizeof(Image));
+    tile_set->pixels = (Color*)malloc(count * tile_pixels * sizeof(Color));
+    
+    if (!tile_set->tiles || !tile_set->pixels) {
+        free_tile_set(tile_set);
+        return NULL;
+    }
+    
+    tile_set_bind_tiles(tile_set);
+    return tile_set;
+}
+
+void tile_set_bind_tiles(TileSet* tile_set) {
+    size_t tile_pixels = (size_t)tile_set->tile_size * tile_set->tile_size;
+    
+    for (int i = 0; i < tile_set->count; i++) {
+        tile_set->tiles[i].data = tile_set->pixels + (size_t)i * tile_pixels;
+        tile_set->tiles[i].width = (uint32_t)tile_set->tile_size;
+        tile_set->tiles[i].height = (uint32_t)tile_set->tile_size;
+    }
+}
+
 void free_tile_set(TileSet* tile_set) {
     if (!tile_set) return;
     
-    if (tile_set->tiles) {
-        for (int i = 0; i < tile_set->count; i++) {
-            if (tile_set->tiles[i]) {
-                image_free(tile_set->tiles[i]);
+    free(tile_set->tiles);
+    free(tile_set->nodes);
+    free(tile_set->contrasts);
+    
+    if (tile_set->cache_map) {
+        // Пиксели, средние и дерево лежат в отображении кэша
+        tile_cache_unmap(tile_set);
+    } else {
+        free(tile_set->pixels);
+        free(tile_set->averages);
+        free(tile_set->signatures);
+        free(tile_set->kd_order);
+        free(tile_set->kd_axis);
+    }
+    
+    free(tile_set);
+}
+
+// Общие наборы плиток
+
+typedef struct SharedTileSet {
+    char* filename;               // Файл плиток
+    int tile_size;                // Размер плитки
+    TileSet* tile_set;            // Загруженный набор
+    struct SharedTileSet* next;
+} SharedTileSet;
+
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static SharedTileSet* shared_sets = NULL;
+static bool sharing_enabled = false;
+
+void tile_set_sharing_begin(void) {
+    pthread_mutex_lock(&shared_mutex);
+    sharing_enabled = true;
+    pthread_mutex_unlock(&shared_mutex);
+}
+
+void tile_set_sharing_end(void) {
+    pthread_mutex_lock(&shared_mutex);
+    
+    while (shared_sets) {
+        SharedTileSet* next = shared_sets->next;
+        free_tile_set(shared_sets->tile_set);
+        free(shared_sets->filename);
+        free(shared_sets);
+        shared_sets = next;
+    }
+    sharing_enabled = false;
+    
+    pthread_mutex_unlock(&shared_mutex);
+}
+
+// Набор плиток: общий (если включено) или собственный
+TileSet* tile_set_acquire(const char* filename, int tile_size) {
+    pthread_mutex_lock(&shared_mutex);
+    
+    if (!sharing_enabled) {
+        pthread_mutex_unlock(&shared_mutex);
+        return load_tile_set(filename, tile_size);
+    }
+    
+    for (SharedTileSet* shared = shared_sets; shared; shared = shared->next) {
+        if (shared->tile_size == tile_size && strcmp(shared->filename, filename) == 0) {
+            pthread_mutex_unlock(&shared_mutex);
+            return shared->tile_set;
+        }
+    }
+    
+    // Загрузка под блокировкой: остальные потоки дождутся готового набора
+    TileSet* tile_set = load_tile_set(filename, tile_size);
+    SharedTileSet* shared = tile_set ? (SharedTileSet*)malloc(sizeof(SharedTileSet)) : NULL;
+    char* name = shared ? strdup(filename) : NULL;
+    
+    if (name) {
+        shared->filename = name;
+        shared->tile_size = tile_size;
+        shared->tile_set = tile_set;
+        shared->next = shared_sets;
+        shared_sets = shared;
+    } else {
+        free(shared);  // Набор останется собственным и будет освобожден после фильтра
+    }
+    
+    pthread_mutex_unlock(&shared_mutex);
+    return tile_set;
+}
+
+void tile_set_release(TileSet* tile_set) {
+    pthread_mutex_lock(&shared_mutex);
+    
+    bool shared = false;
+    for (SharedTileSet* s = shared_sets; s && !shared; s = s->next) {
+        shared = (s->tile_set == tile_set);
+    }
+    
+    pthread_mutex_unlock(&shared_mutex);
+    
+    if (!shared) {
+        free_tile_set(tile_set);
+    }
+}
+
+// Подписи плиток
+
+// Сторона сетки подблоков для плитки tile_size
+static int signature_size_for(int tile_size) {
+    return tile_size < TILE_SIGNATURE_SIZE ? tile_size : TILE_SIGNATURE_SIZE;
+}
+
+// Граница i подблоков по одной оси
+static inline uint32_t signature_edge(int i, int tile_size, int k) {
+    return (uint32_t)(i * tile_size / k);
+}
+
+// Подпись области tile_size x tile_size изображения с углом (x, y)
+static void tile_signature(const TileSet* tile_set, const Image* image,
+                           uint32_t x, uint32_t y, Color* signature) {
+    int k = tile_set->signature_size;
+    int size = tile_set->tile_size;
+    
+    for (int i = 0; i < k; i++) {
+        uint32_t y0 = signature_edge(i, size, k);
+        uint32_t y1 = signature_edge(i + 1, size, k);
+        for (int j = 0; j < k; j++) {
+            uint32_t x0 = signature_edge(j, size, k);
+            uint32_t x1 = signature_edge(j + 1, size, k);
+            signature[i * k + j] = compute_average_color(image, x + x0, y + y0, 
+                                                         x1 - x0, y1 - y0);
+        }
+    }
+}
+
+// То же по таблице сумм изображения
+static void tile_signature_integral(const TileSet* tile_set, const IntegralImage* sat,
+                                    uint32_t x, uint32_t y, Color* signature) {
+    int k = tile_set->signature_size;
+    int size = tile_set->tile_size;
+    
+    for (int i = 0; i < k; i++) {
+        uint32_t y0 = signature_edge(i, size, k);
+        uint32_t y1 = signature_edge(i + 1, size, k);
+        for (int j = 0; j < k; j++) {
+            uint32_t x0 = signature_edge(j, size, k);
+            uint32_t x1 = signature_edge(j + 1, size, k);
+            signature[i * k + j] = integral_mean(sat, x + x0, y + y0, 
+                                                 x1 - x0, y1 - y0);
+        }
+    }
+}
+
+void tile_signature_weights(const TileSet* tile_set, float* weights) {
+    int k = tile_set->signature_size;
+    int size = tile_set->tile_size;
+    float area = (float)size * (float)size;
+    
+    for (int i = 0; i < k; i++) {
+        uint32_t h = signature_edge(i + 1, size, k) - signature_edge(i, size, k);
+        for (int j = 0; j < k; j++) {
+            uint32_t w = signature_edge(j + 1, size, k) - signature_edge(j, size, k);
+            weights[i * k + j] = (float)(w * h) / area;
+        }
+    }
+}
+
+// Квадрат расстояния цветов
+static inline float color_distance_squared(Color a, Color b) {
+    float dr = a.r - b.r;
+    float dg = a.g - b.g;
+    float db = a.b - b.b;
+    return dr * dr + dg * dg + db * db;
+}
+
+// Сторона грубой сетки (0 - грубого уровня нет)
+static int coarse_size_for(int signature_size) {
+    return signature_size >= 2 && signature_size % 2 == 0 ? signature_size / 2 : 0;
+}
+
+// Грубая подпись: подблок (i, j) - среднее четверки подблоков с (2i, 2j)
+//  с весами-площадями; coarse_weights (если не NULL) получают суммы весов
+//  Границы сеток совпадают: (2i)·s/k = i·s/(k/2) при четном k
+static void signature_coarsen(const Color* signature, const float* weights, int k,
+                              Color* coarse, float* coarse_weights) {
+    int half = k / 2;
+    
+    for (int i = 0; i < half; i++) {
+        for (int j = 0; j < half; j++) {
+            Color sum = {0, 0, 0};
+            float weight = 0.0f;
+            
+            for (int dy = 0; dy < 2; dy++) {
+                for (int dx = 0; dx < 2; dx++) {
+                    int q = (2 * i + dy) * k + 2 * j + dx;
+                    sum = color_add(sum, color_mul(signature[q], weights[q]));
+                    weight += weights[q];
+                }
             }
+            
+            coarse[i * half + j] = color_mul(sum, 1.0f / weight);
+            if (coarse_weights) coarse_weights[i * half + j] = weight;
         }
-        free(tile_set->tiles);
+    }
+}
+
+// Контраст подписи: корень взвешенной дисперсии подблоков около их среднего
+//  Расстояние подписей раскладывается на квадрат разности средних и
+//  расстояние отклонений от них, а второе не меньше квадрата разности
+//  контрастов: (средний цвет, контраст) - точка, расстояние до которой
+//  ограничивает расстояние подписей снизу
+static float signature_contrast(const Color* signature, const float* weights, int blocks) {
+    Color mean = {0, 0, 0};
+    for (int i = 0; i < blocks; i++) {
+        mean = color_add(mean, color_mul(signature[i], weights[i]));
     }
     
-    free(tile_set);
+    float variance = 0.0f;
+    for (int i = 0; i < blocks; i++) {
+        variance += weights[i] * color_distance_squared(signature[i], mean);
+    }
+    return sqrtf(variance);
+}
+
+// Контрасты плиток (не кэшируются: считаются по подписям при загрузке)
+static bool tile_set_build_contrasts(TileSet* tile_set) {
+    if (tile_set->contrasts) {
+        return true;
+    }
+    
+    int k = tile_set->signature_size;
+    float weights[TILE_SIGNATURE_SIZE * TILE_SIGNATURE_SIZE];
+    tile_signature_weights(tile_set, weights);
+    
+    tile_set->contrasts = (float*)malloc(tile_set->count * sizeof(float));
+    if (!tile_set->contrasts) {
+        return false;
+    }
+    
+    for (int i = 0; i < tile_set->count; i++) {
+        tile_set->contrasts[i] = signature_contrast(&tile_set->signatures[(size_t)i * k * k],
+                                                    weights, k * k);
+    }
+    return true;
+}
+
+bool tile_set_build_nodes(TileSet* tile_set) {
+    if (tile_set->nodes || !tile_set->kd_order) {
+        return true;
+    }
+    
+    if (!tile_set_build_contrasts(tile_set)) {
+        return false;
+    }
+    
+    int k = tile_set->signature_size;
+    bool coarse = coarse_size_for(k) > 0;
+    float weights[TILE_SIGNATURE_SIZE * TILE_SIGNATURE_SIZE];
+    tile_signature_weights(tile_set, weights);
+    
+    // Узел занимает одну строку кэша
+    tile_set->nodes = (TileNode*)aligned_alloc(sizeof(TileNode), 
+                                               tile_set->kd_count * sizeof(TileNode));
+    if (!tile_set->nodes) {
+        return false;
+    }
+    
+    for (int i = 0; i < tile_set->kd_count; i++) {
+        TileNode* node = &tile_set->nodes[i];
+        int index = tile_set->kd_order[i];
+        
+        memset(node, 0, sizeof(TileNode));
+        node->average = tile_set->averages[index];
+        node->contrast = tile_set->contrasts[index];
+        if (coarse) {
+            signature_coarsen(&tile_set->signatures[(size_t)index * k * k], weights, k,
+                              node->coarse, NULL);
+        }
+    }
+    return true;
+}
+
+// Расстояние подписей; как только сумма превышает limit, счет прекращается
+static float signature_distance(const Color* a, const Color* b, const float* weights,
+                                int blocks, float limit) {
+    float sum = 0.0f;
+    for (int i = 0; i < blocks; i++) {
+        sum += weights[i] * color_distance_squared(a[i], b[i]);
+        if (sum > limit) break;
+    }
+    return sum;
+}
+
+// Индекс плиток по среднему цвету
+
+// Компонента цвета по номеру оси
+static inline float color_component(const Color* c, int axis) {
+    return axis == 0 ? c->r : (axis == 1 ? c->g : c->b);
+}
+
+#define KD_AXES 4   // Оси дерева: R, G, B средних и контраст подписи
+
+// Координата плитки index в дереве: оси 0-2 - средний цвет, 3 - контраст
+static inline float kd_coordinate(const TileSet* tile_set, int index, int axis) {
+    return axis < 3 ? color_component(&tile_set->averages[index], axis) 
+                    : tile_set->contrasts[index];
+}
+
+// Частичная сортировка order[lo, hi) по оси: на место k встает k-й элемент,
+// слева не больше, справа не меньше (quickselect)
+static void kd_select(const TileSet* tile_set, int* order, int lo, int hi, int k, int axis) {
+    while (hi - lo > 1) {
+        float pivot = kd_coordinate(tile_set, order[(lo + hi) / 2], axis);
+        int i = lo, j = hi - 1;
+        
+        while (i <= j) {
+            while (kd_coordinate(tile_set, order[i], axis) < pivot) i++;
+            while (kd_coordinate(tile_set, order[j], axis) > pivot) j--;
+            if (i <= j) {
+                int t = order[i];
+                order[i] = order[j];
+                order[j] = t;
+                i++;
+                j--;
+            }
+        }
+        
+        if (k <= j) {
+            hi = j + 1;
+        } else if (k >= i) {
+            lo = i;
+        } else {
+            return;
+        }
+    }
+}
+
+// Построение поддерева на диапазоне [lo, hi): разбиение по оси
+// с наибольшим разбросом, узел - медиана в середине диапазона
+static void kd_build(TileSet* tile_set, int lo, int hi) {
+    if (hi - lo <= 0) return;
+    
+    float min_c[KD_AXES] = { INFINITY, INFINITY, INFINITY, INFINITY };
+    float max_c[KD_AXES] = { -INFINITY, -INFINITY, -INFINITY, -INFINITY };
+    int axes = tile_set->contrasts ? KD_AXES : 3;
+    
+    for (int i = lo; i < hi; i++) {
+        for (int axis = 0; axis < axes; axis++) {
+            float v = kd_coordinate(tile_set, tile_set->kd_order[i], axis);
+            if (v < min_c[axis]) min_c[axis] = v;
+            if (v > max_c[axis]) max_c[axis] = v;
+        }
+    }
+    
+    int axis = 0;
+    for (int a = 1; a < axes; a++) {
+        if (max_c[a] - min_c[a] > max_c[axis] - min_c[axis]) axis = a;
+    }
+    
+    int mid = (lo + hi) / 2;
+    kd_select(tile_set, tile_set->kd_order, lo, hi, mid, axis);
+    tile_set->kd_axis[mid] = (uint8_t)axis;
+    
+    kd_build(tile_set, lo, mid);
+    kd_build(tile_set, mid + 1, hi);
+}
+
+bool tile_set_build_index(TileSet* tile_set) {
+    if (!tile_set || tile_set->count <= 0) {
+        return false;
+    }
+    
+    int count = tile_set->count;
+    
+    if (!tile_set->averages) {
+        tile_set->averages = (Color*)malloc(count * sizeof(Color));
+        if (!tile_set->averages) {
+            return false;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            const Image* tile = &tile_set->tiles[i];
+            tile_set->averages[i] = compute_average_color(tile, 0, 0, 
+                                                          tile->width, tile->height);
+        }
+    }
+    
+    if (!tile_set->signatures) {
+        int k = signature_size_for(tile_set->tile_size);
+        tile_set->signature_size = k;
+        tile_set->signatures = (Color*)malloc((size_t)count * k * k * sizeof(Color));
+        if (!tile_set->signatures) {
+            return false;
+        }
+        
+        for (int i = 0; i < count; i++) {
+            tile_signature(tile_set, &tile_set->tiles[i], 0, 0, 
+                           &tile_set->signatures[(size_t)i * k * k]);
+        }
+    }
+    
+    free(tile_set->kd_order);
+    free(tile_set->kd_axis);
+    tile_set->kd_order = (int*)malloc(count * sizeof(int));
+    tile_set->kd_axis = (uint8_t*)malloc(count * sizeof(uint8_t));
+    if (!tile_set->kd_order || !tile_set->kd_axis) {
+        return false;
+    }
+    
+    for (int i = 0; i < count; i++) {
+        tile_set->kd_order[i] = i;
+    }
+    
+    if (!tile_set_build_contrasts(tile_set)) {
+        return false;
+    }
+    
+    tile_set->kd_count = count;
+    kd_build(tile_set, 0, count);
+    return tile_set_build_nodes(tile_set);
+}
+
+// Запас при отсечении поддерева: расстояние считается во float,
+// поэтому плоскость разбиения сравнивается с небольшим запасом
+#define KD_PRUNE_MARGIN 1.0001f
+
+static void kd_search(const TileSet* tile_set, int lo, int hi, Color target,
+                      int* best_index, float* best_distance) {
+    while (hi - lo > 0) {
+        int mid = (lo + hi) / 2;
+        int index = tile_set->kd_order[mid];
+        const Color* avg = &tile_set->averages[index];
+        
+        // То же сравнение, что и при полном переборе, плюс меньший индекс при равенстве
+        float distance = color_distance(target, *avg);
+        if (distance < *best_distance ||
+            (distance == *best_distance && index < *best_index)) {
+            *best_distance = distance;
+            *best_index = index;
+        }
+        
+        int axis = tile_set->kd_axis[mid];
+        if (axis == 3) {
+            // Разбиение по контрасту не ограничивает расстояние средних
+            kd_search(tile_set, lo, mid, target, best_index, best_distance);
+            lo = mid + 1;
+            continue;
+        }
+        
+        float diff = color_component(&target, axis) - color_component(avg, axis);
+        
+        // Сначала ближняя сторона, дальняя - если плоскость ближе лучшего
+        int near_lo = diff < 0 ? lo : mid + 1;
+        int near_hi = diff < 0 ? mid : hi;
+        int far_lo = diff < 0 ? mid + 1 : lo;
+        int far_hi = diff < 0 ? hi : mid;
+        
+        kd_search(tile_set, near_lo, near_hi, target, best_index, best_distance);
+        
+        if (!(fabsf(diff) <= *best_distance * KD_PRUNE_MARGIN)) {
+            return;
+        }
+        lo = far_lo;
+        hi = far_hi;
+    }
 }
 
 // Поиск наиболее подходящей плитки
@@ -198,29 +678,180 @@ int find_best_tile(const TileSet* tile_set, Color target_color) {
         return 0;
     }
     
-    // Предварительно вычисляем средние цвета всех плиток
+    if (!tile_set->kd_order) {
+        // Индекс не построен: полный перебор по средним цветам
+        int best_index = 0;
+        float best_distance = INFINITY;
+        
+        for (int i = 0; i < tile_set->count; i++) {
+            const Image* tile = &tile_set->tiles[i];
+            
+            Color tile_avg = tile_set->averages 
+                ? tile_set->averages[i]
+                : compute_average_color(tile, 0, 0, tile->width, tile->height);
+            
+            float distance = color_distance(target_color, tile_avg);
+            if (distance < best_distance) {
+                best_distance = distance;
+                best_index = i;
+            }
+        }
+        
+        return best_index;
+    }
     
-    int best_index = 0;
+    int best_index = -1;
     float best_distance = INFINITY;
+    kd_search(tile_set, 0, tile_set->kd_count, target_color, &best_index, &best_distance);
     
-    for (int i = 0; i < tile_set->count; i++) {
-        Image* tile = tile_set->tiles[i];
-        if (!tile) continue;
+    // Как при полном переборе: если ни одно расстояние не меньше бесконечности
+    // (например, NaN в целевом цвете), выбирается первая плитка
+    return best_index >= 0 ? best_index : 0;
+}
+
+// Поиск по подписям
+//  Расстояние подписей - сумма квадратов разностей подблоков с весами,
+//  равными их доле площади, поэтому оно равно квадрату расстояния средних
+//  цветов плюс расстояние отклонений подблоков от среднего. Контраст -
+//  норма этих отклонений; квадрат расстояния точек (средний цвет, контраст)
+//  ограничивает расстояние подписей снизу. Так же грубая подпись (сетка k/2,
+//  подблоки - объединения четверок) ограничивает снизу точную: поиск по
+//  k-d дереву идет от среднего цвета и контраста через грубую подпись
+//  к точной, плитки дальше лучшего расстояния не проверяются
+
+// Запас нижней границы: средние и подписи считаются во float, поэтому
+// граница сравнивается с лучшим расстоянием с небольшим запасом
+#define SIGNATURE_PRUNE_MARGIN 1.001f
+#define SIGNATURE_PRUNE_EPSILON 1e-6f
+#define SIGNATURE_LEAF_SIZE 32     // Поддерево до стольких узлов проверяется подряд
+
+// Запрос поиска по подписям
+typedef struct {
+    const TileSet* tile_set;
+    Color average;                 // Средний цвет области
+    const Color* signature;        // Подпись области
+    const float* weights;          // Веса подблоков
+    int blocks;                    // Подблоков в подписи
+    Color coarse[TILE_SIGNATURE_SIZE * TILE_SIGNATURE_SIZE / 4];  // Грубая подпись
+    float coarse_weights[TILE_SIGNATURE_SIZE * TILE_SIGNATURE_SIZE / 4];
+    int coarse_blocks;             // Подблоков в грубой подписи (0 - без нее)
+    float contrast;                // Контраст подписи
+} SignatureQuery;
+
+// Проверка плитки от грубого уровня к точному: средний цвет, грубая
+// подпись (если есть), подпись; каждый уровень - нижняя граница следующего
+static inline void signature_check(const SignatureQuery* query, int index,
+                                   const Color* average, float contrast,
+                                   const Color* coarse, float bound,
+                                   int* best_index, float* best_distance) {
+    const TileSet* tile_set = query->tile_set;
+    
+    float contrast_diff = query->contrast - contrast;
+    if (!(color_distance_squared(query->average, *average) + 
+          contrast_diff * contrast_diff <= bound)) {
+        return;
+    }
+    
+    if (coarse && query->coarse_blocks > 0) {
+        float distance = signature_distance(query->coarse, coarse, query->coarse_weights,
+                                            query->coarse_blocks, bound);
+        if (!(distance <= bound)) {
+            return;
+        }
+    }
+    
+    const Color* signature = &tile_set->signatures[(size_t)index * query->blocks];
+    float distance = signature_distance(query->signature, signature, query->weights,
+                                        query->blocks, *best_distance);
+    if (distance < *best_distance ||
+        (distance == *best_distance && index < *best_index)) {
+        *best_distance = distance;
+        *best_index = index;
+    }
+}
+
+// Нижняя граница расстояния подписей для отсечения при лучшем best_distance
+static inline float signature_bound(float best_distance) {
+    return best_distance * SIGNATURE_PRUNE_MARGIN + SIGNATURE_PRUNE_EPSILON;
+}
+
+static void signature_search(const SignatureQuery* query, int lo, int hi,
+                             int* best_index, float* best_distance) {
+    const TileSet* tile_set = query->tile_set;
+    
+    // Малое поддерево проверяется подряд (ниже): узлы лежат в памяти
+    // друг за другом, и проход по ним дешевле спуска с ветвлениями
+    while (hi - lo > SIGNATURE_LEAF_SIZE) {
+        int mid = (lo + hi) / 2;
+        const TileNode* node = &tile_set->nodes[mid];
         
-        // Вычисляем средний цвет плитки
-        Color tile_avg = compute_average_color(tile, 0, 0, 
-                                              tile->width, tile->height);
+        signature_check(query, tile_set->kd_order[mid], &node->average, node->contrast,
+                        node->coarse, signature_bound(*best_distance), 
+                        best_index, best_distance);
         
-        // Вычисляем расстояние до целевого цвета
-        float distance = color_distance(target_color, tile_avg);
+        int axis = tile_set->kd_axis[mid];
+        float diff = axis < 3 ? color_component(&query->average, axis) - 
+                                color_component(&node->average, axis)
+                              : query->contrast - node->contrast;
         
-        if (distance < best_distance) {
-            best_distance = distance;
-            best_index = i;
+        int near_lo = diff < 0 ? lo : mid + 1;
+        int near_hi = diff < 0 ? mid : hi;
+        int far_lo = diff < 0 ? mid + 1 : lo;
+        int far_hi = diff < 0 ? hi : mid;
+        
+        signature_search(query, near_lo, near_hi, best_index, best_distance);
+        
+        // Точки дальней стороны не ближе плоскости, а их подписи - еще дальше
+        if (!(diff * diff <= signature_bound(*best_distance))) {
+            return;
+        }
+        lo = far_lo;
+        hi = far_hi;
+    }
+    
+    for (int i = lo; i < hi; i++) {
+        const TileNode* node = &tile_set->nodes[i];
+        signature_check(query, tile_set->kd_order[i], &node->average, node->contrast,
+                        node->coarse, signature_bound(*best_distance), 
+                        best_index, best_distance);
+    }
+}
+
+int find_best_tile_signature(const TileSet* tile_set, Color average,
+                             const Color* signature, const float* weights) {
+    if (!tile_set || !tile_set->signatures || !tile_set->averages || 
+        !tile_set->contrasts) {
+        return find_best_tile(tile_set, average);
+    }
+    
+    int k = tile_set->signature_size;
+    SignatureQuery query = { 
+        .tile_set = tile_set, .average = average, .signature = signature, 
+        .weights = weights, .blocks = k * k 
+    };
+    
+    query.contrast = signature_contrast(signature, weights, k * k);
+    
+    int half = coarse_size_for(k);
+    if (half > 0) {
+        signature_coarsen(signature, weights, k, query.coarse, query.coarse_weights);
+        query.coarse_blocks = half * half;
+    }
+    
+    int best_index = -1;
+    float best_distance = INFINITY;
+    
+    if (tile_set->nodes) {
+        signature_search(&query, 0, tile_set->kd_count, &best_index, &best_distance);
+    } else {
+        // Индекс не построен: перебор без грубого уровня
+        for (int i = 0; i < tile_set->count; i++) {
+            signature_check(&query, i, &tile_set->averages[i], tile_set->contrasts[i], NULL,
+                            signature_bound(best_distance), &best_index, &best_distance);
         }
     }
     
-    return best_index;
+    return best_index >= 0 ? best_index : 0;
 }
 
 // Основная функция фильтра мозаики
@@ -237,23 +868,36 @@ bool filter_mosaic(Image* image, int tile_size, const char* tile_file) {
         return false;
     }
     
-    if (tile_size > 100) {
-        fprintf(stderr, "Предупреждение: очень большой размер плитки (%d)\n", tile_size);
-    }
-    
     // Загружаем набор плиток
-    TileSet* tile_set = load_tile_set(tile_file, tile_size);
+    TileSet* tile_set = tile_set_acquire(tile_file, tile_size);
     if (!tile_set) {
         fprintf(stderr, "Ошибка загрузки набора плиток\n");
         return false;
     }
     
+    bool ok = filter_mosaic_tiles(image, tile_set);
+    
+    // Освобождаем набор плиток
+    tile_set_release(tile_set);
+    return ok;
+}
+
+bool filter_mosaic_tiles(Image* image, const TileSet* tile_set) {
+    if (!image || !image->data || !tile_set) {
+        fprintf(stderr, "Ошибка: некорректные параметры для мозаики\n");
+        return false;
+    }
+    
     if (tile_set->count == 0) {
         fprintf(stderr, "Ошибка: набор плиток пуст\n");
-        free_tile_set(tile_set);
         return false;
     }
     
+    int tile_size = tile_set->tile_size;
+    if (tile_size > 100) {
+        fprintf(stderr, "Предупреждение: очень большой размер плитки (%d)\n", tile_size);
+    }
+    
     uint32_t width = image->width;
     uint32_t height = image->height;
     
@@ -261,10 +905,9 @@ bool filter_mosaic(Image* image, int tile_size, const char* tile_file) {
            width, height, tile_size, tile_size, tile_set->count);
     
     // Создаем временное изображение для результата
-    Image* result = image_create(width, height);
+    Image* result = image_create_uninit(width, height);  // Плитки покрывают все изображение
     if (!result) {
         fprintf(stderr, "Ошибка создания временного изображения\n");
-        free_tile_set(tile_set);
         return false;
     }
     
@@ -274,6 +917,25 @@ bool filter_mosaic(Image* image, int tile_size, const char* tile_file) {
     
     printf("Требуется плиток: %d x %d = %d\n", tiles_x, tiles_y, tiles_x * tiles_y);
     
+    // Таблица сумм: средние области и ее подблоков за O(1)
+    IntegralImage* sat = integral_create(image, false);
+    
+    // Подпись текущей области и веса подблоков
+    int blocks = tile_set->signature_size * tile_set->signature_size;
+    Color* signature = (Color*)malloc(blocks * sizeof(Color));
+    float* weights = (float*)malloc(blocks * sizeof(float));
+    
+    if (!sat || !signature || !weights) {
+        fprintf(stderr, "Ошибка выделения памяти для подписей мозаики\n");
+        integral_free(sat);
+        free(signature);
+        free(weights);
+        image_free(result);
+        return false;
+    }
+    
+    tile_signature_weights(tile_set, weights);
+    
     for (int ty = 0; ty < tiles_y; ty++) {
         for (int tx = 0; tx < tiles_x; tx++) {
             // Координаты текущей плитки в исходном изображении
@@ -281,16 +943,21 @@ bool filter_mosaic(Image* image, int tile_size, const char* tile_file) {
             uint32_t start_y = ty * tile_size;
             
             // Вычисляем средний цвет текущей области
-            Color area_avg = compute_average_color(image, start_x, start_y, 
-                                                  tile_size, tile_size);
-            
-            // Находим наиболее подходящую плитку
-            int best_tile_index = find_best_tile(tile_set, area_avg);
-            Image* best_tile = tile_set->tiles[best_tile_index];
+            Color area_avg = integral_mean(sat, start_x, start_y, 
+                                           tile_size, tile_size);
             
-            if (!best_tile) {
-                continue;
+            // Находим наиболее подходящую плитку: по подписи, если область
+            // целая; у обрезанной края видна только часть плитки, и она
+            // подбирается по среднему цвету
+            int best_tile_index;
+            if (start_x + tile_size <= width && start_y + tile_size <= height) {
+                tile_signature_integral(tile_set, sat, start_x, start_y, signature);
+                best_tile_index = find_best_tile_signature(tile_set, area_avg, 
+                                                           signature, weights);
+            } else {
+                best_tile_index = find_best_tile(tile_set, area_avg);
             }
+            const Image* best_tile = &tile_set->tiles[best_tile_index];
             
             // Копируем плитку в результат
             uint32_t copy_width = tile_size;
@@ -345,17 +1012,12 @@ bool filter_mosaic(Image* image, int tile_size, const char* tile_file) {
         }
     }
     
-    // Заменяем оригинальное изображение результатом
-    free(image->data);
-    image->data = result->data;
-    image->width = result->width;
-    image->height = result->height;
-    
-    // Освобождаем структуру result (но не данные!)
-    free(result);
+    integral_free(sat);
+    free(signature);
+    free(weights);
     
-    // Освобождаем набор плиток
-    free_tile_set(tile_set);
+    // Заменяем оригинальное изображение результатом
+    image_replace(image, result);
     
     printf("Мозаика создана: %ux%u, плитка %dx%d\n", 
            width, height, tile_size, tile_size);
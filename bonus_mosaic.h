@@ -1,6 +1,8 @@
 //  1. Изображение разбивается на плитки заданного размера
 //  2. Для каждой плитки вычисляется средний цвет
-//  3. Из набора плиток-картинок выбирается наиболее подходящая по цвету
+//  3. Из набора плиток-картинок выбирается наиболее подходящая по цвету:
+//     средний цвет отсекает кандидатов, из оставшихся побеждает плитка
+//     с ближайшей подписью - средними цветами сетки k x k подблоков
 //  4. Выбранная плитка подставляется вместо исходной
 
 #ifndef BONUS_MOSAIC_H
@@ -9,12 +11,34 @@
 #include "image.h"
 #include <stdbool.h>
 
+#define TILE_SIGNATURE_SIZE 4   // Сторона сетки подблоков подписи плитки
+
+// Узел k-d дерева плиток: все, что нужно поиску до точной подписи,
+// в одной строке кэша (64 байта)
+
+typedef struct {
+    Color average;       // Средний цвет плитки
+    float contrast;      // Контраст подписи
+    Color coarse[TILE_SIGNATURE_SIZE * TILE_SIGNATURE_SIZE / 4];  // Грубая подпись
+} TileNode;
+
 // Структура для хранения плиток
 
 typedef struct {
-    Image** tiles;        // Массив изображений-плиток
+    Image* tiles;        // Заголовки плиток (данные лежат внутри pixels)
     int count;           // Количество плиток
     int tile_size;       // Размер плитки (квадратная)
+    Color* pixels;       // Пиксели всех плиток подряд (count * tile_size²)
+    Color* averages;     // Средний цвет каждой плитки (вычисляется при загрузке)
+    Color* signatures;   // Подписи: signature_size² средних подблоков каждой плитки
+    int signature_size;  // Сторона сетки подблоков (не больше размера плитки)
+    float* contrasts;    // Контраст подписи каждой плитки (строится при загрузке)
+    TileNode* nodes;     // Узлы k-d дерева по порядку kd_order (строятся при загрузке)
+    int* kd_order;       // k-d дерево средних цветов и контрастов: узел - середина диапазона
+    uint8_t* kd_axis;    // Ось разбиения узла (0 - R, 1 - G, 2 - B, 3 - контраст)
+    int kd_count;        // Количество плиток в дереве
+    void* cache_map;     // Отображение файла кэша (NULL - данные в куче)
+    size_t cache_length; // Размер отображения
 } TileSet;
 
 // Основная функция фильтра мозаики
@@ -24,29 +48,82 @@ typedef struct {
 // tile_file Путь к файлу с набором плиток
 bool filter_mosaic(Image* image, int tile_size, const char* tile_file);
 
+// Мозаика готовым набором плиток (размер плитки - tile_set->tile_size)
+bool filter_mosaic_tiles(Image* image, const TileSet* tile_set);
+
 // Функции работы с наборами плиток
 
 // /**
 //  Загрузка набора плиток из BMP файла
 //  Предполагается, что все плитки расположены в виде сетки
+//  Сначала проверяется кэш плиток (tile_cache.h), после разбора BMP
+//  набор сохраняется в кэш
 
 // filename Путь к файлу с плитками
 // tile_size Размер одной плитки
 
 TileSet* load_tile_set(const char* filename, int tile_size);
 
+// Создание набора из count плиток tile_size x tile_size
+// (пиксели не инициализированы, средние и дерево не построены)
+
+TileSet* tile_set_create(int count, int tile_size);
+
+// Заполнение заголовков плиток по массиву pixels
+
+void tile_set_bind_tiles(TileSet* tile_set);
+
 //Освобождение памяти набора плиток
 
 void free_tile_set(TileSet* tile_set);
 
+// Общие наборы плиток (пакетная обработка)
+//  Между begin и end filter_mosaic загружает каждый набор (файл, размер)
+//  один раз и использует его во всех вызовах, в том числе из разных потоков;
+//  end освобождает наборы и должен вызываться, когда фильтры не выполняются
+
+void tile_set_sharing_begin(void);
+void tile_set_sharing_end(void);
+
+// Набор плиток (файл, размер): общий между begin и end, иначе загружается;
+// возвращается через tile_set_release (общий набор остается до end)
+
+TileSet* tile_set_acquire(const char* filename, int tile_size);
+void tile_set_release(TileSet* tile_set);
+
+// Вычисление средних цветов и подписей плиток, построение k-d дерева
+// по средним и контрастам и его узлов (вызывается из load_tile_set)
+
+bool tile_set_build_index(TileSet* tile_set);
+
+// Построение контрастов и узлов k-d дерева с грубыми подписями
+// (набор из кэша хранит только порядок дерева и точные подписи)
+
+bool tile_set_build_nodes(TileSet* tile_set);
+
 //  Поиск наиболее подходящей плитки по цвету
 
 // tile_set Набор плиток
 // target_color Целевой цвет
 // Возвращает индекс наиболее подходящей плитки
+// Поиск по k-d дереву, O(log n) в среднем; при равных расстояниях
+// выбирается плитка с меньшим индексом, как при полном переборе
 
 int find_best_tile(const TileSet* tile_set, Color target_color);
 
+// Подписи плиток: подблок (i, j) - [j·s/k, (j+1)·s/k) x [i·s/k, (i+1)·s/k),
+// s - размер плитки, k - signature_size
+
+// Веса подблоков (signature_size² чисел, сумма 1)
+void tile_signature_weights(const TileSet* tile_set, float* weights);
+
+// Поиск плитки с ближайшей подписью
+// average - средний цвет области, signature - средние ее подблоков
+// Результат тот же, что при полном переборе, при равных расстояниях - меньший индекс
+
+int find_best_tile_signature(const TileSet* tile_set, Color average,
+                             const Color* signature, const float* weights);
+
 // Вспомогательные функции
 
 // Вычисление среднего цвета области изображения
@@ -0,0 +1,832 @@
+#include "convolution.h"
+#include "filters.h"
+#include "parallel.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#define CONV_SEPARABLE_EPS 1e-5f   // Допуск проверки ранга 1 (доля max|K|)
+#define CONV_FFT_MIN_TILE 64       // Наименьшая плитка БПФ
+#define CONV_FFT_MAX_TILE 1024     // Наибольшая плитка БПФ (2 x 4 МБ на поток)
+
+// Загрузка ядра
+
+// Разбор одного числа; false, если токен не число
+static bool parse_weight(const char* token, float* value) {
+    char* end = NULL;
+    *value = strtof(token, &end);
+    return end != token && *end == '\0';
+}
+
+// Коэффициент должен быть конечным: nan, inf и числа вне float (1e40)
+// испортили бы все изображение
+static bool weight_finite(const char* filename, int line_number, const char* token,
+                          float value) {
+    if (isfinite(value)) return true;
+    fprintf(stderr, "Ошибка в файле ядра %s, строка %d: '%s' не конечное число float\n",
+            filename, line_number, token);
+    return false;
+}
+
+ConvKernel* conv_kernel_load(const char* filename) {
+    FILE* file = fopen(filename, "r");
+    if (!file) {
+        fprintf(stderr, "Ошибка открытия файла ядра свертки: %s\n", filename);
+        return NULL;
+    }
+
+    int capacity = 64;
+    int count = 0;
+    float divisor = 1.0f;
+    bool expect_divisor = false;
+    bool ok = true;
+    float* weights = (float*)malloc(capacity * sizeof(float));
+
+    char* line = NULL;
+    size_t line_size = 0;
+    int line_number = 0;
+
+    while (ok && weights && getline(&line, &line_size, file) != -1) {
+        line_number++;
+
+        // Комментарий до конца строки
+        char* comment = strchr(line, '#');
+        if (comment) *comment = '\0';
+
+        char* save = NULL;
+        for (char* token = strtok_r(line, " \t\r\n,;", &save); token && ok;
+             token = strtok_r(NULL, " \t\r\n,;", &save)) {
+            float value;
+
+            // Делитель: "/ 16" или "/16"
+            if (token[0] == '/') {
+                expect_divisor = true;
+                if (token[1] == '\0') continue;
+                token++;
+            }
+
+            if (!parse_weight(token, &value)) {
+                fprintf(stderr, "Ошибка в файле ядра %s, строка %d: '%s' не число\n",
+                        filename, line_number, token);
+                ok = false;
+                break;
+            }
+
+            if (!weight_finite(filename, line_number, token, value)) {
+                ok = false;
+                break;
+            }
+
+            if (expect_divisor) {
+                divisor = value;
+                expect_divisor = false;
+                continue;
+            }
+
+            if (count == capacity) {
+                capacity *= 2;
+                float* grown = (float*)realloc(weights, capacity * sizeof(float));
+                if (!grown) {
+                    free(weights);
+                    weights = NULL;
+                    break;
+                }
+                weights = grown;
+            }
+            weights[count++] = value;
+        }
+    }
+
+    free(line);
+    fclose(file);
+
+    if (!weights) {
+        fprintf(stderr, "Ошибка выделения памяти для ядра свертки\n");
+        return NULL;
+    }
+
+    // Квадрат нечетного размера
+    int size = (int)lround(sqrt((double)count));
+    if (ok && (count == 0 || size * size != count || size % 2 == 0 || size > CONV_MAX_SIZE)) {
+        fprintf(stderr, "Ошибка: ядро %s должно быть квадратом нечетного размера "
+                "до %d (чисел: %d)\n", filename, CONV_MAX_SIZE, count);
+        ok = false;
+    }
+
+    if (ok && (expect_divisor || divisor == 0.0f)) {
+        fprintf(stderr, "Ошибка: некорректный делитель ядра %s\n", filename);
+        ok = false;
+    }
+
+    for (int i = 0; i < count && ok; i++) {
+        weights[i] /= divisor;
+        if (!isfinite(weights[i])) {
+            fprintf(stderr, "Ошибка: коэффициент ядра %s после деления на %g "
+                    "не конечное число float\n", filename, divisor);
+            ok = false;
+        }
+    }
+
+    ConvKernel* kernel = ok ? (ConvKernel*)malloc(sizeof(ConvKernel)) : NULL;
+    if (!kernel) {
+        if (ok) fprintf(stderr, "Ошибка выделения памяти для ядра свертки\n");
+        free(weights);
+        return NULL;
+    }
+
+    kernel->weights = weights;
+    kernel->size = size;
+    return kernel;
+}
+
+void conv_kernel_free(ConvKernel* kernel) {
+    if (kernel) {
+        free(kernel->weights);
+        free(kernel);
+    }
+}
+
+// Выбор метода
+//  Разделимое ядро (ранг 1, K = u * v^T) - два 1D прохода, O(2k) на пиксель;
+//  небольшое неразделимое - прямая свертка, O(k²) на пиксель;
+//  большое неразделимое - через БПФ плитками (overlap-save), O(log k).
+//  IMAGECRAFT_CONV=direct|separable|fft задает метод (separable - только
+//  для разделимых ядер), чтобы сравнивать реализации
+
+// Разложение K = column * row^T по строке и столбцу наибольшего коэффициента
+// false, если ядро не разделимо (с точностью CONV_SEPARABLE_EPS)
+static bool separate_kernel(const float* kernel, int size, float* column, float* row) {
+    int pivot = 0;
+    float largest = 0.0f;
+    for (int i = 0; i < size * size; i++) {
+        if (fabsf(kernel[i]) > largest) {
+            largest = fabsf(kernel[i]);
+            pivot = i;
+        }
+    }
+    if (largest == 0.0f) return false;
+
+    int pivot_row = pivot / size;
+    int pivot_column = pivot % size;
+
+    for (int i = 0; i < size; i++) {
+        column[i] = kernel[i * size + pivot_column];
+        row[i] = kernel[pivot_row * size + i] / kernel[pivot];
+    }
+
+    for (int y = 0; y < size; y++) {
+        for (int x = 0; x < size; x++) {
+            if (fabsf(kernel[y * size + x] - column[y] * row[x]) > CONV_SEPARABLE_EPS * largest) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+ConvMethod conv_method(const float* kernel, int size) {
+    float column[CONV_MAX_SIZE], row[CONV_MAX_SIZE];
+    bool separable = size > 1 && size <= CONV_MAX_SIZE &&
+                     separate_kernel(kernel, size, column, row);
+
+    // Принудительный выбор для сравнения реализаций
+    const char* forced = getenv("IMAGECRAFT_CONV");
+    if (forced) {
+        if (strcmp(forced, "direct") == 0) return CONV_DIRECT;
+        if (strcmp(forced, "fft") == 0) return CONV_FFT;
+        if (strcmp(forced, "separable") == 0 && separable) return CONV_SEPARABLE;
+    }
+
+    if (separable) return CONV_SEPARABLE;
+    return size >= CONV_FFT_MIN_SIZE ? CONV_FFT : CONV_DIRECT;
+}
+
+const char* conv_method_name(ConvMethod method) {
+    switch (method) {
+        case CONV_SEPARABLE: return "разделимая";
+        case CONV_FFT:       return "БПФ";
+        default:             return "прямая";
+    }
+}
+
+// Прямая и разделимая свертка
+//  Оба метода читают планарную копию с рамкой радиуса ядра (повтор краев),
+//  поэтому внутренний цикл идет без проверок границ: строка результата
+//  обрабатывается отрезками по CONV_TILE_WIDTH float, сумма отрезка
+//  держится в регистрах, пока перебираются все коэффициенты. Результат
+//  ограничивается в [0, 1], как в apply_convolution
+
+// Параметры проходов по планарной копии
+typedef struct {
+    const PlanarImage* source; // Источник с рамкой радиуса ядра
+    Image* target;             // Результат
+    const float* kernel;       // Ядро size x size (прямая свертка)
+    const float* column;       // Вертикальный множитель u (разделимое ядро)
+    const float* row;          // Горизонтальный множитель v (разделимое ядро)
+    int size;                  // Размер ядра
+    atomic_bool failed;        // Ошибка выделения памяти в одной из полос
+} ConvPass;
+
+// Упаковка плоскостей строки в Color с ограничением в [0, 1]
+static void store_row(const float* out, Color* dst, uint32_t width) {
+    for (uint32_t x = 0; x < width; x++) {
+        dst[x].r = out[x];
+        dst[x].g = out[width + x];
+        dst[x].b = out[2 * (size_t)width + x];
+    }
+    simd_clamp((float*)dst, (size_t)width * 3);
+}
+
+static void direct_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    ConvPass* pass = (ConvPass*)ctx;
+    const PlanarImage* src = pass->source;
+    uint32_t width = src->width;
+    int size = pass->size;
+    int r = size / 2;
+
+    float* out = (float*)malloc((size_t)width * 3 * sizeof(float));
+    if (!out) {
+        atomic_store(&pass->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int c = 0; c < 3; c++) {
+            float* o = out + (size_t)c * width;
+            memset(o, 0, width * sizeof(float));
+
+            // Отрезок результата остается в L1, пока перебираются строки ядра
+            for (uint32_t x0 = 0; x0 < width; x0 += CONV_TILE_WIDTH) {
+                uint32_t n = width - x0 < CONV_TILE_WIDTH ? width - x0 : CONV_TILE_WIDTH;
+                for (int ky = 0; ky < size; ky++) {
+                    const float* line = planar_row(src, c, (int)y + ky - r) + x0 - r;
+                    simd_convolve_row(line, o + x0, n, pass->kernel + ky * size, size);
+                }
+            }
+        }
+        store_row(out, pass->target->data + (size_t)y * width, width);
+    }
+
+    free(out);
+}
+
+// Разделимая свертка строки за один проход по источнику
+//  Вертикальный проход по size строкам источника дает строку с рамкой
+//  r слева и справа (рамка источника уже повторяет края), горизонтальный
+//  проход по ней - строку результата. Промежуточное изображение не нужно
+static void separable_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    ConvPass* pass = (ConvPass*)ctx;
+    const PlanarImage* src = pass->source;
+    uint32_t width = src->width;
+    int size = pass->size;
+    int r = size / 2;
+    uint32_t padded = width + 2 * (uint32_t)r;
+
+    float* out = (float*)malloc((size_t)width * 3 * sizeof(float));
+    float* line = (float*)malloc((size_t)padded * sizeof(float));
+    const float** rows = (const float**)malloc((size_t)size * sizeof(float*));
+    if (!out || !line || !rows) {
+        free(out);
+        free(line);
+        free(rows);
+        atomic_store(&pass->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int c = 0; c < 3; c++) {
+            memset(line, 0, padded * sizeof(float));
+            for (uint32_t x0 = 0; x0 < padded; x0 += CONV_TILE_WIDTH) {
+                uint32_t n = padded - x0 < CONV_TILE_WIDTH ? padded - x0 : CONV_TILE_WIDTH;
+                for (int i = 0; i < size; i++) {
+                    rows[i] = planar_row(src, c, (int)y + i - r) + x0 - r;
+                }
+                simd_convolve_column(rows, line + x0, n, pass->column, size);
+            }
+
+            float* o = out + (size_t)c * width;
+            memset(o, 0, width * sizeof(float));
+            simd_convolve_row(line, o, width, pass->row, size);
+        }
+        store_row(out, pass->target->data + (size_t)y * width, width);
+    }
+
+    free(rows);
+    free(line);
+    free(out);
+}
+
+static bool convolve_direct(const PlanarImage* planar, Image* result,
+                            const float* kernel, int size) {
+    ConvPass pass = { .source = planar, .target = result, .kernel = kernel, .size = size };
+    atomic_init(&pass.failed, false);
+    parallel_for_rows(result->height, direct_band, &pass);
+    return !atomic_load(&pass.failed);
+}
+
+static bool convolve_separable(const PlanarImage* planar, Image* result,
+                               const float* column, const float* row, int size) {
+    ConvPass pass = { .source = planar, .target = result,
+                      .column = column, .row = row, .size = size };
+    atomic_init(&pass.failed, false);
+    parallel_for_rows(result->height, separable_band, &pass);
+    return !atomic_load(&pass.failed);
+}
+
+// Свертка через БПФ
+
+// План БПФ длины size (степень двойки)
+typedef struct {
+    int size;                  // Длина преобразования
+    int* reverse;              // Перестановка с обращением битов
+    float* cos_table;          // cos(2πk / size), k < size / 2
+    float* sin_table;          // sin(2πk / size)
+} FftPlan;
+
+static void fft_plan_free(FftPlan* plan) {
+    free(plan->reverse);
+    free(plan->cos_table);
+    free(plan->sin_table);
+}
+
+static bool fft_plan_init(FftPlan* plan, int size) {
+    plan->size = size;
+    plan->reverse = (int*)malloc(size * sizeof(int));
+    plan->cos_table = (float*)malloc((size / 2) * sizeof(float));
+    plan->sin_table = (float*)malloc((size / 2) * sizeof(float));
+    if (!plan->reverse || !plan->cos_table || !plan->sin_table) {
+        fft_plan_free(plan);
+        return false;
+    }
+
+    int bits = 0;
+    while ((1 << bits) < size) bits++;
+
+    for (int i = 0; i < size; i++) {
+        int reversed = 0;
+        for (int b = 0; b < bits; b++) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        plan->reverse[i] = reversed;
+    }
+
+    for (int k = 0; k < size / 2; k++) {
+        double angle = 2.0 * M_PI * k / size;
+        plan->cos_table[k] = (float)cos(angle);
+        plan->sin_table[k] = (float)sin(angle);
+    }
+    return true;
+}
+
+// Комплексное БПФ на месте (radix-2), обратное - без деления на длину
+static void fft_1d(float* re, float* im, const FftPlan* plan, bool inverse) {
+    int n = plan->size;
+
+    for (int i = 0; i < n; i++) {
+        int j = plan->reverse[i];
+        if (i < j) {
+            float t = re[i]; re[i] = re[j]; re[j] = t;
+            t = im[i]; im[i] = im[j]; im[j] = t;
+        }
+    }
+
+    for (int length = 2; length <= n; length <<= 1) {
+        int half = length / 2;
+        int step = n / length;
+        for (int i = 0; i < n; i += length) {
+            for (int k = 0; k < half; k++) {
+                float wr = plan->cos_table[k * step];
+                float wi = inverse ? plan->sin_table[k * step] : -plan->sin_table[k * step];
+                int a = i + k;
+                int b = a + half;
+                float tr = re[b] * wr - im[b] * wi;
+                float ti = re[b] * wi + im[b] * wr;
+                re[b] = re[a] - tr;
+                im[b] = im[a] - ti;
+                re[a] += tr;
+                im[a] += ti;
+            }
+        }
+    }
+}
+
+// БПФ первых rows строк массива n x n
+static void fft_rows(float* re, float* im, int rows, const FftPlan* plan, bool inverse) {
+    int n = plan->size;
+    for (int y = 0; y < rows; y++) {
+        fft_1d(re + (size_t)y * n, im + (size_t)y * n, plan, inverse);
+    }
+}
+
+// БПФ всех столбцов массива n x n
+//  Та же схема бабочек, что в fft_1d, но элемент - целая строка: внутренний
+//  цикл идет по строке подряд и векторизуется, столбцы не копируются
+static void fft_columns(float* re, float* im, const FftPlan* plan, bool inverse) {
+    int n = plan->size;
+
+    for (int i = 0; i < n; i++) {
+        int j = plan->reverse[i];
+        if (i < j) {
+            float* ri = re + (size_t)i * n;
+            float* rj = re + (size_t)j * n;
+            float* ii = im + (size_t)i * n;
+            float* ij = im + (size_t)j * n;
+            for (int x = 0; x < n; x++) {
+                float t = ri[x]; ri[x] = rj[x]; rj[x] = t;
+                t = ii[x]; ii[x] = ij[x]; ij[x] = t;
+            }
+        }
+    }
+
+    for (int length = 2; length <= n; length <<= 1) {
+        int half = length / 2;
+        int step = n / length;
+        for (int i = 0; i < n; i += length) {
+            for (int k = 0; k < half; k++) {
+                float wr = plan->cos_table[k * step];
+                float wi = inverse ? plan->sin_table[k * step] : -plan->sin_table[k * step];
+                float* ar = re + (size_t)(i + k) * n;
+                float* ai = im + (size_t)(i + k) * n;
+                float* br = ar + (size_t)half * n;
+                float* bi = ai + (size_t)half * n;
+                for (int x = 0; x < n; x++) {
+                    float tr = br[x] * wr - bi[x] * wi;
+                    float ti = br[x] * wi + bi[x] * wr;
+                    br[x] = ar[x] - tr;
+                    bi[x] = ai[x] - ti;
+                    ar[x] += tr;
+                    ai[x] += ti;
+                }
+            }
+        }
+    }
+}
+
+// Параметры свертки плитками (overlap-save)
+//  Плитка tile x tile входа дает valid x valid пикселей результата,
+//  valid = tile - 2 * radius. Каналы R и G упакованы в одно комплексное
+//  преобразование (ядро вещественное), B - во второе
+typedef struct {
+    const PlanarImage* source; // Источник с рамкой радиуса ядра
+    Image* target;             // Результат
+    const FftPlan* plan;       // План БПФ длины tile
+    const float* spectrum_re;  // Спектр отраженного ядра, деленный на tile²
+    const float* spectrum_im;
+    int radius;                // Радиус ядра
+    int valid;                 // Пикселей результата на плитку по стороне
+    uint32_t tiles_x;          // Плиток по ширине
+    atomic_bool failed;        // Ошибка выделения памяти в одной из полос
+} FftPass;
+
+static inline float clamp01(float v) {
+    if (v < 0.0f) return 0.0f;
+    if (v > 1.0f) return 1.0f;
+    return v;
+}
+
+// Загрузка плитки каналов channel_re (+ i * channel_im, если >= 0)
+static void fft_load_tile(const FftPass* pass, float* re, float* im,
+                          int channel_re, int channel_im, int ox, int oy) {
+    const PlanarImage* src = pass->source;
+    int n = pass->plan->size;
+    int r = pass->radius;
+    int limit_x = (int)src->width + r;     // Рамка справа кончается здесь
+    int limit_y = (int)src->height + r;
+
+    int count = limit_x - (ox - r);
+    if (count > n) count = n;
+
+    for (int yy = 0; yy < n; yy++) {
+        float* dre = re + (size_t)yy * n;
+        float* dim = im + (size_t)yy * n;
+        int py = oy - r + yy;
+
+        if (py >= limit_y) {
+            memset(dre, 0, n * sizeof(float));
+            memset(dim, 0, n * sizeof(float));
+            continue;
+        }
+
+        const float* sre = planar_row(src, channel_re, py) + ox - r;
+        memcpy(dre, sre, count * sizeof(float));
+        memset(dre + count, 0, (n - count) * sizeof(float));
+
+        if (channel_im >= 0) {
+            memcpy(dim, planar_row(src, channel_im, py) + ox - r, count * sizeof(float));
+            memset(dim + count, 0, (n - count) * sizeof(float));
+        } else {
+            memset(dim, 0, n * sizeof(float));
+        }
+    }
+}
+
+static void fft_band(void* ctx, uint32_t ty_begin, uint32_t ty_end) {
+    FftPass* pass = (FftPass*)ctx;
+    int n = pass->plan->size;
+    int valid = pass->valid;
+    uint32_t width = pass->target->width;
+    uint32_t height = pass->target->height;
+    size_t cells = (size_t)n * n;
+
+    float* re = (float*)malloc(cells * sizeof(float));
+    float* im = (float*)malloc(cells * sizeof(float));
+    if (!re || !im) {
+        free(re);
+        free(im);
+        atomic_store(&pass->failed, true);
+        return;
+    }
+
+    for (uint32_t ty = ty_begin; ty < ty_end; ty++) {
+        for (uint32_t tx = 0; tx < pass->tiles_x; tx++) {
+            int ox = (int)tx * valid;
+            int oy = (int)ty * valid;
+            uint32_t out_w = width - (uint32_t)ox < (uint32_t)valid ? width - (uint32_t)ox
+                                                                     : (uint32_t)valid;
+            uint32_t out_h = height - (uint32_t)oy < (uint32_t)valid ? height - (uint32_t)oy
+                                                                      : (uint32_t)valid;
+
+            for (int packed = 0; packed < 2; packed++) {
+                // packed 0: R + iG, packed 1: B
+                fft_load_tile(pass, re, im, packed ? 2 : 0, packed ? -1 : 1, ox, oy);
+                fft_rows(re, im, n, pass->plan, false);
+                fft_columns(re, im, pass->plan, false);
+
+                for (size_t i = 0; i < cells; i++) {
+                    float a = re[i], b = im[i];
+                    float c = pass->spectrum_re[i], d = pass->spectrum_im[i];
+                    re[i] = a * c - b * d;
+                    im[i] = a * d + b * c;
+                }
+
+                // Обратно: столбцы, затем только строки, попадающие в результат
+                fft_columns(re, im, pass->plan, true);
+                fft_rows(re, im, (int)out_h, pass->plan, true);
+
+                for (uint32_t yy = 0; yy < out_h; yy++) {
+                    Color* dst = pass->target->data + (size_t)(oy + yy) * width + ox;
+                    const float* sre = re + (size_t)yy * n;
+                    const float* sim = im + (size_t)yy * n;
+                    for (uint32_t xx = 0; xx < out_w; xx++) {
+                        if (packed) {
+                            dst[xx].b = clamp01(sre[xx]);
+                        } else {
+                            dst[xx].r = clamp01(sre[xx]);
+                            dst[xx].g = clamp01(sim[xx]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free(im);
+    free(re);
+}
+
+// Размер плитки - наименьшая оценка работы на пиксель результата:
+//  n² log n на плитку, полезны (n - 2r)² пикселей
+static int fft_tile_size(int r) {
+    int n = 0;
+    double best = 0.0;
+    for (int tile = CONV_FFT_MIN_TILE; tile <= CONV_FFT_MAX_TILE; tile *= 2) {
+        if (tile <= 2 * r) continue;
+        double valid = (double)(tile - 2 * r);
+        double cost = (double)tile * tile * log2((double)tile) / (valid * valid);
+        if (n == 0 || cost < best) {
+            n = tile;
+            best = cost;
+        }
+    }
+    return n;
+}
+
+// Спектр отраженного ядра для плитки n x n (план fft длины n)
+static bool fft_kernel_spectrum(const FftPlan* plan, const float* kernel, int size,
+                                float** spectrum_re, float** spectrum_im) {
+    int n = plan->size;
+    size_t cells = (size_t)n * n;
+    float* re = (float*)calloc(cells, sizeof(float));
+    float* im = (float*)calloc(cells, sizeof(float));
+    if (!re || !im) {
+        free(re);
+        free(im);
+        return false;
+    }
+
+    // Отраженное ядро: корреляция out[x] = sum K[j] * in[x + j - r]
+    // становится круговой сверткой; деление на n² - нормировка обратного БПФ
+    float scale = 1.0f / (float)cells;
+    for (int jy = 0; jy < size; jy++) {
+        for (int jx = 0; jx < size; jx++) {
+            size_t index = (size_t)((n - jy) % n) * n + (size_t)((n - jx) % n);
+            re[index] = kernel[jy * size + jx] * scale;
+        }
+    }
+    fft_rows(re, im, n, plan, false);
+    fft_columns(re, im, plan, false);
+
+    *spectrum_re = re;
+    *spectrum_im = im;
+    return true;
+}
+
+static bool convolve_fft(const PlanarImage* planar, Image* result, const FftPlan* plan,
+                         const float* spectrum_re, const float* spectrum_im, int size) {
+    int r = size / 2;
+    int valid = plan->size - 2 * r;
+    FftPass pass = {
+        .source = planar, .target = result, .plan = plan,
+        .spectrum_re = spectrum_re, .spectrum_im = spectrum_im,
+        .radius = r, .valid = valid,
+        .tiles_x = (result->width + valid - 1) / valid
+    };
+    atomic_init(&pass.failed, false);
+    parallel_for_rows((result->height + valid - 1) / valid, fft_band, &pass);
+    return !atomic_load(&pass.failed);
+}
+
+// Подготовленная свертка
+//  Все, что зависит только от ядра (множители разделимого ядра, таблицы БПФ
+//  и спектр ядра), строится один раз для многих изображений - шаг
+//  скомпилированного конвейера
+
+struct ConvPlan {
+    ConvMethod method;         // Метод
+    int size;                  // Размер ядра
+    float* kernel;             // Копия ядра size x size
+    float* column;             // Множители разделимого ядра (CONV_SEPARABLE)
+    float* row;
+    FftPlan fft;               // План БПФ длины плитки (CONV_FFT)
+    float* spectrum_re;        // Спектр отраженного ядра (CONV_FFT)
+    float* spectrum_im;
+};
+
+ConvPlan* conv_plan_create(const float* kernel, int size) {
+    if (!kernel || size < 1 || size % 2 == 0 || size > CONV_MAX_SIZE) {
+        fprintf(stderr, "Ошибка: некорректные параметры для свертки\n");
+        return NULL;
+    }
+
+    ConvPlan* plan = (ConvPlan*)calloc(1, sizeof(ConvPlan));
+    if (!plan) {
+        fprintf(stderr, "Ошибка выделения памяти для свертки\n");
+        return NULL;
+    }
+
+    plan->size = size;
+    plan->method = conv_method(kernel, size);
+    plan->kernel = (float*)malloc((size_t)size * size * sizeof(float));
+    bool ok = plan->kernel != NULL;
+    if (ok) memcpy(plan->kernel, kernel, (size_t)size * size * sizeof(float));
+
+    if (ok && plan->method == CONV_SEPARABLE) {
+        plan->column = (float*)malloc((size_t)size * sizeof(float));
+        plan->row = (float*)malloc((size_t)size * sizeof(float));
+        ok = plan->column && plan->row;
+        if (ok) separate_kernel(kernel, size, plan->column, plan->row);
+    }
+
+    if (ok && plan->method == CONV_FFT) {
+        ok = fft_plan_init(&plan->fft, fft_tile_size(size / 2)) &&
+             fft_kernel_spectrum(&plan->fft, kernel, size,
+                                 &plan->spectrum_re, &plan->spectrum_im);
+    }
+
+    if (!ok) {
+        fprintf(stderr, "Ошибка выделения памяти для свертки\n");
+        conv_plan_free(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+void conv_plan_free(ConvPlan* plan) {
+    if (!plan) return;
+
+    free(plan->kernel);
+    free(plan->column);
+    free(plan->row);
+    fft_plan_free(&plan->fft);
+    free(plan->spectrum_re);
+    free(plan->spectrum_im);
+    free(plan);
+}
+
+ConvMethod conv_plan_method(const ConvPlan* plan) {
+    return plan->method;
+}
+
+int conv_plan_size(const ConvPlan* plan) {
+    return plan->size;
+}
+
+// Свертка изображения
+
+Image* convolve_plan(const Image* image, const ConvPlan* plan) {
+    if (!image || !image->data || !plan) {
+        fprintf(stderr, "Ошибка: некорректные параметры для свертки\n");
+        return NULL;
+    }
+
+    int size = plan->size;
+    PlanarImage* planar = planar_from_image(image, (uint32_t)(size / 2));
+    if (!planar) {
+        return NULL;
+    }
+
+    Image* result = image_create_uninit(image->width, image->height);
+    if (!result) {
+        planar_free(planar);
+        return NULL;
+    }
+
+    bool ok;
+    switch (plan->method) {
+        case CONV_SEPARABLE:
+            ok = convolve_separable(planar, result, plan->column, plan->row, size);
+            break;
+        case CONV_FFT:
+            ok = convolve_fft(planar, result, &plan->fft,
+                              plan->spectrum_re, plan->spectrum_im, size);
+            break;
+        default:
+            ok = convolve_direct(planar, result, plan->kernel, size);
+            break;
+    }
+
+    planar_free(planar);
+
+    if (!ok) {
+        fprintf(stderr, "Ошибка выделения памяти для свертки\n");
+        image_free(result);
+        return NULL;
+    }
+    return result;
+}
+
+Image* convolve(const Image* image, const float* kernel, int size) {
+    ConvPlan* plan = conv_plan_create(kernel, size);
+    if (!plan) {
+        return NULL;
+    }
+
+    Image* result = convolve_plan(image, plan);
+    conv_plan_free(plan);
+    return result;
+}
+
+// Фильтр -conv
+
+bool filter_convolution(Image* image, const char* kernel_file) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+
+    ConvKernel* kernel = conv_kernel_load(kernel_file);
+    if (!kernel) {
+        return false;
+    }
+
+    ConvPlan* plan = conv_plan_create(kernel->weights, kernel->size);
+    conv_kernel_free(kernel);
+    if (!plan) {
+        return false;
+    }
+
+    bool ok = filter_convolution_plan(image, plan);
+    conv_plan_free(plan);
+    return ok;
+}
+
+bool filter_convolution_plan(Image* image, const ConvPlan* plan) {
+    if (!image || !image->data || !plan) {
+        fprintf(stderr, "Ошибка: изображение или ядро не инициализированы\n");
+        return false;
+    }
+
+    // Ядра 3x3 идут через векторную свертку на месте
+    if (plan->size == 3) {
+        if (!apply_convolution_in_place(image, plan->kernel, 3)) {
+            fprintf(stderr, "Ошибка применения свертки\n");
+            return false;
+        }
+    } else {
+        Image* result = convolve_plan(image, plan);
+        if (!result) {
+            fprintf(stderr, "Ошибка применения свертки\n");
+            return false;
+        }
+        image_replace(image, result);
+    }
+
+    ConvMethod method = plan->size == 3 ? CONV_DIRECT : plan->method;
+    printf("Convolution: ядро %dx%d (%s), размер %ux%u\n",
+           plan->size, plan->size, conv_method_name(method), image->width, image->height);
+
+    return true;
+}
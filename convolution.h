@@ -0,0 +1,65 @@
+// Свертка с ядром произвольного размера (метод выбирается по ядру)
+// IMAGECRAFT_CONV=direct|separable|fft задает метод принудительно
+
+#ifndef CONVOLUTION_H
+#define CONVOLUTION_H
+
+#include "image.h"
+#include <stdbool.h>
+
+#define CONV_MAX_SIZE 255          // Наибольший размер ядра
+#define CONV_FFT_MIN_SIZE 31       // С этого размера неразделимое ядро идет через БПФ
+#define CONV_TILE_WIDTH 1024       // Отрезок строки прямой свертки (float)
+
+// Ядро свертки
+typedef struct {
+    float* weights;            // size x size коэффициентов по строкам
+    int size;                  // Размер стороны (нечетный)
+} ConvKernel;
+
+// Метод свертки
+typedef enum {
+    CONV_DIRECT,               // Прямая свертка
+    CONV_SEPARABLE,            // Два 1D прохода
+    CONV_FFT                   // БПФ плитками
+} ConvMethod;
+
+// Загрузка ядра из текстового файла
+//  Числа через пробелы, запятые или переводы строк (size² чисел, size нечетный),
+//  комментарии от '#' до конца строки, "/ D" делит все коэффициенты на D:
+//   # тиснение
+//   -2 -1 0
+//   -1  1 1
+//    0  1 2
+ConvKernel* conv_kernel_load(const char* filename);
+
+// Освобождение ядра
+void conv_kernel_free(ConvKernel* kernel);
+
+// Метод, которым будет выполнена свертка с ядром
+ConvMethod conv_method(const float* kernel, int size);
+
+// Подготовленная свертка: метод и данные ядра, при свертке только читается
+typedef struct ConvPlan ConvPlan;
+
+ConvPlan* conv_plan_create(const float* kernel, int size);
+void conv_plan_free(ConvPlan* plan);
+ConvMethod conv_plan_method(const ConvPlan* plan);
+int conv_plan_size(const ConvPlan* plan);
+
+// Имя метода для вывода
+const char* conv_method_name(ConvMethod method);
+
+// Свертка изображения, результат - новое изображение
+Image* convolve(const Image* image, const float* kernel, int size);
+
+// Свертка подготовленным ядром, результат - новое изображение
+Image* convolve_plan(const Image* image, const ConvPlan* plan);
+
+// Фильтр -conv: свертка с ядром из файла
+bool filter_convolution(Image* image, const char* kernel_file);
+
+// Свертка подготовленным ядром (результат тот же, что у filter_convolution)
+bool filter_convolution_plan(Image* image, const ConvPlan* plan);
+
+#endif
@@ -1,10 +1,13 @@
 #include "extra_filters.h"
 #include "utils.h"
+#include "parallel.h"
+#include "simd.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
-#include <time.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 // Вспомогательные функции
 
@@ -72,7 +75,121 @@ Color bilinear_interpolation(const Image* image, float x, float y) {
 
 // 1. Crystallize фильтр
 
-bool filter_crystallize(Image* image, int cell_size) {
+// Опорная точка кристалла
+typedef struct {
+    int64_t x, y;              // Координаты (могут лежать за правым и нижним краем)
+    Color color;               // Цвет кристалла
+} CrystalSeed;
+
+// Параметры полос crystallize
+typedef struct {
+    const Image* source;       // Источник
+    Image* target;             // Результат
+    CrystalSeed* seeds;        // Опорные точки, cols x rows
+    uint32_t cols;             // Ячеек сетки по горизонтали
+    uint32_t rows;             // Ячеек сетки по вертикали
+    int cell_size;             // Шаг сетки
+    uint32_t seed;             // Зерно генератора (-seed)
+} CrystalBand;
+
+// Опорные точки строк сетки [y_begin, y_end)
+//  Точка ячейки (gx, gy) - случайный сдвиг внутри ячейки, цвет - пиксель
+//  под точкой со случайным оттенком. Все зависит только от seed и номера
+//  ячейки, но не от размера изображения: обрезка не меняет кристаллы
+static void crystal_seeds_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    CrystalBand* band = (CrystalBand*)ctx;
+    const Image* src = band->source;
+    uint32_t cell = (uint32_t)band->cell_size;
+
+    for (uint32_t gy = y_begin; gy < y_end; gy++) {
+        for (uint32_t gx = 0; gx < band->cols; gx++) {
+            CrystalSeed* seed = &band->seeds[(size_t)gy * band->cols + gx];
+            seed->x = (int64_t)gx * cell + hash_u32(band->seed, gx, gy, 0) % cell;
+            seed->y = (int64_t)gy * cell + hash_u32(band->seed, gx, gy, 1) % cell;
+
+            // Точка за краем изображения берет цвет ближайшего пикселя
+            uint32_t sx = seed->x < (int64_t)src->width ? (uint32_t)seed->x : src->width - 1;
+            uint32_t sy = seed->y < (int64_t)src->height ? (uint32_t)seed->y : src->height - 1;
+            Color color = src->data[(size_t)sy * src->width + sx];
+
+            // Небольшой случайный оттенок для разнообразия
+            float hue_shift = -0.05f + (float)(hash_u32(band->seed, gx, gy, 2) >> 8) /
+                                       16777216.0f * 0.1f;
+            color.r = fminf(1.0f, fmaxf(0.0f, color.r + hue_shift));
+            color.g = fminf(1.0f, fmaxf(0.0f, color.g + hue_shift));
+            color.b = fminf(1.0f, fmaxf(0.0f, color.b + hue_shift));
+            seed->color = color;
+        }
+    }
+}
+
+// Пиксели строк [y_begin, y_end): ближайшая опорная точка среди 3x3 ячеек
+//  Кандидаты одинаковы для всех пикселей отрезка строки внутри одной ячейки,
+//  поэтому собираются один раз на отрезок. Пиксели на границе кристаллов
+//  (вторая точка дальше ближайшей меньше чем на пиксель) смешиваются с
+//  исходным цветом 50/50
+static void crystal_pixels_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    CrystalBand* band = (CrystalBand*)ctx;
+    const Image* src = band->source;
+    uint32_t width = src->width;
+    uint32_t cell = (uint32_t)band->cell_size;
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const Color* src_row = src->data + (size_t)y * width;
+        Color* dst_row = band->target->data + (size_t)y * width;
+        uint32_t gy = y / cell;
+
+        for (uint32_t gx = 0; gx < band->cols; gx++) {
+            const CrystalSeed* candidates[9];
+            int64_t candidate_x[9];
+            int64_t candidate_dy2[9];   // Квадрат расстояния по y: один на всю строку
+            int count = 0;
+            for (uint32_t ny = gy > 0 ? gy - 1 : 0; ny <= gy + 1 && ny < band->rows; ny++) {
+                for (uint32_t nx = gx > 0 ? gx - 1 : 0; nx <= gx + 1 && nx < band->cols; nx++) {
+                    const CrystalSeed* seed = &band->seeds[(size_t)ny * band->cols + nx];
+                    int64_t dy = seed->y - (int64_t)y;
+                    candidates[count] = seed;
+                    candidate_x[count] = seed->x;
+                    candidate_dy2[count] = dy * dy;
+                    count++;
+                }
+            }
+
+            uint32_t x_begin = gx * cell;
+            uint32_t x_end = width - x_begin > cell ? x_begin + cell : width;
+            for (uint32_t x = x_begin; x < x_end; x++) {
+                int64_t nearest = INT64_MAX, second = INT64_MAX;
+                int owner = 0;
+
+                for (int i = 0; i < count; i++) {
+                    int64_t dx = candidate_x[i] - (int64_t)x;
+                    int64_t distance = dx * dx + candidate_dy2[i];
+                    if (distance < nearest) {
+                        second = nearest;
+                        nearest = distance;
+                        owner = i;
+                    } else if (distance < second) {
+                        second = distance;
+                    }
+                }
+
+                const Color* color = &candidates[owner]->color;
+                if (second != INT64_MAX &&
+                    sqrtf((float)second) - sqrtf((float)nearest) < 1.0f) {
+                    Color blended;
+                    blended.r = (src_row[x].r + color->r) * 0.5f;
+                    blended.g = (src_row[x].g + color->g) * 0.5f;
+                    blended.b = (src_row[x].b + color->b) * 0.5f;
+                    dst_row[x] = color_clamp(blended);
+                } else {
+                    dst_row[x] = *color;
+                }
+            }
+        }
+    }
+}
+
+bool filter_crystallize(Image* image, int cell_size, uint32_t seed) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
         return false;
@@ -90,80 +207,200 @@ bool filter_crystallize(Image* image, int cell_size) {
     
     uint32_t width = image->width;
     uint32_t height = image->height;
+    uint32_t cols = (width + (uint32_t)cell_size - 1) / (uint32_t)cell_size;
+    uint32_t rows = (height + (uint32_t)cell_size - 1) / (uint32_t)cell_size;
     
-    // Создаем копию для чтения
-    Image* copy = image_copy(image);
-    if (!copy) {
-        fprintf(stderr, "Ошибка создания копии изображения\n");
+    // Результат пишется в новый буфер, источник читается как есть
+    Image* result = image_create_uninit(width, height);
+    CrystalSeed* seeds = (CrystalSeed*)malloc((size_t)cols * rows * sizeof(CrystalSeed));
+    if (!result || !seeds) {
+        fprintf(stderr, "Ошибка выделения памяти для crystallize\n");
+        image_free(result);
+        free(seeds);
         return false;
     }
     
-    // Инициализация случайного генератора
-    srand((unsigned int)time(NULL));
-    
-    // Проходим по всем ячейкам
-    for (uint32_t cell_y = 0; cell_y < height; cell_y += cell_size) {
-        for (uint32_t cell_x = 0; cell_x < width; cell_x += cell_size) {
-            // Определяем границы текущей ячейки
-            uint32_t cell_end_x = cell_x + cell_size;
-            uint32_t cell_end_y = cell_y + cell_size;
-            
-            if (cell_end_x > width) cell_end_x = width;
-            if (cell_end_y > height) cell_end_y = height;
-            
-            // Выбираем случайную точку внутри ячейки
-            uint32_t sample_x = cell_x + (rand() % (cell_end_x - cell_x));
-            uint32_t sample_y = cell_y + (rand() % (cell_end_y - cell_y));
-            
-            // Получаем цвет выбранного пикселя
-            const Color* sample_color = image_get_pixel_const(copy, sample_x, sample_y);
-            if (!sample_color) {
-                sample_color = &(Color){0, 0, 0};
-            }
-            
-            Color cell_color = *sample_color;
-            
-            // Добавляем небольшой случайный оттенок для разнообразия
-            float hue_shift = random_in_range(cell_x, cell_y, -0.05f, 0.05f);
-            cell_color.r = fminf(1.0f, fmaxf(0.0f, cell_color.r + hue_shift));
-            cell_color.g = fminf(1.0f, fmaxf(0.0f, cell_color.g + hue_shift));
-            cell_color.b = fminf(1.0f, fmaxf(0.0f, cell_color.b + hue_shift));
-            
-            // Заполняем всю ячейку выбранным цветом
-            for (uint32_t y = cell_y; y < cell_end_y; y++) {
-                for (uint32_t x = cell_x; x < cell_end_x; x++) {
-                    // Для пикселей по краям ячейки делаем плавный переход
-                    if (x == cell_x || x == cell_end_x - 1 || 
-                        y == cell_y || y == cell_end_y - 1) {
-                        
-                        // Получаем оригинальный цвет
-                        const Color* original = image_get_pixel_const(copy, x, y);
-                        if (original) {
-                            // Смешиваем с цветом ячейки (50/50)
-                            Color blended;
-                            blended.r = (original->r + cell_color.r) * 0.5f;
-                            blended.g = (original->g + cell_color.g) * 0.5f;
-                            blended.b = (original->b + cell_color.b) * 0.5f;
-                            image_set_pixel(image, x, y, blended);
-                        }
-                    } else {
-                        // Внутренние пиксели - чистый цвет ячейки
-                        image_set_pixel(image, x, y, cell_color);
-                    }
-                }
-            }
-        }
-    }
+    CrystalBand band = {
+        .source = image, .target = result, .seeds = seeds,
+        .cols = cols, .rows = rows, .cell_size = cell_size, .seed = seed
+    };
+    parallel_for_rows(rows, crystal_seeds_band, &band);
+    parallel_for_rows(height, crystal_pixels_band, &band);
     
-    image_free(copy);
+    free(seeds);
+    image_replace(image, result);
     
-    printf("Crystallize: размер ячейки %dpx, изображение %ux%u\n", 
-           cell_size, width, height);
+    printf("Crystallize: размер ячейки %dpx, seed %u, изображение %ux%u\n", 
+           cell_size, seed, width, height);
     return true;
 }
 
 // 2. Glass Distortion фильтр
 
+#define GLASS_FREQUENCY 0.05f  // Частота синусоидальных волн
+
+// Шум стекла: дробные части random_in_range для (x, y) и (y, x)
+//  Зависит только от координат, поэтому строка шума одинакова для любого
+//  масштаба и любого изображения, покрывающего эти координаты
+static void glass_noise_row(float* noise, uint32_t y, uint32_t width) {
+    for (uint32_t x = 0; x < width; x++) {
+        noise[x * 2] = random_in_range(x, y, 0.0f, 1.0f);
+        noise[x * 2 + 1] = random_in_range(y, x, 0.0f, 1.0f);
+    }
+}
+
+// Карта шума width x height (пары float на пиксель)
+typedef struct GlassMap {
+    uint32_t width;
+    uint32_t height;
+    float* noise;
+    struct GlassMap* next;
+} GlassMap;
+
+static void glass_map_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    GlassMap* map = (GlassMap*)ctx;
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        glass_noise_row(map->noise + (size_t)y * map->width * 2, y, map->width);
+    }
+}
+
+static GlassMap* glass_map_create(uint32_t width, uint32_t height) {
+    GlassMap* map = (GlassMap*)malloc(sizeof(GlassMap));
+    float* noise = map ? (float*)malloc((size_t)width * height * 2 * sizeof(float)) : NULL;
+    if (!noise) {
+        free(map);
+        return NULL;
+    }
+
+    map->width = width;
+    map->height = height;
+    map->noise = noise;
+    map->next = NULL;
+    parallel_for_rows(height, glass_map_band, map);
+    return map;
+}
+
+// Общие карты шума
+
+static pthread_mutex_t glass_mutex = PTHREAD_MUTEX_INITIALIZER;
+static GlassMap* glass_maps = NULL;
+static bool glass_sharing = false;
+
+void glass_map_sharing_begin(void) {
+    pthread_mutex_lock(&glass_mutex);
+    glass_sharing = true;
+    pthread_mutex_unlock(&glass_mutex);
+}
+
+void glass_map_sharing_end(void) {
+    pthread_mutex_lock(&glass_mutex);
+
+    while (glass_maps) {
+        GlassMap* next = glass_maps->next;
+        free(glass_maps->noise);
+        free(glass_maps);
+        glass_maps = next;
+    }
+    glass_sharing = false;
+
+    pthread_mutex_unlock(&glass_mutex);
+}
+
+// Карта, покрывающая width x height; NULL - общие карты выключены
+// (шум считается по строкам во время фильтра)
+static const GlassMap* glass_map_acquire(uint32_t width, uint32_t height) {
+    pthread_mutex_lock(&glass_mutex);
+
+    const GlassMap* found = NULL;
+    if (glass_sharing) {
+        for (GlassMap* map = glass_maps; map && !found; map = map->next) {
+            if (map->width >= width && map->height >= height) found = map;
+        }
+
+        // Построение под блокировкой: остальные потоки дождутся готовой карты
+        if (!found) {
+            GlassMap* map = glass_map_create(width, height);
+            if (map) {
+                map->next = glass_maps;
+                glass_maps = map;
+                found = map;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&glass_mutex);
+    return found;
+}
+
+// Параметры полосы glass
+//  Смещение точки (x, y):
+//   dx = sin(x*f) * cos(y*f*0.7) * a + шум(x, y)
+//   dy = cos(x*f*0.8) * sin(y*f*1.2) * a + шум(y, x)
+//  Синусы и косинусы разделимы и берутся из таблиц по столбцам и строкам
+typedef struct {
+    const Image* source;       // Источник
+    Image* target;             // Результат
+    const float* sin_x;        // sin(x*f), по столбцам
+    const float* cos_x;        // cos(x*f*0.8)
+    const float* cos_y;        // cos(y*f*0.7), по строкам
+    const float* sin_y;        // sin(y*f*1.2)
+    const GlassMap* map;       // Общая карта шума (NULL - считать по строкам)
+    float amplitude;           // Амплитуда деформации
+    atomic_bool failed;        // Ошибка выделения памяти в одной из полос
+} GlassBand;
+
+static void glass_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    GlassBand* band = (GlassBand*)ctx;
+    uint32_t width = band->source->width;
+    uint32_t height = band->source->height;
+    float amplitude = band->amplitude;
+    float noise_min = -amplitude * 0.3f;
+    float noise_max = amplitude * 0.3f;
+
+    float* xs = (float*)malloc((size_t)width * 2 * sizeof(float));
+    float* row_noise = band->map ? NULL : (float*)malloc((size_t)width * 2 * sizeof(float));
+    if (!xs || (!band->map && !row_noise)) {
+        free(xs);
+        free(row_noise);
+        atomic_store(&band->failed, true);
+        return;
+    }
+    float* ys = xs + width;
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const float* noise;
+        if (band->map) {
+            noise = band->map->noise + (size_t)y * band->map->width * 2;
+        } else {
+            glass_noise_row(row_noise, y, width);
+            noise = row_noise;
+        }
+
+        float cos_y = band->cos_y[y];
+        float sin_y = band->sin_y[y];
+        for (uint32_t x = 0; x < width; x++) {
+            float dx = band->sin_x[x] * cos_y * amplitude;
+            float dy = band->cos_x[x] * sin_y * amplitude;
+
+            // Шум для текстуры стекла, как random_in_range(x, y, min, max)
+            dx += noise_min + noise[x * 2] * (noise_max - noise_min);
+            dy += noise_min + noise[x * 2 + 1] * (noise_max - noise_min);
+
+            // Выход за границы ограничивается в simd_bilinear_rgb
+            xs[x] = (float)x + dx;
+            ys[x] = (float)y + dy;
+        }
+
+        float* dst = (float*)(band->target->data + (size_t)y * width);
+        simd_bilinear_rgb((const float*)band->source->data, width, height,
+                          xs, ys, dst, width);
+        simd_clamp(dst, (size_t)width * 3);
+    }
+
+    free(row_noise);
+    free(xs);
+}
+
 bool filter_glass_distortion(Image* image, float scale) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
@@ -183,56 +420,49 @@ bool filter_glass_distortion(Image* image, float scale) {
     uint32_t width = image->width;
     uint32_t height = image->height;
     
-    // Создаем копию для чтения
-    Image* copy = image_copy(image);
-    if (!copy) {
-        fprintf(stderr, "Ошибка создания копии изображения\n");
+    // Результат пишется в новый буфер, источник читается как есть
+    Image* result = image_create_uninit(width, height);
+    float* tables = (float*)malloc(((size_t)width + height) * 2 * sizeof(float));
+    if (!result || !tables) {
+        fprintf(stderr, "Ошибка выделения памяти для glass\n");
+        image_free(result);
+        free(tables);
         return false;
     }
     
-    // Параметры деформации
-    float frequency = 0.05f;  // Частота синусоидальных волн
-    float amplitude = scale;  // Амплитуда деформации
-    
-    // Применяем деформацию ко всем пикселям
+    // Таблицы синусов по столбцам и строкам
+    float frequency = GLASS_FREQUENCY;
+    float* sin_x = tables;
+    float* cos_x = sin_x + width;
+    float* cos_y = cos_x + width;
+    float* sin_y = cos_y + height;
+    for (uint32_t x = 0; x < width; x++) {
+        sin_x[x] = sinf((float)x * frequency);
+        cos_x[x] = cosf((float)x * frequency * 0.8f);
+    }
     for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            // Вычисляем смещение с помощью синусоидальных функций
-            // Используем разные частоты для X и Y для более естественного эффекта
-            
-            float dx = sinf((float)x * frequency) * 
-                      cosf((float)y * frequency * 0.7f) * amplitude;
-            
-            float dy = cosf((float)x * frequency * 0.8f) * 
-                      sinf((float)y * frequency * 1.2f) * amplitude;
-            
-            // Добавляем немного шума для текстуры стекла
-            float noise_x = random_in_range(x, y, -amplitude * 0.3f, amplitude * 0.3f);
-            float noise_y = random_in_range(y, x, -amplitude * 0.3f, amplitude * 0.3f);
-            
-            dx += noise_x;
-            dy += noise_y;
-            
-            // Новые координаты с учетом деформации
-            float new_x = (float)x + dx;
-            float new_y = (float)y + dy;
-            
-            // Проверяем границы
-            if (new_x < 0.0f) new_x = 0.0f;
-            if (new_y < 0.0f) new_y = 0.0f;
-            if (new_x >= (float)width) new_x = (float)(width - 1);
-            if (new_y >= (float)height) new_y = (float)(height - 1);
-            
-            // Получаем цвет с билинейной интерполяцией для плавности
-            Color distorted_color = bilinear_interpolation(copy, new_x, new_y);
-            
-            // Сохраняем результат
-            image_set_pixel(image, x, y, distorted_color);
-        }
+        cos_y[y] = cosf((float)y * frequency * 0.7f);
+        sin_y[y] = sinf((float)y * frequency * 1.2f);
+    }
+    
+    GlassBand band = {
+        .source = image, .target = result,
+        .sin_x = sin_x, .cos_x = cos_x, .cos_y = cos_y, .sin_y = sin_y,
+        .map = glass_map_acquire(width, height), .amplitude = scale
+    };
+    atomic_init(&band.failed, false);
+    parallel_for_rows(height, glass_band, &band);
+    
+    free(tables);
+    
+    if (atomic_load(&band.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для glass\n");
+        image_free(result);
+        return false;
     }
     
-    image_free(copy);
+    image_replace(image, result);
     
     printf("Glass Distortion: масштаб %.2f, размер %ux%u\n", scale, width, height);
     return true;
-}
\ No newline at end of file
+}
@@ -12,12 +12,16 @@
 
 // 1. Crystallize фильтр
 
-// Изображение разбивается на ячейки заданного размера
-// Внутри каждой ячейки все пиксели принимают цвет одного случайно выбранного пикселя из этой ячейки
-// Создает эффект мозаики из "кристаллов" разного размера
+// Изображение разбивается на кристаллы - ячейки Вороного вокруг опорных
+// точек, случайно сдвинутых внутри ячеек сетки cell_size x cell_size
+// Кристалл закрашивается цветом пикселя под опорной точкой, граница
+// кристаллов смешивается с исходным изображением
+// Случайность - счетчиковый генератор hash_u32 от seed и номера ячейки:
+// результат для одного seed одинаков побайтно при любом числе потоков
 // image Изображение для обработки
-// cell_size Размер ячейки кристаллизации (пикселей)
-bool filter_crystallize(Image* image, int cell_size);
+// cell_size Шаг сетки опорных точек (пикселей)
+// seed Зерно генератора (-seed)
+bool filter_crystallize(Image* image, int cell_size, uint32_t seed);
 
 // 2. Glass Distortion фильтр
 
@@ -30,6 +34,15 @@ bool filter_crystallize(Image* image, int cell_size);
 // scale Масштаб деформации (сила эффекта)
 bool filter_glass_distortion(Image* image, float scale);
 
+// Общие карты шума glass (пакетная обработка)
+//  Шум стекла зависит только от координат пикселя. Между begin и end
+//  filter_glass_distortion считает его один раз для изображений одного
+//  размера (и меньших) и использует во всех вызовах, в том числе из разных
+//  потоков; end освобождает карты и должен вызываться, когда фильтры не
+//  выполняются. Вне begin/end шум считается заново при каждом вызове
+void glass_map_sharing_begin(void);
+void glass_map_sharing_end(void);
+
 // Вспомогательные функции
 
 float random_in_range(int x, int y, float min, float max);
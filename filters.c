@@ -1,9 +1,15 @@
 #include "filters.h"
 #include "utils.h"
+#include "parallel.h"
+#include "median.h"
+#include "simd.h"
+#include "frame_pool.h"
+#include "convolution.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <stdatomic.h>
 
 // Вспомогательные функции
 
@@ -72,16 +78,8 @@ bool filter_crop(Image* image, uint32_t width, uint32_t height) {
         return false;
     }
     
-    // Освобождаем старые данные
-    free(image->data);
-    
-    // Копируем новые данные
-    image->data = cropped->data;
-    image->width = cropped->width;
-    image->height = cropped->height;
-    
-    // Освобождаем структуру (но данные остаются)
-    free(cropped);
+    // Старые данные возвращаются в пул кадров, новые переходят к image
+    image_replace(image, cropped);
     
     printf("Crop: %ux%u -> %ux%u\n", orig_width, orig_height, crop_width, crop_height);
     return true;
@@ -89,67 +87,93 @@ bool filter_crop(Image* image, uint32_t width, uint32_t height) {
 
 // 2. Grayscale фильтр
 
+// Полоса строк для grayscale
+//  Строки полосы лежат в памяти подряд и обрабатываются одним векторным ядром
+//  Формула: 0.299*R + 0.587*G + 0.114*B
+static void grayscale_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Image* image = (Image*)ctx;
+    size_t first = (size_t)y_begin * image->width;
+    size_t pixels = (size_t)(y_end - y_begin) * image->width;
+    
+    simd_grayscale_interleaved((float*)(image->data + first), pixels);
+}
+
 bool filter_grayscale(Image* image) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
         return false;
     }
     
-    uint32_t width = image->width;
-    uint32_t height = image->height;
+    parallel_for_rows(image->height, grayscale_band, image);
     
-    // Коэффициенты для преобразования в оттенки серого
-    // Формула: 0.299*R + 0.587*G + 0.114*B
-    const float R_COEFF = 0.299f;
-    const float G_COEFF = 0.587f;
-    const float B_COEFF = 0.114f;
-    
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color* pixel = image_get_pixel(image, x, y);
-            if (!pixel) continue;
-            
-            // Вычисление яркости по формуле
-            float luminance = 
-                pixel->r * R_COEFF + 
-                pixel->g * G_COEFF + 
-                pixel->b * B_COEFF;
-            
-            // Присваивание одинакового значения всем каналам
-            pixel->r = luminance;
-            pixel->g = luminance;
-            pixel->b = luminance;
-        }
-    }
-    
-    printf("Grayscale: применено к %ux%u пикселей\n", width, height);
+    printf("Grayscale: применено к %ux%u пикселей\n", image->width, image->height);
     return true;
 }
 
 // 3. Negative фильтр
 
+// Полоса строк для negative
+//  Формула: R' = 1 - R, G' = 1 - G, B' = 1 - B - одинакова для всех каналов,
+//  поэтому полоса обрабатывается как сплошной массив float
+static void negative_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Image* image = (Image*)ctx;
+    size_t first = (size_t)y_begin * image->width;
+    size_t pixels = (size_t)(y_end - y_begin) * image->width;
+    
+    simd_negative((float*)(image->data + first), pixels * 3);
+}
+
 bool filter_negative(Image* image) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
         return false;
     }
     
-    uint32_t width = image->width;
-    uint32_t height = image->height;
+    parallel_for_rows(image->height, negative_band, image);
     
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color* pixel = image_get_pixel(image, x, y);
-            if (!pixel) continue;
-            
-            // Формула негатива: R' = 1 - R, G' = 1 - G, B' = 1 - B
-            pixel->r = 1.0f - pixel->r;
-            pixel->g = 1.0f - pixel->g;
-            pixel->b = 1.0f - pixel->b;
+    printf("Negative: применено к %ux%u пикселей\n", image->width, image->height);
+    return true;
+}
+
+// Слияние поточечных фильтров
+
+#define POINT_BLOCK_PIXELS 1024  // 12 КБ float RGB: блок остается в L1
+
+typedef struct {
+    Image* image;
+    const PointOp* ops;
+    int count;
+} PointOpsBand;
+
+static void point_ops_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    PointOpsBand* band = (PointOpsBand*)ctx;
+    float* data = (float*)(band->image->data + (size_t)y_begin * band->image->width);
+    size_t pixels = (size_t)(y_end - y_begin) * band->image->width;
+    
+    for (size_t first = 0; first < pixels; first += POINT_BLOCK_PIXELS) {
+        size_t block = pixels - first < POINT_BLOCK_PIXELS ? pixels - first : POINT_BLOCK_PIXELS;
+        float* rgb = data + first * 3;
+        
+        for (int i = 0; i < band->count; i++) {
+            switch (band->ops[i]) {
+                case POINT_GRAYSCALE: simd_grayscale_interleaved(rgb, block); break;
+                case POINT_NEGATIVE:  simd_negative(rgb, block * 3); break;
+            }
         }
     }
+}
+
+bool filter_point_ops(Image* image, const PointOp* ops, int count) {
+    if (!image || !image->data || !ops || count <= 0) {
+        fprintf(stderr, "Ошибка: изображение или операции не инициализированы\n");
+        return false;
+    }
     
-    printf("Negative: применено к %ux%u пикселей\n", width, height);
+    PointOpsBand band = {image, ops, count};
+    parallel_for_rows(image->height, point_ops_band, &band);
+    
+    printf("Point ops: %d операций за один проход, %ux%u пикселей\n",
+           count, image->width, image->height);
     return true;
 }
 
@@ -171,27 +195,48 @@ bool filter_sharpen(Image* image) {
         0.0f, -1.0f,  0.0f
     };
     
-    // Применяем свертку
-    Image* result = apply_convolution(image, sharpen_kernel, 3);
-    if (!result) {
+    // Применяем свертку (результат - в том же кадре)
+    if (!apply_convolution_in_place(image, sharpen_kernel, 3)) {
         fprintf(stderr, "Ошибка применения фильтра резкости\n");
         return false;
     }
     
-    // Заменяем данные изображения
-    free(image->data);
-    image->data = result->data;
-    image->width = result->width;
-    image->height = result->height;
-    
-    free(result);
-    
     printf("Sharpening: применен фильтр повышения резкости\n");
     return true;
 }
 
 // 5. Edge Detection фильтр
 
+// Параметры полосы бинаризации
+typedef struct {
+    Image* image;
+    float threshold;
+} ThresholdBand;
+
+static void threshold_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    ThresholdBand* band = (ThresholdBand*)ctx;
+    Image* edges = band->image;
+    float threshold = band->threshold;
+    uint32_t width = edges->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            Color* pixel = image_get_pixel(edges, x, y);
+            if (!pixel) continue;
+            
+            // Используем только красный канал (все одинаковы после grayscale)
+            float value = pixel->r;
+            
+            // Бинаризация: выше порога -> белый, иначе черный
+            if (value > threshold) {
+                pixel->r = pixel->g = pixel->b = 1.0f;  // Белый
+            } else {
+                pixel->r = pixel->g = pixel->b = 0.0f;  // Черный
+            }
+        }
+    }
+}
+
 bool filter_edge_detection(Image* image, float threshold) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
@@ -204,15 +249,9 @@ bool filter_edge_detection(Image* image, float threshold) {
         return false;
     }
     
-    // 1. Создаем копию для преобразования в grayscale
-    Image* grayscale = image_copy(image);
-    if (!grayscale) {
-        fprintf(stderr, "Ошибка создания копии изображения\n");
-        return false;
-    }
-    
-    // 2. Преобразуем в оттенки серого
-    filter_grayscale(grayscale);
+    // 1-2. Преобразуем в оттенки серого на месте: исходные цвета дальше
+    // не нужны, результат все равно заменит изображение
+    filter_grayscale(image);
     
     // 3. Ядро Лапласиана для выделения границ
     // [ 0 -1  0]
@@ -224,44 +263,18 @@ bool filter_edge_detection(Image* image, float threshold) {
         0.0f, -1.0f,  0.0f
     };
     
-    // 4. Применяем свертку
-    Image* edges = apply_convolution(grayscale, edge_kernel, 3);
-    if (!edges) {
+    // 4. Применяем свертку (результат - в том же кадре)
+    if (!apply_convolution_in_place(image, edge_kernel, 3)) {
         fprintf(stderr, "Ошибка применения фильтра границ\n");
-        image_free(grayscale);
         return false;
     }
     
     // 5. Бинаризация по порогу
-    uint32_t width = edges->width;
-    uint32_t height = edges->height;
-    
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color* pixel = image_get_pixel(edges, x, y);
-            if (!pixel) continue;
-            
-            // Используем только красный канал (все одинаковы после grayscale)
-            float value = pixel->r;
-            
-            // Бинаризация: выше порога -> белый, иначе черный
-            if (value > threshold) {
-                pixel->r = pixel->g = pixel->b = 1.0f;  // Белый
-            } else {
-                pixel->r = pixel->g = pixel->b = 0.0f;  // Черный
-            }
-        }
-    }
-    
-    // 6. Заменяем оригинальное изображение
-    free(image->data);
-    image->data = edges->data;
-    image->width = edges->width;
-    image->height = edges->height;
+    uint32_t width = image->width;
+    uint32_t height = image->height;
     
-    // 7. Освобождаем временные изображения
-    image_free(grayscale);
-    free(edges);
+    ThresholdBand band = { image, threshold };
+    parallel_for_rows(height, threshold_band, &band);
     
     printf("Edge Detection: порог %.2f, размер %ux%u\n", threshold, width, height);
     return true;
@@ -269,52 +282,36 @@ bool filter_edge_detection(Image* image, float threshold) {
 
 // 6. Median Filter
 
-bool filter_median(Image* image, int window) {
-    if (!image || !image->data) {
-        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
-        return false;
-    }
-    
-    // Проверка размера окна
-    if (window <= 0 || window % 2 == 0) {
-        fprintf(stderr, "Ошибка: размер окна должен быть положительным нечетным числом\n");
-        return false;
-    }
-    
-    if (window == 1) {
-        printf("Median Filter: окно размером 1, фильтрация не требуется\n");
-        return true;
-    }
-    
-    uint32_t width = image->width;
-    uint32_t height = image->height;
-    
-    // Создаем копию для чтения
-    Image* copy = image_copy(image);
-    if (!copy) {
-        fprintf(stderr, "Ошибка создания копии изображения\n");
-        return false;
-    }
+// Параметры полосы медианного фильтра
+typedef struct {
+    const Image* source;   // Копия исходного изображения (только чтение)
+    Image* target;         // Изображение для записи результата
+    int window;            // Размер окна
+    atomic_bool failed;    // Ошибка выделения памяти в одной из полос
+} MedianBand;
+
+static void median_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    MedianBand* band = (MedianBand*)ctx;
+    const Image* copy = band->source;
+    uint32_t width = copy->width;
     
-    int half = window / 2;
-    int window_size = window * window;
+    int half = band->window / 2;
+    int window_size = band->window * band->window;
     
-    // Буферы для значений каналов
+    // Буферы для значений каналов (свои у каждой полосы)
     float* r_vals = (float*)malloc(window_size * sizeof(float));
     float* g_vals = (float*)malloc(window_size * sizeof(float));
     float* b_vals = (float*)malloc(window_size * sizeof(float));
     
     if (!r_vals || !g_vals || !b_vals) {
-        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        atomic_store(&band->failed, true);
         free(r_vals);
         free(g_vals);
         free(b_vals);
-        image_free(copy);
-        return false;
+        return;
     }
     
-    // Проходим по всем пикселям изображения
-    for (uint32_t y = 0; y < height; y++) {
+    for (uint32_t y = y_begin; y < y_end; y++) {
         for (uint32_t x = 0; x < width; x++) {
             int count = 0;
             
@@ -348,43 +345,169 @@ bool filter_median(Image* image, int window) {
             };
             
             // Устанавливаем медианное значение
-            image_set_pixel(image, x, y, median_color);
+            image_set_pixel(band->target, x, y, median_color);
         }
     }
     
-    // Освобождаем память
     free(r_vals);
     free(g_vals);
     free(b_vals);
+}
+
+// Эталонный режим: сортировка float значений окна для каждого пикселя
+static bool median_reference(Image* image, int window) {
+    // Создаем копию для чтения
+    Image* copy = image_copy(image);
+    if (!copy) {
+        fprintf(stderr, "Ошибка создания копии изображения\n");
+        return false;
+    }
+    
+    // Полосы читают окно (ореол window/2 строк) из копии и пишут в image
+    MedianBand band = { .source = copy, .target = image, .window = window };
+    atomic_init(&band.failed, false);
+    parallel_for_rows(image->height, median_band, &band);
+    
     image_free(copy);
     
-    printf("Median Filter: окно %dx%d, размер %ux%u\n", window, window, width, height);
+    if (atomic_load(&band.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        return false;
+    }
     return true;
 }
 
-// 7. Gaussian Blur фильтр
+// Квантование в 8 бит и обратно (полосами строк)
+typedef struct {
+    Image* image;
+    uint8_t* bytes;        // RGB по 3 байта на пиксель
+} QuantizeBand;
 
-bool filter_gaussian_blur(Image* image, float sigma) {
+static void quantize_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    QuantizeBand* band = (QuantizeBand*)ctx;
+    size_t begin = (size_t)y_begin * band->image->width;
+    size_t end = (size_t)y_end * band->image->width;
+    
+    for (size_t i = begin; i < end; i++) {
+        Color c = band->image->data[i];
+        band->bytes[i * 3 + 0] = color_channel_to_u8(c.r);
+        band->bytes[i * 3 + 1] = color_channel_to_u8(c.g);
+        band->bytes[i * 3 + 2] = color_channel_to_u8(c.b);
+    }
+}
+
+static void dequantize_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    QuantizeBand* band = (QuantizeBand*)ctx;
+    size_t begin = (size_t)y_begin * band->image->width;
+    size_t end = (size_t)y_end * band->image->width;
+    
+    for (size_t i = begin; i < end; i++) {
+        band->image->data[i].r = (float)band->bytes[i * 3 + 0] / 255.0f;
+        band->image->data[i].g = (float)band->bytes[i * 3 + 1] / 255.0f;
+        band->image->data[i].b = (float)band->bytes[i * 3 + 2] / 255.0f;
+    }
+}
+
+// Основной режим: медиана по 8-битным каналам (сеть выбора или гистограммы)
+//  Совпадает с эталонным режимом, только если вход на сетке k/255
+//  (image_on_byte_grid); иначе вызывается median_float
+static bool median_histogram(Image* image, int window) {
+    size_t bytes = (size_t)image->width * image->height * 3;
+    uint8_t* src = (uint8_t*)frame_alloc(bytes);
+    uint8_t* dst = (uint8_t*)frame_alloc(bytes);
+    
+    if (!src || !dst) {
+        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        frame_release(src, bytes);
+        frame_release(dst, bytes);
+        return false;
+    }
+    
+    QuantizeBand band = { image, src };
+    parallel_for_rows(image->height, quantize_band, &band);
+    
+    bool ok = median_filter_u8(src, dst, image->width, image->height, window);
+    
+    if (ok) {
+        band.bytes = dst;
+        parallel_for_rows(image->height, dequantize_band, &band);
+    }
+    
+    frame_release(src, bytes);
+    frame_release(dst, bytes);
+    return ok;
+}
+
+// Вход вне сетки k/255: та же медиана по float значениям без квантования
+static bool median_float(Image* image, int window) {
+    Image* result = image_create_uninit(image->width, image->height);
+    if (!result) {
+        fprintf(stderr, "Ошибка создания изображения для медианного фильтра\n");
+        return false;
+    }
+    
+    if (!median_filter_float((const float*)image->data, (float*)result->data,
+                             image->width, image->height, window)) {
+        image_free(result);
+        return false;
+    }
+    
+    image_replace(image, result);
+    return true;
+}
+
+bool filter_median_mode(Image* image, int window, MedianMode mode) {
     if (!image || !image->data) {
         fprintf(stderr, "Ошибка: изображение не инициализировано\n");
         return false;
     }
     
-    // Проверка параметра sigma
-    if (sigma <= 0.0f) {
-        fprintf(stderr, "Ошибка: sigma должен быть положительным (%.2f)\n", sigma);
+    // Проверка размера окна
+    if (window <= 0 || window % 2 == 0) {
+        fprintf(stderr, "Ошибка: размер окна должен быть положительным нечетным числом\n");
         return false;
     }
     
-    // Вычисляем размер ядра (правило 3σ)
+    if (window == 1) {
+        printf("Median Filter: окно размером 1, фильтрация не требуется\n");
+        return true;
+    }
+    
+    // После фильтров с произвольными значениями (размытие, резкость)
+    // квантование в 8 бит изменило бы результат: медиана по float
+    bool ok;
+    if (mode == MEDIAN_REFERENCE) {
+        ok = median_reference(image, window);
+    } else if (image_on_byte_grid(image)) {
+        ok = median_histogram(image, window);
+    } else {
+        ok = median_float(image, window);
+    }
+    
+    if (!ok) {
+        return false;
+    }
+    
+    printf("Median Filter%s: окно %dx%d, размер %ux%u\n", 
+           mode == MEDIAN_REFERENCE ? " (эталон)" : "",
+           window, window, image->width, image->height);
+    return true;
+}
+
+bool filter_median(Image* image, int window) {
+    return filter_median_mode(image, window, MEDIAN_HISTOGRAM);
+}
+
+// 7. Gaussian Blur фильтр
+
+// Построение нормализованного 1D гауссова ядра (правило 3σ)
+float* gaussian_kernel_create(float sigma, int* radius) {
     int kernel_radius = (int)ceil(3.0f * sigma);
     int kernel_size = kernel_radius * 2 + 1;
     
-    // Создаем 1D гауссово ядро
     float* kernel = (float*)malloc(kernel_size * sizeof(float));
     if (!kernel) {
-        fprintf(stderr, "Ошибка выделения памяти для гауссова ядра\n");
-        return false;
+        return NULL;
     }
     
     // Вычисляем коэффициенты ядра
@@ -404,115 +527,469 @@ bool filter_gaussian_blur(Image* image, float sigma) {
         kernel[i] /= sum;
     }
     
+    *radius = kernel_radius;
+    return kernel;
+}
+
+// Индекс с повторением крайнего пикселя
+static inline int clamp_index(int i, int n) {
+    if (i < 0) return 0;
+    if (i >= n) return n - 1;
+    return i;
+}
+
+// Параметры полосы одного прохода размытия
+typedef struct {
+    const Image* source;   // Источник прохода (только чтение)
+    Image* target;         // Результат прохода
+    const float* kernel;   // 1D гауссово ядро
+    int radius;            // Радиус ядра
+    atomic_bool failed;    // Ошибка выделения памяти в одной из полос
+} BlurPass;
+
+// Горизонтальный проход одной строки
+//  Внутренние пиксели (x - r >= 0, x + r < width) считаются без проверок,
+//  краевые - с повторением крайнего пикселя
+void blur_horizontal_row(const Color* src, Color* dst, int width,
+                         const float* kernel, int r) {
+    // Границы внутренней области
+    int inner_begin = r < width ? r : width;
+    int inner_end = width - r > inner_begin ? width - r : inner_begin;
+    
+    // Левый край
+    for (int x = 0; x < inner_begin; x++) {
+        Color sum_color = {0, 0, 0};
+        for (int i = -r; i <= r; i++) {
+            Color pixel = src[clamp_index(x + i, width)];
+            float weight = kernel[i + r];
+            sum_color.r += pixel.r * weight;
+            sum_color.g += pixel.g * weight;
+            sum_color.b += pixel.b * weight;
+        }
+        dst[x] = color_clamp(sum_color);
+    }
+    
+    // Внутренняя область
+    for (int x = inner_begin; x < inner_end; x++) {
+        const Color* window = src + x - r;
+        Color sum_color = {0, 0, 0};
+        for (int i = 0; i <= 2 * r; i++) {
+            float weight = kernel[i];
+            sum_color.r += window[i].r * weight;
+            sum_color.g += window[i].g * weight;
+            sum_color.b += window[i].b * weight;
+        }
+        dst[x] = color_clamp(sum_color);
+    }
+    
+    // Правый край
+    for (int x = inner_end; x < width; x++) {
+        Color sum_color = {0, 0, 0};
+        for (int i = -r; i <= r; i++) {
+            Color pixel = src[clamp_index(x + i, width)];
+            float weight = kernel[i + r];
+            sum_color.r += pixel.r * weight;
+            sum_color.g += pixel.g * weight;
+            sum_color.b += pixel.b * weight;
+        }
+        dst[x] = color_clamp(sum_color);
+    }
+}
+
+// Вертикальный проход одной строки
+//  Сумма накапливается построчно в буфере строки: внутренний цикл идет
+//  подряд по памяти, граница обрабатывается выбором строки, а не пикселя
+void blur_vertical_row(const Color* const* rows, Color* dst, Color* acc,
+                       uint32_t width, const float* kernel, int r) {
+    memset(acc, 0, width * sizeof(Color));
+    
+    for (int i = 0; i <= 2 * r; i++) {
+        const Color* row = rows[i];
+        float weight = kernel[i];
+        
+        for (uint32_t x = 0; x < width; x++) {
+            acc[x].r += row[x].r * weight;
+            acc[x].g += row[x].g * weight;
+            acc[x].b += row[x].b * weight;
+        }
+    }
+    
+    for (uint32_t x = 0; x < width; x++) {
+        dst[x] = color_clamp(acc[x]);
+    }
+}
+
+// Горизонтальный проход: ореол не нужен, строки независимы
+static void blur_horizontal_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BlurPass* pass = (BlurPass*)ctx;
+    int width = (int)pass->source->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        blur_horizontal_row(pass->source->data + (size_t)y * width,
+                            pass->target->data + (size_t)y * width,
+                            width, pass->kernel, pass->radius);
+    }
+}
+
+// Вертикальный проход: полоса читает ореол radius строк из временного изображения
+static void blur_vertical_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BlurPass* pass = (BlurPass*)ctx;
+    int r = pass->radius;
+    uint32_t width = pass->source->width;
+    int height = (int)pass->source->height;
+    
+    Color* acc = (Color*)malloc(width * sizeof(Color));
+    const Color** rows = (const Color**)malloc((size_t)(2 * r + 1) * sizeof(Color*));
+    if (!acc || !rows) {
+        free(acc);
+        free(rows);
+        atomic_store(&pass->failed, true);
+        return;
+    }
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int i = -r; i <= r; i++) {
+            rows[i + r] = pass->source->data + 
+                          (size_t)clamp_index((int)y + i, height) * width;
+        }
+        blur_vertical_row(rows, pass->target->data + (size_t)y * width, acc,
+                          width, pass->kernel, r);
+    }
+    
+    free(rows);
+    free(acc);
+}
+
+// Размеры трех боксов, приближающих гауссиану с заданной sigma
+//  (дисперсия суммы трех равномерных распределений равна σ²)
+void box_sizes_for_gauss(float sigma, int sizes[3]) {
+    const int n = 3;
+    float w_ideal = sqrtf(12.0f * sigma * sigma / n + 1.0f);
+    int wl = (int)floorf(w_ideal);
+    if (wl % 2 == 0) wl--;
+    int wu = wl + 2;
+    
+    float m_ideal = (12.0f * sigma * sigma - n * wl * wl - 4.0f * n * wl - 3.0f * n) /
+                    (-4.0f * wl - 4.0f);
+    int m = (int)roundf(m_ideal);
+    
+    for (int i = 0; i < n; i++) {
+        sizes[i] = i < m ? wl : wu;
+    }
+}
+
+// Горизонтальный бокс одной строки: скользящая сумма, O(1) на пиксель
+void box_horizontal_row(const Color* src, Color* dst, int width, int r) {
+    double norm = 1.0 / (2 * r + 1);
+    
+    // Начальное окно [-r, r] с повторением крайнего пикселя
+    double sr = 0.0, sg = 0.0, sb = 0.0;
+    for (int i = -r; i <= r; i++) {
+        const Color* p = &src[clamp_index(i, width)];
+        sr += p->r;
+        sg += p->g;
+        sb += p->b;
+    }
+    
+    for (int x = 0; x < width; x++) {
+        dst[x].r = (float)(sr * norm);
+        dst[x].g = (float)(sg * norm);
+        dst[x].b = (float)(sb * norm);
+        
+        // Сдвиг окна
+        const Color* in = &src[clamp_index(x + r + 1, width)];
+        const Color* out = &src[clamp_index(x - r, width)];
+        sr += in->r - out->r;
+        sg += in->g - out->g;
+        sb += in->b - out->b;
+    }
+}
+
+static void box_horizontal_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BlurPass* pass = (BlurPass*)ctx;
+    int width = (int)pass->source->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        box_horizontal_row(pass->source->data + (size_t)y * width,
+                           pass->target->data + (size_t)y * width,
+                           width, pass->radius);
+    }
+}
+
+// Вертикальный бокс: скользящая сумма строк в буфере полосы
+static void box_vertical_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    BlurPass* pass = (BlurPass*)ctx;
+    int r = pass->radius;
+    uint32_t width = pass->source->width;
+    int height = (int)pass->source->height;
+    double norm = 1.0 / (2 * r + 1);
+    
+    double* acc = (double*)calloc((size_t)width * 3, sizeof(double));
+    if (!acc) {
+        atomic_store(&pass->failed, true);
+        return;
+    }
+    
+    // Начальное окно для первой строки полосы
+    for (int i = -r; i <= r; i++) {
+        const float* row = (const float*)(pass->source->data +
+                           (size_t)clamp_index((int)y_begin + i, height) * width);
+        for (uint32_t k = 0; k < width * 3; k++) {
+            acc[k] += row[k];
+        }
+    }
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        float* dst = (float*)(pass->target->data + (size_t)y * width);
+        for (uint32_t k = 0; k < width * 3; k++) {
+            dst[k] = (float)(acc[k] * norm);
+        }
+        
+        // Сдвиг окна
+        const float* in = (const float*)(pass->source->data +
+                          (size_t)clamp_index((int)y + r + 1, height) * width);
+        const float* out = (const float*)(pass->source->data +
+                           (size_t)clamp_index((int)y - r, height) * width);
+        for (uint32_t k = 0; k < width * 3; k++) {
+            acc[k] += (double)in[k] - (double)out[k];
+        }
+    }
+    
+    free(acc);
+}
+
+// Точное размытие: два 1D прохода готовым гауссовым ядром
+static bool gaussian_blur_exact(Image* image, Image* temp,
+                                const float* kernel, int kernel_radius) {
+    // 1. Горизонтальное размытие
+    BlurPass horizontal = { .source = image, .target = temp,
+                            .kernel = kernel, .radius = kernel_radius };
+    atomic_init(&horizontal.failed, false);
+    parallel_for_rows(image->height, blur_horizontal_band, &horizontal);
+    
+    // 2. Вертикальное размытие (применяем к оригинальному изображению)
+    BlurPass vertical = { .source = temp, .target = image,
+                          .kernel = kernel, .radius = kernel_radius };
+    atomic_init(&vertical.failed, false);
+    parallel_for_rows(image->height, blur_vertical_band, &vertical);
+    
+    if (atomic_load(&vertical.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для буфера размытия\n");
+        return false;
+    }
+    return true;
+}
+
+// Приближенное размытие: три бокса подряд, стоимость не зависит от sigma
+static bool gaussian_blur_box(Image* image, Image* temp, float sigma, int* kernel_size) {
+    int sizes[3];
+    box_sizes_for_gauss(sigma, sizes);
+    *kernel_size = 0;
+    
+    for (int i = 0; i < 3; i++) {
+        int r = (sizes[i] - 1) / 2;
+        *kernel_size += 2 * r;
+        if (r <= 0) continue;
+        
+        BlurPass horizontal = { .source = image, .target = temp, .radius = r };
+        atomic_init(&horizontal.failed, false);
+        parallel_for_rows(image->height, box_horizontal_band, &horizontal);
+        
+        BlurPass vertical = { .source = temp, .target = image, .radius = r };
+        atomic_init(&vertical.failed, false);
+        parallel_for_rows(image->height, box_vertical_band, &vertical);
+        
+        if (atomic_load(&vertical.failed)) {
+            fprintf(stderr, "Ошибка выделения памяти для буфера размытия\n");
+            return false;
+        }
+    }
+    
+    *kernel_size += 1;
+    return true;
+}
+
+bool filter_gaussian_blur_mode(Image* image, float sigma, BlurMode mode) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    // Проверка параметра sigma
+    if (sigma <= 0.0f) {
+        fprintf(stderr, "Ошибка: sigma должен быть положительным (%.2f)\n", sigma);
+        return false;
+    }
+    
     uint32_t width = image->width;
     uint32_t height = image->height;
     
     // Создаем временное изображение для горизонтального размытия
-    Image* temp = image_create(width, height);
+    // (горизонтальный проход перезаписывает его целиком)
+    Image* temp = image_create_uninit(width, height);
     if (!temp) {
         fprintf(stderr, "Ошибка создания временного изображения\n");
-        free(kernel);
         return false;
     }
     
-    // 1. Горизонтальное размытие
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color sum_color = {0, 0, 0};
-            
-            for (int i = -kernel_radius; i <= kernel_radius; i++) {
-                int px = (int)x + i;
-                int py = (int)y;
-                
-                Color pixel = get_pixel_with_border(image, px, py);
-                float weight = kernel[i + kernel_radius];
-                
-                sum_color.r += pixel.r * weight;
-                sum_color.g += pixel.g * weight;
-                sum_color.b += pixel.b * weight;
-            }
-            
-            image_set_pixel(temp, x, y, sum_color);
+    int kernel_size = 0;
+    bool ok;
+    if (mode == BLUR_BOX_APPROX) {
+        ok = gaussian_blur_box(image, temp, sigma, &kernel_size);
+    } else {
+        int kernel_radius = 0;
+        float* kernel = gaussian_kernel_create(sigma, &kernel_radius);
+        if (!kernel) {
+            fprintf(stderr, "Ошибка выделения памяти для гауссова ядра\n");
+            image_free(temp);
+            return false;
         }
+        kernel_size = kernel_radius * 2 + 1;
+        ok = gaussian_blur_exact(image, temp, kernel, kernel_radius);
+        free(kernel);
     }
     
-    // 2. Вертикальное размытие (применяем к оригинальному изображению)
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color sum_color = {0, 0, 0};
-            
-            for (int i = -kernel_radius; i <= kernel_radius; i++) {
-                int px = (int)x;
-                int py = (int)y + i;
-                
-                Color pixel = get_pixel_with_border(temp, px, py);
-                float weight = kernel[i + kernel_radius];
-                
-                sum_color.r += pixel.r * weight;
-                sum_color.g += pixel.g * weight;
-                sum_color.b += pixel.b * weight;
-            }
-            
-            image_set_pixel(image, x, y, sum_color);
-        }
+    image_free(temp);
+    
+    if (!ok) {
+        return false;
     }
     
-    // Освобождаем память
-    free(kernel);
+    printf("Gaussian Blur%s: sigma=%.2f, ядро %dx%d, размер %ux%u\n", 
+           mode == BLUR_BOX_APPROX ? " (3 бокса)" : "",
+           sigma, kernel_size, kernel_size, width, height);
+    return true;
+}
+
+bool filter_gaussian_blur(Image* image, float sigma) {
+    return filter_gaussian_blur_mode(image, sigma, BLUR_EXACT);
+}
+
+bool filter_gaussian_blur_kernel(Image* image, float sigma, const float* kernel, int radius) {
+    if (!image || !image->data || !kernel) {
+        fprintf(stderr, "Ошибка: изображение или ядро не инициализированы\n");
+        return false;
+    }
+    
+    Image* temp = image_create_uninit(image->width, image->height);
+    if (!temp) {
+        fprintf(stderr, "Ошибка создания временного изображения\n");
+        return false;
+    }
+    
+    bool ok = gaussian_blur_exact(image, temp, kernel, radius);
     image_free(temp);
     
+    if (!ok) {
+        return false;
+    }
+    
     printf("Gaussian Blur: sigma=%.2f, ядро %dx%d, размер %ux%u\n", 
-           sigma, kernel_size, kernel_size, width, height);
+           sigma, radius * 2 + 1, radius * 2 + 1, image->width, image->height);
     return true;
 }
 
 // Функция применения свертки
 
+// Параметры полосы свертки 3x3 по планарному представлению
+typedef struct {
+    const PlanarImage* source;   // Источник с рамкой в 1 пиксель
+    Image* target;               // Результат
+    const float* kernel;         // Ядро 3x3
+    atomic_bool failed;          // Ошибка выделения памяти в одной из полос
+} Convolution3x3Band;
+
+static void convolution3x3_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Convolution3x3Band* band = (Convolution3x3Band*)ctx;
+    const PlanarImage* src = band->source;
+    uint32_t width = src->width;
+    
+    // Строка результата по каналам
+    float* out = (float*)malloc((size_t)width * 3 * sizeof(float));
+    if (!out) {
+        atomic_store(&band->failed, true);
+        return;
+    }
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int c = 0; c < 3; c++) {
+            // Строки y-1 и y+1 на краях берутся из рамки (повтор края)
+            const float* rows[3] = {
+                planar_row(src, c, (int)y - 1),
+                planar_row(src, c, (int)y),
+                planar_row(src, c, (int)y + 1)
+            };
+            simd_convolve3x3(rows, out + (size_t)c * width, width, band->kernel);
+        }
+        
+        // Обратная упаковка каналов и ограничение в [0, 1]
+        Color* dst = band->target->data + (size_t)y * width;
+        for (uint32_t x = 0; x < width; x++) {
+            dst[x].r = out[x];
+            dst[x].g = out[width + x];
+            dst[x].b = out[2 * (size_t)width + x];
+        }
+        simd_clamp((float*)dst, (size_t)width * 3);
+    }
+    
+    free(out);
+}
+
+// Свертка 3x3 через планарное представление и векторное ядро
+//  Полосы читают только планарную копию, поэтому target может быть самим
+//  image: тогда одновременно живут два кадра, как без планарной копии
+static bool apply_convolution3x3(const Image* image, Image* target, const float* kernel) {
+    PlanarImage* planar = planar_from_image(image, 1);
+    if (!planar) {
+        return false;
+    }
+    
+    Convolution3x3Band band = { .source = planar, .target = target, .kernel = kernel };
+    atomic_init(&band.failed, false);
+    parallel_for_rows(image->height, convolution3x3_band, &band);
+    
+    planar_free(planar);
+    
+    if (atomic_load(&band.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для буфера свертки\n");
+        return false;
+    }
+    return true;
+}
+
 Image* apply_convolution(const Image* image, const float* kernel, int size) {
     if (!image || !image->data || !kernel || size % 2 == 0) {
         fprintf(stderr, "Ошибка: некорректные параметры для свертки\n");
         return NULL;
     }
     
-    uint32_t width = image->width;
-    uint32_t height = image->height;
-    int half = size / 2;
+    if (size == 3) {
+        Image* result = image_create_uninit(image->width, image->height);
+        if (result && !apply_convolution3x3(image, result, kernel)) {
+            image_free(result);
+            return NULL;
+        }
+        return result;
+    }
     
-    // Создаем новое изображение для результата
-    Image* result = image_create(width, height);
-    if (!result) {
-        return NULL;
+    // Остальные размеры: разделимая, прямая или БПФ свертка по ядру
+    return convolve(image, kernel, size);
+}
+
+bool apply_convolution_in_place(Image* image, const float* kernel, int size) {
+    if (!image || !image->data || !kernel || size % 2 == 0) {
+        fprintf(stderr, "Ошибка: некорректные параметры для свертки\n");
+        return false;
     }
     
-    // Применяем свертку ко всем пикселям
-    for (uint32_t y = 0; y < height; y++) {
-        for (uint32_t x = 0; x < width; x++) {
-            Color sum_color = {0, 0, 0};
-            
-            // Проходим по ядру свертки
-            for (int ky = -half; ky <= half; ky++) {
-                for (int kx = -half; kx <= half; kx++) {
-                    int px = (int)x + kx;
-                    int py = (int)y + ky;
-                    
-                    // Получаем значение пикселя с учетом границ
-                    Color pixel = get_pixel_with_border(image, px, py);
-                    
-                    // Индекс в ядре
-                    int kernel_index = (ky + half) * size + (kx + half);
-                    float weight = kernel[kernel_index];
-                    
-                    // Добавляем взвешенное значение
-                    sum_color.r += pixel.r * weight;
-                    sum_color.g += pixel.g * weight;
-                    sum_color.b += pixel.b * weight;
-                }
-            }
-            
-            // Ограничиваем значения и сохраняем результат
-            image_set_pixel(result, x, y, sum_color);
-        }
+    if (size == 3) {
+        return apply_convolution3x3(image, image, kernel);
     }
     
-    return result;
-}
\ No newline at end of file
+    Image* result = convolve(image, kernel, size);
+    if (!result) {
+        return false;
+    }
+    image_replace(image, result);
+    return true;
+}
@@ -29,6 +29,23 @@ bool filter_grayscale(Image* image);
 //  image Изображение для обработки
 bool filter_negative(Image* image);
 
+// Слияние поточечных фильтров
+
+// Поточечная операция: новый пиксель зависит только от старого
+typedef enum {
+    POINT_GRAYSCALE,  // Как filter_grayscale
+    POINT_NEGATIVE    // Как filter_negative
+} PointOp;
+
+#define POINT_OPS_MAX 16  // Наибольшая длина сливаемой серии
+
+//  Серия поточечных операций за один проход по памяти
+//  Изображение обрабатывается блоками, помещающимися в кэш L1; к блоку
+//  по очереди применяются те же векторные ядра, что и в отдельных
+//  фильтрах, поэтому результат совпадает с последовательным применением
+//  побитово (сворачивание в матрицу 3x4 меняло бы округление)
+bool filter_point_ops(Image* image, const PointOp* ops, int count);
+
 // 4. Sharpening фильтр
 
 //  Повышение резкости изображения
@@ -60,6 +77,16 @@ bool filter_edge_detection(Image* image, float threshold);
 //  window Размер окна (нечетное число)
 bool filter_median(Image* image, int window);
 
+// Режим медианного фильтра
+typedef enum {
+    MEDIAN_HISTOGRAM,  // 8-битные каналы: сеть выбора (3, 5) или гистограммы, O(1)
+                       // (вход вне сетки k/255 - та же сеть или выбор по float)
+    MEDIAN_REFERENCE   // Сортировка float значений окна, O(w²·log w) - для сравнения
+} MedianMode;
+
+// Медианный фильтр в заданном режиме
+bool filter_median_mode(Image* image, int window, MedianMode mode);
+
 // 7. Gaussian Blur фильтр
 
 // Гауссово размытие изображения
@@ -68,12 +95,50 @@ bool filter_median(Image* image, int window);
 // sigma Сигма гауссова ядра
 bool filter_gaussian_blur(Image* image, float sigma);
 
+// Режим гауссова размытия
+typedef enum {
+    BLUR_EXACT,       // Два 1D прохода гауссовым ядром, O(σ) на пиксель
+    BLUR_BOX_APPROX   // Три бокса скользящей суммой, O(1) на пиксель
+} BlurMode;
+
+// Гауссово размытие в заданном режиме
+// BLUR_BOX_APPROX приближает гауссиану тремя боксами с той же дисперсией,
+// время на пиксель не зависит от sigma
+bool filter_gaussian_blur_mode(Image* image, float sigma, BlurMode mode);
+
+// Точное гауссово размытие готовым ядром gaussian_kernel_create(sigma)
+// (sigma - для вывода); ядро строится один раз для многих изображений
+bool filter_gaussian_blur_kernel(Image* image, float sigma, const float* kernel, int radius);
+
+// Построчные ядра размытия (общие для обработки в памяти и потоковой)
+
+// Нормализованное 1D гауссово ядро радиуса ceil(3σ), освобождается free()
+float* gaussian_kernel_create(float sigma, int* radius);
+
+// Горизонтальный проход гауссова размытия одной строки
+void blur_horizontal_row(const Color* src, Color* dst, int width,
+                         const float* kernel, int radius);
+
+// Вертикальный проход: rows - 2*radius+1 строк окна (края уже повторены),
+// acc - буфер на width пикселей
+void blur_vertical_row(const Color* const* rows, Color* dst, Color* acc,
+                       uint32_t width, const float* kernel, int radius);
+
+// Размеры трех боксов, приближающих гауссиану с заданной sigma
+void box_sizes_for_gauss(float sigma, int sizes[3]);
+
+// Горизонтальный бокс одной строки (скользящая сумма)
+void box_horizontal_row(const Color* src, Color* dst, int width, int radius);
+
 // Вспомогательные функции для фильтров
 
 //  Применение матрицы свертки к изображению
 // kernel Матрица ядра свертки (квадратная, нечетного размера)
 Image* apply_convolution(const Image* image, const float* kernel, int size);
 
+// Свертка с заменой изображения результатом (3x3 - в том же кадре)
+bool apply_convolution_in_place(Image* image, const float* kernel, int size);
+
 
 // Получение пикселя с обработкой границ
 // Если координаты вне границ, возвращается значение ближайшего пикселя
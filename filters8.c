@@ -0,0 +1,351 @@
+#include "filters8.h"
+#include "frame_pool.h"
+#include "median.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Вспомогательные функции
+
+static inline uint8_t clamp_u8(int v) {
+    if (v < 0) return 0;
+    if (v > 255) return 255;
+    return (uint8_t)v;
+}
+
+static inline uint8_t luminance_u8(BMPixel p) {
+    return (uint8_t)((19595u * p.r + 38470u * p.g + 7471u * p.b + 32768u) >> 16);
+}
+
+// Замена данных изображения новым буфером
+static void image8_replace_data(Image8* image, BMPixel* data) {
+    frame_release(image->data, (size_t)image->width * image->height * sizeof(BMPixel));
+    image->data = data;
+}
+
+// Параметры полосы целочисленной свертки 3x3
+typedef struct {
+    const Image8* source;
+    BMPixel* target;
+    const int* kernel;
+} Convolution8Band;
+
+static inline int tap(const uint8_t* row, uint32_t x, int c) {
+    return row[x * 3 + c];
+}
+
+static void convolution8_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Convolution8Band* band = (Convolution8Band*)ctx;
+    const Image8* src = band->source;
+    const int* k = band->kernel;
+    uint32_t width = src->width;
+    uint32_t height = src->height;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        // Строки y-1 и y+1 с повтором края
+        uint32_t ym = (y > 0) ? y - 1 : 0;
+        uint32_t yp = (y + 1 < height) ? y + 1 : height - 1;
+        const uint8_t* rows[3] = {
+            (const uint8_t*)(src->data + (size_t)ym * width),
+            (const uint8_t*)(src->data + (size_t)y * width),
+            (const uint8_t*)(src->data + (size_t)yp * width)
+        };
+        uint8_t* dst = (uint8_t*)(band->target + (size_t)y * width);
+        
+        for (uint32_t x = 0; x < width; x++) {
+            uint32_t xm = (x > 0) ? x - 1 : 0;
+            uint32_t xp = (x + 1 < width) ? x + 1 : width - 1;
+            
+            for (int c = 0; c < 3; c++) {
+                int sum = 0;
+                for (int ky = 0; ky < 3; ky++) {
+                    sum += tap(rows[ky], xm, c) * k[ky * 3 + 0] +
+                           tap(rows[ky], x, c) * k[ky * 3 + 1] +
+                           tap(rows[ky], xp, c) * k[ky * 3 + 2];
+                }
+                dst[x * 3 + c] = clamp_u8(sum);
+            }
+        }
+    }
+}
+
+// Применение целочисленного ядра 3x3, результат - новый буфер
+static BMPixel* convolve3x3_u8(const Image8* image, const int kernel[9]) {
+    size_t pixel_count = (size_t)image->width * image->height;
+    BMPixel* result = (BMPixel*)frame_alloc(pixel_count * sizeof(BMPixel));
+    if (!result) {
+        fprintf(stderr, "Ошибка выделения памяти для результата свертки\n");
+        return NULL;
+    }
+    
+    Convolution8Band band = { image, result, kernel };
+    parallel_for_rows(image->height, convolution8_band, &band);
+    return result;
+}
+
+// 1. Crop
+
+bool filter8_crop(Image8* image, uint32_t width, uint32_t height) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    if (width == 0 || height == 0) {
+        fprintf(stderr, "Ошибка: неверные размеры для crop: %ux%u\n", width, height);
+        return false;
+    }
+    
+    uint32_t orig_width = image->width;
+    uint32_t orig_height = image->height;
+    uint32_t crop_width = (width > orig_width) ? orig_width : width;
+    uint32_t crop_height = (height > orig_height) ? orig_height : height;
+    
+    if (crop_width == orig_width && crop_height == orig_height) {
+        printf("Crop: размеры совпадают, обрезка не требуется\n");
+        return true;
+    }
+    
+    // Новый кадр из пула: буфер пула нельзя уменьшать realloc - он вернулся
+    // бы в пул с прежним размером
+    BMPixel* cropped = (BMPixel*)frame_alloc((size_t)crop_width * crop_height * sizeof(BMPixel));
+    if (!cropped) {
+        fprintf(stderr, "Ошибка выделения памяти для обрезанного изображения\n");
+        return false;
+    }
+    
+    for (uint32_t y = 0; y < crop_height; y++) {
+        memcpy(cropped + (size_t)y * crop_width,
+               image->data + (size_t)y * orig_width,
+               (size_t)crop_width * sizeof(BMPixel));
+    }
+    
+    image8_replace_data(image, cropped);
+    image->width = crop_width;
+    image->height = crop_height;
+    
+    printf("Crop: %ux%u -> %ux%u\n", orig_width, orig_height, crop_width, crop_height);
+    return true;
+}
+
+// 2. Grayscale
+
+static void grayscale8_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Image8* image = (Image8*)ctx;
+    size_t begin = (size_t)y_begin * image->width;
+    size_t end = (size_t)y_end * image->width;
+    
+    for (size_t i = begin; i < end; i++) {
+        uint8_t y = luminance_u8(image->data[i]);
+        image->data[i].r = y;
+        image->data[i].g = y;
+        image->data[i].b = y;
+    }
+}
+
+bool filter8_grayscale(Image8* image) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    parallel_for_rows(image->height, grayscale8_band, image);
+    
+    printf("Grayscale (8 бит): применено к %ux%u пикселей\n", image->width, image->height);
+    return true;
+}
+
+// 3. Negative
+
+static void negative8_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Image8* image = (Image8*)ctx;
+    uint8_t* bytes = (uint8_t*)image->data;
+    size_t begin = (size_t)y_begin * image->width * 3;
+    size_t end = (size_t)y_end * image->width * 3;
+    
+    for (size_t i = begin; i < end; i++) {
+        bytes[i] = (uint8_t)(255 - bytes[i]);
+    }
+}
+
+bool filter8_negative(Image8* image) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    parallel_for_rows(image->height, negative8_band, image);
+    
+    printf("Negative (8 бит): применено к %ux%u пикселей\n", image->width, image->height);
+    return true;
+}
+
+// Слияние поточечных фильтров: операции применяются к пикселю по очереди
+
+typedef struct {
+    Image8* image;
+    const PointOp* ops;
+    int count;
+} PointOps8Band;
+
+static void point_ops8_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    PointOps8Band* band = (PointOps8Band*)ctx;
+    BMPixel* data = band->image->data;
+    size_t begin = (size_t)y_begin * band->image->width;
+    size_t end = (size_t)y_end * band->image->width;
+    
+    for (size_t i = begin; i < end; i++) {
+        BMPixel p = data[i];
+        
+        for (int k = 0; k < band->count; k++) {
+            if (band->ops[k] == POINT_GRAYSCALE) {
+                uint8_t y = luminance_u8(p);
+                p.r = p.g = p.b = y;
+            } else {
+                p.r = (uint8_t)(255 - p.r);
+                p.g = (uint8_t)(255 - p.g);
+                p.b = (uint8_t)(255 - p.b);
+            }
+        }
+        
+        data[i] = p;
+    }
+}
+
+bool filter8_point_ops(Image8* image, const PointOp* ops, int count) {
+    if (!image || !image->data || !ops || count <= 0) {
+        fprintf(stderr, "Ошибка: изображение или операции не инициализированы\n");
+        return false;
+    }
+    
+    PointOps8Band band = {image, ops, count};
+    parallel_for_rows(image->height, point_ops8_band, &band);
+    
+    printf("Point ops (8 бит): %d операций за один проход, %ux%u пикселей\n",
+           count, image->width, image->height);
+    return true;
+}
+
+// 4. Sharpening
+
+bool filter8_sharpen(Image8* image) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    const int sharpen_kernel[9] = {
+         0, -1,  0,
+        -1,  5, -1,
+         0, -1,  0
+    };
+    
+    BMPixel* result = convolve3x3_u8(image, sharpen_kernel);
+    if (!result) {
+        fprintf(stderr, "Ошибка применения фильтра резкости\n");
+        return false;
+    }
+    
+    image8_replace_data(image, result);
+    
+    printf("Sharpening (8 бит): применен фильтр повышения резкости\n");
+    return true;
+}
+
+// 5. Edge Detection
+
+typedef struct {
+    Image8* image;
+    float threshold;
+} Threshold8Band;
+
+static void threshold8_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    Threshold8Band* band = (Threshold8Band*)ctx;
+    size_t begin = (size_t)y_begin * band->image->width;
+    size_t end = (size_t)y_end * band->image->width;
+    
+    for (size_t i = begin; i < end; i++) {
+        // Все каналы одинаковы после grayscale
+        float value = (float)band->image->data[i].r / 255.0f;
+        uint8_t v = (value > band->threshold) ? 255 : 0;
+        band->image->data[i].r = v;
+        band->image->data[i].g = v;
+        band->image->data[i].b = v;
+    }
+}
+
+bool filter8_edge_detection(Image8* image, float threshold) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    if (threshold < 0.0f || threshold > 1.0f) {
+        fprintf(stderr, "Ошибка: некорректный порог %.2f (должен быть 0.0-1.0)\n", threshold);
+        return false;
+    }
+    
+    // Grayscale выполняется на месте: исходные цвета фильтру не нужны
+    parallel_for_rows(image->height, grayscale8_band, image);
+    
+    const int edge_kernel[9] = {
+         0, -1,  0,
+        -1,  4, -1,
+         0, -1,  0
+    };
+    
+    BMPixel* edges = convolve3x3_u8(image, edge_kernel);
+    if (!edges) {
+        fprintf(stderr, "Ошибка применения фильтра границ\n");
+        return false;
+    }
+    
+    image8_replace_data(image, edges);
+    
+    Threshold8Band band = { image, threshold };
+    parallel_for_rows(image->height, threshold8_band, &band);
+    
+    printf("Edge Detection (8 бит): порог %.2f, размер %ux%u\n", 
+           threshold, image->width, image->height);
+    return true;
+}
+
+// 6. Median Filter
+
+bool filter8_median(Image8* image, int window) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+    
+    if (window <= 0 || window % 2 == 0) {
+        fprintf(stderr, "Ошибка: размер окна должен быть положительным нечетным числом\n");
+        return false;
+    }
+    
+    if (window == 1) {
+        printf("Median Filter: окно размером 1, фильтрация не требуется\n");
+        return true;
+    }
+    
+    size_t pixel_count = (size_t)image->width * image->height;
+    BMPixel* result = (BMPixel*)frame_alloc(pixel_count * sizeof(BMPixel));
+    if (!result) {
+        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        return false;
+    }
+    
+    // Порядок каналов (BGR) для медианы не важен
+    if (!median_filter_u8((const uint8_t*)image->data, (uint8_t*)result,
+                          image->width, image->height, window)) {
+        frame_release(result, pixel_count * sizeof(BMPixel));
+        return false;
+    }
+    
+    image8_replace_data(image, result);
+    
+    printf("Median Filter (8 бит): окно %dx%d, размер %ux%u\n", 
+           window, window, image->width, image->height);
+    return true;
+}
@@ -0,0 +1,36 @@
+// Фильтры для 8-битного представления (Image8)
+//  Целочисленные реализации с фиксированной точкой: 3 байта на пиксель
+//  вместо 12, промежуточные копии в 4 раза меньше.
+//  Результат может отличаться от float версии на единицу младшего разряда
+//  из-за округления (медиана и crop совпадают точно).
+
+#ifndef FILTERS8_H
+#define FILTERS8_H
+
+#include "filters.h"
+#include "image.h"
+#include <stdbool.h>
+
+// Crop: верхняя левая часть изображения
+bool filter8_crop(Image8* image, uint32_t width, uint32_t height);
+
+// Grayscale: Y = (19595*R + 38470*G + 7471*B + 2^15) >> 16
+bool filter8_grayscale(Image8* image);
+
+// Negative: v' = 255 - v
+bool filter8_negative(Image8* image);
+
+// Серия поточечных операций за один проход (результат как у цепочки)
+bool filter8_point_ops(Image8* image, const PointOp* ops, int count);
+
+// Sharpening: ядро [0 -1 0; -1 5 -1; 0 -1 0] в целых числах
+bool filter8_sharpen(Image8* image);
+
+// Edge Detection: grayscale, ядро [0 -1 0; -1 4 -1; 0 -1 0], бинаризация
+// threshold Порог в долях [0.0, 1.0], как у float версии
+bool filter8_edge_detection(Image8* image, float threshold);
+
+// Median Filter: медиана по 8-битным каналам (median.c)
+bool filter8_median(Image8* image, int window);
+
+#endif
@@ -0,0 +1,169 @@
+#include "frame_pool.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+// Пул свободных буферов
+
+struct FramePool {
+    void** buffers;            // Свободные буферы
+    size_t* sizes;             // Их размеры, байт
+    int count;                 // Количество свободных буферов
+    int capacity;              // Максимум свободных буферов
+    unsigned long reused;      // Выдано из пула
+    unsigned long allocated;   // Выделено заново
+};
+
+static _Thread_local FramePool* bound_pool = NULL;
+
+// Размер выделяемого буфера: округление вверх с шагом около 1/64 размера
+//  Кадры почти одного размера (изображение и его планарная копия с рамкой)
+//  попадают в один размер и заменяют друг друга в пуле
+static size_t frame_size(size_t bytes) {
+    size_t step = FRAME_ALIGN;
+    while (step * 128 <= bytes) {
+        step *= 2;
+    }
+    return (bytes + step - 1) / step * step;
+}
+
+// Создание и уничтожение
+
+FramePool* frame_pool_create(int capacity) {
+    if (capacity <= 0) capacity = FRAME_POOL_FRAMES;
+
+    FramePool* pool = (FramePool*)calloc(1, sizeof(FramePool));
+    if (!pool) {
+        fprintf(stderr, "Ошибка выделения памяти для пула кадров\n");
+        return NULL;
+    }
+
+    pool->buffers = (void**)malloc(capacity * sizeof(void*));
+    pool->sizes = (size_t*)malloc(capacity * sizeof(size_t));
+    if (!pool->buffers || !pool->sizes) {
+        fprintf(stderr, "Ошибка выделения памяти для пула кадров\n");
+        free(pool->buffers);
+        free(pool->sizes);
+        free(pool);
+        return NULL;
+    }
+
+    pool->capacity = capacity;
+    return pool;
+}
+
+void frame_pool_destroy(FramePool* pool) {
+    if (!pool) return;
+
+    if (bound_pool == pool) {
+        bound_pool = NULL;
+    }
+
+    for (int i = 0; i < pool->count; i++) {
+        free(pool->buffers[i]);
+    }
+    free(pool->buffers);
+    free(pool->sizes);
+    free(pool);
+}
+
+// Привязка к потоку
+
+FramePool* frame_pool_bind(FramePool* pool) {
+    FramePool* previous = bound_pool;
+    bound_pool = pool;
+    return previous;
+}
+
+FramePool* frame_pool_current(void) {
+    return bound_pool;
+}
+
+// Выдача и возврат буферов
+
+void* frame_alloc(size_t bytes) {
+    FramePool* pool = bound_pool;
+
+    bytes = frame_size(bytes ? bytes : 1);
+
+    if (pool && bytes >= FRAME_POOL_MIN_BYTES) {
+        // Наименьший подходящий буфер; буфер больше двух запрошенных
+        // оставляется для кадров своего размера
+        int best = -1;
+        for (int i = 0; i < pool->count; i++) {
+            if (pool->sizes[i] >= bytes && pool->sizes[i] / 2 <= bytes &&
+                (best < 0 || pool->sizes[i] < pool->sizes[best])) {
+                best = i;
+            }
+        }
+
+        if (best >= 0) {
+            void* data = pool->buffers[best];
+            pool->count--;
+            pool->buffers[best] = pool->buffers[pool->count];
+            pool->sizes[best] = pool->sizes[pool->count];
+            pool->reused++;
+            return data;
+        }
+
+        // Перед новым кадром освобождаются буферы, меньшие его: иначе они
+        // лежали бы в пуле сверх пикового потребления без пула
+        for (int i = 0; i < pool->count; ) {
+            if (pool->sizes[i] < bytes) {
+                free(pool->buffers[i]);
+                pool->count--;
+                pool->buffers[i] = pool->buffers[pool->count];
+                pool->sizes[i] = pool->sizes[pool->count];
+            } else {
+                i++;
+            }
+        }
+        pool->allocated++;
+    }
+
+    return aligned_alloc(FRAME_ALIGN, bytes);
+}
+
+void frame_release(void* data, size_t bytes) {
+    if (!data) return;
+
+    FramePool* pool = bound_pool;
+    bytes = frame_size(bytes);
+
+    // Маленькие и невыровненные буферы (выделенные не пулом) не хранятся
+    if (!pool || bytes < FRAME_POOL_MIN_BYTES || (uintptr_t)data % FRAME_ALIGN != 0) {
+        free(data);
+        return;
+    }
+
+    if (pool->count < pool->capacity) {
+        pool->buffers[pool->count] = data;
+        pool->sizes[pool->count] = bytes;
+        pool->count++;
+        return;
+    }
+
+    // Пул полон: остаются наибольшие буферы
+    int smallest = 0;
+    for (int i = 1; i < pool->count; i++) {
+        if (pool->sizes[i] < pool->sizes[smallest]) smallest = i;
+    }
+
+    if (pool->sizes[smallest] >= bytes) {
+        free(data);
+        return;
+    }
+
+    free(pool->buffers[smallest]);
+    pool->buffers[smallest] = data;
+    pool->sizes[smallest] = bytes;
+}
+
+// Статистика
+
+void frame_pool_print(const FramePool* pool) {
+    if (!pool || pool->reused + pool->allocated == 0) return;
+
+    printf("♻️  Пул кадров: %lu буферов переиспользовано, %lu выделено\n",
+           pool->reused, pool->allocated);
+}
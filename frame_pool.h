@@ -0,0 +1,37 @@
+// Пул кадров: выровненные буферы пикселей, привязанные к потоку
+// Без привязанного пула frame_alloc и frame_release работают как malloc и free
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+
+#define FRAME_ALIGN 64                       // Выравнивание буферов (байт)
+#define FRAME_POOL_FRAMES 3                  // Свободных кадров в пуле
+#define FRAME_POOL_MIN_BYTES (256 * 1024)    // Меньшие буферы не хранятся
+
+typedef struct FramePool FramePool;
+
+// Создание пула на capacity свободных буферов
+FramePool* frame_pool_create(int capacity);
+
+// Уничтожение пула и свободных буферов (выданные буферы остаются у владельцев)
+void frame_pool_destroy(FramePool* pool);
+
+// Привязка пула к текущему потоку (NULL - отвязать), возвращает прежний пул
+// Пул используется только своим потоком, блокировок нет
+FramePool* frame_pool_bind(FramePool* pool);
+
+// Пул текущего потока (NULL - не привязан)
+FramePool* frame_pool_current(void);
+
+// Буфер не меньше bytes байт без инициализации
+void* frame_alloc(size_t bytes);
+
+// Возврат буфера: bytes - известный владельцу размер (не больше выделенного)
+void frame_release(void* data, size_t bytes);
+
+// Печать статистики пула
+void frame_pool_print(const FramePool* pool);
+
+#endif
@@ -1,11 +1,13 @@
 #include "image.h"
+#include "frame_pool.h"
+#include "parallel.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 // Создание нового изображения
 
-Image* image_create(uint32_t width, uint32_t height) {
+Image* image_create_uninit(uint32_t width, uint32_t height) {
     // Проверка корректности размеров
     if (width == 0 || height == 0) {
         fprintf(stderr, "Ошибка: неверные размеры изображения %ux%u\n", width, height);
@@ -23,9 +25,9 @@ Image* image_create(uint32_t width, uint32_t height) {
     img->width = width;
     img->height = height;
     
-    // Выделение памяти для данных пикселей
+    // Выделение памяти для данных пикселей (из пула кадров, если он есть)
     size_t pixel_count = (size_t)width * (size_t)height;
-    img->data = (Color*)malloc(pixel_count * sizeof(Color));
+    img->data = (Color*)frame_alloc(pixel_count * sizeof(Color));
     
     if (!img->data) {
         fprintf(stderr, "Ошибка выделения памяти для данных изображения (%zu пикселей)\n", 
@@ -34,8 +36,17 @@ Image* image_create(uint32_t width, uint32_t height) {
         return NULL;
     }
     
+    return img;
+}
+
+Image* image_create(uint32_t width, uint32_t height) {
+    Image* img = image_create_uninit(width, height);
+    if (!img) {
+        return NULL;
+    }
+    
     // Инициализация всех пикселей черным цветом
-    memset(img->data, 0, pixel_count * sizeof(Color));
+    memset(img->data, 0, (size_t)width * (size_t)height * sizeof(Color));
     
     return img;
 }
@@ -45,12 +56,27 @@ Image* image_create(uint32_t width, uint32_t height) {
 void image_free(Image* img) {
     if (img) {
         if (img->data) {
-            free(img->data);
+            frame_release(img->data, (size_t)img->width * img->height * sizeof(Color));
         }
         free(img);
     }
 }
 
+// Замена данных изображения результатом фильтра
+
+void image_replace(Image* img, Image* result) {
+    if (img->data) {
+        frame_release(img->data, (size_t)img->width * img->height * sizeof(Color));
+    }
+    
+    img->data = result->data;
+    img->width = result->width;
+    img->height = result->height;
+    
+    // Структура результата больше не нужна, данные перешли к img
+    free(result);
+}
+
 // Глубокое копирование
 
 Image* image_copy(const Image* src) {
@@ -59,8 +85,8 @@ Image* image_copy(const Image* src) {
         return NULL;
     }
     
-    // Создание нового изображения такого же размера
-    Image* copy = image_create(src->width, src->height);
+    // Создание нового изображения такого же размера (перезаписывается целиком)
+    Image* copy = image_create_uninit(src->width, src->height);
     if (!copy) {
         return NULL;
     }
@@ -161,8 +187,8 @@ Image* image_create_subimage(const Image* src, uint32_t x, uint32_t y,
         fprintf(stderr, "Предупреждение: высота crop ограничена до %u\n", actual_height);
     }
     
-    // Создание нового изображения
-    Image* subimg = image_create(actual_width, actual_height);
+    // Создание нового изображения (перезаписывается целиком)
+    Image* subimg = image_create_uninit(actual_width, actual_height);
     if (!subimg) {
         return NULL;
     }
@@ -178,4 +204,460 @@ Image* image_create_subimage(const Image* src, uint32_t x, uint32_t y,
     }
     
     return subimg;
-}
\ No newline at end of file
+}
+// Планарное представление
+
+// Округление вверх до кратного PLANAR_LANES
+static size_t round_up_lanes(size_t n) {
+    return (n + PLANAR_LANES - 1) / PLANAR_LANES * PLANAR_LANES;
+}
+
+PlanarImage* planar_create(uint32_t width, uint32_t height, uint32_t border) {
+    if (width == 0 || height == 0) {
+        fprintf(stderr, "Ошибка: неверные размеры изображения %ux%u\n", width, height);
+        return NULL;
+    }
+    
+    PlanarImage* img = (PlanarImage*)malloc(sizeof(PlanarImage));
+    if (!img) {
+        fprintf(stderr, "Ошибка выделения памяти для структуры PlanarImage\n");
+        return NULL;
+    }
+    
+    // Левая рамка дополняется до кратного 8, чтобы пиксель x = 0 был выровнен
+    size_t left = round_up_lanes(border);
+    size_t stride = round_up_lanes(left + width + border);
+    size_t rows = (size_t)height + 2 * (size_t)border;
+    size_t plane_floats = stride * rows;
+    size_t bytes = plane_floats * 3 * sizeof(float);
+    
+    img->memory = frame_alloc(bytes);  // FRAME_ALIGN кратно PLANAR_ALIGN
+    if (!img->memory) {
+        fprintf(stderr, "Ошибка выделения памяти для планарного изображения (%zu байт)\n", 
+                bytes);
+        free(img);
+        return NULL;
+    }
+    
+    img->width = width;
+    img->height = height;
+    img->border = border;
+    img->stride = stride;
+    
+    for (int c = 0; c < 3; c++) {
+        img->planes[c] = (float*)img->memory + c * plane_floats + 
+                         (size_t)border * stride + left;
+    }
+    
+    return img;
+}
+
+void planar_free(PlanarImage* img) {
+    if (img) {
+        size_t rows = (size_t)img->height + 2 * (size_t)img->border;
+        frame_release(img->memory, img->stride * rows * 3 * sizeof(float));
+        free(img);
+    }
+}
+
+// Полоса преобразования Image <-> PlanarImage
+typedef struct {
+    const Image* image;
+    Image* target;
+    PlanarImage* planar;
+} PlanarConvert;
+
+static void planar_from_image_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    PlanarConvert* job = (PlanarConvert*)ctx;
+    uint32_t width = job->image->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const Color* src = job->image->data + (size_t)y * width;
+        float* r = planar_row(job->planar, 0, (int)y);
+        float* g = planar_row(job->planar, 1, (int)y);
+        float* b = planar_row(job->planar, 2, (int)y);
+        
+        for (uint32_t x = 0; x < width; x++) {
+            r[x] = src[x].r;
+            g[x] = src[x].g;
+            b[x] = src[x].b;
+        }
+    }
+}
+
+static void planar_to_image_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    PlanarConvert* job = (PlanarConvert*)ctx;
+    uint32_t width = job->target->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        Color* dst = job->target->data + (size_t)y * width;
+        const float* r = planar_row(job->planar, 0, (int)y);
+        const float* g = planar_row(job->planar, 1, (int)y);
+        const float* b = planar_row(job->planar, 2, (int)y);
+        
+        for (uint32_t x = 0; x < width; x++) {
+            dst[x].r = r[x];
+            dst[x].g = g[x];
+            dst[x].b = b[x];
+        }
+    }
+}
+
+PlanarImage* planar_from_image(const Image* src, uint32_t border) {
+    if (!src || !src->data) {
+        fprintf(stderr, "Ошибка: исходное изображение не инициализировано\n");
+        return NULL;
+    }
+    
+    PlanarImage* planar = planar_create(src->width, src->height, border);
+    if (!planar) {
+        return NULL;
+    }
+    
+    PlanarConvert job = { src, NULL, planar };
+    parallel_for_rows(src->height, planar_from_image_band, &job);
+    
+    planar_fill_border(planar);
+    return planar;
+}
+
+bool planar_to_image(const PlanarImage* src, Image* dst) {
+    if (!src || !dst || !dst->data || 
+        src->width != dst->width || src->height != dst->height) {
+        fprintf(stderr, "Ошибка: размеры планарного изображения не совпадают\n");
+        return false;
+    }
+    
+    PlanarConvert job = { NULL, dst, (PlanarImage*)src };
+    parallel_for_rows(dst->height, planar_to_image_band, &job);
+    return true;
+}
+
+void planar_fill_border(PlanarImage* img) {
+    if (!img || img->border == 0) return;
+    
+    int border = (int)img->border;
+    int width = (int)img->width;
+    int height = (int)img->height;
+    
+    for (int c = 0; c < 3; c++) {
+        // Левая и правая рамка каждой строки
+        for (int y = 0; y < height; y++) {
+            float* row = planar_row(img, c, y);
+            for (int i = 1; i <= border; i++) {
+                row[-i] = row[0];
+                row[width - 1 + i] = row[width - 1];
+            }
+        }
+        
+        // Верхняя и нижняя рамка (вместе с углами)
+        size_t row_bytes = ((size_t)width + 2 * border) * sizeof(float);
+        for (int i = 1; i <= border; i++) {
+            memcpy(planar_row(img, c, -i) - border, 
+                   planar_row(img, c, 0) - border, row_bytes);
+            memcpy(planar_row(img, c, height - 1 + i) - border, 
+                   planar_row(img, c, height - 1) - border, row_bytes);
+        }
+    }
+}
+
+// 8-битное представление
+
+Image8* image8_create(uint32_t width, uint32_t height) {
+    if (width == 0 || height == 0) {
+        fprintf(stderr, "Ошибка: неверные размеры изображения %ux%u\n", width, height);
+        return NULL;
+    }
+    
+    Image8* img = (Image8*)malloc(sizeof(Image8));
+    if (!img) {
+        fprintf(stderr, "Ошибка выделения памяти для структуры Image8\n");
+        return NULL;
+    }
+    
+    size_t pixel_count = (size_t)width * (size_t)height;
+    img->data = (BMPixel*)frame_alloc(pixel_count * sizeof(BMPixel));
+    if (!img->data) {
+        fprintf(stderr, "Ошибка выделения памяти для данных изображения (%zu пикселей)\n", 
+                pixel_count);
+        free(img);
+        return NULL;
+    }
+    
+    img->width = width;
+    img->height = height;
+    return img;
+}
+
+void image8_free(Image8* img) {
+    if (img) {
+        frame_release(img->data, (size_t)img->width * img->height * sizeof(BMPixel));
+        free(img);
+    }
+}
+
+Image8* image8_from_image(const Image* src) {
+    if (!src || !src->data) {
+        fprintf(stderr, "Ошибка: исходное изображение не инициализировано\n");
+        return NULL;
+    }
+    
+    Image8* img = image8_create(src->width, src->height);
+    if (!img) {
+        return NULL;
+    }
+    
+    size_t pixel_count = (size_t)src->width * (size_t)src->height;
+    for (size_t i = 0; i < pixel_count; i++) {
+        img->data[i].r = color_channel_to_u8(src->data[i].r);
+        img->data[i].g = color_channel_to_u8(src->data[i].g);
+        img->data[i].b = color_channel_to_u8(src->data[i].b);
+    }
+    
+    return img;
+}
+
+bool image_on_byte_grid(const Image* img) {
+    if (!img || !img->data) return false;
+    
+    const float* values = (const float*)img->data;
+    size_t count = (size_t)img->width * img->height * 3;
+    for (size_t i = 0; i < count; i++) {
+        if ((float)color_channel_to_u8(values[i]) / 255.0f != values[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Image* image_from_image8(const Image8* src) {
+    if (!src || !src->data) {
+        fprintf(stderr, "Ошибка: исходное изображение не инициализировано\n");
+        return NULL;
+    }
+    
+    Image* img = image_create_uninit(src->width, src->height);
+    if (!img) {
+        return NULL;
+    }
+    
+    size_t pixel_count = (size_t)src->width * (size_t)src->height;
+    for (size_t i = 0; i < pixel_count; i++) {
+        img->data[i] = bmpixel_to_color(src->data[i]);
+    }
+    
+    return img;
+}
+
+// Таблица сумм
+
+#define INTEGRAL_COLUMN_BLOCK 512  // Столбцов (double) в полосе вертикального прохода
+
+// Задание построения таблицы сумм
+typedef struct {
+    const Image* image;
+    IntegralImage* sat;
+    size_t stride;                 // double в строке таблицы
+} IntegralBuild;
+
+// Строка таблицы y (y = 0 - нулевая строка)
+static inline double* integral_row(double* table, size_t stride, uint32_t y) {
+    return table + (size_t)y * stride;
+}
+
+// Первый проход: суммы по строкам (строка y изображения -> строка y + 1 таблицы)
+static void integral_rows_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    IntegralBuild* job = (IntegralBuild*)ctx;
+    uint32_t width = job->image->width;
+    
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const Color* src = job->image->data + (size_t)y * width;
+        double* sums = integral_row(job->sat->sums, job->stride, y + 1);
+        double* squares = job->sat->squares ? 
+                          integral_row(job->sat->squares, job->stride, y + 1) : NULL;
+        
+        double r = 0.0, g = 0.0, b = 0.0;
+        sums[0] = sums[1] = sums[2] = 0.0;
+        for (uint32_t x = 0; x < width; x++) {
+            r += src[x].r;
+            g += src[x].g;
+            b += src[x].b;
+            sums[3 * x + 3] = r;
+            sums[3 * x + 4] = g;
+            sums[3 * x + 5] = b;
+        }
+        
+        if (!squares) continue;
+        
+        r = g = b = 0.0;
+        squares[0] = squares[1] = squares[2] = 0.0;
+        for (uint32_t x = 0; x < width; x++) {
+            r += (double)src[x].r * src[x].r;
+            g += (double)src[x].g * src[x].g;
+            b += (double)src[x].b * src[x].b;
+            squares[3 * x + 3] = r;
+            squares[3 * x + 4] = g;
+            squares[3 * x + 5] = b;
+        }
+    }
+}
+
+// Накопление по столбцам [begin, end) сверху вниз
+static void integral_accumulate(double* table, size_t stride, uint32_t rows,
+                                size_t begin, size_t end) {
+    for (uint32_t y = 1; y < rows; y++) {
+        const double* above = integral_row(table, stride, y - 1);
+        double* row = integral_row(table, stride, y);
+        for (size_t i = begin; i < end; i++) {
+            row[i] += above[i];
+        }
+    }
+}
+
+// Второй проход: суммы по столбцам, полосы - блоки столбцов таблицы
+//  Строки зависят от предыдущих, поэтому таблица делится по ширине
+static void integral_columns_band(void* ctx, uint32_t block_begin, uint32_t block_end) {
+    IntegralBuild* job = (IntegralBuild*)ctx;
+    uint32_t rows = job->sat->height + 1;
+    size_t begin = (size_t)block_begin * INTEGRAL_COLUMN_BLOCK;
+    size_t end = (size_t)block_end * INTEGRAL_COLUMN_BLOCK;
+    if (end > job->stride) end = job->stride;
+    
+    integral_accumulate(job->sat->sums, job->stride, rows, begin, end);
+    if (job->sat->squares) {
+        integral_accumulate(job->sat->squares, job->stride, rows, begin, end);
+    }
+}
+
+// Размер одной таблицы в байтах
+static size_t integral_bytes(uint32_t width, uint32_t height) {
+    return ((size_t)width + 1) * 3 * ((size_t)height + 1) * sizeof(double);
+}
+
+IntegralImage* integral_create(const Image* src, bool with_squares) {
+    if (!src || !src->data) {
+        fprintf(stderr, "Ошибка: исходное изображение не инициализировано\n");
+        return NULL;
+    }
+    
+    IntegralImage* sat = (IntegralImage*)calloc(1, sizeof(IntegralImage));
+    if (!sat) {
+        fprintf(stderr, "Ошибка выделения памяти для структуры IntegralImage\n");
+        return NULL;
+    }
+    
+    sat->width = src->width;
+    sat->height = src->height;
+    
+    size_t bytes = integral_bytes(src->width, src->height);
+    sat->sums = (double*)frame_alloc(bytes);
+    if (with_squares) {
+        sat->squares = (double*)frame_alloc(bytes);
+    }
+    if (!sat->sums || (with_squares && !sat->squares)) {
+        fprintf(stderr, "Ошибка выделения памяти для таблицы сумм (%zu байт)\n", bytes);
+        integral_free(sat);
+        return NULL;
+    }
+    
+    IntegralBuild job = { src, sat, ((size_t)src->width + 1) * 3 };
+    
+    // Нулевая строка; нулевой столбец заполняет первый проход
+    memset(sat->sums, 0, job.stride * sizeof(double));
+    if (sat->squares) {
+        memset(sat->squares, 0, job.stride * sizeof(double));
+    }
+    
+    parallel_for_rows(src->height, integral_rows_band, &job);
+    
+    uint32_t blocks = (uint32_t)((job.stride + INTEGRAL_COLUMN_BLOCK - 1) / 
+                                 INTEGRAL_COLUMN_BLOCK);
+    parallel_for_rows(blocks, integral_columns_band, &job);
+    
+    return sat;
+}
+
+void integral_free(IntegralImage* sat) {
+    if (sat) {
+        size_t bytes = integral_bytes(sat->width, sat->height);
+        frame_release(sat->sums, bytes);
+        frame_release(sat->squares, bytes);
+        free(sat);
+    }
+}
+
+// Обрезка прямоугольника по изображению (false - пустая область)
+static bool integral_clip(const IntegralImage* sat, uint32_t x, uint32_t y,
+                          uint32_t width, uint32_t height, 
+                          uint32_t* x1, uint32_t* y1) {
+    if (!sat || width == 0 || height == 0 || 
+        x >= sat->width || y >= sat->height) {
+        return false;
+    }
+    
+    *x1 = (width > sat->width - x) ? sat->width : x + width;
+    *y1 = (height > sat->height - y) ? sat->height : y + height;
+    return true;
+}
+
+// Сумма каналов прямоугольника [x0, x1) x [y0, y1)
+static void integral_sum(const double* table, size_t stride,
+                         uint32_t x0, uint32_t y0, uint32_t x1, uint32_t y1,
+                         double sum[3]) {
+    const double* top = table + (size_t)y0 * stride;
+    const double* bottom = table + (size_t)y1 * stride;
+    
+    for (int c = 0; c < 3; c++) {
+        sum[c] = bottom[3 * (size_t)x1 + c] - bottom[3 * (size_t)x0 + c] -
+                 top[3 * (size_t)x1 + c] + top[3 * (size_t)x0 + c];
+    }
+}
+
+Color integral_mean(const IntegralImage* sat, uint32_t x, uint32_t y,
+                    uint32_t width, uint32_t height) {
+    Color mean = {0, 0, 0};
+    uint32_t x1, y1;
+    
+    if (!integral_clip(sat, x, y, width, height, &x1, &y1)) {
+        return mean;
+    }
+    
+    size_t stride = ((size_t)sat->width + 1) * 3;
+    double area = (double)(x1 - x) * (double)(y1 - y);
+    double sum[3];
+    integral_sum(sat->sums, stride, x, y, x1, y1, sum);
+    
+    mean.r = (float)(sum[0] / area);
+    mean.g = (float)(sum[1] / area);
+    mean.b = (float)(sum[2] / area);
+    return mean;
+}
+
+Color integral_variance(const IntegralImage* sat, uint32_t x, uint32_t y,
+                        uint32_t width, uint32_t height) {
+    Color variance = {0, 0, 0};
+    uint32_t x1, y1;
+    
+    if (!integral_clip(sat, x, y, width, height, &x1, &y1) || !sat->squares) {
+        return variance;
+    }
+    
+    size_t stride = ((size_t)sat->width + 1) * 3;
+    double area = (double)(x1 - x) * (double)(y1 - y);
+    double sum[3], squares[3], result[3];
+    integral_sum(sat->sums, stride, x, y, x1, y1, sum);
+    integral_sum(sat->squares, stride, x, y, x1, y1, squares);
+    
+    // D = E[x²] - E[x]²; при почти постоянной области разность может
+    // уйти в небольшой минус из-за округления
+    for (int c = 0; c < 3; c++) {
+        double mean = sum[c] / area;
+        result[c] = squares[c] / area - mean * mean;
+        if (result[c] < 0.0) result[c] = 0.0;
+    }
+    
+    variance.r = (float)result[0];
+    variance.g = (float)result[1];
+    variance.b = (float)result[2];
+    return variance;
+}
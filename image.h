@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 // Структура для представления цвета пикселя
 
@@ -29,6 +30,49 @@ typedef struct {
     uint32_t height;    // Высота изображения в пикселях
 } Image;
 
+// Изображение с 8-битными каналами
+//  Пиксели хранятся в порядке BGR, как в файле BMP: 3 байта вместо 12,
+//  строки можно копировать из файла и в файл без преобразования
+
+typedef struct {
+    BMPixel* data;      // Массив пикселей в формате row-major
+    uint32_t width;     // Ширина изображения в пикселях
+    uint32_t height;    // Высота изображения в пикселях
+} Image8;
+
+// Планарное представление изображения (SoA)
+//  Каналы R, G, B хранятся в отдельных плоскостях, начало каждой строки
+//  выровнено по 32 байта, длина строки (stride) кратна 8 float.
+//  Вокруг изображения есть рамка border пикселей для ядер свертки,
+//  planar_fill_border заполняет ее повтором крайних пикселей.
+
+#define PLANAR_ALIGN 32           // Выравнивание плоскостей (байт)
+#define PLANAR_LANES 8            // float в одном AVX регистре
+
+typedef struct {
+    float* planes[3];   // Пиксель (0, 0) плоскостей R, G, B
+    void* memory;       // Выделенный блок (все три плоскости)
+    uint32_t width;     // Ширина изображения в пикселях
+    uint32_t height;    // Высота изображения в пикселях
+    uint32_t border;    // Ширина рамки в пикселях
+    size_t stride;      // Длина строки плоскости в float (с рамкой и выравниванием)
+} PlanarImage;
+
+// Таблица сумм (summed-area table, интегральное изображение)
+//  Элемент (x, y) - сумма каналов прямоугольника [0, x) x [0, y),
+//  таблица (width + 1) x (height + 1), нулевые строка и столбец.
+//  Сумма любого прямоугольника - четыре обращения к таблице, поэтому
+//  среднее и дисперсия области считаются за O(1) при любом ее размере.
+//  Суммы в double: для изображения 2^24 пикселей ошибка остается
+//  на уровне 1e-9 от суммы.
+
+typedef struct {
+    double* sums;       // Суммы R, G, B (по 3 double на элемент)
+    double* squares;    // Суммы квадратов R, G, B (NULL, если не строились)
+    uint32_t width;     // Ширина изображения в пикселях
+    uint32_t height;    // Высота изображения в пикселях
+} IntegralImage;
+
 // Вспомогательные функции для работы с цветом
 
 // Создание цвета из компонент
@@ -67,6 +111,13 @@ static inline Color bmpixel_to_color(BMPixel p) {
     return c;
 }
 
+// Квантование компоненты [0, 1] -> [0, 255] с округлением
+static inline uint8_t color_channel_to_u8(float v) {
+    if (v < 0.0f) v = 0.0f;
+    if (v > 1.0f) v = 1.0f;
+    return (uint8_t)(v * 255.0f + 0.5f);
+}
+
 // Сложение цветов (используется в фильтрах)
 static inline Color color_add(Color a, Color b) {
     return color_create(a.r + b.r, a.g + b.g, a.b + b.b);
@@ -88,12 +139,19 @@ static inline Color color_lerp(Color a, Color b, float t) {
 
 // Основные функции работы с изображениями
 
-// Создание нового изображения заданного размера
+// Создание нового изображения заданного размера (пиксели черные)
 Image* image_create(uint32_t width, uint32_t height);
 
+// Создание изображения без инициализации пикселей
+// Для результатов, которые перезаписываются целиком
+Image* image_create_uninit(uint32_t width, uint32_t height);
+
 // Освобождение памяти изображения
 void image_free(Image* img);
 
+// Замена данных img данными result (result освобождается)
+void image_replace(Image* img, Image* result);
+
 // Создание глубокой копии изображения
 Image* image_copy(const Image* src);
 
@@ -118,4 +176,61 @@ uint32_t image_get_height(const Image* img);
 Image* image_create_subimage(const Image* src, uint32_t x, uint32_t y, 
                             uint32_t width, uint32_t height);
 
+// Функции 8-битного представления
+
+// Создание 8-битного изображения (без инициализации пикселей)
+Image8* image8_create(uint32_t width, uint32_t height);
+
+// Освобождение 8-битного изображения
+void image8_free(Image8* img);
+
+// Преобразование Image -> Image8 (с ограничением и округлением)
+Image8* image8_from_image(const Image* src);
+
+// Все компоненты лежат на сетке k/255 (как после загрузки BMP): перевод
+// в 8 бит и обратно не меняет ни одного значения
+bool image_on_byte_grid(const Image* img);
+
+// Преобразование Image8 -> Image
+Image* image_from_image8(const Image8* src);
+
+// Функции планарного представления
+
+// Создание планарного изображения с рамкой border пикселей (без инициализации)
+PlanarImage* planar_create(uint32_t width, uint32_t height, uint32_t border);
+
+// Освобождение планарного изображения
+void planar_free(PlanarImage* img);
+
+// Преобразование Image -> PlanarImage (рамка заполняется повтором краев)
+PlanarImage* planar_from_image(const Image* src, uint32_t border);
+
+// Преобразование PlanarImage -> Image (размеры должны совпадать)
+bool planar_to_image(const PlanarImage* src, Image* dst);
+
+// Заполнение рамки повтором крайних пикселей
+void planar_fill_border(PlanarImage* img);
+
+// Указатель на пиксель (0, y) канала channel (0 - R, 1 - G, 2 - B)
+// y может выходить за изображение в пределах рамки
+static inline float* planar_row(const PlanarImage* img, int channel, int y) {
+    return img->planes[channel] + (ptrdiff_t)y * (ptrdiff_t)img->stride;
+}
+
+// Функции таблицы сумм
+
+// Построение таблицы сумм (with_squares - также суммы квадратов для дисперсии)
+IntegralImage* integral_create(const Image* src, bool with_squares);
+
+// Освобождение таблицы сумм
+void integral_free(IntegralImage* sat);
+
+// Средний цвет прямоугольника (обрезается по изображению, пустой - черный)
+Color integral_mean(const IntegralImage* sat, uint32_t x, uint32_t y,
+                    uint32_t width, uint32_t height);
+
+// Дисперсия каналов прямоугольника (нужна таблица с суммами квадратов)
+Color integral_variance(const IntegralImage* sat, uint32_t x, uint32_t y,
+                        uint32_t width, uint32_t height);
+
 #endif
\ No newline at end of file
@@ -4,10 +4,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <ctype.h>
+#include <stdint.h>
 
+#include "batch.h"
 #include "bmp.h"
 #include "image.h"
+#include "parallel.h"
 #include "pipeline.h"
+#include "profile.h"
+#include "server.h"
+#include "stream.h"
 #include "utils.h"
 
 // Константы и глобальные переменные
@@ -27,21 +34,32 @@ void print_help(void) {
     printf("\n");
     printf("📋 Использование:\n");
     printf("  image_craft <входной_файл> <выходной_файл> [фильтры...]\n");
+    printf("  image_craft --batch <список|каталог|шаблон> <каталог_результатов> [фильтры...]\n");
+    printf("  image_craft --serve <сокет> [-threads N] [-jobs N]\n");
     printf("\n");
     printf("🎯 Примеры:\n");
     printf("  image_craft input.bmp output.bmp -crop 800 600 -gs -blur 0.5\n");
     printf("  image_craft photo.bmp result.bmp -neg -sharp -edge 0.1\n");
+    printf("  image_craft photo.bmp thumb.bmp -resize 320 240 -sharp\n");
     printf("  image_craft in.bmp out.bmp -crystallize 15 -glass 3.0\n");
     printf("  image_craft image.bmp mosaic.bmp -mosaic 32 tiles.bmp\n");
+    printf("  image_craft in.bmp out.bmp -sharp -tee s.bmp -branch g.bmp -gs -end -blur 2\n");
+    printf("  image_craft big.bmp out.bmp -threads 8 -med 5 -blur 2\n");
+    printf("  image_craft --batch list.txt out/ -jobs 4 -gs -blur 2\n");
+    printf("  image_craft --serve /run/imagecraft.sock -jobs 4\n");
     printf("\n");
     printf("🛠️  Базовые фильтры:\n");
     printf("  -crop W H          Обрезка до WxH пикселей (верхний левый угол)\n");
+    printf("  -resize W H [M]    Масштабирование до WxH, M - lanczos (по умолчанию)\n");
+    printf("                     или bicubic\n");
     printf("  -gs                Преобразование в оттенки серого\n");
     printf("  -neg               Негатив изображения\n");
     printf("  -sharp             Повышение резкости\n");
     printf("  -edge THRESH       Выделение границ с порогом THRESH (0.0-1.0)\n");
     printf("  -med WINDOW        Медианный фильтр (WINDOW - нечетное число)\n");
     printf("  -blur SIGMA        Гауссово размытие с сигмой SIGMA\n");
+    printf("  -fblur SIGMA       Быстрое размытие (3 бокса, время не зависит от SIGMA)\n");
+    printf("  -conv FILE         Свертка с ядром NxN из текстового файла (N нечетное)\n");
     printf("\n");
     printf("🌟 Дополнительные фильтры:\n");
     printf("  -crystallize SIZE  Эффект кристаллизации (размер ячейки)\n");
@@ -50,11 +68,38 @@ void print_help(void) {
     printf("🏆 Бонусный фильтр:\n");
     printf("  -mosaic SIZE FILE  Мозаика с плитками из FILE (размер SIZE)\n");
     printf("\n");
+    printf("🔀 Ветви (несколько результатов из одной загрузки):\n");
+    printf("  -tee FILE          Сохранить текущее изображение в FILE и продолжить\n");
+    printf("  -branch FILE ... -end\n");
+    printf("                     Применить фильтры до -end к копии текущего изображения\n");
+    printf("                     и сохранить в FILE; основная цепочка продолжается\n");
+    printf("                     без них. Ветви одной точки выполняются одновременно\n");
+    printf("\n");
+    printf("⚙️  Параметры выполнения:\n");
+    printf("  -threads N         Количество потоков (0 - по числу ядер, по умолчанию)\n");
+    printf("  -u8                8-битный режим для -crop -gs -neg -sharp -edge -med\n");
+    printf("                     (в 4 раза меньше памяти; каждый шаг округляет до 1/255,\n");
+    printf("                     -edge у порога может дать противоположный пиксель;\n");
+    printf("                     с другими фильтрами - обычный режим и уведомление)\n");
+    printf("  -stream            Потоковая обработка полосами строк для больших файлов\n");
+    printf("                     (-crop -gs -neg -sharp -edge -med -blur -fblur)\n");
+    printf("  -jobs N            Файлов одновременно в режиме --batch, заданий в --serve\n");
+    printf("                     (0 - по числу потоков)\n");
+    printf("  -seed N            Зерно случайных фильтров (-crystallize), по умолчанию 0:\n");
+    printf("                     одинаковый seed - одинаковый результат\n");
+    printf("  --profile [FILE]   Время, ЦП и память каждого этапа: таблица и трасса\n");
+    printf("                     Chrome trace (по умолчанию <выходной_файл>.trace.json)\n");
+    printf("\n");
     printf("📝 Примечания:\n");
     printf("  • Фильтры применяются в порядке указания\n");
     printf("  • Изображения должны быть в 24-битном BMP формате\n");
     printf("  • Поддерживаются файлы с заголовком BITMAPINFOHEADER\n");
     printf("  • Все компоненты цвета представляются числами [0.0, 1.0]\n");
+    printf("  • --batch: список - файл с путями (по одному на строку), каталог - все *.bmp,\n");
+    printf("    шаблон - в кавычках (\"in/*.bmp\"); журнал фильтров скрыт, в конце - отчет\n");
+    printf("  • --serve: задания - строки \"<вход> <выход> [фильтры...]\" через Unix-сокет,\n");
+    printf("    ответ - \"OK total_ms=...\" или \"ERROR ...\"; потоки, пулы и плитки мозаики\n");
+    printf("    остаются загруженными между заданиями; остановка - SIGINT/SIGTERM\n");
     printf("\n");
     printf("🔗 Ссылки:\n");
     printf("  • Формат BMP: https://en.wikipedia.org/wiki/BMP_file_format\n");
@@ -111,82 +156,197 @@ bool parse_arguments(int argc, char** argv,
     }
     
     // Обрабатываем фильтры (начиная с 3-го аргумента)
-    int i = 3;
-    while (i < argc) {
-        if (argv[i][0] == '-') {
-            // Нашли фильтр
-            char* filter_name = argv[i] + 1;  // Пропускаем '-'
-            FilterType filter_type = filter_name_to_type(filter_name);
-            
-            if (filter_type == FILTER_COUNT) {
-                fprintf(stderr, "❌ Неизвестный фильтр: -%s\n", filter_name);
-                pipeline_destroy(*pipeline);
-                return false;
-            }
-            
-            // Определяем количество аргументов для этого фильтра
-            int arg_count = 0;
-            char** filter_args = NULL;
-            
-            // Для каждого типа фильтра определяем необходимое количество аргументов
-            switch (filter_type) {
-                case FILTER_CROP:
-                    arg_count = 2;
-                    break;
-                case FILTER_EDGE:
-                case FILTER_MEDIAN:
-                case FILTER_BLUR:
-                case FILTER_CRYSTALLIZE:
-                case FILTER_GLASS:
-                    arg_count = 1;
-                    break;
-                case FILTER_MOSAIC:
-                    arg_count = 2;
-                    break;
-                case FILTER_GRAYSCALE:
-                case FILTER_NEGATIVE:
-                case FILTER_SHARPEN:
-                    arg_count = 0;
-                    break;
-                default:
-                    arg_count = 0;
-                    break;
-            }
-            
-            // Проверяем, достаточно ли аргументов
-            if (i + arg_count >= argc) {
-                fprintf(stderr, "❌ Недостаточно аргументов для фильтра -%s\n", filter_name);
-                fprintf(stderr, "   Требуется %d аргумент(ов)\n", arg_count);
-                pipeline_destroy(*pipeline);
-                return false;
-            }
-            
-            // Собираем аргументы фильтра
-            if (arg_count > 0) {
-                filter_args = &argv[i + 1];
-            }
-            
-            // Добавляем фильтр в конвейер
-            if (!pipeline_add_filter(*pipeline, filter_type, filter_args, arg_count)) {
-                fprintf(stderr, "❌ Ошибка добавления фильтра -%s\n", filter_name);
-                pipeline_destroy(*pipeline);
-                return false;
-            }
-            
-            // Пропускаем обработанные аргументы
-            i += arg_count + 1;
-        } else {
-            // Неожиданный аргумент (не начинается с '-')
-            fprintf(stderr, "Неожиданный аргумент: %s (ожидается фильтр с префиксом '-')\n", 
-                    argv[i]);
-            pipeline_destroy(*pipeline);
-            return false;
-        }
+    if (!pipeline_parse_options(*pipeline, argc, argv, 3)) {
+        pipeline_destroy(*pipeline);
+        return false;
     }
     
     return true;
 }
 
+// Вывод профиля: таблица этапов и трасса (--profile)
+
+void finish_profile(const FilterPipeline* pipeline, const char* output) {
+    if (!pipeline->profile) return;
+    
+    profile_print(stdout);
+    
+    char trace_file[4096];
+    if (pipeline->trace_file) {
+        snprintf(trace_file, sizeof(trace_file), "%s", pipeline->trace_file);
+    } else {
+        snprintf(trace_file, sizeof(trace_file), "%s.trace.json", output);
+    }
+    
+    if (profile_write_trace(trace_file)) {
+        printf("🧭 Трасса профиля: %s\n", trace_file);
+    }
+    profile_reset();
+}
+
+// Потоковая обработка
+
+int run_stream(FilterPipeline* pipeline, const char* input_file, const char* output_file) {
+    printf("\n📥 Потоковая обработка: %s\n", input_file);
+    
+    ProfileSpan span;
+    profile_begin(&span);
+    bool ok = stream_run(pipeline, input_file, output_file);
+    profile_end(&span, "stream", "stream_run", input_file, 0);
+    
+    finish_profile(pipeline, output_file);
+    pipeline_destroy(pipeline);
+    parallel_shutdown();
+    
+    if (!ok) {
+        return 1;
+    }
+    
+    printf("\nОбработка завершена успешно!\n");
+    printf("Входной файл:  %s\n", input_file);
+    printf("Выходной файл: %s\n", output_file);
+    printf("\n");
+    
+    return 0;
+}
+
+// Пакетная обработка: image_craft --batch SOURCE OUTDIR [параметры и фильтры]
+
+int run_batch(int argc, char** argv) {
+    if (argc < 4) {
+        fprintf(stderr, "❌ Использование: image_craft --batch <список|каталог|шаблон> "
+                "<каталог_результатов> [фильтры...]\n");
+        return 1;
+    }
+    
+    FilterPipeline* pipeline = pipeline_create();
+    if (!pipeline) {
+        fprintf(stderr, "❌ Ошибка создания конвейера фильтров\n");
+        return 1;
+    }
+    
+    if (!pipeline_parse_options(pipeline, argc, argv, 4)) {
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    // Файлы ветвей одни на все входы: результаты перезаписывали бы друг друга
+    if (pipeline_has_branches(pipeline)) {
+        fprintf(stderr, "❌ -tee и -branch в режиме --batch не поддерживаются\n");
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    int failed = batch_run(pipeline, argv[2], argv[3]);
+    
+    // Трасса по умолчанию: OUTDIR/batch.trace.json
+    char batch_name[4096];
+    snprintf(batch_name, sizeof(batch_name), "%s/batch", argv[3]);
+    finish_profile(pipeline, batch_name);
+    
+    pipeline_destroy(pipeline);
+    parallel_shutdown();
+    
+    return failed == 0 ? 0 : 1;
+}
+
+// Режим сервера: image_craft --serve SOCKET [-threads N] [-jobs N]
+
+int run_serve(int argc, char** argv) {
+    if (argc < 3) {
+        fprintf(stderr, "❌ Использование: image_craft --serve <сокет> [-threads N] [-jobs N]\n");
+        return 1;
+    }
+    
+    FilterPipeline* pipeline = pipeline_create();
+    if (!pipeline) {
+        fprintf(stderr, "❌ Ошибка создания конвейера фильтров\n");
+        return 1;
+    }
+    
+    if (!pipeline_parse_options(pipeline, argc, argv, 3)) {
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    if (pipeline->count > 0 || pipeline->allow_u8 || pipeline->streaming || pipeline->seed != 0) {
+        fprintf(stderr, "❌ Фильтры, -u8, -stream и -seed задаются в заданиях сервера\n");
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    if (pipeline->profile) {
+        fprintf(stderr, "❌ --profile в режиме сервера не поддерживается\n");
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    int slots = pipeline->jobs > 0 ? pipeline->jobs : parallel_get_threads();
+    pipeline_destroy(pipeline);
+    
+    int result = server_run(argv[2], slots);
+    parallel_shutdown();
+    
+    return result;
+}
+
+// Обработка в 8-битном режиме
+
+int run_u8(FilterPipeline* pipeline, const char* input_file, const char* output_file) {
+    printf("\n📥 Загрузка изображения (8 бит): %s\n", input_file);
+    ProfileSpan span;
+    profile_begin(&span);
+    Image8* image = bmp_load8(input_file);
+    profile_end(&span, "io", "bmp_load8", input_file,
+                image ? (uint64_t)image->width * image->height : 0);
+    
+    if (!image) {
+        fprintf(stderr, "Ошибка загрузки BMP изображения: %s\n", input_file);
+        fprintf(stderr, "Требуется: 24-битный BMP без сжатия (BITMAPINFOHEADER)\n");
+        pipeline_destroy(pipeline);
+        return 1;
+    }
+    
+    printf("✅ Изображение загружено: %u x %u пикселей\n", 
+           image->width, image->height);
+    
+    if (pipeline->count > 0) {
+        pipeline_print(pipeline);
+        printf("\nПрименение фильтров...\n");
+        
+        if (!pipeline_apply_u8(pipeline, image)) {
+            fprintf(stderr, "Ошибка применения фильтров\n");
+            image8_free(image);
+            pipeline_destroy(pipeline);
+            return 1;
+        }
+    }
+    
+    printf("\nСохранение результата: %s\n", output_file);
+    profile_begin(&span);
+    bool saved = bmp_save8(output_file, image);
+    profile_end(&span, "io", "bmp_save8", output_file, (uint64_t)image->width * image->height);
+    if (!saved) {
+        fprintf(stderr, "Ошибка сохранения изображения: %s\n", output_file);
+    }
+    
+    image8_free(image);
+    finish_profile(pipeline, output_file);
+    pipeline_destroy(pipeline);
+    parallel_shutdown();
+    
+    if (!saved) {
+        return 1;
+    }
+    
+    printf("\nОбработка завершена успешно!\n");
+    printf("Входной файл:  %s\n", input_file);
+    printf("Выходной файл: %s\n", output_file);
+    printf("\n");
+    
+    return 0;
+}
+
 // ============================================
 // Основная функция
 // ============================================
@@ -201,6 +361,16 @@ int main(int argc, char** argv) {
     FilterPipeline* pipeline = NULL;
     Image* image = NULL;
     
+    // Пакетный режим
+    if (argc >= 2 && strcmp(argv[1], "--batch") == 0) {
+        return run_batch(argc, argv);
+    }
+    
+    // Режим сервера
+    if (argc >= 2 && strcmp(argv[1], "--serve") == 0) {
+        return run_serve(argc, argv);
+    }
+    
     // 1. Парсинг аргументов командной строки
     if (!parse_arguments(argc, argv, &input_file, &output_file, &pipeline)) {
         return 1;
@@ -213,9 +383,43 @@ int main(int argc, char** argv) {
         return 1;
     }
     
+    // 3. Потоковая обработка: изображение не загружается целиком
+    if (pipeline->streaming) {
+        if (file_same(input_file, output_file)) {
+            // Запись результата полосами затерла бы еще не прочитанный вход
+            printf("ℹ️  Результат записывается в исходный файл, "
+                   "изображение будет загружено целиком\n");
+        } else if (!file_regular_or_missing(output_file)) {
+            // Полосы пишутся по смещениям, в канал или терминал - только подряд
+            printf("ℹ️  Результат записывается не в обычный файл, "
+                   "изображение будет загружено целиком\n");
+        } else if (stream_supported(pipeline)) {
+            if (pipeline->allow_u8) {
+                printf("ℹ️  Потоковая обработка идет во float, -u8 не используется\n");
+            }
+            return run_stream(pipeline, input_file, output_file);
+        } else {
+            printf("ℹ️  Не все фильтры поддерживают потоковую обработку, "
+                   "изображение будет загружено целиком\n");
+        }
+    }
+    
+    // 3. 8-битный режим: загрузка, фильтры и сохранение без перевода в float
+    if (pipeline_use_u8(pipeline)) {
+        return run_u8(pipeline, input_file, output_file);
+    }
+    if (pipeline->allow_u8) {
+        printf("ℹ️  Не все фильтры поддерживают 8-битный режим, "
+               "изображение будет обработано во float\n");
+    }
+    
     // 3. Загрузка изображения
     printf("\n📥 Загрузка изображения: %s\n", input_file);
+    ProfileSpan span;
+    profile_begin(&span);
     image = bmp_load(input_file);
+    profile_end(&span, "io", "bmp_load", input_file,
+                image ? (uint64_t)image->width * image->height : 0);
     
     if (!image) {
         fprintf(stderr, "Ошибка загрузки BMP изображения: %s\n", input_file);
@@ -250,7 +454,11 @@ int main(int argc, char** argv) {
     // 6. Сохранение результата
     printf("\nСохранение результата: %s\n", output_file);
     
-    if (!bmp_save(output_file, image)) {
+    profile_begin(&span);
+    bool saved = bmp_save(output_file, image);
+    profile_end(&span, "io", "bmp_save", output_file, (uint64_t)image->width * image->height);
+    
+    if (!saved) {
         fprintf(stderr, "Ошибка сохранения изображения: %s\n", output_file);
         
         // Попробуем сохранить с другим именем
@@ -269,7 +477,9 @@ int main(int argc, char** argv) {
     
     // 7. Освобождение ресурсов
     image_free(image);
+    finish_profile(pipeline, output_file);
     pipeline_destroy(pipeline);
+    parallel_shutdown();
     
     // 8. Завершение работы
     printf("\nОбработка завершена успешно!\n");
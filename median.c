@@ -0,0 +1,533 @@
+#include "median.h"
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+// Константы
+
+#define MEDIAN_BINS 256          // Уровней в 8-битном канале
+#define MEDIAN_COARSE 16         // Грубых корзин (по 16 уровней)
+#define MEDIAN_MAX_NETWORK 25    // Самая большая сеть выбора (окно 5x5)
+
+// Сеть выбора медианы
+
+typedef struct {
+    uint8_t a, b;                // После обмена: a <= b
+} Comparator;
+
+typedef struct {
+    int n;                       // Количество входов
+    int count;                   // Количество компараторов
+    Comparator ops[MEDIAN_MAX_NETWORK * MEDIAN_MAX_NETWORK];
+} SelectionNetwork;
+
+// Построение сети: сортирующая сеть слиянием с обменами (Knuth, алгоритм M),
+// из которой удалены компараторы, не влияющие на центральный выход
+static void network_build(SelectionNetwork* net, int n) {
+    Comparator full[MEDIAN_MAX_NETWORK * MEDIAN_MAX_NETWORK];
+    int full_count = 0;
+
+    int t = 0;
+    while ((1 << t) < n) t++;
+
+    for (int p = 1 << (t - 1); p > 0; p >>= 1) {
+        int q = 1 << (t - 1);
+        int r = 0;
+        int d = p;
+
+        while (d > 0) {
+            for (int i = 0; i < n - d; i++) {
+                if ((i & p) == r) {
+                    full[full_count].a = (uint8_t)i;
+                    full[full_count].b = (uint8_t)(i + d);
+                    full_count++;
+                }
+            }
+            d = q - p;
+            q >>= 1;
+            r = p;
+        }
+    }
+
+    // Обратный проход: оставляем компараторы, от которых зависит медиана
+    bool needed[MEDIAN_MAX_NETWORK] = {false};
+    bool keep[MEDIAN_MAX_NETWORK * MEDIAN_MAX_NETWORK] = {false};
+    needed[n / 2] = true;
+
+    for (int k = full_count - 1; k >= 0; k--) {
+        if (needed[full[k].a] || needed[full[k].b]) {
+            keep[k] = true;
+            needed[full[k].a] = true;
+            needed[full[k].b] = true;
+        }
+    }
+
+    net->n = n;
+    net->count = 0;
+    for (int k = 0; k < full_count; k++) {
+        if (keep[k]) {
+            net->ops[net->count++] = full[k];
+        }
+    }
+}
+
+static SelectionNetwork network3;   // Окно 3x3
+static SelectionNetwork network5;   // Окно 5x5
+static pthread_once_t networks_once = PTHREAD_ONCE_INIT;
+
+static void networks_build(void) {
+    network_build(&network3, 9);
+    network_build(&network5, 25);
+}
+
+static void networks_init(void) {
+    pthread_once(&networks_once, networks_build);
+}
+
+// Состояние фильтра
+
+struct MedianState {
+    uint32_t width;
+    int window;
+    int radius;
+
+    // Сеть выбора: n плоскостей длиной width * 3
+    uint8_t* planes;
+
+    // Гистограммы: по столбцу и каналу, грубые и точные
+    uint16_t* column_fine;       // width * 3 * 256
+    uint16_t* column_coarse;     // width * 3 * 16
+    uint32_t kernel_fine[3][MEDIAN_BINS];
+    uint32_t kernel_coarse[3][MEDIAN_COARSE];
+
+    bool valid;                  // Гистограммы столбцов построены
+    uint32_t next_y;             // Строка, для которой они построены
+};
+
+static inline int clamp_row(int y, uint32_t height) {
+    if (y < 0) return 0;
+    if (y >= (int)height) return (int)height - 1;
+    return y;
+}
+
+static inline uint32_t clamp_col(int x, uint32_t width) {
+    if (x < 0) return 0;
+    if (x >= (int)width) return width - 1;
+    return (uint32_t)x;
+}
+
+MedianState* median_state_create(uint32_t width, int window) {
+    if (width == 0 || window < 1 || window % 2 == 0) {
+        return NULL;
+    }
+
+    MedianState* state = (MedianState*)calloc(1, sizeof(MedianState));
+    if (!state) return NULL;
+
+    state->width = width;
+    state->window = window;
+    state->radius = window / 2;
+
+    size_t row_bytes = (size_t)width * 3;
+
+    if (window == 3 || window == 5) {
+        networks_init();
+        state->planes = (uint8_t*)malloc((size_t)window * window * row_bytes);
+        if (!state->planes) {
+            free(state);
+            return NULL;
+        }
+    } else if (window > 1) {
+        state->column_fine = (uint16_t*)malloc(row_bytes * MEDIAN_BINS * sizeof(uint16_t));
+        state->column_coarse = (uint16_t*)malloc(row_bytes * MEDIAN_COARSE * sizeof(uint16_t));
+        if (!state->column_fine || !state->column_coarse) {
+            median_state_free(state);
+            return NULL;
+        }
+    }
+
+    return state;
+}
+
+void median_state_free(MedianState* state) {
+    if (!state) return;
+    free(state->planes);
+    free(state->column_fine);
+    free(state->column_coarse);
+    free(state);
+}
+
+void median_state_reset(MedianState* state) {
+    if (state) state->valid = false;
+}
+
+// Окна 3 и 5: сеть выбора над плоскостями сдвинутых строк
+
+static void network_row(MedianState* state, MedianRowFunc get_row, void* ctx,
+                        uint32_t height, uint32_t y, uint8_t* out) {
+    const SelectionNetwork* net = (state->window == 3) ? &network3 : &network5;
+    uint32_t width = state->width;
+    size_t row_bytes = (size_t)width * 3;
+    int r = state->radius;
+    int plane = 0;
+
+    // Плоскость (dy, dx) - строка y + dy, сдвинутая на dx пикселей
+    for (int dy = -r; dy <= r; dy++) {
+        const uint8_t* row = get_row(ctx, (uint32_t)clamp_row((int)y + dy, height));
+
+        for (int dx = -r; dx <= r; dx++) {
+            uint8_t* p = state->planes + (size_t)plane * row_bytes;
+
+            // Внутренняя часть копируется одним блоком, края - повтором
+            int lo = (dx < 0) ? -dx : 0;
+            int hi = (int)width - ((dx > 0) ? dx : 0);
+            if (lo > (int)width) lo = (int)width;
+            if (hi < lo) hi = lo;
+            uint32_t x_lo = (uint32_t)lo;
+            uint32_t x_hi = (uint32_t)hi;
+
+            memcpy(p + (size_t)x_lo * 3, row + ((size_t)x_lo + dx) * 3,
+                   (size_t)(x_hi - x_lo) * 3);
+
+            for (uint32_t x = 0; x < x_lo; x++) {
+                memcpy(p + (size_t)x * 3, row, 3);
+            }
+            for (uint32_t x = x_hi; x < width; x++) {
+                memcpy(p + (size_t)x * 3, row + (size_t)(width - 1) * 3, 3);
+            }
+            plane++;
+        }
+    }
+
+    // Компараторы применяются сразу ко всей строке
+    for (int k = 0; k < net->count; k++) {
+        uint8_t* a = state->planes + (size_t)net->ops[k].a * row_bytes;
+        uint8_t* b = state->planes + (size_t)net->ops[k].b * row_bytes;
+
+        for (size_t i = 0; i < row_bytes; i++) {
+            uint8_t lo = a[i] < b[i] ? a[i] : b[i];
+            uint8_t hi = a[i] < b[i] ? b[i] : a[i];
+            a[i] = lo;
+            b[i] = hi;
+        }
+    }
+
+    memcpy(out, state->planes + (size_t)(net->n / 2) * row_bytes, row_bytes);
+}
+
+// Окна от 7: гистограммы столбцов
+
+// Добавление (delta = 1) или удаление (delta = -1) строки из гистограмм столбцов
+static inline void column_add(MedianState* state, const uint8_t* row, int delta) {
+    size_t row_bytes = (size_t)state->width * 3;
+    for (size_t i = 0; i < row_bytes; i++) {
+        state->column_fine[i * MEDIAN_BINS + row[i]] += delta;
+        state->column_coarse[i * MEDIAN_COARSE + (row[i] >> 4)] += delta;
+    }
+}
+
+// Построение гистограмм столбцов для окна вокруг строки y
+static void columns_init(MedianState* state, MedianRowFunc get_row, void* ctx,
+                         uint32_t height, uint32_t y) {
+    size_t row_bytes = (size_t)state->width * 3;
+    memset(state->column_fine, 0, row_bytes * MEDIAN_BINS * sizeof(uint16_t));
+    memset(state->column_coarse, 0, row_bytes * MEDIAN_COARSE * sizeof(uint16_t));
+
+    for (int dy = -state->radius; dy <= state->radius; dy++) {
+        column_add(state, get_row(ctx, (uint32_t)clamp_row((int)y + dy, height)), 1);
+    }
+
+    state->valid = true;
+    state->next_y = y;
+}
+
+// Сдвиг гистограмм столбцов на строку вниз
+static void columns_advance(MedianState* state, MedianRowFunc get_row, void* ctx,
+                            uint32_t height) {
+    int y = (int)state->next_y;
+    column_add(state, get_row(ctx, (uint32_t)clamp_row(y - state->radius, height)), -1);
+    column_add(state, get_row(ctx, (uint32_t)clamp_row(y + state->radius + 1, height)), 1);
+    state->next_y++;
+}
+
+static inline void kernel_update(MedianState* state, uint32_t column, int sign) {
+    for (int c = 0; c < 3; c++) {
+        size_t index = (size_t)column * 3 + c;
+        const uint16_t* fine = state->column_fine + index * MEDIAN_BINS;
+        const uint16_t* coarse = state->column_coarse + index * MEDIAN_COARSE;
+        uint32_t* kf = state->kernel_fine[c];
+        uint32_t* kc = state->kernel_coarse[c];
+
+        if (sign > 0) {
+            for (int b = 0; b < MEDIAN_BINS; b++) kf[b] += fine[b];
+            for (int b = 0; b < MEDIAN_COARSE; b++) kc[b] += coarse[b];
+        } else {
+            for (int b = 0; b < MEDIAN_BINS; b++) kf[b] -= fine[b];
+            for (int b = 0; b < MEDIAN_COARSE; b++) kc[b] -= coarse[b];
+        }
+    }
+}
+
+// Поиск медианы: сначала грубая корзина, затем уровень внутри нее
+static inline uint8_t kernel_median(const uint32_t* fine, const uint32_t* coarse,
+                                    uint32_t rank) {
+    uint32_t seen = 0;
+    int bucket = 0;
+    while (seen + coarse[bucket] <= rank) {
+        seen += coarse[bucket];
+        bucket++;
+    }
+
+    int level = bucket * 16;
+    while (seen + fine[level] <= rank) {
+        seen += fine[level];
+        level++;
+    }
+    return (uint8_t)level;
+}
+
+static void histogram_row(MedianState* state, uint8_t* out) {
+    uint32_t width = state->width;
+    int r = state->radius;
+    uint32_t rank = (uint32_t)(state->window * state->window) / 2;
+
+    memset(state->kernel_fine, 0, sizeof(state->kernel_fine));
+    memset(state->kernel_coarse, 0, sizeof(state->kernel_coarse));
+
+    // Окно для x = 0: столбец 0 повторяется r + 1 раз
+    for (int dx = -r; dx <= r; dx++) {
+        kernel_update(state, clamp_col(dx, width), 1);
+    }
+
+    for (uint32_t x = 0; x < width; x++) {
+        for (int c = 0; c < 3; c++) {
+            out[x * 3 + c] = kernel_median(state->kernel_fine[c],
+                                           state->kernel_coarse[c], rank);
+        }
+
+        // Сдвиг окна: уходит столбец x - r, приходит x + r + 1
+        if (x + 1 < width) {
+            kernel_update(state, clamp_col((int)x - r, width), -1);
+            kernel_update(state, clamp_col((int)x + r + 1, width), 1);
+        }
+    }
+}
+
+void median_state_run(MedianState* state, MedianRowFunc get_row, void* ctx,
+                      uint32_t height, uint32_t y_begin, uint32_t y_end,
+                      uint8_t* dst, size_t dst_stride) {
+    if (!state || !get_row || !dst) return;
+
+    size_t row_bytes = (size_t)state->width * 3;
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        uint8_t* out = dst + (size_t)(y - y_begin) * dst_stride;
+
+        if (state->window == 1) {
+            memcpy(out, get_row(ctx, y), row_bytes);
+        } else if (state->planes) {
+            network_row(state, get_row, ctx, height, y, out);
+        } else {
+            if (!state->valid || state->next_y != y) {
+                columns_init(state, get_row, ctx, height, y);
+            }
+            histogram_row(state, out);
+            columns_advance(state, get_row, ctx, height);
+        }
+    }
+}
+
+// Обработка всего изображения полосами
+
+typedef struct {
+    const uint8_t* src;
+    uint8_t* dst;
+    uint32_t width;
+    uint32_t height;
+    int window;
+    atomic_bool failed;
+} MedianImageJob;
+
+static const uint8_t* image_row(void* ctx, uint32_t y) {
+    MedianImageJob* job = (MedianImageJob*)ctx;
+    return job->src + (size_t)y * job->width * 3;
+}
+
+static void median_image_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    MedianImageJob* job = (MedianImageJob*)ctx;
+
+    MedianState* state = median_state_create(job->width, job->window);
+    if (!state) {
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    size_t stride = (size_t)job->width * 3;
+    median_state_run(state, image_row, job, job->height, y_begin, y_end,
+                     job->dst + (size_t)y_begin * stride, stride);
+
+    median_state_free(state);
+}
+
+bool median_filter_u8(const uint8_t* src, uint8_t* dst,
+                      uint32_t width, uint32_t height, int window) {
+    if (!src || !dst || width == 0 || height == 0 || window < 1 || window % 2 == 0) {
+        fprintf(stderr, "Ошибка: некорректные параметры медианного фильтра\n");
+        return false;
+    }
+
+    MedianImageJob job = { .src = src, .dst = dst, .width = width,
+                           .height = height, .window = window };
+    atomic_init(&job.failed, false);
+    parallel_for_rows(height, median_image_band, &job);
+
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        return false;
+    }
+    return true;
+}
+
+// Медиана по float каналам
+
+typedef struct {
+    const float* src;
+    float* dst;
+    uint32_t width;
+    uint32_t height;
+    int window;
+    atomic_bool failed;
+} MedianFloatJob;
+
+// k-й по величине элемент values[0..n) (выбор Хоара, массив переставляется)
+static float select_kth(float* values, int n, int k) {
+    int lo = 0;
+    int hi = n - 1;
+    while (lo < hi) {
+        float pivot = values[k];
+        int i = lo;
+        int j = hi;
+        do {
+            while (values[i] < pivot) i++;
+            while (pivot < values[j]) j--;
+            if (i <= j) {
+                float t = values[i];
+                values[i] = values[j];
+                values[j] = t;
+                i++;
+                j--;
+            }
+        } while (i <= j);
+        if (j < k) lo = i;
+        if (k < i) hi = j;
+    }
+    return values[k];
+}
+
+// Окна 3 и 5: та же сеть выбора над плоскостями сдвинутых строк
+static void network_row_float(const MedianFloatJob* job, float* planes, uint32_t y,
+                              float* out) {
+    const SelectionNetwork* net = (job->window == 3) ? &network3 : &network5;
+    uint32_t width = job->width;
+    size_t row_len = (size_t)width * 3;
+    int r = job->window / 2;
+    int plane = 0;
+
+    for (int dy = -r; dy <= r; dy++) {
+        const float* row = job->src + (size_t)clamp_row((int)y + dy, job->height) * row_len;
+
+        for (int dx = -r; dx <= r; dx++) {
+            float* p = planes + (size_t)plane * row_len;
+            for (uint32_t x = 0; x < width; x++) {
+                memcpy(p + (size_t)x * 3, row + (size_t)clamp_col((int)x + dx, width) * 3,
+                       3 * sizeof(float));
+            }
+            plane++;
+        }
+    }
+
+    for (int k = 0; k < net->count; k++) {
+        float* a = planes + (size_t)net->ops[k].a * row_len;
+        float* b = planes + (size_t)net->ops[k].b * row_len;
+
+        for (size_t i = 0; i < row_len; i++) {
+            float lo = a[i] < b[i] ? a[i] : b[i];
+            float hi = a[i] < b[i] ? b[i] : a[i];
+            a[i] = lo;
+            b[i] = hi;
+        }
+    }
+
+    memcpy(out, planes + (size_t)(net->n / 2) * row_len, row_len * sizeof(float));
+}
+
+// Окна от 7: выбор медианы среди значений окна каждого канала
+static void select_row_float(const MedianFloatJob* job, float* values, uint32_t y,
+                             float* out) {
+    uint32_t width = job->width;
+    size_t row_len = (size_t)width * 3;
+    int r = job->window / 2;
+    int n = job->window * job->window;
+
+    for (uint32_t x = 0; x < width; x++) {
+        for (int c = 0; c < 3; c++) {
+            int count = 0;
+            for (int dy = -r; dy <= r; dy++) {
+                const float* row = job->src + (size_t)clamp_row((int)y + dy, job->height) * row_len;
+                for (int dx = -r; dx <= r; dx++) {
+                    values[count++] = row[(size_t)clamp_col((int)x + dx, width) * 3 + c];
+                }
+            }
+            out[(size_t)x * 3 + c] = select_kth(values, n, n / 2);
+        }
+    }
+}
+
+static void median_float_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    MedianFloatJob* job = (MedianFloatJob*)ctx;
+    size_t row_len = (size_t)job->width * 3;
+    bool network = job->window == 3 || job->window == 5;
+
+    size_t count = network ? (size_t)job->window * job->window * row_len
+                           : (size_t)job->window * job->window;
+    float* buffer = (float*)malloc(count * sizeof(float));
+    if (!buffer) {
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        float* out = job->dst + (size_t)y * row_len;
+        if (network) {
+            network_row_float(job, buffer, y, out);
+        } else {
+            select_row_float(job, buffer, y, out);
+        }
+    }
+
+    free(buffer);
+}
+
+bool median_filter_float(const float* src, float* dst,
+                         uint32_t width, uint32_t height, int window) {
+    if (!src || !dst || width == 0 || height == 0 || window < 1 || window % 2 == 0) {
+        fprintf(stderr, "Ошибка: некорректные параметры медианного фильтра\n");
+        return false;
+    }
+
+    networks_init();
+
+    MedianFloatJob job = { .src = src, .dst = dst, .width = width,
+                           .height = height, .window = window };
+    atomic_init(&job.failed, false);
+    parallel_for_rows(height, median_float_band, &job);
+
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,48 @@
+// Медианный фильтр по 8-битным каналам
+//  Окна 3 и 5 - сеть выбора медианы (min/max над строками, векторизуется)
+//  Окна от 7 - скользящие гистограммы столбцов (Perreault/Hebert),
+//  стоимость на пиксель не зависит от размера окна
+
+#ifndef MEDIAN_H
+#define MEDIAN_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// Источник строк: возвращает строку y (RGB по 3 байта на пиксель)
+// y всегда в диапазоне [0, height) - края уже повторены вызывающей стороной
+typedef const uint8_t* (*MedianRowFunc)(void* ctx, uint32_t y);
+
+// Состояние медианного фильтра для одной полосы строк
+typedef struct MedianState MedianState;
+
+// Создание состояния для строк шириной width и окна window (нечетное)
+MedianState* median_state_create(uint32_t width, int window);
+
+// Освобождение состояния
+void median_state_free(MedianState* state);
+
+// Сброс гистограмм: следующий вызов строит их заново (строки сменились)
+void median_state_reset(MedianState* state);
+
+// Вычисление строк [y_begin, y_end) изображения высотой height
+// Строка y пишется в dst + (y - y_begin) * dst_stride
+// Если y_begin продолжает предыдущий вызов, гистограммы сдвигаются,
+// а не строятся заново (используется при построчной обработке)
+void median_state_run(MedianState* state, MedianRowFunc get_row, void* ctx,
+                      uint32_t height, uint32_t y_begin, uint32_t y_end,
+                      uint8_t* dst, size_t dst_stride);
+
+// Медиана всего изображения (RGB по 3 байта, строки подряд)
+// Полосы строк обрабатываются параллельно
+bool median_filter_u8(const uint8_t* src, uint8_t* dst,
+                      uint32_t width, uint32_t height, int window);
+
+// Медиана по float каналам (RGB по 3 float на пиксель) без квантования:
+// окна 3 и 5 - та же сеть выбора, от 7 - выбор среди значений окна.
+// Результат совпадает с сортировкой окна при любых значениях
+bool median_filter_float(const float* src, float* dst,
+                         uint32_t width, uint32_t height, int window);
+
+#endif
@@ -0,0 +1,211 @@
+#include "parallel.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <unistd.h>
+
+// Константы
+
+#define MAX_THREADS 256        // Верхняя граница размера пула
+#define BANDS_PER_THREAD 4     // Полос на поток (балансировка нагрузки)
+#define MIN_BAND_ROWS 8        // Минимальная высота полосы
+
+// Описание текущего задания
+
+typedef struct {
+    RowBandFunc func;          // Обработчик полосы
+    void* ctx;                 // Контекст фильтра
+    uint32_t height;           // Высота изображения
+    uint32_t band_rows;        // Высота одной полосы
+    uint32_t band_count;       // Количество полос
+    atomic_uint next_band;     // Следующая свободная полоса
+} ParallelJob;
+
+// Состояние пула
+
+static int requested_threads = 0;          // 0 - по числу ядер
+static int pool_size = 0;                  // Количество запущенных рабочих
+static pthread_t workers[MAX_THREADS];
+
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t start_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t dispatch_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static ParallelJob job;
+static unsigned long generation = 0;       // Номер текущего задания
+static int active_workers = 0;             // Рабочие, не закончившие задание
+static bool shutting_down = false;
+
+// Признак выполнения внутри полосы (для вложенных вызовов)
+static _Thread_local bool inside_band = false;
+
+// Вспомогательные функции
+
+static int detect_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) return 1;
+    if (n > MAX_THREADS) return MAX_THREADS;
+    return (int)n;
+}
+
+static void run_bands(ParallelJob* j) {
+    inside_band = true;
+
+    for (;;) {
+        uint32_t band = atomic_fetch_add(&j->next_band, 1);
+        if (band >= j->band_count) break;
+
+        uint32_t y_begin = band * j->band_rows;
+        uint32_t y_end = y_begin + j->band_rows;
+        if (y_end > j->height) y_end = j->height;
+
+        j->func(j->ctx, y_begin, y_end);
+    }
+
+    inside_band = false;
+}
+
+static void* worker_main(void* arg) {
+    // Номер задания на момент запуска потока передается аргументом,
+    // иначе задание, выданное до старта потока, было бы пропущено
+    unsigned long seen = (unsigned long)(uintptr_t)arg;
+
+    pthread_mutex_lock(&pool_mutex);
+
+    for (;;) {
+        while (generation == seen && !shutting_down) {
+            pthread_cond_wait(&start_cond, &pool_mutex);
+        }
+        if (shutting_down) break;
+
+        seen = generation;
+        pthread_mutex_unlock(&pool_mutex);
+
+        run_bands(&job);
+
+        pthread_mutex_lock(&pool_mutex);
+        if (--active_workers == 0) {
+            pthread_cond_signal(&done_cond);
+        }
+    }
+
+    pthread_mutex_unlock(&pool_mutex);
+    return NULL;
+}
+
+// Запуск рабочих потоков (вызывается под dispatch_mutex)
+static void pool_start(void) {
+    int wanted = parallel_get_threads() - 1;  // Вызывающий поток тоже работает
+
+    pthread_mutex_lock(&pool_mutex);
+    shutting_down = false;
+    void* start_generation = (void*)(uintptr_t)generation;
+    pthread_mutex_unlock(&pool_mutex);
+
+    pool_size = 0;
+
+    for (int i = 0; i < wanted; i++) {
+        if (pthread_create(&workers[i], NULL, worker_main, start_generation) != 0) {
+            fprintf(stderr, "Предупреждение: запущено только %d рабочих потоков\n", i);
+            break;
+        }
+        pool_size++;
+    }
+}
+
+// Остановка рабочих потоков (вызывается под dispatch_mutex)
+static void pool_stop(void) {
+    if (pool_size == 0) return;
+
+    pthread_mutex_lock(&pool_mutex);
+    shutting_down = true;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    for (int i = 0; i < pool_size; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    pool_size = 0;
+}
+
+// Настройка пула
+
+void parallel_set_threads(int count) {
+    if (count < 0) count = 0;
+    if (count > MAX_THREADS) count = MAX_THREADS;
+
+    pthread_mutex_lock(&dispatch_mutex);
+    pool_stop();
+    requested_threads = count;
+    pthread_mutex_unlock(&dispatch_mutex);
+}
+
+int parallel_get_threads(void) {
+    return requested_threads > 0 ? requested_threads : detect_cpu_count();
+}
+
+void parallel_shutdown(void) {
+    pthread_mutex_lock(&dispatch_mutex);
+    pool_stop();
+    pthread_mutex_unlock(&dispatch_mutex);
+}
+
+// Выполнение задания
+
+void parallel_for_rows(uint32_t height, RowBandFunc func, void* ctx) {
+    if (!func || height == 0) return;
+
+    int threads = parallel_get_threads();
+
+    // Однопоточный режим, вложенный вызов или пул занят другим заданием
+    if (threads <= 1 || height < 2 * MIN_BAND_ROWS || inside_band ||
+        pthread_mutex_trylock(&dispatch_mutex) != 0) {
+        func(ctx, 0, height);
+        return;
+    }
+
+    if (pool_size == 0) {
+        pool_start();
+    }
+
+    if (pool_size == 0) {
+        pthread_mutex_unlock(&dispatch_mutex);
+        func(ctx, 0, height);
+        return;
+    }
+
+    // Разбиение на полосы
+    uint32_t bands = (uint32_t)(pool_size + 1) * BANDS_PER_THREAD;
+    uint32_t band_rows = (height + bands - 1) / bands;
+    if (band_rows < MIN_BAND_ROWS) band_rows = MIN_BAND_ROWS;
+
+    job.func = func;
+    job.ctx = ctx;
+    job.height = height;
+    job.band_rows = band_rows;
+    job.band_count = (height + band_rows - 1) / band_rows;
+    atomic_store(&job.next_band, 0);
+
+    // Запуск рабочих
+    pthread_mutex_lock(&pool_mutex);
+    active_workers = pool_size;
+    generation++;
+    pthread_cond_broadcast(&start_cond);
+    pthread_mutex_unlock(&pool_mutex);
+
+    // Вызывающий поток обрабатывает полосы наравне с рабочими
+    run_bands(&job);
+
+    // Ожидание завершения
+    pthread_mutex_lock(&pool_mutex);
+    while (active_workers > 0) {
+        pthread_cond_wait(&done_cond, &pool_mutex);
+    }
+    pthread_mutex_unlock(&pool_mutex);
+
+    pthread_mutex_unlock(&dispatch_mutex);
+}
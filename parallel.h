@@ -0,0 +1,32 @@
+// Многопоточное выполнение фильтров
+//  Изображение разбивается на горизонтальные полосы строк,
+//  полосы раздаются пулу рабочих потоков.
+//  Фильтры с ядром читают строки из неизменяемого источника,
+//  поэтому полоса [y0, y1) свободно читает строки ореола
+//  [y0 - radius, y1 + radius) без копирования и синхронизации.
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Обработчик полосы строк [y_begin, y_end)
+typedef void (*RowBandFunc)(void* ctx, uint32_t y_begin, uint32_t y_end);
+
+// Установка количества потоков
+// count 0 - по числу доступных ядер, 1 - однопоточный режим
+void parallel_set_threads(int count);
+
+// Текущее количество потоков
+int parallel_get_threads(void);
+
+// Выполнение func над всеми строками [0, height)
+// Вызов блокируется до завершения всех полос
+// Вложенные вызовы (и вызовы при занятом пуле) выполняются в текущем потоке
+void parallel_for_rows(uint32_t height, RowBandFunc func, void* ctx);
+
+// Остановка рабочих потоков
+void parallel_shutdown(void);
+
+#endif
@@ -1,12 +1,23 @@
 #include "pipeline.h"
+#include "bmp.h"
 #include "filters.h"
+#include "filters8.h"
 #include "extra_filters.h"
 #include "bonus_mosaic.h"
+#include "convolution.h"
+#include "resize.h"
+#include "profile.h"
+#include "frame_pool.h"
 #include "utils.h"
+#include "parallel.h"
+#include "stream.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <pthread.h>
 
 // Создание и уничтожение конвейера
 
@@ -20,6 +31,15 @@ FilterPipeline* pipeline_create(void) {
     pipeline->first = NULL;
     pipeline->last = NULL;
     pipeline->count = 0;
+    pipeline->allow_u8 = false;
+    pipeline->streaming = false;
+    pipeline->jobs = 0;
+    pipeline->profile = false;
+    pipeline->trace_file = NULL;
+    pipeline->stages = NULL;
+    pipeline->stage_count = 0;
+    pipeline->compiled = false;
+    pipeline->seed = 0;
     
     return pipeline;
 }
@@ -33,100 +53,1120 @@ void pipeline_destroy(FilterPipeline* pipeline) {
 
 // Очистка конвейера
 
+static void pipeline_stages_free(FilterPipeline* pipeline);
+
+// Освобождение разобранных аргументов (ядро -conv)
+static void filter_values_free(FilterValues* values) {
+    conv_kernel_free(values->kernel);
+    values->kernel = NULL;
+}
+
 void pipeline_clear(FilterPipeline* pipeline) {
     if (!pipeline) return;
     
-    FilterParams* current = pipeline->first;
-    while (current) {
-        FilterParams* next = current->next;
-        
-        // Освобождение аргументов
-        if (current->args) {
-            for (int i = 0; i < current->arg_count; i++) {
-                if (current->args[i]) {
-                    free(current->args[i]);
-                }
-            }
-            free(current->args);
+    FilterParams* current = pipeline->first;
+    while (current) {
+        FilterParams* next = current->next;
+        
+        // Освобождение аргументов
+        if (current->args) {
+            for (int i = 0; i < current->arg_count; i++) {
+                if (current->args[i]) {
+                    free(current->args[i]);
+                }
+            }
+            free(current->args);
+        }
+        
+        // Ядро -conv и фильтры ветви
+        filter_values_free(&current->values);
+        pipeline_destroy(current->branch);
+        
+        free(current);
+        current = next;
+    }
+    
+    pipeline->first = NULL;
+    pipeline->last = NULL;
+    pipeline->count = 0;
+    pipeline_stages_free(pipeline);
+}
+
+// Разбор аргументов фильтра с проверкой
+
+static bool filter_values_parse(FilterType type, char** args, int arg_count,
+                                FilterValues* values) {
+    memset(values, 0, sizeof(*values));
+    
+    switch (type) {
+        case FILTER_CROP:
+            // -crop width height
+            if (arg_count != 2) {
+                fprintf(stderr, "Фильтр Crop требует 2 аргумента (width height)\n");
+                return false;
+            }
+            values->width = (uint32_t)atoi(args[0]);
+            values->height = (uint32_t)atoi(args[1]);
+            return (atoi(args[0]) > 0 && atoi(args[1]) > 0);
+            
+        case FILTER_RESIZE: {
+            // -resize width height [lanczos|bicubic]
+            if (arg_count != 2 && arg_count != 3) {
+                fprintf(stderr, "Фильтр Resize требует 2 или 3 аргумента "
+                                "(width height [lanczos|bicubic])\n");
+                return false;
+            }
+            values->width = (uint32_t)atoi(args[0]);
+            values->height = (uint32_t)atoi(args[1]);
+            ResizeMethod method = RESIZE_LANCZOS;
+            if (arg_count == 3 && !resize_method_parse(args[2], &method)) {
+                fprintf(stderr, "Неизвестный метод resize: %s (lanczos, bicubic)\n", args[2]);
+                return false;
+            }
+            values->method = (int)method;
+            return (atoi(args[0]) > 0 && atoi(args[1]) > 0);
+        }
+            
+        case FILTER_GRAYSCALE:
+        case FILTER_NEGATIVE:
+        case FILTER_SHARPEN:
+            // Без аргументов
+            return (arg_count == 0);
+            
+        case FILTER_EDGE:
+            // -edge threshold
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Edge Detection требует 1 аргумент (threshold)\n");
+                return false;
+            }
+            values->value = atof(args[0]);
+            return (values->value >= 0.0f);
+            
+        case FILTER_MEDIAN:
+            // -med window (нечетное)
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Median требует 1 аргумент (window size)\n");
+                return false;
+            }
+            values->size = atoi(args[0]);
+            return (values->size > 0 && values->size % 2 == 1);
+            
+        case FILTER_BLUR:
+        case FILTER_BLUR_FAST:
+            // -blur sigma, -fblur sigma
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Gaussian Blur требует 1 аргумент (sigma)\n");
+                return false;
+            }
+            values->value = atof(args[0]);
+            return (values->value > 0.0f);
+            
+        case FILTER_CONV:
+            // -conv kernel_file: ядро читается один раз, сразу, чтобы ошибка
+            // в файле обнаружилась до загрузки изображения
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Convolution требует 1 аргумент (kernel file)\n");
+                return false;
+            }
+            values->file = args[0];
+            values->kernel = conv_kernel_load(args[0]);
+            return values->kernel != NULL;
+            
+        case FILTER_CRYSTALLIZE:
+            // -crystallize cell_size
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Crystallize требует 1 аргумент (cell size)\n");
+                return false;
+            }
+            values->size = atoi(args[0]);
+            return (values->size > 1);
+            
+        case FILTER_GLASS:
+            // -glass dist_scale
+            if (arg_count != 1) {
+                fprintf(stderr, "Фильтр Glass Distortion требует 1 аргумент (scale)\n");
+                return false;
+            }
+            values->value = atof(args[0]);
+            return (values->value > 0.0f);
+        
+        case FILTER_MOSAIC:
+            // -mosaic tile_size tile_file
+            if (arg_count != 2) {
+                fprintf(stderr, "Фильтр Mosaic требует 2 аргумента (tile_size tile_file)\n");
+                return false;
+            }
+            values->size = atoi(args[0]);
+            values->file = args[1];
+            return (values->size > 0);
+        
+        case FILTER_TEE:
+        case FILTER_BRANCH:
+            // -tee file, -branch file ... -end
+            if (arg_count != 1) {
+                fprintf(stderr, "Ветвь конвейера требует 1 аргумент (output file)\n");
+                return false;
+            }
+            values->file = args[0];
+            return (args[0][0] != '\0');
+            
+        default:
+            fprintf(stderr, "Неизвестный тип фильтра\n");
+            return false;
+    }
+}
+
+// Добавление фильтра в конвейер
+
+bool pipeline_add_filter(FilterPipeline* pipeline, 
+                        FilterType type, 
+                        char** args, 
+                        int arg_count) {
+    if (!pipeline) {
+        fprintf(stderr, "Ошибка: конвейер не инициализирован\n");
+        return false;
+    }
+    
+    // Создание новой структуры параметров
+    FilterParams* params = (FilterParams*)malloc(sizeof(FilterParams));
+    if (!params) {
+        fprintf(stderr, "Ошибка выделения памяти для параметров фильтра\n");
+        return false;
+    }
+    
+    params->type = type;
+    params->arg_count = arg_count;
+    params->region_width = 0;
+    params->region_height = 0;
+    params->branch = NULL;
+    params->next = NULL;
+    
+    // Копирование аргументов
+    if (arg_count > 0 && args) {
+        params->args = (char**)malloc(arg_count * sizeof(char*));
+        if (!params->args) {
+            fprintf(stderr, "Ошибка выделения памяти для аргументов фильтра\n");
+            free(params);
+            return false;
+        }
+        
+        for (int i = 0; i < arg_count; i++) {
+            params->args[i] = strdup(args[i]);
+            if (!params->args[i]) {
+                fprintf(stderr, "Ошибка копирования аргумента %d\n", i);
+                // Освобождаем уже выделенную память
+                for (int j = 0; j < i; j++) {
+                    free(params->args[j]);
+                }
+                free(params->args);
+                free(params);
+                return false;
+            }
+        }
+    } else {
+        params->args = NULL;
+    }
+    
+    // Аргументы разбираются и проверяются один раз (строки файлов - из копии)
+    if (!filter_values_parse(type, params->args, arg_count, &params->values)) {
+        fprintf(stderr, "Ошибка: некорректные аргументы для фильтра %s\n", 
+                filter_type_to_name(type));
+        filter_values_free(&params->values);
+        for (int i = 0; i < arg_count && params->args; i++) {
+            free(params->args[i]);
+        }
+        free(params->args);
+        free(params);
+        return false;
+    }
+    
+    // Добавление в конец цепочки
+    if (!pipeline->first) {
+        pipeline->first = params;
+        pipeline->last = params;
+    } else {
+        pipeline->last->next = params;
+        pipeline->last = params;
+    }
+    
+    pipeline->count++;
+    pipeline->compiled = false;
+    
+    printf("✅ Добавлен фильтр: %s (аргументов: %d)\n", 
+           filter_type_to_name(type), arg_count);
+    
+    return true;
+}
+
+// Разбор параметров и фильтров командной строки
+
+// Параметр выполнения (задается для всего конвейера, не для ветви)
+static bool is_runtime_option(const char* arg) {
+    return strcmp(arg, "-threads") == 0 || strcmp(arg, "-jobs") == 0 ||
+           strcmp(arg, "-seed") == 0 || strcmp(arg, "--profile") == 0 ||
+           strcmp(arg, "-u8") == 0 || strcmp(arg, "-stream") == 0;
+}
+
+// Разбор цепочки с argv[*index]; в ветви - до -end включительно
+static bool parse_chain(FilterPipeline* pipeline, int argc, char** argv, int* index,
+                        bool in_branch) {
+    int i = *index;
+    while (i < argc) {
+        if (strcmp(argv[i], "-end") == 0) {
+            // Конец ветви: разбор продолжается в объемлющей цепочке
+            if (!in_branch) {
+                fprintf(stderr, "❌ -end без открытой ветви -branch\n");
+                return false;
+            }
+            *index = i + 1;
+            return true;
+        } else if (in_branch && is_runtime_option(argv[i])) {
+            fprintf(stderr, "❌ Параметр %s задается вне ветвей -branch ... -end\n", argv[i]);
+            return false;
+        } else if (strcmp(argv[i], "-threads") == 0) {
+            // Параметр выполнения: количество потоков
+            if (i + 1 >= argc || !is_numeric(argv[i + 1]) || atoi(argv[i + 1]) < 0) {
+                fprintf(stderr, "❌ Параметр -threads требует неотрицательное число\n");
+                return false;
+            }
+            parallel_set_threads(atoi(argv[i + 1]));
+            i += 2;
+        } else if (strcmp(argv[i], "-jobs") == 0) {
+            // Параметр пакетного режима: файлов одновременно
+            if (i + 1 >= argc || !is_numeric(argv[i + 1]) || atoi(argv[i + 1]) < 0) {
+                fprintf(stderr, "❌ Параметр -jobs требует неотрицательное число\n");
+                return false;
+            }
+            pipeline->jobs = atoi(argv[i + 1]);
+            i += 2;
+        } else if (strcmp(argv[i], "-seed") == 0) {
+            // Параметр выполнения: зерно случайных фильтров
+            char* end = NULL;
+            unsigned long seed = i + 1 < argc ? strtoul(argv[i + 1], &end, 10) : 0;
+            if (i + 1 >= argc || !isdigit((unsigned char)argv[i + 1][0]) || *end != '\0' ||
+                seed > UINT32_MAX) {
+                fprintf(stderr, "❌ Параметр -seed требует целое число от 0 до %u\n", UINT32_MAX);
+                return false;
+            }
+            pipeline->seed = (uint32_t)seed;
+            i += 2;
+        } else if (strcmp(argv[i], "--profile") == 0) {
+            // Параметр выполнения: профилирование этапов, необязательный файл трассы
+            pipeline->profile = true;
+            profile_enable();
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                pipeline->trace_file = argv[i + 1];
+                i++;
+            }
+            i++;
+        } else if (strcmp(argv[i], "-u8") == 0) {
+            // Параметр выполнения: 8-битный режим, если его поддерживает вся цепочка
+            pipeline->allow_u8 = true;
+            i++;
+        } else if (strcmp(argv[i], "-stream") == 0) {
+            // Параметр выполнения: потоковая обработка полосами строк
+            pipeline->streaming = true;
+            i++;
+        } else if (argv[i][0] == '-') {
+            // Нашли фильтр
+            char* filter_name = argv[i] + 1;  // Пропускаем '-'
+            FilterType filter_type = filter_name_to_type(filter_name);
+            
+            if (filter_type == FILTER_COUNT) {
+                fprintf(stderr, "❌ Неизвестный фильтр: -%s\n", filter_name);
+                return false;
+            }
+            
+            // Определяем количество аргументов для этого фильтра
+            int arg_count = 0;
+            char** filter_args = NULL;
+            
+            // Для каждого типа фильтра определяем необходимое количество аргументов
+            switch (filter_type) {
+                case FILTER_CROP:
+                    arg_count = 2;
+                    break;
+                case FILTER_RESIZE:
+                    // Метод необязателен: третий аргумент - если это не фильтр
+                    arg_count = i + 3 < argc && argv[i + 3][0] != '-' ? 3 : 2;
+                    break;
+                case FILTER_EDGE:
+                case FILTER_MEDIAN:
+                case FILTER_BLUR:
+                case FILTER_BLUR_FAST:
+                case FILTER_CONV:
+                case FILTER_CRYSTALLIZE:
+                case FILTER_GLASS:
+                    arg_count = 1;
+                    break;
+                case FILTER_MOSAIC:
+                    arg_count = 2;
+                    break;
+                case FILTER_TEE:
+                case FILTER_BRANCH:
+                    arg_count = 1;
+                    break;
+                case FILTER_GRAYSCALE:
+                case FILTER_NEGATIVE:
+                case FILTER_SHARPEN:
+                    arg_count = 0;
+                    break;
+                default:
+                    arg_count = 0;
+                    break;
+            }
+            
+            // Проверяем, достаточно ли аргументов
+            if (i + arg_count >= argc) {
+                fprintf(stderr, "❌ Недостаточно аргументов для фильтра -%s\n", filter_name);
+                fprintf(stderr, "   Требуется %d аргумент(ов)\n", arg_count);
+                return false;
+            }
+            
+            // Собираем аргументы фильтра
+            if (arg_count > 0) {
+                filter_args = &argv[i + 1];
+            }
+            
+            // Добавляем фильтр в конвейер
+            if (!pipeline_add_filter(pipeline, filter_type, filter_args, arg_count)) {
+                fprintf(stderr, "❌ Ошибка добавления фильтра -%s\n", filter_name);
+                return false;
+            }
+            
+            // Пропускаем обработанные аргументы
+            i += arg_count + 1;
+            
+            // Фильтры ветви - до парного -end
+            if (filter_type == FILTER_BRANCH) {
+                FilterParams* fork = pipeline->last;
+                fork->branch = pipeline_create();
+                if (!fork->branch || !parse_chain(fork->branch, argc, argv, &i, true)) {
+                    return false;
+                }
+            }
+        } else {
+            // Неожиданный аргумент (не начинается с '-')
+            fprintf(stderr, "Неожиданный аргумент: %s (ожидается фильтр с префиксом '-')\n", 
+                    argv[i]);
+            return false;
+        }
+    }
+    
+    if (in_branch) {
+        fprintf(stderr, "❌ Ветвь -branch не закрыта -end\n");
+        return false;
+    }
+    
+    *index = i;
+    return true;
+}
+
+bool pipeline_parse_options(FilterPipeline* pipeline, int argc, char** argv, int start) {
+    if (!parse_chain(pipeline, argc, argv, &start, false)) {
+        return false;
+    }
+    
+    // Шаги и области вычислений (видны в pipeline_print)
+    return pipeline_compile(pipeline);
+}
+
+// Компиляция конвейера
+
+// Шаг скомпилированного конвейера
+//  Строится один раз и при применении только читается: один конвейер
+//  могут выполнять несколько потоков (--batch, --serve)
+
+struct PipelineStage {
+    const FilterParams* filter;    // Фильтр шага (тип, значения, область по плану)
+    int run;                       // Шагов, выполняемых отсюда одним проходом
+                                   // (больше 1 - серия поточечных, 0 - внутри серии)
+    PointOp ops[POINT_OPS_MAX];    // Операции серии
+    char label[256];               // Имя этапа для профиля: "Gaussian Blur [2]"
+    int tiled;                     // Шагов, выполняемых отсюда плитками (0 - нет)
+    int halo;                      // Ореол этих шагов (сумма радиусов)
+    char tiled_label[256];         // Их общее имя
+    float* blur_kernel;            // -blur: 1D гауссово ядро
+    int blur_radius;               // Его радиус
+    ConvPlan* conv_plan;           // -conv: ядро из файла, подготовленное к свертке
+    TileSet* tile_set;             // -mosaic: набор плиток (общий при tile_set_sharing)
+};
+
+static void pipeline_stages_free(FilterPipeline* pipeline) {
+    for (int i = 0; i < pipeline->stage_count; i++) {
+        PipelineStage* stage = &pipeline->stages[i];
+        free(stage->blur_kernel);
+        conv_plan_free(stage->conv_plan);
+        if (stage->tile_set) tile_set_release(stage->tile_set);
+    }
+    free(pipeline->stages);
+    
+    pipeline->stages = NULL;
+    pipeline->stage_count = 0;
+    pipeline->compiled = false;
+}
+
+// Имя этапа для профиля: "Gaussian Blur [2]"
+static void filter_label(const FilterParams* params, char* buffer, size_t size) {
+    int length = snprintf(buffer, size, "%s", filter_type_to_name(params->type));
+    
+    for (int i = 0; i < params->arg_count && length > 0 && (size_t)length < size; i++) {
+        length += snprintf(buffer + length, size - length, "%s%s%s",
+                           i == 0 ? " [" : ", ", params->args[i],
+                           i == params->arg_count - 1 ? "]" : "");
+    }
+}
+
+// Ресурсы шага, не зависящие от изображения
+static bool stage_prepare(PipelineStage* stage) {
+    const FilterValues* values = &stage->filter->values;
+    
+    switch (stage->filter->type) {
+        case FILTER_BLUR:
+            stage->blur_kernel = gaussian_kernel_create(values->value, &stage->blur_radius);
+            if (!stage->blur_kernel) {
+                fprintf(stderr, "Ошибка выделения памяти для гауссова ядра\n");
+                return false;
+            }
+            return true;
+            
+        case FILTER_CONV:
+            // Ядро прочитано при разборе аргументов
+            stage->conv_plan = conv_plan_create(values->kernel->weights, values->kernel->size);
+            return stage->conv_plan != NULL;
+            
+        case FILTER_MOSAIC:
+            stage->tile_set = tile_set_acquire(values->file, values->size);
+            if (!stage->tile_set) {
+                fprintf(stderr, "Ошибка загрузки набора плиток\n");
+                return false;
+            }
+            return true;
+            
+        default:
+            return true;
+    }
+}
+
+// Слияние поточечных фильтров
+
+// Поточечный фильтр: соседние такие фильтры выполняются одним проходом
+static bool filter_point_op(FilterType type, PointOp* op) {
+    switch (type) {
+        case FILTER_GRAYSCALE: *op = POINT_GRAYSCALE; return true;
+        case FILTER_NEGATIVE:  *op = POINT_NEGATIVE;  return true;
+        default:               return false;
+    }
+}
+
+// Разметка серий: первый шаг серии получает ее операции и общее имя
+static void stages_mark_runs(PipelineStage* stages, int count) {
+    int i = 0;
+    while (i < count) {
+        PipelineStage* first = &stages[i];
+        int run = 0;
+        while (i + run < count && run < POINT_OPS_MAX &&
+               filter_point_op(stages[i + run].filter->type, &first->ops[run])) {
+            run++;
+        }
+        
+        if (run < 2) {
+            first->run = 1;
+            i++;
+            continue;
+        }
+        
+        first->run = run;
+        size_t length = 0;
+        for (int j = 0; j < run; j++) {
+            if (j > 0) stages[i + j].run = 0;
+            if (length < sizeof(first->label)) {
+                length += snprintf(first->label + length, sizeof(first->label) - length,
+                                   "%s%s", j ? " + " : "",
+                                   filter_type_to_name(stages[i + j].filter->type));
+            }
+        }
+        i += run;
+    }
+}
+
+// Планирование областей вычислений
+
+#define REGION_ALL UINT32_MAX  // Нужно все изображение
+
+// Расширение области на radius пикселей (с насыщением)
+static uint32_t region_grow(uint32_t size, uint64_t radius) {
+    if (size == REGION_ALL) return REGION_ALL;
+    uint64_t grown = (uint64_t)size + radius;
+    return grown < REGION_ALL ? (uint32_t)grown : REGION_ALL;
+}
+
+// Округление области вверх до целого числа блоков
+static uint32_t region_align(uint32_t size, uint32_t block) {
+    if (size == REGION_ALL || block == 0) return size;
+    uint64_t aligned = ((uint64_t)size + block - 1) / block * block;
+    return aligned < REGION_ALL ? (uint32_t)aligned : REGION_ALL;
+}
+
+// Область входа шага, из которой получается область выхода width x height
+//  Радиусы совпадают с тем, что фильтры читают на самом деле: пиксели за
+//  границей области влияют на результат только через повтор края
+static void stage_input_region(const PipelineStage* stage,
+                               uint32_t* width, uint32_t* height) {
+    const FilterValues* values = &stage->filter->values;
+    uint64_t radius = 0;
+    
+    switch (stage->filter->type) {
+        case FILTER_CROP:
+            if (values->width < *width) *width = values->width;
+            if (values->height < *height) *height = values->height;
+            return;
+        
+        case FILTER_GRAYSCALE:
+        case FILTER_NEGATIVE:
+            return;
+            
+        case FILTER_RESIZE:
+            // Масштаб зависит от размеров всего входа: область не переносится
+            *width = REGION_ALL;
+            *height = REGION_ALL;
+            return;
+        
+        case FILTER_TEE:
+        case FILTER_BRANCH:
+            // Ветвь получает изображение точки ветвления целиком
+            *width = REGION_ALL;
+            *height = REGION_ALL;
+            return;
+            
+        case FILTER_SHARPEN:
+        case FILTER_EDGE:
+            radius = 1;  // Ядро 3x3
+            break;
+            
+        case FILTER_MEDIAN:
+            radius = (uint64_t)(values->size / 2);
+            break;
+            
+        case FILTER_BLUR:
+            radius = (uint64_t)stage->blur_radius;
+            break;
+            
+        case FILTER_BLUR_FAST: {
+            // Три бокса подряд: радиусы складываются
+            int sizes[3];
+            box_sizes_for_gauss(values->value, sizes);
+            for (int i = 0; i < 3; i++) {
+                if (sizes[i] > 1) radius += (uint64_t)((sizes[i] - 1) / 2);
+            }
+            break;
+        }
+        
+        case FILTER_CONV: {
+            // Свертка через БПФ идет плитками от начала координат, поэтому
+            // обрезка входа меняет округление результата: не сужается
+            int size = conv_plan_size(stage->conv_plan);
+            if (size != 3 && conv_plan_method(stage->conv_plan) == CONV_FFT) {
+                *width = REGION_ALL;
+                *height = REGION_ALL;
+                return;
+            }
+            radius = (uint64_t)(size / 2);
+            break;
+        }
+            
+        case FILTER_GLASS:
+            // Смещение не больше 1.3 * scale, билинейная выборка читает
+            // соседний пиксель, еще один - запас на округление
+            radius = (uint64_t)ceilf(1.3f * values->value) + 2;
+            break;
+            
+        case FILTER_MOSAIC:
+            // Блоки независимы: нужны целые блоки, покрывающие область
+            *width = region_align(*width, (uint32_t)values->size);
+            *height = region_align(*height, (uint32_t)values->size);
+            return;
+        
+        case FILTER_CRYSTALLIZE: {
+            // Пиксель ячейки сетки выбирает точку среди соседних ячеек:
+            // нужны целые ячейки области и еще одна справа и снизу
+            uint32_t cell_size = (uint32_t)values->size;
+            *width = region_grow(region_align(*width, cell_size), cell_size);
+            *height = region_grow(region_align(*height, cell_size), cell_size);
+            return;
+        }
+        
+        default:
+            // Неизвестный фильтр: нужно все изображение
+            *width = REGION_ALL;
+            *height = REGION_ALL;
+            return;
+    }
+    
+    *width = region_grow(*width, radius);
+    *height = region_grow(*height, radius);
+}
+
+// Серии фильтров для выполнения плитками
+//  Подряд идущие фильтры окрестности и поточечные (без обрезки) можно
+//  выполнить над плиткой с ореолом, пока она в кэше. Ореол серии - сумма
+//  радиусов, те же, что у плана областей
+static void stages_mark_tiles(PipelineStage* stages, int count) {
+    int i = 0;
+    while (i < count) {
+        int length = 0;
+        uint32_t halo = 0;
+        uint32_t unused = 0;
+        bool on_grid = true;
+        while (i + length < count && stream_supports_tiles(stages[i + length].filter->type)) {
+            // Медиана плитки квантует вход: только медианы в начале серии,
+            // вход серии проверяется при применении
+            FilterType type = stages[i + length].filter->type;
+            if (type == FILTER_MEDIAN && !on_grid) break;
+            on_grid = on_grid && type == FILTER_MEDIAN;
+            stage_input_region(&stages[i + length], &halo, &unused);
+            length++;
+        }
+        
+        // Одному фильтру или серии без окрестности плитки не нужны
+        if (length < 2 || halo == 0 || halo == REGION_ALL) {
+            i += length > 0 ? length : 1;
+            continue;
+        }
+        
+        PipelineStage* first = &stages[i];
+        first->tiled = length;
+        first->halo = (int)halo;
+        size_t used = 0;
+        for (int j = 0; j < length && used < sizeof(first->tiled_label); j++) {
+            used += snprintf(first->tiled_label + used, sizeof(first->tiled_label) - used,
+                             "%s%s", j ? " + " : "", stages[i + j].label);
+        }
+        i += length;
+    }
+}
+
+bool pipeline_compile(FilterPipeline* pipeline) {
+    if (!pipeline) return false;
+    
+    pipeline_stages_free(pipeline);
+    
+    if (pipeline->count > 0) {
+        pipeline->stages = (PipelineStage*)calloc(pipeline->count, sizeof(PipelineStage));
+        if (!pipeline->stages) {
+            fprintf(stderr, "Ошибка выделения памяти для шагов конвейера\n");
+            return false;
+        }
+    }
+    
+    for (FilterParams* current = pipeline->first; current; current = current->next) {
+        PipelineStage* stage = &pipeline->stages[pipeline->stage_count++];
+        stage->filter = current;
+        filter_label(current, stage->label, sizeof(stage->label));
+        
+        // Ветвь компилируется со своими ресурсами и тем же зерном
+        if (current->branch) {
+            current->branch->seed = pipeline->seed;
+            if (!pipeline_compile(current->branch)) {
+                pipeline_stages_free(pipeline);
+                return false;
+            }
+        }
+        
+        if (!stage_prepare(stage)) {
+            fprintf(stderr, "Ошибка подготовки фильтра %s\n", filter_type_to_name(current->type));
+            pipeline_stages_free(pipeline);
+            return false;
+        }
+    }
+    
+    stages_mark_tiles(pipeline->stages, pipeline->stage_count);
+    stages_mark_runs(pipeline->stages, pipeline->stage_count);
+    
+    // План: проход с конца, область выхода шага - область входа следующего
+    uint32_t width = REGION_ALL;
+    uint32_t height = REGION_ALL;
+    for (int i = pipeline->stage_count - 1; i >= 0; i--) {
+        FilterParams* filter = (FilterParams*)pipeline->stages[i].filter;
+        stage_input_region(&pipeline->stages[i], &width, &height);
+        filter->region_width = width == REGION_ALL ? 0 : width;
+        filter->region_height = height == REGION_ALL ? 0 : height;
+    }
+    
+    pipeline->compiled = true;
+    return true;
+}
+
+// Применение шагов
+
+// Обрезка изображения до области входа шага по плану (image или image8)
+static bool apply_plan_crop(const FilterParams* params, Image* image, Image8* image8) {
+    uint32_t width = image ? image->width : image8->width;
+    uint32_t height = image ? image->height : image8->height;
+    
+    // Обрезку пользователя выполняет сам шаг
+    if (params->type == FILTER_CROP) return true;
+    
+    uint32_t crop_width = params->region_width && params->region_width < width
+                        ? params->region_width : width;
+    uint32_t crop_height = params->region_height && params->region_height < height
+                         ? params->region_height : height;
+    if (crop_width == width && crop_height == height) return true;
+    
+    printf("→ Обрезка по плану перед %s... ", filter_type_to_name(params->type));
+    fflush(stdout);
+    
+    ProfileSpan span;
+    profile_begin(&span);
+    
+    bool result = image ? filter_crop(image, crop_width, crop_height)
+                        : filter8_crop(image8, crop_width, crop_height);
+    
+    profile_end(&span, "filter", "Plan Crop", NULL, (uint64_t)width * height);
+    
+    if (result) {
+        printf("✅\n");
+    } else {
+        printf("❌\n");
+        fprintf(stderr, "Ошибка обрезки по плану конвейера\n");
+    }
+    return result;
+}
+
+// Выполнение серии поточечных фильтров с шага first (image или image8)
+static bool apply_point_run(const PipelineStage* first, int step,
+                            Image* image, Image8* image8) {
+    printf("%d-%d. Применение %s (один проход)... ", step, step + first->run - 1, first->label);
+    fflush(stdout);
+    
+    uint64_t pixels = image ? (uint64_t)image->width * image->height
+                            : (uint64_t)image8->width * image8->height;
+    ProfileSpan span;
+    profile_begin(&span);
+    
+    bool result = image ? filter_point_ops(image, first->ops, first->run)
+                        : filter8_point_ops(image8, first->ops, first->run);
+    
+    profile_end(&span, "filter", first->label, NULL, pixels);
+    
+    if (result) {
+        printf("✅\n");
+    } else {
+        printf("❌\n");
+        fprintf(stderr, "Ошибка применения фильтров %s\n", first->label);
+    }
+    return result;
+}
+
+// Выполнение серии плитками
+//  Изображение, которое помещается в кэш, быстрее обработать целиком.
+//  IMAGECRAFT_TILED=on|off задает выбор, чтобы сравнивать выполнение
+
+#define TILED_MIN_BYTES (32u << 20)  // С этого размера кадра (12 байт на пиксель)
+
+static bool tiled_wanted(const Image* image) {
+    const char* forced = getenv("IMAGECRAFT_TILED");
+    if (forced) {
+        if (strcmp(forced, "on") == 0) return true;
+        if (strcmp(forced, "off") == 0) return false;
+    }
+    return (uint64_t)image->width * image->height * sizeof(Color) >= TILED_MIN_BYTES;
+}
+
+static bool apply_tiled_run(const PipelineStage* first, int step, Image* image) {
+    printf("%d-%d. Применение %s (плитками)... ", step, step + first->tiled - 1,
+           first->tiled_label);
+    fflush(stdout);
+    
+    uint64_t pixels = (uint64_t)image->width * image->height;
+    ProfileSpan span;
+    profile_begin(&span);
+    
+    StreamTiles tiles;
+    bool result = stream_apply_tiled(first->filter, first->tiled, first->halo, image, &tiles);
+    
+    profile_end(&span, "filter", first->tiled_label, NULL, pixels);
+    
+    if (result) {
+        printf("✅ %ux%u плиток %ux%u, ореол %d\n", tiles.columns, tiles.rows,
+               tiles.tile_width, tiles.tile_height, tiles.halo);
+    } else {
+        printf("❌\n");
+        fprintf(stderr, "Ошибка применения фильтров %s\n", first->tiled_label);
+    }
+    return result;
+}
+
+// Пул кадров на время применения конвейера
+//  Если потоку уже выдан пул (рабочий поток пакетного режима), используется он
+
+static FramePool* pipeline_pool_begin(void) {
+    if (frame_pool_current()) {
+        return NULL;
+    }
+    
+    FramePool* pool = frame_pool_create(FRAME_POOL_FRAMES);
+    frame_pool_bind(pool);
+    return pool;
+}
+
+static void pipeline_pool_end(FramePool* pool) {
+    if (!pool) return;
+    
+    frame_pool_bind(NULL);
+    frame_pool_print(pool);
+    frame_pool_destroy(pool);
+}
+
+// Один шаг над изображением
+static bool apply_stage(const FilterPipeline* pipeline, const PipelineStage* stage,
+                        Image* image) {
+    const FilterValues* values = &stage->filter->values;
+    
+    switch (stage->filter->type) {
+        case FILTER_CROP:        return filter_crop(image, values->width, values->height);
+        case FILTER_RESIZE:
+            return filter_resize(image, values->width, values->height,
+                                 (ResizeMethod)values->method);
+        case FILTER_GRAYSCALE:   return filter_grayscale(image);
+        case FILTER_NEGATIVE:    return filter_negative(image);
+        case FILTER_SHARPEN:     return filter_sharpen(image);
+        case FILTER_EDGE:        return filter_edge_detection(image, values->value);
+        case FILTER_MEDIAN:      return filter_median(image, values->size);
+        case FILTER_BLUR:
+            return filter_gaussian_blur_kernel(image, values->value,
+                                               stage->blur_kernel, stage->blur_radius);
+        case FILTER_BLUR_FAST:
+            return filter_gaussian_blur_mode(image, values->value, BLUR_BOX_APPROX);
+        case FILTER_CONV:        return filter_convolution_plan(image, stage->conv_plan);
+        case FILTER_CRYSTALLIZE: return filter_crystallize(image, values->size, pipeline->seed);
+        case FILTER_GLASS:       return filter_glass_distortion(image, values->value);
+        case FILTER_MOSAIC:      return filter_mosaic_tiles(image, stage->tile_set);
+        default:
+            fprintf(stderr, "Ошибка: неизвестный тип фильтра\n");
+            return false;
+    }
+}
+
+// Один шаг над 8-битным изображением
+static bool apply_stage_u8(const PipelineStage* stage, Image8* image) {
+    const FilterValues* values = &stage->filter->values;
+    
+    switch (stage->filter->type) {
+        case FILTER_CROP:      return filter8_crop(image, values->width, values->height);
+        case FILTER_GRAYSCALE: return filter8_grayscale(image);
+        case FILTER_NEGATIVE:  return filter8_negative(image);
+        case FILTER_SHARPEN:   return filter8_sharpen(image);
+        case FILTER_EDGE:      return filter8_edge_detection(image, values->value);
+        case FILTER_MEDIAN:    return filter8_median(image, values->size);
+        default:
+            fprintf(stderr, "Ошибка: фильтр не поддерживает 8-битный режим\n");
+            return false;
+    }
+}
+
+// Ветви конвейера
+
+static bool apply_steps(const FilterPipeline* pipeline, Image* image, Image8* image8);
+
+static bool stage_is_branch(const PipelineStage* stage) {
+    return stage->filter->type == FILTER_TEE || stage->filter->type == FILTER_BRANCH;
+}
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Ветвь точки ветвления
+typedef struct {
+    const FilterParams* filter;    // -tee или -branch
+    const Image* source;           // Изображение точки ветвления (только чтение)
+    bool ok;                       // Результат ветви
+    double seconds;                // Время выполнения ветви
+} BranchJob;
+
+// Фильтры ветви и сохранение результата
+//  Общее изображение не меняется: -tee сохраняет его как есть, ветвь с
+//  фильтрами сразу копирует его целиком и работает над копией
+static void branch_run(BranchJob* job) {
+    const FilterParams* filter = job->filter;
+    const FilterPipeline* branch = filter->branch;
+    double start = now_seconds();
+    
+    Image* copy = NULL;
+    if (branch && branch->count > 0) {
+        copy = image_copy(job->source);
+        job->ok = copy && apply_steps(branch, copy, NULL);
+    } else {
+        job->ok = true;
+    }
+    
+    if (job->ok) {
+        const Image* result = copy ? copy : job->source;
+        ProfileSpan span;
+        profile_begin(&span);
+        job->ok = bmp_save(filter->values.file, result);
+        profile_end(&span, "io", "bmp_save", filter->values.file,
+                    (uint64_t)result->width * result->height);
+        if (!job->ok) {
+            fprintf(stderr, "Ошибка сохранения результата ветви: %s\n", filter->values.file);
         }
-        
-        free(current);
-        current = next;
     }
     
-    pipeline->first = NULL;
-    pipeline->last = NULL;
-    pipeline->count = 0;
+    image_free(copy);
+    job->seconds = now_seconds() - start;
 }
 
-// Добавление фильтра в конвейер
+// Поток ветви: свой пул кадров на время ветви
+static void* branch_thread(void* arg) {
+    FramePool* pool = pipeline_pool_begin();
+    branch_run((BranchJob*)arg);
+    pipeline_pool_end(pool);
+    return NULL;
+}
 
-bool pipeline_add_filter(FilterPipeline* pipeline, 
-                        FilterType type, 
-                        char** args, 
-                        int arg_count) {
-    if (!pipeline) {
-        fprintf(stderr, "Ошибка: конвейер не инициализирован\n");
+// Выполнение count ветвей с шага first над общим изображением
+//  Ветви только читают image, поэтому выполняются одновременно: текущий
+//  поток берет первую ветвь, остальные - отдельные потоки. Журналы ветвей
+//  перемешались бы: stdout подавляется, по каждой ветви выводится итог
+static bool apply_branches(const PipelineStage* first, int count, int step,
+                           const Image* image) {
+    BranchJob* jobs = (BranchJob*)calloc(count, sizeof(BranchJob));
+    pthread_t* threads = (pthread_t*)malloc(count * sizeof(pthread_t));
+    if (!jobs || !threads) {
+        fprintf(stderr, "Ошибка выделения памяти для ветвей конвейера\n");
+        free(jobs);
+        free(threads);
         return false;
     }
     
-    // Проверка корректности аргументов
-    if (!validate_filter_args(type, args, arg_count)) {
-        fprintf(stderr, "Ошибка: некорректные аргументы для фильтра %s\n", 
-                filter_type_to_name(type));
-        return false;
+    for (int j = 0; j < count; j++) {
+        jobs[j].filter = first[j].filter;
+        jobs[j].source = image;
     }
     
-    // Создание новой структуры параметров
-    FilterParams* params = (FilterParams*)malloc(sizeof(FilterParams));
-    if (!params) {
-        fprintf(stderr, "Ошибка выделения памяти для параметров фильтра\n");
-        return false;
+    bool concurrent = count > 1 && parallel_get_threads() > 1;
+    if (concurrent) {
+        printf("🔀 Ветвей одновременно: %d\n", count);
     }
     
-    params->type = type;
-    params->arg_count = arg_count;
-    params->next = NULL;
+    int saved_stdout = stdout_suppress();
     
-    // Копирование аргументов
-    if (arg_count > 0 && args) {
-        params->args = (char**)malloc(arg_count * sizeof(char*));
-        if (!params->args) {
-            fprintf(stderr, "Ошибка выделения памяти для аргументов фильтра\n");
-            free(params);
-            return false;
+    // Потоки ветвей 2..count; при ошибке создания ветвь выполняется здесь
+    bool* started = (bool*)calloc(count, sizeof(bool));
+    for (int j = 1; concurrent && started && j < count; j++) {
+        started[j] = pthread_create(&threads[j], NULL, branch_thread, &jobs[j]) == 0;
+    }
+    for (int j = 0; j < count; j++) {
+        if (!started || !started[j]) {
+            branch_run(&jobs[j]);
         }
-        
-        for (int i = 0; i < arg_count; i++) {
-            params->args[i] = strdup(args[i]);
-            if (!params->args[i]) {
-                fprintf(stderr, "Ошибка копирования аргумента %d\n", i);
-                // Освобождаем уже выделенную память
-                for (int j = 0; j < i; j++) {
-                    free(params->args[j]);
-                }
-                free(params->args);
-                free(params);
-                return false;
-            }
+    }
+    for (int j = 1; started && j < count; j++) {
+        if (started[j]) {
+            pthread_join(threads[j], NULL);
         }
-    } else {
-        params->args = NULL;
     }
     
-    // Добавление в конец цепочки
-    if (!pipeline->first) {
-        pipeline->first = params;
-        pipeline->last = params;
-    } else {
-        pipeline->last->next = params;
-        pipeline->last = params;
+    stdout_restore(saved_stdout);
+    
+    bool ok = true;
+    for (int j = 0; j < count; j++) {
+        const FilterParams* filter = jobs[j].filter;
+        if (filter->type == FILTER_TEE) {
+            printf("%d. Сохранение ветви → %s... ", step + j, filter->values.file);
+        } else {
+            printf("%d. Ветвь → %s (%d фильтров)... ", step + j, filter->values.file,
+                   filter->branch ? filter->branch->count : 0);
+        }
+        if (jobs[j].ok) {
+            printf("✅ %.1f мс\n", jobs[j].seconds * 1e3);
+        } else {
+            printf("❌\n");
+            ok = false;
+        }
     }
     
-    pipeline->count++;
+    free(started);
+    free(threads);
+    free(jobs);
+    return ok;
+}
+
+// Шаги конвейера над изображением (image или image8)
+static bool apply_steps(const FilterPipeline* pipeline, Image* image, Image8* image8) {
+    int i = 0;
     
-    printf("✅ Добавлен фильтр: %s (аргументов: %d)\n", 
-           filter_type_to_name(type), arg_count);
+    while (i < pipeline->stage_count) {
+        const PipelineStage* stage = &pipeline->stages[i];
+        
+        // Перед шагом вычисляется только нужная дальше область
+        if (!apply_plan_crop(stage->filter, image, image8)) {
+            return false;
+        }
+        
+        // Ветви этой точки цепочки: выполняются вместе, цепочка ждет их
+        if (stage_is_branch(stage)) {
+            int count = 1;
+            while (i + count < pipeline->stage_count && stage_is_branch(&stage[count])) {
+                count++;
+            }
+            if (!image) {
+                fprintf(stderr, "Ошибка: ветви не поддерживают 8-битный режим\n");
+                return false;
+            }
+            if (!apply_branches(stage, count, i + 1, image)) {
+                return false;
+            }
+            i += count;
+            continue;
+        }
+        
+        // Серия фильтров окрестности над большим изображением - плитками
+        if (stage->tiled > 1 && image && tiled_wanted(image) &&
+            (stage->filter->type != FILTER_MEDIAN || image_on_byte_grid(image))) {
+            if (!apply_tiled_run(stage, i + 1, image)) {
+                return false;
+            }
+            i += stage->tiled;
+            continue;
+        }
+        
+        // Серия поточечных фильтров выполняется одним проходом по памяти
+        if (stage->run > 1) {
+            if (!apply_point_run(stage, i + 1, image, image8)) {
+                return false;
+            }
+            i += stage->run;
+            continue;
+        }
+        
+        const char* name = filter_type_to_name(stage->filter->type);
+        printf("%d. Применение %s... ", i + 1, name);
+        fflush(stdout);
+        
+        uint64_t pixels = image ? (uint64_t)image->width * image->height
+                                : (uint64_t)image8->width * image8->height;
+        ProfileSpan span;
+        profile_begin(&span);
+        
+        bool result = image ? apply_stage(pipeline, stage, image)
+                            : apply_stage_u8(stage, image8);
+        
+        profile_end(&span, "filter", stage->label, NULL, pixels);
+        
+        if (result) {
+            printf("✅\n");
+        } else {
+            printf("❌\n");
+            fprintf(stderr, "Ошибка применения фильтра %s\n", name);
+            return false;
+        }
+        
+        i++;
+    }
     
     return true;
 }
@@ -144,99 +1184,20 @@ bool pipeline_apply(FilterPipeline* pipeline, Image* image) {
         return true;
     }
     
+    if (!pipeline->compiled && !pipeline_compile(pipeline)) {
+        return false;
+    }
+    
     printf("\nНачало обработки изображения (%d фильтров)\n", pipeline->count);
     printf("========================================\n");
     
-    FilterParams* current = pipeline->first;
-    int step = 1;
+    // Буферы кадров переиспользуются между шагами
+    FramePool* pool = pipeline_pool_begin();
+    bool ok = apply_steps(pipeline, image, NULL);
+    pipeline_pool_end(pool);
     
-    while (current) {
-        printf("%d. Применение %s... ", step, filter_type_to_name(current->type));
-        fflush(stdout);
-        
-        bool result = false;
-        
-        // Применение соответствующего фильтра
-        switch (current->type) {
-            case FILTER_CROP:
-                if (current->arg_count >= 2) {
-                    int width = atoi(current->args[0]);
-                    int height = atoi(current->args[1]);
-                    result = filter_crop(image, width, height);
-                }
-                break;
-                
-            case FILTER_GRAYSCALE:
-                result = filter_grayscale(image);
-                break;
-                
-            case FILTER_NEGATIVE:
-                result = filter_negative(image);
-                break;
-                
-            case FILTER_SHARPEN:
-                result = filter_sharpen(image);
-                break;
-                
-            case FILTER_EDGE:
-                if (current->arg_count >= 1) {
-                    float threshold = atof(current->args[0]);
-                    result = filter_edge_detection(image, threshold);
-                }
-                break;
-                
-            case FILTER_MEDIAN:
-                if (current->arg_count >= 1) {
-                    int window = atoi(current->args[0]);
-                    result = filter_median(image, window);
-                }
-                break;
-                
-            case FILTER_BLUR:
-                if (current->arg_count >= 1) {
-                    float sigma = atof(current->args[0]);
-                    result = filter_gaussian_blur(image, sigma);
-                }
-                break;
-                
-            case FILTER_CRYSTALLIZE:
-                if (current->arg_count >= 1) {
-                    int cell_size = atoi(current->args[0]);
-                    result = filter_crystallize(image, cell_size);
-                }
-                break;
-                
-            case FILTER_GLASS:
-                if (current->arg_count >= 1) {
-                    float scale = atof(current->args[0]);
-                    result = filter_glass_distortion(image, scale);
-                }
-                break;
-                
-            case FILTER_MOSAIC:
-                if (current->arg_count >= 2) {
-                    int tile_size = atoi(current->args[0]);
-                    const char* tile_file = current->args[1];
-                    result = filter_mosaic(image, tile_size, tile_file);
-                }
-                break;
-                
-            default:
-                fprintf(stderr, "Ошибка: неизвестный тип фильтра\n");
-                break;
-        }
-        
-        if (result) {
-            printf("✅\n");
-        } else {
-            printf("❌\n");
-            fprintf(stderr, "Ошибка применения фильтра %s\n", 
-                    filter_type_to_name(current->type));
-            return false;
-        }
-        
-        current = current->next;
-        step++;
+    if (!ok) {
+        return false;
     }
     
     printf("========================================\n");
@@ -245,22 +1206,81 @@ bool pipeline_apply(FilterPipeline* pipeline, Image* image) {
     return true;
 }
 
-// Печать информации о конвейере
+// Применение конвейера к 8-битному изображению
 
-void pipeline_print(const FilterPipeline* pipeline) {
-    if (!pipeline) {
-        printf("Конвейер не инициализирован\n");
-        return;
+bool pipeline_apply_u8(FilterPipeline* pipeline, Image8* image) {
+    if (!pipeline || !image) {
+        fprintf(stderr, "Ошибка: конвейер или изображение не инициализированы\n");
+        return false;
+    }
+    
+    if (pipeline->count == 0) {
+        printf("Конвейер пуст, изображение не изменено\n");
+        return true;
+    }
+    
+    if (!pipeline->compiled && !pipeline_compile(pipeline)) {
+        return false;
+    }
+    
+    printf("\nНачало обработки изображения (%d фильтров, 8-битный режим)\n", 
+           pipeline->count);
+    printf("========================================\n");
+    
+    // Буферы кадров переиспользуются между шагами
+    FramePool* pool = pipeline_pool_begin();
+    bool ok = apply_steps(pipeline, NULL, image);
+    pipeline_pool_end(pool);
+    
+    if (!ok) {
+        return false;
     }
     
-    printf("\nКонвейер фильтров (%d элементов):\n", pipeline->count);
     printf("========================================\n");
+    printf("Обработка завершена успешно!\n\n");
+    
+    return true;
+}
+
+// Выбор 8-битного режима
+
+bool pipeline_use_u8(const FilterPipeline* pipeline) {
+    if (!pipeline || !pipeline->allow_u8) {
+        return false;
+    }
+    
+    for (FilterParams* current = pipeline->first; current; current = current->next) {
+        if (!filter_supports_u8(current->type)) {
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Есть ли в конвейере ветви
+
+bool pipeline_has_branches(const FilterPipeline* pipeline) {
+    if (!pipeline) return false;
+    
+    for (FilterParams* current = pipeline->first; current; current = current->next) {
+        if (current->type == FILTER_TEE || current->type == FILTER_BRANCH) {
+            return true;
+        }
+    }
     
+    return false;
+}
+
+// Печать информации о конвейере
+
+// Фильтры цепочки; фильтры ветви - с отступом под ней
+static void filters_print(const FilterPipeline* pipeline, int depth) {
     FilterParams* current = pipeline->first;
     int index = 1;
     
     while (current) {
-        printf("%d. %s", index, filter_type_to_name(current->type));
+        printf("%*s%d. %s", depth * 3, "", index, filter_type_to_name(current->type));
         
         if (current->arg_count > 0) {
             printf(" [");
@@ -273,11 +1293,30 @@ void pipeline_print(const FilterPipeline* pipeline) {
             printf("]");
         }
         
+        // Область входа по плану, если шаг считает не все изображение
+        if (pipeline->compiled && current->type != FILTER_CROP &&
+            current->region_width && current->region_height) {
+            printf("  → вход: %ux%u", current->region_width, current->region_height);
+        }
+        
         printf("\n");
+        if (current->branch) {
+            filters_print(current->branch, depth + 1);
+        }
         current = current->next;
         index++;
     }
+}
+
+void pipeline_print(const FilterPipeline* pipeline) {
+    if (!pipeline) {
+        printf("Конвейер не инициализирован\n");
+        return;
+    }
     
+    printf("\nКонвейер фильтров (%d элементов):\n", pipeline->count);
+    printf("========================================\n");
+    filters_print(pipeline, 0);
     printf("========================================\n");
 }
 
@@ -286,15 +1325,20 @@ void pipeline_print(const FilterPipeline* pipeline) {
 const char* filter_type_to_name(FilterType type) {
     switch (type) {
         case FILTER_CROP:        return "Crop";
+        case FILTER_RESIZE:      return "Resize";
         case FILTER_GRAYSCALE:   return "Grayscale";
         case FILTER_NEGATIVE:    return "Negative";
         case FILTER_SHARPEN:     return "Sharpening";
         case FILTER_EDGE:        return "Edge Detection";
         case FILTER_MEDIAN:      return "Median Filter";
         case FILTER_BLUR:        return "Gaussian Blur";
+        case FILTER_BLUR_FAST:   return "Fast Gaussian Blur";
+        case FILTER_CONV:        return "Convolution";
         case FILTER_CRYSTALLIZE: return "Crystallize";
         case FILTER_GLASS:       return "Glass Distortion";
         case FILTER_MOSAIC:      return "Mosaic";
+        case FILTER_TEE:         return "Tee";
+        case FILTER_BRANCH:      return "Branch";
         default:                 return "Unknown";
     }
 }
@@ -318,90 +1362,45 @@ FilterType filter_name_to_type(const char* name) {
     
     // Сопоставление имен
     if (strcmp(lower_name, "crop") == 0)        return FILTER_CROP;
+    if (strcmp(lower_name, "resize") == 0)      return FILTER_RESIZE;
     if (strcmp(lower_name, "gs") == 0)          return FILTER_GRAYSCALE;
     if (strcmp(lower_name, "neg") == 0)         return FILTER_NEGATIVE;
     if (strcmp(lower_name, "sharp") == 0)       return FILTER_SHARPEN;
     if (strcmp(lower_name, "edge") == 0)        return FILTER_EDGE;
     if (strcmp(lower_name, "med") == 0)         return FILTER_MEDIAN;
     if (strcmp(lower_name, "blur") == 0)        return FILTER_BLUR;
+    if (strcmp(lower_name, "fblur") == 0)       return FILTER_BLUR_FAST;
+    if (strcmp(lower_name, "conv") == 0)        return FILTER_CONV;
     if (strcmp(lower_name, "crystallize") == 0) return FILTER_CRYSTALLIZE;
     if (strcmp(lower_name, "glass") == 0)       return FILTER_GLASS;
     if (strcmp(lower_name, "mosaic") == 0)      return FILTER_MOSAIC;
+    if (strcmp(lower_name, "tee") == 0)         return FILTER_TEE;
+    if (strcmp(lower_name, "branch") == 0)      return FILTER_BRANCH;
     
     return FILTER_COUNT;  // Неизвестный фильтр
 }
 
-// Проверка корректности аргументов
+// Поддержка 8-битного режима
 
-bool validate_filter_args(FilterType type, char** args, int arg_count) {
+bool filter_supports_u8(FilterType type) {
     switch (type) {
         case FILTER_CROP:
-            // -crop width height
-            if (arg_count != 2) {
-                fprintf(stderr, "Фильтр Crop требует 2 аргумента (width height)\n");
-                return false;
-            }
-            return (atoi(args[0]) > 0 && atoi(args[1]) > 0);
-            
         case FILTER_GRAYSCALE:
         case FILTER_NEGATIVE:
         case FILTER_SHARPEN:
-            // Без аргументов
-            return (arg_count == 0);
-            
         case FILTER_EDGE:
-            // -edge threshold
-            if (arg_count != 1) {
-                fprintf(stderr, "Фильтр Edge Detection требует 1 аргумент (threshold)\n");
-                return false;
-            }
-            return (atof(args[0]) >= 0.0f);
-            
         case FILTER_MEDIAN:
-            // -med window (нечетное)
-            if (arg_count != 1) {
-                fprintf(stderr, "Фильтр Median требует 1 аргумент (window size)\n");
-                return false;
-            }
-            {
-                int window = atoi(args[0]);
-                return (window > 0 && window % 2 == 1);
-            }
-            
-        case FILTER_BLUR:
-            // -blur sigma
-            if (arg_count != 1) {
-                fprintf(stderr, "Фильтр Gaussian Blur требует 1 аргумент (sigma)\n");
-                return false;
-            }
-            return (atof(args[0]) > 0.0f);
-            
-        case FILTER_CRYSTALLIZE:
-            // -crystallize cell_size
-            if (arg_count != 1) {
-                fprintf(stderr, "Фильтр Crystallize требует 1 аргумент (cell size)\n");
-                return false;
-            }
-            return (atoi(args[0]) > 1);
-            
-        case FILTER_GLASS:
-            // -glass dist_scale
-            if (arg_count != 1) {
-                fprintf(stderr, "Фильтр Glass Distortion требует 1 аргумент (scale)\n");
-                return false;
-            }
-            return (atof(args[0]) > 0.0f);
-        
-        case FILTER_MOSAIC:
-            // -mosaic tile_size tile_file
-            if (arg_count != 2) {
-                fprintf(stderr, "Фильтр Mosaic требует 2 аргумента (tile_size tile_file)\n");
-                return false;
-            }
-            return (atoi(args[0]) > 0);
-            
+            return true;
         default:
-            fprintf(stderr, "Неизвестный тип фильтра\n");
             return false;
     }
-}
\ No newline at end of file
+}
+
+// Проверка корректности аргументов
+
+bool validate_filter_args(FilterType type, char** args, int arg_count) {
+    FilterValues values;
+    bool ok = filter_values_parse(type, args, arg_count, &values);
+    filter_values_free(&values);
+    return ok;
+}
@@ -2,6 +2,7 @@
 #define PIPELINE_H
 
 #include "image.h"
+#include "convolution.h"
 #include <stdbool.h>
 
 // Типы фильтров
@@ -9,12 +10,15 @@
 // Основные фильтры 
 typedef enum {
     FILTER_CROP,      // -crop width height
+    FILTER_RESIZE,    // -resize width height [lanczos|bicubic]
     FILTER_GRAYSCALE, // -gs
     FILTER_NEGATIVE,  // -neg
     FILTER_SHARPEN,   // -sharp
     FILTER_EDGE,      // -edge threshold
     FILTER_MEDIAN,    // -med window
     FILTER_BLUR,      // -blur sigma
+    FILTER_BLUR_FAST, // -fblur sigma (приближение тремя боксами)
+    FILTER_CONV,      // -conv kernel_file
     
     // Дополнительные фильтры
     FILTER_CRYSTALLIZE, // -crystallize cell_size
@@ -23,24 +27,59 @@ typedef enum {
     // Мозаика
     FILTER_MOSAIC,      // -mosaic tile_size tile_file
     
+    // Ветвление конвейера
+    FILTER_TEE,         // -tee file (сохранить текущее изображение и продолжить)
+    FILTER_BRANCH,      // -branch file фильтры... -end
+    
     FILTER_COUNT        // Количество фильтров
 } FilterType;
 
+// Разобранные аргументы фильтра (заполняются при добавлении в конвейер)
+
+typedef struct {
+    uint32_t width;            // -crop, -resize: ширина
+    uint32_t height;           // -crop, -resize: высота
+    int method;                // -resize: ядро (ResizeMethod)
+    int size;                  // -med: окно, -crystallize: ячейка, -mosaic: плитка
+    float value;               // -edge: порог, -blur/-fblur: сигма, -glass: масштаб
+    const char* file;          // -conv, -mosaic: входной файл, -tee, -branch: файл результата
+    ConvKernel* kernel;        // -conv: ядро, прочитанное из файла при разборе
+} FilterValues;
+
 // Структура для параметров фильтра
 
+struct FilterPipeline;
+
 typedef struct FilterParams {
     FilterType type;           // Тип фильтра
-    char** args;               // Аргументы фильтра
+    char** args;               // Аргументы фильтра (для вывода)
     int arg_count;             // Количество аргументов
+    FilterValues values;       // Разобранные аргументы
+    uint32_t region_width;     // Нужная ширина входа по плану (0 - все изображение)
+    uint32_t region_height;    // Нужная высота входа по плану (0 - все изображение)
+    struct FilterPipeline* branch; // -branch: фильтры ветви (NULL - нет)
     struct FilterParams* next; // Следующий фильтр в цепочке
 } FilterParams;
 
-// Структура конвейера фильтров
+// Шаг скомпилированного конвейера (pipeline.c)
 
-typedef struct {
+typedef struct PipelineStage PipelineStage;
+
+// Структура конвейера фильтров (ветви -tee/-branch образуют дерево)
+
+typedef struct FilterPipeline {
     FilterParams* first;       // Первый фильтр в цепочке
     FilterParams* last;        // Последний фильтр в цепочке
     int count;                 // Количество фильтров
+    bool allow_u8;             // Разрешен 8-битный режим (-u8)
+    bool streaming;            // Потоковая обработка полосами (-stream)
+    int jobs;                  // Файлов одновременно в пакетном режиме (-jobs, 0 - авто)
+    bool profile;              // Профилирование этапов (--profile)
+    const char* trace_file;    // Файл трассы --profile (NULL - по умолчанию)
+    PipelineStage* stages;     // Скомпилированные шаги (pipeline_compile)
+    int stage_count;           // Количество шагов
+    bool compiled;             // Шаги и план областей актуальны
+    uint32_t seed;             // Зерно случайных фильтров (-seed)
 } FilterPipeline;
 
 // Функции работы с конвейером
@@ -54,9 +93,26 @@ bool pipeline_add_filter(FilterPipeline* pipeline,
                         char** args, 
                         int arg_count);
 
-// Применение всего конвейера к изображению
+// Разбор параметров и фильтров командной строки (argv[start..argc)) с компиляцией
+bool pipeline_parse_options(FilterPipeline* pipeline, int argc, char** argv, int start);
+
+// Компиляция конвейера в шаги с готовыми ресурсами и планом областей
+// Вызывается автоматически при применении, если цепочка изменилась
+bool pipeline_compile(FilterPipeline* pipeline);
+
+// Применение всего конвейера к изображению (ветви одной точки - параллельно)
 bool pipeline_apply(FilterPipeline* pipeline, Image* image);
 
+// Применение конвейера к 8-битному изображению
+// Все фильтры цепочки должны поддерживать 8-битный режим
+bool pipeline_apply_u8(FilterPipeline* pipeline, Image8* image);
+
+// Выбор 8-битного режима: разрешен и поддерживается всеми фильтрами цепочки
+bool pipeline_use_u8(const FilterPipeline* pipeline);
+
+// Есть ли в конвейере ветви (-tee, -branch)
+bool pipeline_has_branches(const FilterPipeline* pipeline);
+
 // Очистка конвейера
 void pipeline_clear(FilterPipeline* pipeline);
 
@@ -74,6 +130,9 @@ const char* filter_type_to_name(FilterType type);
 // Получение типа фильтра по имени
 FilterType filter_name_to_type(const char* name);
 
+// Поддержка фильтром 8-битного режима
+bool filter_supports_u8(FilterType type);
+
 // Проверка корректности аргументов фильтра
 bool validate_filter_args(FilterType type, char** args, int arg_count);
 
@@ -0,0 +1,298 @@
+#include "profile.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+// Записанный этап
+
+typedef struct {
+    char* category;            // Группа в трассе
+    char* name;                // Имя этапа
+    char* detail;              // Аргументы или файл (может быть NULL)
+    int thread;                // Номер потока в трассе
+    double start;              // Начало от старта профилирования, с
+    double wall;               // Длительность, с
+    double cpu;                // Процессорное время, с
+    uint64_t pixels;           // Пикселей на входе
+    int64_t heap_delta;        // Прирост занятой кучи, байт
+    int64_t rss;               // RSS на конец этапа, байт
+    int64_t peak_rss;          // Пиковый RSS на конец этапа, байт
+    int64_t peak_rss_delta;    // Рост пикового RSS за этап, байт
+} ProfileEvent;
+
+// Состояние
+
+static atomic_bool enabled = false;
+static double origin = 0.0;                // Время включения
+static pthread_mutex_t events_mutex = PTHREAD_MUTEX_INITIALIZER;
+static ProfileEvent* events = NULL;
+static int event_count = 0;
+static int event_capacity = 0;
+
+static atomic_int next_thread = 1;
+static _Thread_local int thread_id = 0;
+
+// Измерения
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static double cpu_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static int64_t heap_in_use(void) {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    // Блоки арен и большие блоки, выделенные через mmap (изображения)
+    struct mallinfo2 info = mallinfo2();
+    return (int64_t)(info.uordblks + info.hblkhd);
+#else
+    return 0;
+#endif
+}
+
+static int64_t current_rss(void) {
+    FILE* statm = fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+
+    long long size = 0, resident = 0;
+    int read = fscanf(statm, "%lld %lld", &size, &resident);
+    fclose(statm);
+
+    return read == 2 ? (int64_t)resident * sysconf(_SC_PAGESIZE) : 0;
+}
+
+static int64_t peak_rss(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+    return (int64_t)usage.ru_maxrss * 1024;  // ru_maxrss в КБ
+}
+
+static char* copy_string(const char* s) {
+    return s ? strdup(s) : NULL;
+}
+
+// Управление
+
+void profile_enable(void) {
+    origin = monotonic_seconds();
+    atomic_store(&enabled, true);
+}
+
+bool profile_enabled(void) {
+    return atomic_load_explicit(&enabled, memory_order_relaxed);
+}
+
+void profile_reset(void) {
+    pthread_mutex_lock(&events_mutex);
+    for (int i = 0; i < event_count; i++) {
+        free(events[i].category);
+        free(events[i].name);
+        free(events[i].detail);
+    }
+    free(events);
+    events = NULL;
+    event_count = 0;
+    event_capacity = 0;
+    pthread_mutex_unlock(&events_mutex);
+}
+
+// Этапы
+
+void profile_begin(ProfileSpan* span) {
+    span->active = profile_enabled();
+    if (!span->active) return;
+
+    span->heap = heap_in_use();
+    span->peak_rss = peak_rss();
+    span->cpu = cpu_seconds();
+    span->wall = monotonic_seconds();
+}
+
+void profile_end(const ProfileSpan* span, const char* category, const char* name,
+                 const char* detail, uint64_t pixels) {
+    if (!span->active) return;
+
+    double wall_end = monotonic_seconds();
+    double cpu_end = cpu_seconds();
+
+    if (thread_id == 0) {
+        thread_id = atomic_fetch_add(&next_thread, 1);
+    }
+
+    ProfileEvent event;
+    event.category = copy_string(category);
+    event.name = copy_string(name);
+    event.detail = copy_string(detail);
+    event.thread = thread_id;
+    event.start = span->wall - origin;
+    event.wall = wall_end - span->wall;
+    event.cpu = cpu_end - span->cpu;
+    event.pixels = pixels;
+    event.heap_delta = heap_in_use() - span->heap;
+    event.rss = current_rss();
+    event.peak_rss = peak_rss();
+    event.peak_rss_delta = event.peak_rss - span->peak_rss;
+
+    pthread_mutex_lock(&events_mutex);
+
+    if (event_count == event_capacity) {
+        int capacity = event_capacity ? event_capacity * 2 : 32;
+        ProfileEvent* grown = (ProfileEvent*)realloc(events, capacity * sizeof(ProfileEvent));
+        if (!grown) {
+            pthread_mutex_unlock(&events_mutex);
+            free(event.category);
+            free(event.name);
+            free(event.detail);
+            return;
+        }
+        events = grown;
+        event_capacity = capacity;
+    }
+    events[event_count++] = event;
+
+    pthread_mutex_unlock(&events_mutex);
+}
+
+// Таблица
+
+// Вывод текста в колонку ширины width символов (UTF-8: кириллица - 2 байта)
+static void print_cell(FILE* out, const char* text, int width, bool left) {
+    int chars = 0;
+    for (const char* p = text; *p; p++) {
+        if (((unsigned char)*p & 0xC0) != 0x80) chars++;
+    }
+    
+    int pad = width > chars ? width - chars : 0;
+    if (left) {
+        fprintf(out, "%s%*s", text, pad, "");
+    } else {
+        fprintf(out, "%*s%s", pad, "", text);
+    }
+}
+
+void profile_print(FILE* out) {
+    const double mb = 1024.0 * 1024.0;
+
+    pthread_mutex_lock(&events_mutex);
+
+    fprintf(out, "\n📊 Профиль выполнения (%d этапов)\n", event_count);
+    fprintf(out, "==========================================================================================\n");
+    const char* headers[] = {"Время,мс", "ЦП,мс", "МП/с", "Куча,МБ", "RSS,МБ", "Пик,МБ"};
+    const int widths[] = {10, 10, 9, 10, 9, 10};
+    print_cell(out, "Этап", 32, true);
+    for (int i = 0; i < 6; i++) {
+        fputc(' ', out);
+        print_cell(out, headers[i], widths[i], false);
+    }
+    fputc('\n', out);
+    fprintf(out, "------------------------------------------------------------------------------------------\n");
+
+    double total_wall = 0.0, total_cpu = 0.0;
+
+    for (int i = 0; i < event_count; i++) {
+        const ProfileEvent* e = &events[i];
+        // Имя этапа и файл (без каталога), если он указан
+        char label[33];
+        const char* file = e->detail ? strrchr(e->detail, '/') : NULL;
+        file = file ? file + 1 : e->detail;
+        snprintf(label, sizeof(label), "%s%s%s", e->name ? e->name : "?",
+                 file ? " " : "", file ? file : "");
+
+        print_cell(out, label, 32, true);
+        fprintf(out, " %10.2f %10.2f ", e->wall * 1e3, e->cpu * 1e3);
+        if (e->pixels > 0 && e->wall > 0.0) {
+            fprintf(out, "%9.1f", (double)e->pixels / 1e6 / e->wall);
+        } else {
+            fprintf(out, "%9s", "-");
+        }
+        fprintf(out, " %+10.1f %9.1f %10.1f%s\n", (double)e->heap_delta / mb,
+                (double)e->rss / mb, (double)e->peak_rss / mb,
+                e->peak_rss_delta > 0 ? " ▲" : "");
+
+        total_wall += e->wall;
+        total_cpu += e->cpu;
+    }
+
+    fprintf(out, "------------------------------------------------------------------------------------------\n");
+    print_cell(out, "Итого", 32, true);
+    fprintf(out, " %10.2f %10.2f\n", total_wall * 1e3, total_cpu * 1e3);
+    fprintf(out, "▲ - этап поднял пиковый RSS процесса\n");
+
+    pthread_mutex_unlock(&events_mutex);
+}
+
+// Трасса Chrome trace events
+
+static void write_json_string(FILE* out, const char* s) {
+    fputc('"', out);
+    for (; s && *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+bool profile_write_trace(const char* filename) {
+    FILE* out = fopen(filename, "w");
+    if (!out) {
+        fprintf(stderr, "Ошибка создания файла трассы: %s\n", filename);
+        return false;
+    }
+
+    pthread_mutex_lock(&events_mutex);
+
+    int pid = (int)getpid();
+    fprintf(out, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+
+    for (int i = 0; i < event_count; i++) {
+        const ProfileEvent* e = &events[i];
+        double ts = e->start * 1e6;
+        double end = (e->start + e->wall) * 1e6;
+
+        // Длительность этапа
+        fprintf(out, "%s  {\"name\": ", i ? ",\n" : "");
+        write_json_string(out, e->name);
+        fprintf(out, ", \"cat\": ");
+        write_json_string(out, e->category);
+        fprintf(out, ", \"ph\": \"X\", \"ts\": %.3f, \"dur\": %.3f, \"pid\": %d, \"tid\": %d, "
+                "\"args\": {\"detail\": ", ts, e->wall * 1e6, pid, e->thread);
+        write_json_string(out, e->detail);
+        fprintf(out, ", \"cpu_ms\": %.3f, \"pixels\": %llu, \"heap_delta_bytes\": %lld, "
+                "\"rss_bytes\": %lld, \"peak_rss_bytes\": %lld}}",
+                e->cpu * 1e3, (unsigned long long)e->pixels, (long long)e->heap_delta,
+                (long long)e->rss, (long long)e->peak_rss);
+
+        // Счетчик памяти на конец этапа
+        fprintf(out, ",\n  {\"name\": \"memory\", \"ph\": \"C\", \"ts\": %.3f, \"pid\": %d, "
+                "\"args\": {\"rss_mb\": %.2f, \"peak_rss_mb\": %.2f}}",
+                end, pid, (double)e->rss / (1024.0 * 1024.0),
+                (double)e->peak_rss / (1024.0 * 1024.0));
+    }
+
+    fprintf(out, "\n]}\n");
+
+    pthread_mutex_unlock(&events_mutex);
+
+    bool ok = (fclose(out) == 0);
+    if (!ok) {
+        fprintf(stderr, "Ошибка записи файла трассы: %s\n", filename);
+    }
+    return ok;
+}
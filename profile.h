@@ -0,0 +1,55 @@
+// Профилирование этапов обработки (--profile)
+//  Для каждого этапа (загрузка, каждый фильтр конвейера, сохранение)
+//  записываются время, процессорное время процесса, число пикселей,
+//  прирост занятой кучи и RSS. В конце выводится таблица и пишется
+//  трасса в формате Chrome trace events (chrome://tracing, Perfetto).
+//  Память:
+//   куча - чистый прирост занятых байт malloc за этап (mallinfo2);
+//          временные буферы, освобожденные внутри этапа, в нем не видны,
+//   пик RSS - максимум RSS процесса на конец этапа; этап, на котором
+//          пик вырос, и есть этап, поднявший пиковое потребление.
+//  Процессорное время учитывает все потоки процесса: при --batch
+//  с несколькими файлами одновременно оно включает соседние файлы.
+//  Выключенное профилирование стоит одну проверку флага на этап.
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Начало этапа
+typedef struct {
+    bool active;               // Профилирование было включено при начале
+    double wall;               // Время начала (CLOCK_MONOTONIC), с
+    double cpu;                // Процессорное время процесса, с
+    int64_t heap;              // Занято в куче, байт
+    int64_t peak_rss;          // Пиковый RSS, байт
+} ProfileSpan;
+
+// Включение профилирования (до начала обработки)
+void profile_enable(void);
+
+// Включено ли профилирование
+bool profile_enabled(void);
+
+// Начало этапа
+void profile_begin(ProfileSpan* span);
+
+// Завершение этапа
+// category - группа в трассе (io, filter, stream), name - имя этапа,
+// detail - аргументы или имя файла (может быть NULL), pixels - пикселей на входе
+void profile_end(const ProfileSpan* span, const char* category, const char* name,
+                 const char* detail, uint64_t pixels);
+
+// Таблица этапов
+void profile_print(FILE* out);
+
+// Трасса в формате Chrome trace events
+bool profile_write_trace(const char* filename);
+
+// Освобождение записанных этапов
+void profile_reset(void);
+
+#endif
@@ -0,0 +1,234 @@
+#include "resize.h"
+#include "parallel.h"
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdatomic.h>
+
+#define LANCZOS_A 3.0              // Радиус ядра Ланцоша
+#define BICUBIC_A (-0.5)           // Параметр бикубического ядра
+
+// Ядра
+
+static double lanczos_kernel(double x) {
+    x = fabs(x);
+    if (x < 1e-9) return 1.0;
+    if (x >= LANCZOS_A) return 0.0;
+    double px = M_PI * x;
+    return LANCZOS_A * sin(px) * sin(px / LANCZOS_A) / (px * px);
+}
+
+static double bicubic_kernel(double x) {
+    const double a = BICUBIC_A;
+    x = fabs(x);
+    if (x < 1.0) return ((a + 2.0) * x - (a + 3.0)) * x * x + 1.0;
+    if (x < 2.0) return a * (((x - 5.0) * x + 8.0) * x - 4.0);
+    return 0.0;
+}
+
+bool resize_method_parse(const char* name, ResizeMethod* method) {
+    if (strcmp(name, "lanczos") == 0) {
+        *method = RESIZE_LANCZOS;
+        return true;
+    }
+    if (strcmp(name, "bicubic") == 0) {
+        *method = RESIZE_BICUBIC;
+        return true;
+    }
+    return false;
+}
+
+const char* resize_method_name(ResizeMethod method) {
+    return method == RESIZE_BICUBIC ? "bicubic" : "lanczos";
+}
+
+// Таблица весов одной оси
+
+typedef struct {
+    int taps;                  // Отсчетов входа на выходной пиксель
+    int32_t* starts;           // Первый отсчет для каждого выходного пикселя
+    float* weights;            // Веса: [t * count + i] (tap_major) или [i * taps + t]
+} ResizeAxis;
+
+static void axis_free(ResizeAxis* axis) {
+    free(axis->starts);
+    free(axis->weights);
+}
+
+// Веса выходных пикселей 0..out-1 по входу из in отсчетов
+//  Окно у всех пикселей одной длины (у краев сдвигается внутрь, лишние
+//  веса нулевые), поэтому внутренние циклы проходов не ветвятся
+static bool axis_build(ResizeAxis* axis, uint32_t in, uint32_t out,
+                       ResizeMethod method, bool tap_major) {
+    double (*kernel)(double) = method == RESIZE_BICUBIC ? bicubic_kernel : lanczos_kernel;
+    double radius = method == RESIZE_BICUBIC ? 2.0 : LANCZOS_A;
+
+    double scale = (double)in / out;
+    double stretch = scale > 1.0 ? scale : 1.0;
+    double support = radius * stretch;
+
+    double span = ceil(2.0 * support) + 1.0;
+    int taps = span < (double)in ? (int)span : (int)in;
+
+    axis->taps = taps;
+    axis->starts = (int32_t*)malloc(out * sizeof(int32_t));
+    axis->weights = (float*)calloc((size_t)out * taps, sizeof(float));
+    double* values = (double*)malloc((size_t)taps * sizeof(double));
+    if (!axis->starts || !axis->weights || !values) {
+        free(values);
+        axis_free(axis);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < out; i++) {
+        // Центр выходного пикселя в координатах входа
+        double center = (i + 0.5) * scale;
+        double low = floor(center - support + 0.5);
+        double high = floor(center + support + 0.5);
+        int first = low > 0.0 ? (int)low : 0;
+        int last = high < (double)in ? (int)high : (int)in;
+        if (last - first > taps) last = first + taps;
+
+        int start = first + taps <= (int)in ? first : (int)in - taps;
+        axis->starts[i] = start;
+
+        double sum = 0.0;
+        for (int t = 0; t < taps; t++) {
+            int j = start + t;
+            values[t] = j >= first && j < last ? kernel((j + 0.5 - center) / stretch) : 0.0;
+            sum += values[t];
+        }
+
+        for (int t = 0; t < taps; t++) {
+            // Ни один отсчет не попал в носитель: берется ближайший
+            double w = sum != 0.0 ? values[t] / sum : (start + t == first ? 1.0 : 0.0);
+            size_t index = tap_major ? (size_t)t * out + i : (size_t)i * taps + t;
+            axis->weights[index] = (float)w;
+        }
+    }
+
+    free(values);
+    return true;
+}
+
+// Проходы
+
+typedef struct {
+    const Image* source;
+    Image* target;
+    const ResizeAxis* axis;
+    atomic_bool failed;        // Ошибка выделения памяти в одной из полос
+} ResizePass;
+
+// Горизонтальный проход: строки входа -> строки ширины результата
+static void horizontal_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    ResizePass* pass = (ResizePass*)ctx;
+    const Image* src = pass->source;
+    Image* dst = pass->target;
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        simd_resample_row_rgb((const float*)(src->data + (size_t)y * src->width), src->width,
+                              (float*)(dst->data + (size_t)y * dst->width), dst->width,
+                              pass->axis->starts, pass->axis->weights, pass->axis->taps);
+    }
+}
+
+// Вертикальный проход: строка результата - взвешенная сумма строк входа
+static void vertical_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    ResizePass* pass = (ResizePass*)ctx;
+    const Image* src = pass->source;
+    Image* dst = pass->target;
+    const ResizeAxis* axis = pass->axis;
+    size_t count = (size_t)dst->width * 3;
+
+    const float** rows = (const float**)malloc((size_t)axis->taps * sizeof(float*));
+    if (!rows) {
+        atomic_store(&pass->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int t = 0; t < axis->taps; t++) {
+            rows[t] = (const float*)(src->data + (size_t)(axis->starts[y] + t) * src->width);
+        }
+
+        float* out = (float*)(dst->data + (size_t)y * dst->width);
+        memset(out, 0, count * sizeof(float));
+        simd_convolve_column(rows, out, count, axis->weights + (size_t)y * axis->taps,
+                             axis->taps);
+        simd_clamp(out, count);
+    }
+
+    free(rows);
+}
+
+// Фильтр -resize
+
+bool filter_resize(Image* image, uint32_t width, uint32_t height, ResizeMethod method) {
+    if (!image || !image->data) {
+        fprintf(stderr, "Ошибка: изображение не инициализировано\n");
+        return false;
+    }
+
+    if (width == 0 || height == 0) {
+        fprintf(stderr, "Ошибка: неверные размеры для resize: %ux%u\n", width, height);
+        return false;
+    }
+
+    uint32_t old_width = image->width;
+    uint32_t old_height = image->height;
+
+    if (width == old_width && height == old_height) {
+        printf("Resize: размер %ux%u не изменился\n", width, height);
+        return true;
+    }
+
+    // Таблицы весов: по столбцам - сбор по отсчетам, по строкам - подряд
+    ResizeAxis columns, rows;
+    if (!axis_build(&columns, old_width, width, method, true)) {
+        fprintf(stderr, "Ошибка выделения памяти для весов resize\n");
+        return false;
+    }
+    if (!axis_build(&rows, old_height, height, method, false)) {
+        fprintf(stderr, "Ошибка выделения памяти для весов resize\n");
+        axis_free(&columns);
+        return false;
+    }
+
+    Image* temp = image_create_uninit(width, old_height);
+    Image* result = temp ? image_create_uninit(width, height) : NULL;
+    if (!result) {
+        fprintf(stderr, "Ошибка создания изображения для resize\n");
+        image_free(temp);
+        axis_free(&columns);
+        axis_free(&rows);
+        return false;
+    }
+
+    ResizePass horizontal = { .source = image, .target = temp, .axis = &columns };
+    atomic_init(&horizontal.failed, false);
+    parallel_for_rows(old_height, horizontal_band, &horizontal);
+
+    ResizePass vertical = { .source = temp, .target = result, .axis = &rows };
+    atomic_init(&vertical.failed, false);
+    parallel_for_rows(height, vertical_band, &vertical);
+
+    image_free(temp);
+
+    bool ok = !atomic_load(&vertical.failed);
+    if (ok) {
+        image_replace(image, result);
+        printf("Resize: %ux%u -> %ux%u (%s, отсчетов %dx%d)\n",
+               old_width, old_height, width, height, resize_method_name(method),
+               columns.taps, rows.taps);
+    } else {
+        fprintf(stderr, "Ошибка выделения памяти для буфера resize\n");
+        image_free(result);
+    }
+
+    axis_free(&columns);
+    axis_free(&rows);
+    return ok;
+}
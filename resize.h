@@ -0,0 +1,35 @@
+// Изменение размера изображения (-resize W H [lanczos|bicubic])
+//  Разделимая передискретизация: горизонтальный проход в промежуточный
+//  кадр out_w x in_h, затем вертикальный. Для каждого выходного столбца
+//  и строки один раз на геометрию считается таблица весов (первый отсчет
+//  входа и веса), проходы только читают ее.
+//  При уменьшении ядро растягивается в in/out раз (сглаживание без
+//  наложения спектров), веса у краев нормируются по попавшим в изображение
+//  отсчетам. Результат ограничивается в [0, 1]: лепестки Ланцоша и
+//  бикубического ядра дают выбросы на резких границах.
+//  Горизонтальный проход на AVX2 собирает 8 выходных пикселей за шаг,
+//  вертикальный - свертка столбцов simd_convolve_column; полосы строк
+//  обоих проходов выполняются параллельно.
+
+#ifndef RESIZE_H
+#define RESIZE_H
+
+#include "image.h"
+#include <stdbool.h>
+
+// Ядро передискретизации
+typedef enum {
+    RESIZE_LANCZOS,            // Ланцош, a = 3 (по умолчанию)
+    RESIZE_BICUBIC             // Бикубическое ядро Кейса, a = -0.5
+} ResizeMethod;
+
+// Метод по имени ("lanczos", "bicubic"), false - неизвестное имя
+bool resize_method_parse(const char* name, ResizeMethod* method);
+
+// Имя метода для вывода
+const char* resize_method_name(ResizeMethod method);
+
+// Фильтр -resize: новое изображение width x height
+bool filter_resize(Image* image, uint32_t width, uint32_t height, ResizeMethod method);
+
+#endif
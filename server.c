@@ -0,0 +1,524 @@
+#include "server.h"
+#include "batch.h"
+#include "bonus_mosaic.h"
+#include "extra_filters.h"
+#include "frame_pool.h"
+#include "pipeline.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+// Общее состояние сервера
+
+typedef struct {
+    int listen_fd;             // Слушающий сокет
+    int stop_fd;               // Канал остановки: готов к чтению - сервер останавливается
+    atomic_ulong jobs;         // Принято заданий
+    atomic_ulong failed;       // Из них с ошибкой
+    FramePool** pools;         // Пулы кадров мест выполнения
+    bool* busy;                // Место занято заданием (под slot_mutex)
+    int slots;                 // Заданий одновременно
+    int connections;           // Открытых соединений (под slot_mutex)
+    pthread_mutex_t slot_mutex;
+    pthread_cond_t slot_cond;  // Освободилось место или закрылось соединение
+    pthread_mutex_t log_mutex;
+    FILE* log;                 // Журнал заданий (stdout до подавления)
+} ServerContext;
+
+typedef struct {
+    ServerContext* ctx;
+    int client;
+} ServerConnection;
+
+// Вспомогательные функции
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Отправка всего буфера; разрыв соединения клиентом не завершает процесс
+static bool send_all(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        data += sent;
+        size -= (size_t)sent;
+    }
+    return true;
+}
+
+// Разбиение строки задания на слова на месте
+//  Разделители - пробелы и табуляции, "..." - одно слово с пробелами
+//  Возвращает число слов, -1 - слов больше max, -2 - незакрытая кавычка
+static int split_words(char* line, char** words, int max) {
+    int count = 0;
+    char* read = line;
+
+    for (;;) {
+        while (*read == ' ' || *read == '\t') read++;
+        if (*read == '\0') break;
+        if (count >= max) return -1;
+
+        char* write = read;
+        words[count++] = write;
+        while (*read != '\0' && *read != ' ' && *read != '\t') {
+            if (*read == '"') {
+                read++;
+                while (*read != '\0' && *read != '"') *write++ = *read++;
+                if (*read != '"') return -2;
+                read++;
+            } else {
+                *write++ = *read++;
+            }
+        }
+        if (*read != '\0') read++;
+        *write = '\0';
+    }
+
+    return count;
+}
+
+// Места выполнения заданий
+//  Соединений может быть больше, чем мест: простаивающее соединение
+//  не занимает место, задание ждет свободного. Пул кадров принадлежит
+//  месту, поэтому буферы переходят от задания к заданию
+
+static int slot_acquire(ServerContext* ctx) {
+    pthread_mutex_lock(&ctx->slot_mutex);
+    for (;;) {
+        for (int i = 0; i < ctx->slots; i++) {
+            if (!ctx->busy[i]) {
+                ctx->busy[i] = true;
+                pthread_mutex_unlock(&ctx->slot_mutex);
+                return i;
+            }
+        }
+        pthread_cond_wait(&ctx->slot_cond, &ctx->slot_mutex);
+    }
+}
+
+static void slot_release(ServerContext* ctx, int slot) {
+    pthread_mutex_lock(&ctx->slot_mutex);
+    ctx->busy[slot] = false;
+    pthread_cond_broadcast(&ctx->slot_cond);
+    pthread_mutex_unlock(&ctx->slot_mutex);
+}
+
+// Создание слушающего сокета
+//  Файл сокета, оставшийся от завершенного процесса (соединение
+//  отклоняется), удаляется; работающий сервер не вытесняется
+
+static int server_listen(const char* path) {
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+
+    if (strlen(path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "Ошибка: путь сокета длиннее %zu символов: %s\n",
+                sizeof(address.sun_path) - 1, path);
+        return -1;
+    }
+    strcpy(address.sun_path, path);
+
+    struct stat st;
+    if (lstat(path, &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            fprintf(stderr, "Ошибка: '%s' существует и не является сокетом\n", path);
+            return -1;
+        }
+
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool alive = probe >= 0 &&
+                     connect(probe, (struct sockaddr*)&address, sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (alive) {
+            fprintf(stderr, "Ошибка: на сокете '%s' уже работает сервер\n", path);
+            return -1;
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        fprintf(stderr, "Ошибка создания сокета: %s\n", strerror(errno));
+        return -1;
+    }
+
+    if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        listen(fd, SERVER_BACKLOG) < 0) {
+        fprintf(stderr, "Ошибка открытия сокета '%s': %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+
+    // Клиент может закрыть соединение между poll и accept:
+    // прием не должен блокироваться
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        fprintf(stderr, "Ошибка настройки сокета: %s\n", strerror(errno));
+        close(fd);
+        unlink(path);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Выполнение одного задания, ответ - в response
+
+static void server_job(ServerContext* ctx, char* line, char* response, size_t size) {
+    double start = now_seconds();
+    unsigned long number = atomic_fetch_add(&ctx->jobs, 1) + 1;
+
+    char* words[SERVER_MAX_ARGS];
+    int count = split_words(line, words, SERVER_MAX_ARGS);
+    const char* error = NULL;
+
+    if (count == -1) {
+        error = "слишком много аргументов";
+    } else if (count == -2) {
+        error = "незакрытая кавычка";
+    } else if (count < 2) {
+        error = "ожидается: <входной_файл> <выходной_файл> [фильтры...]";
+    } else {
+        // Параметры процесса задаются при запуске сервера
+        for (int i = 2; i < count && !error; i++) {
+            if (strcmp(words[i], "-threads") == 0 || strcmp(words[i], "-jobs") == 0 ||
+                strcmp(words[i], "--profile") == 0) {
+                error = "-threads и -jobs задаются при запуске сервера, --profile не поддерживается";
+            }
+        }
+    }
+
+    if (error) {
+        snprintf(response, size, "ERROR %s\n", error);
+        atomic_fetch_add(&ctx->failed, 1);
+        pthread_mutex_lock(&ctx->log_mutex);
+        fprintf(ctx->log, "[%lu] ❌ %s\n", number, error);
+        fflush(ctx->log);
+        pthread_mutex_unlock(&ctx->log_mutex);
+        return;
+    }
+
+    const char* input = words[0];
+    const char* output = words[1];
+
+    FilterPipeline* pipeline = pipeline_create();
+    bool parsed = pipeline && pipeline_parse_options(pipeline, count, words, 2);
+    double parse_seconds = now_seconds() - start;
+
+    BatchStatus status = BATCH_FAILED_FILTER;
+    BatchTimings timings = {0.0, 0.0, 0.0};
+    if (parsed) {
+        int slot = slot_acquire(ctx);
+        FramePool* previous = frame_pool_bind(ctx->pools[slot]);
+        status = batch_process_file(pipeline, input, output, &timings);
+        frame_pool_bind(previous);
+        slot_release(ctx, slot);
+    }
+    if (pipeline) pipeline_destroy(pipeline);
+
+    double total = now_seconds() - start;
+
+    if (!parsed) {
+        // Подробности разбор выводит в stderr сервера
+        error = "некорректные параметры или фильтры";
+    } else if (status != BATCH_OK) {
+        error = batch_status_text(status);
+    }
+
+    if (error) {
+        snprintf(response, size, "ERROR %s\n", error);
+        atomic_fetch_add(&ctx->failed, 1);
+    } else {
+        snprintf(response, size,
+                 "OK total_ms=%.3f parse_ms=%.3f load_ms=%.3f filter_ms=%.3f save_ms=%.3f\n",
+                 total * 1e3, parse_seconds * 1e3, timings.load * 1e3,
+                 timings.filters * 1e3, timings.save * 1e3);
+    }
+
+    pthread_mutex_lock(&ctx->log_mutex);
+    if (error) {
+        fprintf(ctx->log, "[%lu] ❌ %s: %s\n", number, input, error);
+    } else {
+        fprintf(ctx->log, "[%lu] ✅ %s -> %s (%.1f мс)\n", number, input, output, total * 1e3);
+    }
+    fflush(ctx->log);
+    pthread_mutex_unlock(&ctx->log_mutex);
+}
+
+// Обслуживание соединения: задания по строкам до закрытия или остановки
+
+static void server_connection(ServerContext* ctx, int client) {
+    char* buffer = (char*)malloc(SERVER_MAX_LINE + 1);
+    if (!buffer) {
+        fprintf(stderr, "Ошибка выделения памяти для соединения\n");
+        return;
+    }
+
+    char response[512];
+    size_t used = 0;
+
+    for (;;) {
+        struct pollfd fds[2] = {{client, POLLIN, 0}, {ctx->stop_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        ssize_t received = read(client, buffer + used, SERVER_MAX_LINE - used);
+        if (received < 0 && errno == EINTR) continue;
+        if (received <= 0) break;
+        used += (size_t)received;
+
+        // Все полные строки буфера
+        size_t begin = 0;
+        bool open = true;
+        for (;;) {
+            char* newline = (char*)memchr(buffer + begin, '\n', used - begin);
+            if (!newline) break;
+
+            *newline = '\0';
+            char* line = buffer + begin;
+            size_t length = (size_t)(newline - line);
+            if (length > 0 && line[length - 1] == '\r') line[length - 1] = '\0';
+            begin = (size_t)(newline - buffer) + 1;
+
+            // Пустые строки пропускаются (удобно при ручном вводе)
+            if (line[strspn(line, " \t")] == '\0') continue;
+
+            server_job(ctx, line, response, sizeof(response));
+            if (!send_all(client, response, strlen(response))) {
+                open = false;
+                break;
+            }
+        }
+        if (!open) break;
+
+        memmove(buffer, buffer + begin, used - begin);
+        used -= begin;
+
+        if (used == SERVER_MAX_LINE) {
+            snprintf(response, sizeof(response),
+                     "ERROR строка задания длиннее %d байт\n", SERVER_MAX_LINE);
+            send_all(client, response, strlen(response));
+            break;
+        }
+    }
+
+    free(buffer);
+}
+
+static void* server_connection_thread(void* arg) {
+    ServerConnection* connection = (ServerConnection*)arg;
+    ServerContext* ctx = connection->ctx;
+
+    server_connection(ctx, connection->client);
+    close(connection->client);
+    free(connection);
+
+    pthread_mutex_lock(&ctx->slot_mutex);
+    ctx->connections--;
+    pthread_cond_broadcast(&ctx->slot_cond);
+    pthread_mutex_unlock(&ctx->slot_mutex);
+    return NULL;
+}
+
+// Прием соединений: на каждое - свой поток до его закрытия
+
+static void* server_acceptor(void* arg) {
+    ServerContext* ctx = (ServerContext*)arg;
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+
+    for (;;) {
+        struct pollfd fds[2] = {{ctx->listen_fd, POLLIN, 0}, {ctx->stop_fd, POLLIN, 0}};
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        if (fds[1].revents) break;
+
+        int client = accept(ctx->listen_fd, NULL, NULL);
+        if (client < 0) continue;
+
+        pthread_mutex_lock(&ctx->slot_mutex);
+        bool accepted = ctx->connections < SERVER_MAX_CONNECTIONS;
+        if (accepted) ctx->connections++;
+        pthread_mutex_unlock(&ctx->slot_mutex);
+
+        ServerConnection* connection = NULL;
+        pthread_t thread;
+        if (accepted) {
+            connection = (ServerConnection*)malloc(sizeof(ServerConnection));
+            if (connection) {
+                connection->ctx = ctx;
+                connection->client = client;
+            }
+            if (!connection ||
+                pthread_create(&thread, &attr, server_connection_thread, connection) != 0) {
+                free(connection);
+                pthread_mutex_lock(&ctx->slot_mutex);
+                ctx->connections--;
+                pthread_mutex_unlock(&ctx->slot_mutex);
+                accepted = false;
+            }
+        }
+
+        if (!accepted) {
+            static const char busy[] = "ERROR слишком много соединений\n";
+            send_all(client, busy, sizeof(busy) - 1);
+            close(client);
+        }
+    }
+
+    pthread_attr_destroy(&attr);
+    return NULL;
+}
+
+// Запуск сервера
+
+int server_run(const char* socket_path, int slots) {
+    if (!socket_path || socket_path[0] == '\0') {
+        fprintf(stderr, "Ошибка: не указан путь сокета\n");
+        return 1;
+    }
+    if (slots < 1) slots = 1;
+
+    ServerContext ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.slots = slots;
+    ctx.pools = (FramePool**)calloc((size_t)slots, sizeof(FramePool*));
+    ctx.busy = (bool*)calloc((size_t)slots, sizeof(bool));
+    if (!ctx.pools || !ctx.busy) {
+        fprintf(stderr, "Ошибка выделения памяти для сервера\n");
+        free(ctx.pools);
+        free(ctx.busy);
+        return 1;
+    }
+    for (int i = 0; i < slots; i++) {
+        ctx.pools[i] = frame_pool_create(FRAME_POOL_FRAMES);
+    }
+
+    int stop_pipe[2] = {-1, -1};
+    ctx.listen_fd = server_listen(socket_path);
+    if (ctx.listen_fd >= 0 && pipe(stop_pipe) < 0) {
+        fprintf(stderr, "Ошибка создания канала остановки: %s\n", strerror(errno));
+        close(ctx.listen_fd);
+        unlink(socket_path);
+        ctx.listen_fd = -1;
+    }
+    if (ctx.listen_fd < 0) {
+        for (int i = 0; i < slots; i++) frame_pool_destroy(ctx.pools[i]);
+        free(ctx.pools);
+        free(ctx.busy);
+        return 1;
+    }
+    ctx.stop_fd = stop_pipe[0];
+    atomic_init(&ctx.jobs, 0);
+    atomic_init(&ctx.failed, 0);
+    pthread_mutex_init(&ctx.slot_mutex, NULL);
+    pthread_cond_init(&ctx.slot_cond, NULL);
+    pthread_mutex_init(&ctx.log_mutex, NULL);
+
+    // Сигналы остановки принимает только sigwait: маска наследуется
+    // потоками соединений и пула, созданными после этой точки
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    printf("\n🛰️  Сервер запущен: %s (заданий одновременно: %d)\n", socket_path, slots);
+    printf("   Задание - строка: <входной_файл> <выходной_файл> [фильтры...]\n");
+
+    // Журналы фильтров разных заданий перемешались бы: stdout подавляется,
+    // строка о каждом задании пишется в исходный поток
+    int saved_stdout = stdout_suppress();
+    FILE* log = NULL;
+    if (saved_stdout >= 0) {
+        int log_fd = dup(saved_stdout);
+        log = log_fd >= 0 ? fdopen(log_fd, "w") : NULL;
+        if (!log && log_fd >= 0) close(log_fd);
+    }
+    ctx.log = log ? log : stderr;
+
+    tile_set_sharing_begin();
+    glass_map_sharing_begin();
+
+    int result = 0;
+    pthread_t acceptor;
+    bool started = pthread_create(&acceptor, NULL, server_acceptor, &ctx) == 0;
+    if (!started) {
+        fprintf(stderr, "Ошибка запуска потока сервера\n");
+        result = 1;
+    } else {
+        int signal_number = 0;
+        while (sigwait(&signals, &signal_number) != 0) {
+        }
+        fprintf(ctx.log, "🛑 Остановка сервера (%s)\n",
+                signal_number == SIGINT ? "SIGINT" : "SIGTERM");
+        fflush(ctx.log);
+    }
+
+    // Канал остается готовым к чтению: его видят прием и все соединения,
+    // текущие задания завершаются
+    if (write(stop_pipe[1], "", 1) < 0) {
+        fprintf(stderr, "Ошибка остановки сервера: %s\n", strerror(errno));
+    }
+    if (started) {
+        pthread_join(acceptor, NULL);
+    }
+    pthread_mutex_lock(&ctx.slot_mutex);
+    while (ctx.connections > 0) {
+        pthread_cond_wait(&ctx.slot_cond, &ctx.slot_mutex);
+    }
+    pthread_mutex_unlock(&ctx.slot_mutex);
+
+    tile_set_sharing_end();
+    glass_map_sharing_end();
+
+    close(ctx.listen_fd);
+    unlink(socket_path);
+    close(stop_pipe[0]);
+    close(stop_pipe[1]);
+
+    if (log) fclose(log);
+    stdout_restore(saved_stdout);
+    pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+
+    for (int i = 0; i < slots; i++) {
+        frame_pool_destroy(ctx.pools[i]);
+    }
+    free(ctx.pools);
+    free(ctx.busy);
+    pthread_cond_destroy(&ctx.slot_cond);
+    pthread_mutex_destroy(&ctx.slot_mutex);
+    pthread_mutex_destroy(&ctx.log_mutex);
+
+    printf("\n📋 Сервер остановлен: заданий %lu, с ошибкой %lu\n",
+           atomic_load(&ctx.jobs), atomic_load(&ctx.failed));
+
+    return result;
+}
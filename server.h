@@ -0,0 +1,30 @@
+// Режим сервера (--serve)
+//  Процесс остается запущенным и принимает задания через локальный
+//  Unix-сокет: потоки, пулы кадров и наборы плиток мозаики переходят от
+//  задания к заданию, задание не платит за запуск процесса и разогрев.
+//  Задание - одна строка в синтаксисе командной строки:
+//   <входной_файл> <выходной_файл> [-u8] [-stream] [-seed N] [фильтры...]
+//  Аргументы с пробелами берутся в двойные кавычки. Ответ - одна строка:
+//   OK total_ms=... parse_ms=... load_ms=... filter_ms=... save_ms=...
+//   ERROR <описание>
+//  В одном соединении задания выполняются по очереди, ответы приходят
+//  в том же порядке. Соединения обслуживаются своими потоками и могут
+//  простаивать; одновременно выполняется не больше slots заданий (-jobs N),
+//  у каждого места выполнения свой пул кадров.
+//  Наборы плиток загружаются один раз на (файл, размер) и не
+//  перечитываются до остановки сервера. SIGINT и SIGTERM завершают
+//  сервер после текущих заданий и удаляют файл сокета.
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SERVER_MAX_LINE 65536       // Наибольшая длина строки задания, байт
+#define SERVER_MAX_ARGS 256         // Наибольшее число слов в задании
+#define SERVER_BACKLOG 64           // Очередь ожидающих соединений
+#define SERVER_MAX_CONNECTIONS 1024 // Наибольшее число открытых соединений
+
+// Запуск сервера на сокете socket_path, slots заданий одновременно
+// Возвращает 0 после остановки по сигналу, 1 при ошибке запуска
+int server_run(const char* socket_path, int slots);
+
+#endif
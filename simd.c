@@ -0,0 +1,873 @@
+#include "simd.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_X86 1
+#else
+#define SIMD_X86 0
+#endif
+
+// Коэффициенты яркости (как в filter_grayscale)
+#define GRAY_R 0.299f
+#define GRAY_G 0.587f
+#define GRAY_B 0.114f
+
+// Определение уровня
+
+static SimdLevel detected_level = SIMD_SCALAR;
+static pthread_once_t detect_once = PTHREAD_ONCE_INIT;
+
+static void detect_level(void) {
+    SimdLevel level = SIMD_SCALAR;
+
+#if SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.1")) level = SIMD_SSE41;
+    if (__builtin_cpu_supports("avx2")) level = SIMD_AVX2;
+#endif
+
+    // Понижение уровня для сравнения реализаций
+    const char* forced = getenv("IMAGECRAFT_SIMD");
+    if (forced) {
+        SimdLevel limit = level;
+        if (strcmp(forced, "scalar") == 0) limit = SIMD_SCALAR;
+        else if (strcmp(forced, "sse4") == 0) limit = SIMD_SSE41;
+        else if (strcmp(forced, "avx2") == 0) limit = SIMD_AVX2;
+        else fprintf(stderr, "Предупреждение: неизвестное значение IMAGECRAFT_SIMD=%s\n", forced);
+
+        if (limit < level) level = limit;
+    }
+
+    detected_level = level;
+}
+
+SimdLevel simd_level(void) {
+    pthread_once(&detect_once, detect_level);
+    return detected_level;
+}
+
+const char* simd_level_name(SimdLevel level) {
+    switch (level) {
+        case SIMD_AVX2:  return "AVX2";
+        case SIMD_SSE41: return "SSE4.1";
+        default:         return "scalar";
+    }
+}
+
+// Скалярные реализации
+
+static void negative_scalar(float* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        data[i] = 1.0f - data[i];
+    }
+}
+
+static void clamp_scalar(float* data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        if (data[i] < 0.0f) data[i] = 0.0f;
+        if (data[i] > 1.0f) data[i] = 1.0f;
+    }
+}
+
+static void grayscale_interleaved_scalar(float* rgb, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        float* p = rgb + i * 3;
+        float luminance = p[0] * GRAY_R + p[1] * GRAY_G + p[2] * GRAY_B;
+        p[0] = p[1] = p[2] = luminance;
+    }
+}
+
+static void grayscale_planar_scalar(float* r, float* g, float* b, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float luminance = r[i] * GRAY_R + g[i] * GRAY_G + b[i] * GRAY_B;
+        r[i] = g[i] = b[i] = luminance;
+    }
+}
+
+static void convolve3x3_scalar(const float* const rows[3], float* out,
+                               size_t begin, size_t count, const float kernel[9]) {
+    for (size_t x = begin; x < count; x++) {
+        float sum = 0.0f;
+        for (int ky = 0; ky < 3; ky++) {
+            const float* row = rows[ky] + x - 1;
+            for (int kx = 0; kx < 3; kx++) {
+                sum += row[kx] * kernel[ky * 3 + kx];
+            }
+        }
+        out[x] = sum;
+    }
+}
+
+static void convolve_row_scalar(const float* row, float* out, size_t begin, size_t count,
+                                const float* taps, int ntaps) {
+    for (size_t x = begin; x < count; x++) {
+        float sum = out[x];
+        for (int t = 0; t < ntaps; t++) {
+            sum += row[x + t] * taps[t];
+        }
+        out[x] = sum;
+    }
+}
+
+static void convolve_column_scalar(const float* const* rows, float* out, size_t begin,
+                                   size_t count, const float* taps, int ntaps) {
+    for (size_t x = begin; x < count; x++) {
+        float sum = out[x];
+        for (int t = 0; t < ntaps; t++) {
+            sum += rows[t][x] * taps[t];
+        }
+        out[x] = sum;
+    }
+}
+
+static void bilinear_rgb_scalar(const float* rgb, uint32_t width, uint32_t height,
+                                const float* xs, const float* ys, float* out,
+                                size_t begin, size_t count) {
+    float max_x = (float)(width - 1);
+    float max_y = (float)(height - 1);
+    size_t stride = (size_t)width * 3;
+
+    for (size_t i = begin; i < count; i++) {
+        float x = xs[i], y = ys[i];
+        if (x < 0.0f) x = 0.0f;
+        if (y < 0.0f) y = 0.0f;
+        if (x >= max_x) x = max_x;
+        if (y >= max_y) y = max_y;
+
+        // Координаты неотрицательны: отбрасывание дробной части = floorf
+        uint32_t x0 = (uint32_t)x, y0 = (uint32_t)y;
+        float dx = x - (float)x0;
+        float dy = y - (float)y0;
+
+        // На последнем столбце (строке) вес соседа 0: берется сам пиксель
+        const float* p00 = rgb + y0 * stride + (size_t)x0 * 3;
+        const float* p10 = p00 + (x0 + 1 < width ? 3 : 0);
+        const float* p01 = p00 + (y0 + 1 < height ? stride : 0);
+        const float* p11 = p01 + (x0 + 1 < width ? 3 : 0);
+
+        for (int c = 0; c < 3; c++) {
+            float c0 = p00[c] + dx * (p10[c] - p00[c]);
+            float c1 = p01[c] + dx * (p11[c] - p01[c]);
+            out[i * 3 + c] = c0 + dy * (c1 - c0);
+        }
+    }
+}
+
+static void resample_row_rgb_scalar(const float* rgb, float* out, size_t begin, size_t count,
+                                    const int32_t* starts, const float* weights, int ntaps) {
+    for (size_t i = begin; i < count; i++) {
+        const float* p = rgb + (size_t)starts[i] * 3;
+        float r = 0.0f, g = 0.0f, b = 0.0f;
+        for (int t = 0; t < ntaps; t++) {
+            float w = weights[(size_t)t * count + i];
+            r += p[t * 3 + 0] * w;
+            g += p[t * 3 + 1] * w;
+            b += p[t * 3 + 2] * w;
+        }
+        out[i * 3 + 0] = r;
+        out[i * 3 + 1] = g;
+        out[i * 3 + 2] = b;
+    }
+}
+
+static void bgr_to_rgbf_scalar(const uint8_t* bgr, float* rgb, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        rgb[i * 3 + 0] = (float)bgr[i * 3 + 2] / 255.0f;
+        rgb[i * 3 + 1] = (float)bgr[i * 3 + 1] / 255.0f;
+        rgb[i * 3 + 2] = (float)bgr[i * 3 + 0] / 255.0f;
+    }
+}
+
+// Как color_to_bmpixel: ограничение, умножение и отбрасывание дробной части
+static inline uint8_t channel_to_byte(float v) {
+    if (v < 0.0f) v = 0.0f;
+    if (v > 1.0f) v = 1.0f;
+    return (uint8_t)(v * 255.0f);
+}
+
+static void rgbf_to_bgr_scalar(const float* rgb, uint8_t* bgr, size_t pixels) {
+    for (size_t i = 0; i < pixels; i++) {
+        bgr[i * 3 + 0] = channel_to_byte(rgb[i * 3 + 2]);
+        bgr[i * 3 + 1] = channel_to_byte(rgb[i * 3 + 1]);
+        bgr[i * 3 + 2] = channel_to_byte(rgb[i * 3 + 0]);
+    }
+}
+
+#if SIMD_X86
+
+// SSE4.1
+
+__attribute__((target("sse4.1")))
+static void negative_sse41(float* data, size_t count) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(data + i, _mm_sub_ps(one, _mm_loadu_ps(data + i)));
+    }
+    negative_scalar(data + i, count - i);
+}
+
+// max(0, x), затем min(1, x): при равенстве и NaN возвращается x,
+// как в скалярном варианте
+__attribute__((target("sse4.1")))
+static void clamp_sse41(float* data, size_t count) {
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 v = _mm_loadu_ps(data + i);
+        v = _mm_max_ps(zero, v);
+        v = _mm_min_ps(one, v);
+        _mm_storeu_ps(data + i, v);
+    }
+    clamp_scalar(data + i, count - i);
+}
+
+// 4 пикселя: [r0 g0 b0 r1] [g1 b1 r2 g2] [b2 r3 g3 b3]
+__attribute__((target("sse4.1")))
+static void grayscale_interleaved_sse41(float* rgb, size_t pixels) {
+    const __m128 kr = _mm_set1_ps(GRAY_R);
+    const __m128 kg = _mm_set1_ps(GRAY_G);
+    const __m128 kb = _mm_set1_ps(GRAY_B);
+    size_t i = 0;
+
+    for (; i + 4 <= pixels; i += 4) {
+        float* p = rgb + i * 3;
+        __m128 a0 = _mm_loadu_ps(p);
+        __m128 a1 = _mm_loadu_ps(p + 4);
+        __m128 a2 = _mm_loadu_ps(p + 8);
+
+        // Разделение каналов
+        __m128 t = _mm_blend_ps(a1, a2, 0x2);                       // g1 r3 r2 g2
+        __m128 r = _mm_shuffle_ps(a0, t, _MM_SHUFFLE(1, 2, 3, 0));  // r0 r1 r2 r3
+        __m128 g0 = _mm_blend_ps(a0, a1, 0x1);                      // g1 g0 b0 r1
+        __m128 g1 = _mm_blend_ps(a1, a2, 0x4);                      // g1 b1 g3 g2
+        __m128 g = _mm_shuffle_ps(g0, g1, _MM_SHUFFLE(2, 3, 0, 1)); // g0 g1 g2 g3
+        __m128 b0 = _mm_blend_ps(a0, a1, 0x2);                      // r0 b1 b0 r1
+        __m128 b = _mm_shuffle_ps(b0, a2, _MM_SHUFFLE(3, 0, 1, 2)); // b0 b1 b2 b3
+
+        __m128 lum = _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, kr), _mm_mul_ps(g, kg)),
+                                _mm_mul_ps(b, kb));
+
+        // Обратная упаковка: l0 l0 l0 l1 | l1 l1 l2 l2 | l2 l3 l3 l3
+        _mm_storeu_ps(p, _mm_shuffle_ps(lum, lum, _MM_SHUFFLE(1, 0, 0, 0)));
+        _mm_storeu_ps(p + 4, _mm_shuffle_ps(lum, lum, _MM_SHUFFLE(2, 2, 1, 1)));
+        _mm_storeu_ps(p + 8, _mm_shuffle_ps(lum, lum, _MM_SHUFFLE(3, 3, 3, 2)));
+    }
+
+    grayscale_interleaved_scalar(rgb + i * 3, pixels - i);
+}
+
+__attribute__((target("sse4.1")))
+static void grayscale_planar_sse41(float* r, float* g, float* b, size_t count) {
+    const __m128 kr = _mm_set1_ps(GRAY_R);
+    const __m128 kg = _mm_set1_ps(GRAY_G);
+    const __m128 kb = _mm_set1_ps(GRAY_B);
+    size_t i = 0;
+
+    for (; i + 4 <= count; i += 4) {
+        __m128 lum = _mm_add_ps(
+            _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(r + i), kr),
+                       _mm_mul_ps(_mm_loadu_ps(g + i), kg)),
+            _mm_mul_ps(_mm_loadu_ps(b + i), kb));
+        _mm_storeu_ps(r + i, lum);
+        _mm_storeu_ps(g + i, lum);
+        _mm_storeu_ps(b + i, lum);
+    }
+
+    grayscale_planar_scalar(r + i, g + i, b + i, count - i);
+}
+
+__attribute__((target("sse4.1")))
+static void convolve3x3_sse41(const float* const rows[3], float* out, size_t count,
+                              const float kernel[9]) {
+    __m128 k[9];
+    for (int i = 0; i < 9; i++) k[i] = _mm_set1_ps(kernel[i]);
+
+    size_t x = 0;
+    for (; x + 4 <= count; x += 4) {
+        __m128 sum = _mm_setzero_ps();
+        for (int ky = 0; ky < 3; ky++) {
+            const float* row = rows[ky] + x - 1;
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row), k[ky * 3]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + 1), k[ky * 3 + 1]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(row + 2), k[ky * 3 + 2]));
+        }
+        _mm_storeu_ps(out + x, sum);
+    }
+
+    convolve3x3_scalar(rows, out, x, count, kernel);
+}
+
+// Четыре независимые суммы на итерацию скрывают задержку сложения
+__attribute__((target("sse4.1")))
+static void convolve_row_sse41(const float* row, float* out, size_t count,
+                               const float* taps, int ntaps) {
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128 s0 = _mm_loadu_ps(out + x);
+        __m128 s1 = _mm_loadu_ps(out + x + 4);
+        __m128 s2 = _mm_loadu_ps(out + x + 8);
+        __m128 s3 = _mm_loadu_ps(out + x + 12);
+        for (int t = 0; t < ntaps; t++) {
+            const float* p = row + x + t;
+            __m128 w = _mm_set1_ps(taps[t]);
+            s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(p), w));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(p + 4), w));
+            s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(p + 8), w));
+            s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(p + 12), w));
+        }
+        _mm_storeu_ps(out + x, s0);
+        _mm_storeu_ps(out + x + 4, s1);
+        _mm_storeu_ps(out + x + 8, s2);
+        _mm_storeu_ps(out + x + 12, s3);
+    }
+    for (; x + 4 <= count; x += 4) {
+        __m128 s0 = _mm_loadu_ps(out + x);
+        for (int t = 0; t < ntaps; t++) {
+            s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(row + x + t), _mm_set1_ps(taps[t])));
+        }
+        _mm_storeu_ps(out + x, s0);
+    }
+
+    convolve_row_scalar(row, out, x, count, taps, ntaps);
+}
+
+__attribute__((target("sse4.1")))
+static void convolve_column_sse41(const float* const* rows, float* out, size_t count,
+                                  const float* taps, int ntaps) {
+    size_t x = 0;
+    for (; x + 16 <= count; x += 16) {
+        __m128 s0 = _mm_loadu_ps(out + x);
+        __m128 s1 = _mm_loadu_ps(out + x + 4);
+        __m128 s2 = _mm_loadu_ps(out + x + 8);
+        __m128 s3 = _mm_loadu_ps(out + x + 12);
+        for (int t = 0; t < ntaps; t++) {
+            const float* p = rows[t] + x;
+            __m128 w = _mm_set1_ps(taps[t]);
+            s0 = _mm_add_ps(s0, _mm_mul_ps(_mm_loadu_ps(p), w));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(_mm_loadu_ps(p + 4), w));
+            s2 = _mm_add_ps(s2, _mm_mul_ps(_mm_loadu_ps(p + 8), w));
+            s3 = _mm_add_ps(s3, _mm_mul_ps(_mm_loadu_ps(p + 12), w));
+        }
+        _mm_storeu_ps(out + x, s0);
+        _mm_storeu_ps(out + x + 4, s1);
+        _mm_storeu_ps(out + x + 8, s2);
+        _mm_storeu_ps(out + x + 12, s3);
+    }
+
+    convolve_column_scalar(rows, out, x, count, taps, ntaps);
+}
+
+// Перестановка BGR -> RGB внутри 4 пикселей (12 байт), байты 12..15 обнуляются
+//  Перестановка симметрична, поэтому годится и для RGB -> BGR
+#define SWAP_BGR_4PX 2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, -1, -1, -1, -1
+
+// Загрузка 16 байт на 4 пикселя: в конце строки нужен запас в 4 байта
+__attribute__((target("sse4.1")))
+static void bgr_to_rgbf_sse41(const uint8_t* bgr, float* rgb, size_t pixels) {
+    const __m128i swap = _mm_setr_epi8(SWAP_BGR_4PX);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 6 <= pixels; i += 4) {
+        __m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(bgr + i * 3)), swap);
+        float* out = rgb + i * 3;
+        _mm_storeu_ps(out, _mm_div_ps(_mm_cvtepi32_ps(_mm_cvtepu8_epi32(v)), scale));
+        _mm_storeu_ps(out + 4, _mm_div_ps(
+            _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 4))), scale));
+        _mm_storeu_ps(out + 8, _mm_div_ps(
+            _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(v, 8))), scale));
+    }
+    bgr_to_rgbf_scalar(bgr + i * 3, rgb + i * 3, pixels - i);
+}
+
+// Ограничение как в clamp_sse41 (NaN дает 0, как при скалярном приведении)
+__attribute__((target("sse4.1")))
+static void rgbf_to_bgr_sse41(const float* rgb, uint8_t* bgr, size_t pixels) {
+    const __m128i swap = _mm_setr_epi8(SWAP_BGR_4PX);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 scale = _mm_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 4 <= pixels; i += 4) {
+        const float* in = rgb + i * 3;
+        __m128i a = _mm_cvttps_epi32(_mm_mul_ps(
+            _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(in))), scale));
+        __m128i b = _mm_cvttps_epi32(_mm_mul_ps(
+            _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(in + 4))), scale));
+        __m128i c = _mm_cvttps_epi32(_mm_mul_ps(
+            _mm_min_ps(one, _mm_max_ps(zero, _mm_loadu_ps(in + 8))), scale));
+        __m128i v = _mm_packus_epi16(_mm_packus_epi32(a, b), _mm_packus_epi32(c, c));
+        v = _mm_shuffle_epi8(v, swap);
+
+        uint8_t* out = bgr + i * 3;
+        uint32_t tail = (uint32_t)_mm_extract_epi32(v, 2);
+        _mm_storel_epi64((__m128i*)out, v);
+        memcpy(out + 8, &tail, sizeof(tail));
+    }
+    rgbf_to_bgr_scalar(rgb + i * 3, bgr + i * 3, pixels - i);
+}
+
+// AVX2
+//  Хвост массива обрабатывается скалярной (или SSE) функцией. Перед ней
+//  верхние половины регистров обнуляются явно: GCC не вставляет vzeroupper
+//  перед хвостовым вызовом, а код без VEX (SSE, libm) при "грязных"
+//  регистрах ymm работает в разы медленнее до следующего vzeroupper
+
+__attribute__((target("avx2")))
+static void negative_avx2(float* data, size_t count) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(data + i, _mm256_sub_ps(one, _mm256_loadu_ps(data + i)));
+    }
+    _mm256_zeroupper();
+    negative_scalar(data + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void clamp_avx2(float* data, size_t count) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 v = _mm256_loadu_ps(data + i);
+        v = _mm256_max_ps(zero, v);
+        v = _mm256_min_ps(one, v);
+        _mm256_storeu_ps(data + i, v);
+    }
+    _mm256_zeroupper();
+    clamp_scalar(data + i, count - i);
+}
+
+// 8 пикселей = 24 float в трех регистрах a0, a1, a2
+//  R: a0[0,3,6] a1[1,4,7] a2[2,5]
+//  G: a0[1,4,7] a1[2,5]   a2[0,3,6]
+//  B: a0[2,5]   a1[0,3,6] a2[1,4,7]
+__attribute__((target("avx2")))
+static void grayscale_interleaved_avx2(float* rgb, size_t pixels) {
+    const __m256 kr = _mm256_set1_ps(GRAY_R);
+    const __m256 kg = _mm256_set1_ps(GRAY_G);
+    const __m256 kb = _mm256_set1_ps(GRAY_B);
+
+    const __m256i r0 = _mm256_setr_epi32(0, 3, 6, 0, 0, 0, 0, 0);
+    const __m256i r1 = _mm256_setr_epi32(0, 0, 0, 1, 4, 7, 0, 0);
+    const __m256i r2 = _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 2, 5);
+    const __m256i g0 = _mm256_setr_epi32(1, 4, 7, 0, 0, 0, 0, 0);
+    const __m256i g1 = _mm256_setr_epi32(0, 0, 0, 2, 5, 0, 0, 0);
+    const __m256i g2 = _mm256_setr_epi32(0, 0, 0, 0, 0, 0, 3, 6);
+    const __m256i b0 = _mm256_setr_epi32(2, 5, 0, 0, 0, 0, 0, 0);
+    const __m256i b1 = _mm256_setr_epi32(0, 0, 0, 3, 6, 0, 0, 0);
+    const __m256i b2 = _mm256_setr_epi32(0, 0, 0, 0, 0, 1, 4, 7);
+
+    const __m256i o0 = _mm256_setr_epi32(0, 0, 0, 1, 1, 1, 2, 2);
+    const __m256i o1 = _mm256_setr_epi32(2, 3, 3, 3, 4, 4, 4, 5);
+    const __m256i o2 = _mm256_setr_epi32(5, 5, 6, 6, 6, 7, 7, 7);
+
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        float* p = rgb + i * 3;
+        __m256 a0 = _mm256_loadu_ps(p);
+        __m256 a1 = _mm256_loadu_ps(p + 8);
+        __m256 a2 = _mm256_loadu_ps(p + 16);
+
+        __m256 r = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a0, r0),
+                            _mm256_permutevar8x32_ps(a1, r1), 0x38),
+            _mm256_permutevar8x32_ps(a2, r2), 0xC0);
+        __m256 g = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a0, g0),
+                            _mm256_permutevar8x32_ps(a1, g1), 0x18),
+            _mm256_permutevar8x32_ps(a2, g2), 0xE0);
+        __m256 b = _mm256_blend_ps(
+            _mm256_blend_ps(_mm256_permutevar8x32_ps(a0, b0),
+                            _mm256_permutevar8x32_ps(a1, b1), 0x1C),
+            _mm256_permutevar8x32_ps(a2, b2), 0xE0);
+
+        __m256 lum = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(r, kr), _mm256_mul_ps(g, kg)),
+            _mm256_mul_ps(b, kb));
+
+        _mm256_storeu_ps(p, _mm256_permutevar8x32_ps(lum, o0));
+        _mm256_storeu_ps(p + 8, _mm256_permutevar8x32_ps(lum, o1));
+        _mm256_storeu_ps(p + 16, _mm256_permutevar8x32_ps(lum, o2));
+    }
+
+    _mm256_zeroupper();
+    grayscale_interleaved_sse41(rgb + i * 3, pixels - i);
+}
+
+__attribute__((target("avx2")))
+static void grayscale_planar_avx2(float* r, float* g, float* b, size_t count) {
+    const __m256 kr = _mm256_set1_ps(GRAY_R);
+    const __m256 kg = _mm256_set1_ps(GRAY_G);
+    const __m256 kb = _mm256_set1_ps(GRAY_B);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 lum = _mm256_add_ps(
+            _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(r + i), kr),
+                          _mm256_mul_ps(_mm256_loadu_ps(g + i), kg)),
+            _mm256_mul_ps(_mm256_loadu_ps(b + i), kb));
+        _mm256_storeu_ps(r + i, lum);
+        _mm256_storeu_ps(g + i, lum);
+        _mm256_storeu_ps(b + i, lum);
+    }
+
+    _mm256_zeroupper();
+    grayscale_planar_scalar(r + i, g + i, b + i, count - i);
+}
+
+__attribute__((target("avx2")))
+static void convolve3x3_avx2(const float* const rows[3], float* out, size_t count,
+                             const float kernel[9]) {
+    __m256 k[9];
+    for (int i = 0; i < 9; i++) k[i] = _mm256_set1_ps(kernel[i]);
+
+    size_t x = 0;
+    for (; x + 8 <= count; x += 8) {
+        __m256 sum = _mm256_setzero_ps();
+        for (int ky = 0; ky < 3; ky++) {
+            const float* row = rows[ky] + x - 1;
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(row), k[ky * 3]));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(row + 1), k[ky * 3 + 1]));
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_loadu_ps(row + 2), k[ky * 3 + 2]));
+        }
+        _mm256_storeu_ps(out + x, sum);
+    }
+
+    _mm256_zeroupper();
+    convolve3x3_scalar(rows, out, x, count, kernel);
+}
+
+__attribute__((target("avx2")))
+static void convolve_row_avx2(const float* row, float* out, size_t count,
+                              const float* taps, int ntaps) {
+    size_t x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m256 s0 = _mm256_loadu_ps(out + x);
+        __m256 s1 = _mm256_loadu_ps(out + x + 8);
+        __m256 s2 = _mm256_loadu_ps(out + x + 16);
+        __m256 s3 = _mm256_loadu_ps(out + x + 24);
+        for (int t = 0; t < ntaps; t++) {
+            const float* p = row + x + t;
+            __m256 w = _mm256_set1_ps(taps[t]);
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(p), w));
+            s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(p + 8), w));
+            s2 = _mm256_add_ps(s2, _mm256_mul_ps(_mm256_loadu_ps(p + 16), w));
+            s3 = _mm256_add_ps(s3, _mm256_mul_ps(_mm256_loadu_ps(p + 24), w));
+        }
+        _mm256_storeu_ps(out + x, s0);
+        _mm256_storeu_ps(out + x + 8, s1);
+        _mm256_storeu_ps(out + x + 16, s2);
+        _mm256_storeu_ps(out + x + 24, s3);
+    }
+    for (; x + 8 <= count; x += 8) {
+        __m256 s0 = _mm256_loadu_ps(out + x);
+        for (int t = 0; t < ntaps; t++) {
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(row + x + t),
+                                                 _mm256_set1_ps(taps[t])));
+        }
+        _mm256_storeu_ps(out + x, s0);
+    }
+
+    _mm256_zeroupper();
+    convolve_row_scalar(row, out, x, count, taps, ntaps);
+}
+
+__attribute__((target("avx2")))
+static void convolve_column_avx2(const float* const* rows, float* out, size_t count,
+                                 const float* taps, int ntaps) {
+    size_t x = 0;
+    for (; x + 32 <= count; x += 32) {
+        __m256 s0 = _mm256_loadu_ps(out + x);
+        __m256 s1 = _mm256_loadu_ps(out + x + 8);
+        __m256 s2 = _mm256_loadu_ps(out + x + 16);
+        __m256 s3 = _mm256_loadu_ps(out + x + 24);
+        for (int t = 0; t < ntaps; t++) {
+            const float* p = rows[t] + x;
+            __m256 w = _mm256_set1_ps(taps[t]);
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(p), w));
+            s1 = _mm256_add_ps(s1, _mm256_mul_ps(_mm256_loadu_ps(p + 8), w));
+            s2 = _mm256_add_ps(s2, _mm256_mul_ps(_mm256_loadu_ps(p + 16), w));
+            s3 = _mm256_add_ps(s3, _mm256_mul_ps(_mm256_loadu_ps(p + 24), w));
+        }
+        _mm256_storeu_ps(out + x, s0);
+        _mm256_storeu_ps(out + x + 8, s1);
+        _mm256_storeu_ps(out + x + 16, s2);
+        _mm256_storeu_ps(out + x + 24, s3);
+    }
+    for (; x + 8 <= count; x += 8) {
+        __m256 s0 = _mm256_loadu_ps(out + x);
+        for (int t = 0; t < ntaps; t++) {
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(_mm256_loadu_ps(rows[t] + x),
+                                                 _mm256_set1_ps(taps[t])));
+        }
+        _mm256_storeu_ps(out + x, s0);
+    }
+
+    _mm256_zeroupper();
+    convolve_column_scalar(rows, out, x, count, taps, ntaps);
+}
+
+// 8 точек за шаг: индексы четырех соседей, по три сбора на канал
+//  Индексы 32-битные: изображения больше 2^31 float идут скалярно
+__attribute__((target("avx2")))
+static void bilinear_rgb_avx2(const float* rgb, uint32_t width, uint32_t height,
+                              const float* xs, const float* ys, float* out, size_t count) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 max_x = _mm256_set1_ps((float)(width - 1));
+    const __m256 max_y = _mm256_set1_ps((float)(height - 1));
+    const __m256i last_x = _mm256_set1_epi32((int)width - 1);
+    const __m256i last_y = _mm256_set1_epi32((int)height - 1);
+    const __m256i one = _mm256_set1_epi32(1);
+    const __m256i three = _mm256_set1_epi32(3);
+    const __m256i stride = _mm256_set1_epi32((int)width * 3);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256 x = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(xs + i), zero), max_x);
+        __m256 y = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(ys + i), zero), max_y);
+        __m256i x0 = _mm256_cvttps_epi32(x);
+        __m256i y0 = _mm256_cvttps_epi32(y);
+        __m256 dx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(x0));
+        __m256 dy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(y0));
+
+        // Шаг к соседу: 0 на последнем столбце (строке)
+        __m256i step_x = _mm256_mullo_epi32(
+            _mm256_sub_epi32(_mm256_min_epi32(_mm256_add_epi32(x0, one), last_x), x0), three);
+        __m256i step_y = _mm256_mullo_epi32(
+            _mm256_sub_epi32(_mm256_min_epi32(_mm256_add_epi32(y0, one), last_y), y0), stride);
+
+        __m256i i00 = _mm256_add_epi32(_mm256_mullo_epi32(y0, stride),
+                                       _mm256_mullo_epi32(x0, three));
+        __m256i i10 = _mm256_add_epi32(i00, step_x);
+        __m256i i01 = _mm256_add_epi32(i00, step_y);
+        __m256i i11 = _mm256_add_epi32(i01, step_x);
+
+        float channels[3][8];
+        for (int c = 0; c < 3; c++) {
+            const float* base = rgb + c;
+            __m256 p00 = _mm256_i32gather_ps(base, i00, 4);
+            __m256 p10 = _mm256_i32gather_ps(base, i10, 4);
+            __m256 p01 = _mm256_i32gather_ps(base, i01, 4);
+            __m256 p11 = _mm256_i32gather_ps(base, i11, 4);
+            __m256 c0 = _mm256_add_ps(p00, _mm256_mul_ps(dx, _mm256_sub_ps(p10, p00)));
+            __m256 c1 = _mm256_add_ps(p01, _mm256_mul_ps(dx, _mm256_sub_ps(p11, p01)));
+            _mm256_storeu_ps(channels[c],
+                             _mm256_add_ps(c0, _mm256_mul_ps(dy, _mm256_sub_ps(c1, c0))));
+        }
+
+        float* dst = out + i * 3;
+        for (int k = 0; k < 8; k++) {
+            dst[k * 3 + 0] = channels[0][k];
+            dst[k * 3 + 1] = channels[1][k];
+            dst[k * 3 + 2] = channels[2][k];
+        }
+    }
+
+    _mm256_zeroupper();
+    bilinear_rgb_scalar(rgb, width, height, xs, ys, out, i, count);
+}
+
+// 8 выходных пикселей за шаг: сбор отсчета t каждого канала, веса подряд
+//  Индексы 32-битные: строки длиннее 2^31 float идут скалярно
+__attribute__((target("avx2")))
+static void resample_row_rgb_avx2(const float* rgb, float* out, size_t count,
+                                  const int32_t* starts, const float* weights, int ntaps) {
+    const __m256i three = _mm256_set1_epi32(3);
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_mullo_epi32(_mm256_loadu_si256((const __m256i*)(starts + i)),
+                                           three);
+        __m256 r = _mm256_setzero_ps();
+        __m256 g = _mm256_setzero_ps();
+        __m256 b = _mm256_setzero_ps();
+
+        for (int t = 0; t < ntaps; t++) {
+            __m256 w = _mm256_loadu_ps(weights + (size_t)t * count + i);
+            r = _mm256_add_ps(r, _mm256_mul_ps(_mm256_i32gather_ps(rgb, index, 4), w));
+            g = _mm256_add_ps(g, _mm256_mul_ps(_mm256_i32gather_ps(rgb + 1, index, 4), w));
+            b = _mm256_add_ps(b, _mm256_mul_ps(_mm256_i32gather_ps(rgb + 2, index, 4), w));
+            index = _mm256_add_epi32(index, three);
+        }
+
+        float channels[3][8];
+        _mm256_storeu_ps(channels[0], r);
+        _mm256_storeu_ps(channels[1], g);
+        _mm256_storeu_ps(channels[2], b);
+
+        float* dst = out + i * 3;
+        for (int k = 0; k < 8; k++) {
+            dst[k * 3 + 0] = channels[0][k];
+            dst[k * 3 + 1] = channels[1][k];
+            dst[k * 3 + 2] = channels[2][k];
+        }
+    }
+
+    _mm256_zeroupper();
+    resample_row_rgb_scalar(rgb, out, i, count, starts, weights, ntaps);
+}
+
+// 8 пикселей = 24 байта: вторая загрузка со смещения 8 кладет
+// пиксели 4..7 в байты 4..15, после объединения получаются байты 8..23
+__attribute__((target("avx2")))
+static void bgr_to_rgbf_avx2(const uint8_t* bgr, float* rgb, size_t pixels) {
+    const __m128i swap_lo = _mm_setr_epi8(SWAP_BGR_4PX);
+    const __m128i swap_hi = _mm_setr_epi8(-1, -1, -1, -1, 6, 5, 4, 9, 8, 7,
+                                          12, 11, 10, 15, 14, 13);
+    const __m256 scale = _mm256_set1_ps(255.0f);
+    size_t i = 0;
+    for (; i + 8 <= pixels; i += 8) {
+        const uint8_t* in = bgr + i * 3;
+        __m128i lo = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)in), swap_lo);
+        __m128i hi = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(in + 8)), swap_hi);
+        __m128i mid = _mm_or_si128(_mm_srli_si128(lo, 8), hi);
+
+        float* out = rgb + i * 3;
+        _mm256_storeu_ps(out, _mm256_div_ps(
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(lo)), scale));
+        _mm256_storeu_ps(out + 8, _mm256_div_ps(
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(mid)), scale));
+        _mm256_storeu_ps(out + 16, _mm256_div_ps(
+            _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(mid, 8))), scale));
+    }
+    _mm256_zeroupper();
+    bgr_to_rgbf_scalar(bgr + i * 3, rgb + i * 3, pixels - i);
+}
+
+#endif
+
+// Диспетчеризация
+
+void simd_negative(float* data, size_t count) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  negative_avx2(data, count); return;
+        case SIMD_SSE41: negative_sse41(data, count); return;
+        default: break;
+    }
+#endif
+    negative_scalar(data, count);
+}
+
+void simd_clamp(float* data, size_t count) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  clamp_avx2(data, count); return;
+        case SIMD_SSE41: clamp_sse41(data, count); return;
+        default: break;
+    }
+#endif
+    clamp_scalar(data, count);
+}
+
+void simd_grayscale_interleaved(float* rgb, size_t pixels) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  grayscale_interleaved_avx2(rgb, pixels); return;
+        case SIMD_SSE41: grayscale_interleaved_sse41(rgb, pixels); return;
+        default: break;
+    }
+#endif
+    grayscale_interleaved_scalar(rgb, pixels);
+}
+
+void simd_grayscale_planar(float* r, float* g, float* b, size_t count) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  grayscale_planar_avx2(r, g, b, count); return;
+        case SIMD_SSE41: grayscale_planar_sse41(r, g, b, count); return;
+        default: break;
+    }
+#endif
+    grayscale_planar_scalar(r, g, b, count);
+}
+
+void simd_convolve3x3(const float* const rows[3], float* out, size_t count,
+                      const float kernel[9]) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  convolve3x3_avx2(rows, out, count, kernel); return;
+        case SIMD_SSE41: convolve3x3_sse41(rows, out, count, kernel); return;
+        default: break;
+    }
+#endif
+    convolve3x3_scalar(rows, out, 0, count, kernel);
+}
+
+void simd_convolve_row(const float* row, float* out, size_t count,
+                       const float* taps, int ntaps) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  convolve_row_avx2(row, out, count, taps, ntaps); return;
+        case SIMD_SSE41: convolve_row_sse41(row, out, count, taps, ntaps); return;
+        default: break;
+    }
+#endif
+    convolve_row_scalar(row, out, 0, count, taps, ntaps);
+}
+
+void simd_convolve_column(const float* const* rows, float* out, size_t count,
+                          const float* taps, int ntaps) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  convolve_column_avx2(rows, out, count, taps, ntaps); return;
+        case SIMD_SSE41: convolve_column_sse41(rows, out, count, taps, ntaps); return;
+        default: break;
+    }
+#endif
+    convolve_column_scalar(rows, out, 0, count, taps, ntaps);
+}
+
+void simd_bilinear_rgb(const float* rgb, uint32_t width, uint32_t height,
+                       const float* xs, const float* ys, float* out, size_t count) {
+#if SIMD_X86
+    if (simd_level() == SIMD_AVX2 && (uint64_t)width * height * 3 <= INT32_MAX) {
+        bilinear_rgb_avx2(rgb, width, height, xs, ys, out, count);
+        return;
+    }
+#endif
+    bilinear_rgb_scalar(rgb, width, height, xs, ys, out, 0, count);
+}
+
+void simd_resample_row_rgb(const float* rgb, uint32_t width, float* out, size_t count,
+                           const int32_t* starts, const float* weights, int ntaps) {
+#if SIMD_X86
+    if (simd_level() == SIMD_AVX2 && (uint64_t)width * 3 <= INT32_MAX) {
+        resample_row_rgb_avx2(rgb, out, count, starts, weights, ntaps);
+        return;
+    }
+#else
+    (void)width;
+#endif
+    resample_row_rgb_scalar(rgb, out, 0, count, starts, weights, ntaps);
+}
+
+void simd_bgr_to_rgbf(const uint8_t* bgr, float* rgb, size_t pixels) {
+#if SIMD_X86
+    switch (simd_level()) {
+        case SIMD_AVX2:  bgr_to_rgbf_avx2(bgr, rgb, pixels); return;
+        case SIMD_SSE41: bgr_to_rgbf_sse41(bgr, rgb, pixels); return;
+        default: break;
+    }
+#endif
+    bgr_to_rgbf_scalar(bgr, rgb, pixels);
+}
+
+// Упаковка ограничена шириной 128 бит (перестановка байтов внутри дорожки),
+// поэтому на AVX2 используется вариант SSE4.1
+void simd_rgbf_to_bgr(const float* rgb, uint8_t* bgr, size_t pixels) {
+#if SIMD_X86
+    if (simd_level() >= SIMD_SSE41) {
+        rgbf_to_bgr_sse41(rgb, bgr, pixels);
+        return;
+    }
+#endif
+    rgbf_to_bgr_scalar(rgb, bgr, pixels);
+}
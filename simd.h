@@ -0,0 +1,80 @@
+// Векторные ядра фильтров (SSE4.1 / AVX2)
+//  Набор инструкций выбирается во время выполнения по CPUID,
+//  скалярная реализация остается запасным вариантом.
+//  Все ядра выполняют те же операции в том же порядке, что и скалярный код
+//  (без FMA), поэтому результат совпадает побитово.
+
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Уровень поддержки векторных инструкций
+typedef enum {
+    SIMD_SCALAR,      // Без векторных инструкций
+    SIMD_SSE41,       // SSE4.1, 4 float
+    SIMD_AVX2         // AVX2, 8 float
+} SimdLevel;
+
+// Используемый уровень (CPUID, может быть понижен
+// переменной окружения IMAGECRAFT_SIMD=scalar|sse4|avx2)
+SimdLevel simd_level(void);
+
+// Имя уровня для вывода
+const char* simd_level_name(SimdLevel level);
+
+// Ядра над массивами float (раскладка каналов не важна)
+
+// x = 1 - x
+void simd_negative(float* data, size_t count);
+
+// x = min(max(x, 0), 1)
+void simd_clamp(float* data, size_t count);
+
+// Ядра над упакованными RGB пикселями (Color)
+
+// R = G = B = 0.299*R + 0.587*G + 0.114*B
+void simd_grayscale_interleaved(float* rgb, size_t pixels);
+
+// Строка BMP (B, G, R по байту) -> RGB float, деление на 255 как в bmpixel_to_color
+void simd_bgr_to_rgbf(const uint8_t* bgr, float* rgb, size_t pixels);
+
+// RGB float -> строка BMP, ограничение и отбрасывание дробной части
+// как в color_to_bmpixel
+void simd_rgbf_to_bgr(const float* rgb, uint8_t* bgr, size_t pixels);
+
+// Билинейная выборка из упакованного RGB изображения width x height:
+// out[i] = цвет в точке (xs[i], ys[i]), координаты ограничиваются
+// [0, width - 1] x [0, height - 1] (как в bilinear_interpolation, без
+// ограничения результата)
+void simd_bilinear_rgb(const float* rgb, uint32_t width, uint32_t height,
+                       const float* xs, const float* ys, float* out, size_t count);
+
+// Строка передискретизации по горизонтали (упакованный RGB, width пикселей):
+// out[i] = sum(weights[t * count + i] * rgb[starts[i] + t]), t = 0..ntaps-1,
+// сумма с нуля по возрастанию t (на AVX2 - 8 выходных пикселей за шаг сбором)
+void simd_resample_row_rgb(const float* rgb, uint32_t width, float* out, size_t count,
+                           const int32_t* starts, const float* weights, int ntaps);
+
+// Ядра над строками планарного представления
+
+// Grayscale над плоскостями R, G, B
+void simd_grayscale_planar(float* r, float* g, float* b, size_t count);
+
+// Свертка 3x3 одной плоскости
+// rows[0..2] - строки y-1, y, y+1 (доступны индексы от -1 до count)
+// kernel - ядро 3x3 по строкам
+void simd_convolve3x3(const float* const rows[3], float* out, size_t count,
+                      const float kernel[9]);
+
+// Строка свертки: out[x] += sum(taps[t] * row[x + t]), t = 0..ntaps-1
+// (доступны индексы row от 0 до count + ntaps - 2)
+void simd_convolve_row(const float* row, float* out, size_t count,
+                       const float* taps, int ntaps);
+
+// Столбец свертки: out[x] += sum(taps[t] * rows[t][x]), t = 0..ntaps-1
+void simd_convolve_column(const float* const* rows, float* out, size_t count,
+                          const float* taps, int ntaps);
+
+#endif
@@ -0,0 +1,943 @@
+#include "stream.h"
+#include "bmp.h"
+#include "filters.h"
+#include "median.h"
+#include "parallel.h"
+#include "simd.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+
+// Константы
+
+#define STREAM_STRIP_ROWS 64   // Строк в полосе, запрашиваемой при записи
+
+// Стадия конвейера
+//  Стадия отдает строки результата полосами по запросу следующей стадии
+//  (запросы идут строго подряд сверху вниз). Стадия с окрестностью хранит
+//  окно строк входа [win_begin, win_end) в собственном формате строки
+//  (ingest), полосу результата считает из окна (compute).
+
+typedef struct StreamStage StreamStage;
+
+// Преобразование строки входа при попадании в окно
+//  Строку входа можно менять на месте
+typedef void (*StageIngestFunc)(StreamStage* stage, Color* in, uint8_t* slot);
+
+// Вычисление строк результата [y_begin, y_end)
+typedef void (*StageComputeFunc)(StreamStage* stage, uint32_t y_begin, uint32_t y_end);
+
+// Поточечная обработка строк полосы на месте
+typedef void (*StagePointFunc)(StreamStage* stage, Color* rows, uint32_t count);
+
+struct StreamStage {
+    const char* name;           // Название для вывода
+    StreamStage* input;         // Предыдущая стадия (NULL - чтение источника)
+    BMPStream* source;          // Входной файл (только у первой стадии)
+    const Image* image;         // Или изображение в памяти (выполнение плитками)
+    uint32_t image_x;           // Первый столбец изображения в строках стадии
+
+    uint32_t in_width;          // Размеры входа
+    uint32_t in_height;
+    uint32_t width;             // Размеры результата
+    uint32_t height;
+    uint32_t capacity;          // Максимум строк в одном запросе
+
+    // Поточечная стадия (radius == 0)
+    StagePointFunc point;
+
+    // Стадия с окрестностью
+    int radius;                 // Ореол в строках входа
+    size_t slot_size;           // Байт на строку окна
+    uint8_t* window;            // Окно строк входа
+    uint32_t win_begin;         // Первая строка в окне
+    uint32_t win_end;           // Строка после последней в окне
+    StageIngestFunc ingest;
+    StageComputeFunc compute;
+    bool sequential;            // compute вызывается для всей полосы сразу
+
+    Color* out;                 // Полоса результата (capacity строк)
+    uint32_t out_y;             // Первая строка текущей полосы
+    atomic_bool failed;         // Ошибка выделения памяти в одной из полос
+
+    // Параметры фильтров
+    float conv_kernel[9];       // Ядро 3x3 (резкость, границы)
+    float threshold;            // Порог бинаризации (границы)
+    float* kernel;              // 1D гауссово ядро (размытие)
+    int kernel_radius;          // Радиус ядра или бокса
+    MedianState* median;        // Состояние медианного фильтра
+    uint8_t* median_out;        // Полоса результата медианы в 8 битах
+};
+
+// Строка окна для строки входа y (с повторением крайних строк)
+static inline uint8_t* stage_slot(const StreamStage* stage, int y) {
+    if (y < 0) y = 0;
+    if (y >= (int)stage->in_height) y = (int)stage->in_height - 1;
+    return stage->window + (size_t)((uint32_t)y - stage->win_begin) * stage->slot_size;
+}
+
+// Строка полосы результата для строки y
+static inline Color* stage_out_row(const StreamStage* stage, uint32_t y) {
+    return stage->out + (size_t)(y - stage->out_y) * stage->width;
+}
+
+// Поточечные стадии
+
+static void crop_rows(StreamStage* stage, Color* rows, uint32_t count) {
+    // Строки сдвигаются к началу буфера (новая ширина не больше прежней)
+    if (stage->width == stage->in_width) return;
+    for (uint32_t j = 1; j < count; j++) {
+        memmove(rows + (size_t)j * stage->width, rows + (size_t)j * stage->in_width,
+                stage->width * sizeof(Color));
+    }
+}
+
+static void grayscale_rows(StreamStage* stage, Color* rows, uint32_t count) {
+    simd_grayscale_interleaved((float*)rows, (size_t)stage->width * count);
+}
+
+static void negative_rows(StreamStage* stage, Color* rows, uint32_t count) {
+    simd_negative((float*)rows, (size_t)stage->width * count * 3);
+}
+
+// Свертка 3x3 (резкость): окно из трех плоскостей с рамкой в 1 пиксель,
+// как в apply_convolution3x3
+
+static void planes_ingest(StreamStage* stage, Color* in, uint8_t* slot) {
+    uint32_t width = stage->in_width;
+    float* plane = (float*)slot;
+
+    for (int c = 0; c < 3; c++) {
+        const float* channel = (const float*)in + c;
+        plane[0] = channel[0];
+        for (uint32_t x = 0; x < width; x++) {
+            plane[x + 1] = channel[(size_t)x * 3];
+        }
+        plane[width + 1] = channel[(size_t)(width - 1) * 3];
+        plane += width + 2;
+    }
+}
+
+static void sharpen_compute(StreamStage* stage, uint32_t y_begin, uint32_t y_end) {
+    uint32_t width = stage->width;
+    size_t plane_stride = width + 2;
+
+    float* out = (float*)malloc((size_t)width * 3 * sizeof(float));
+    if (!out) {
+        atomic_store(&stage->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int c = 0; c < 3; c++) {
+            const float* rows[3];
+            for (int ky = 0; ky < 3; ky++) {
+                rows[ky] = (const float*)stage_slot(stage, (int)y + ky - 1) +
+                           c * plane_stride + 1;
+            }
+            simd_convolve3x3(rows, out + (size_t)c * width, width, stage->conv_kernel);
+        }
+
+        Color* dst = stage_out_row(stage, y);
+        for (uint32_t x = 0; x < width; x++) {
+            dst[x].r = out[x];
+            dst[x].g = out[width + x];
+            dst[x].b = out[2 * (size_t)width + x];
+        }
+        simd_clamp((float*)dst, (size_t)width * 3);
+    }
+
+    free(out);
+}
+
+// Выделение границ: строка переводится в оттенки серого при попадании
+// в окно, после этого каналы равны и сворачивается только один
+
+static void edge_ingest(StreamStage* stage, Color* in, uint8_t* slot) {
+    uint32_t width = stage->in_width;
+    float* plane = (float*)slot;
+
+    simd_grayscale_interleaved((float*)in, width);
+
+    plane[0] = in[0].r;
+    for (uint32_t x = 0; x < width; x++) {
+        plane[x + 1] = in[x].r;
+    }
+    plane[width + 1] = in[width - 1].r;
+}
+
+static void edge_compute(StreamStage* stage, uint32_t y_begin, uint32_t y_end) {
+    uint32_t width = stage->width;
+    float threshold = stage->threshold;
+
+    float* out = (float*)malloc((size_t)width * sizeof(float));
+    if (!out) {
+        atomic_store(&stage->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const float* rows[3];
+        for (int ky = 0; ky < 3; ky++) {
+            rows[ky] = (const float*)stage_slot(stage, (int)y + ky - 1) + 1;
+        }
+        simd_convolve3x3(rows, out, width, stage->conv_kernel);
+        simd_clamp(out, width);
+
+        // Бинаризация: выше порога -> белый, иначе черный
+        Color* dst = stage_out_row(stage, y);
+        for (uint32_t x = 0; x < width; x++) {
+            float value = out[x] > threshold ? 1.0f : 0.0f;
+            dst[x].r = dst[x].g = dst[x].b = value;
+        }
+    }
+
+    free(out);
+}
+
+// Медиана: окно из квантованных строк, состояние сдвигается от полосы
+// к полосе (гистограммы столбцов не строятся заново)
+
+static void median_ingest(StreamStage* stage, Color* in, uint8_t* slot) {
+    for (uint32_t x = 0; x < stage->in_width; x++) {
+        slot[x * 3 + 0] = color_channel_to_u8(in[x].r);
+        slot[x * 3 + 1] = color_channel_to_u8(in[x].g);
+        slot[x * 3 + 2] = color_channel_to_u8(in[x].b);
+    }
+}
+
+static const uint8_t* median_row(void* ctx, uint32_t y) {
+    return stage_slot((const StreamStage*)ctx, (int)y);
+}
+
+static void median_compute(StreamStage* stage, uint32_t y_begin, uint32_t y_end) {
+    size_t row_bytes = (size_t)stage->width * 3;
+
+    median_state_run(stage->median, median_row, stage, stage->in_height,
+                     y_begin, y_end, stage->median_out, row_bytes);
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        const uint8_t* src = stage->median_out + (size_t)(y - y_begin) * row_bytes;
+        float* dst = (float*)stage_out_row(stage, y);
+        for (size_t i = 0; i < row_bytes; i++) {
+            dst[i] = (float)src[i] / 255.0f;
+        }
+    }
+}
+
+// Гауссово размытие: горизонтальный проход при попадании строки в окно,
+// вертикальный - по строкам окна
+
+static void blur_ingest(StreamStage* stage, Color* in, uint8_t* slot) {
+    blur_horizontal_row(in, (Color*)slot, (int)stage->in_width,
+                        stage->kernel, stage->kernel_radius);
+}
+
+static void blur_compute(StreamStage* stage, uint32_t y_begin, uint32_t y_end) {
+    int r = stage->kernel_radius;
+    uint32_t width = stage->width;
+
+    Color* acc = (Color*)malloc(width * sizeof(Color));
+    const Color** rows = (const Color**)malloc((size_t)(2 * r + 1) * sizeof(Color*));
+    if (!acc || !rows) {
+        free(acc);
+        free(rows);
+        atomic_store(&stage->failed, true);
+        return;
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        for (int i = -r; i <= r; i++) {
+            rows[i + r] = (const Color*)stage_slot(stage, (int)y + i);
+        }
+        blur_vertical_row(rows, stage_out_row(stage, y), acc, width, stage->kernel, r);
+    }
+
+    free(rows);
+    free(acc);
+}
+
+// Один бокс приближенного размытия: горизонтальная скользящая сумма
+// при попадании строки в окно, вертикальная - по строкам окна
+
+static void box_ingest(StreamStage* stage, Color* in, uint8_t* slot) {
+    box_horizontal_row(in, (Color*)slot, (int)stage->in_width, stage->kernel_radius);
+}
+
+static void box_compute(StreamStage* stage, uint32_t y_begin, uint32_t y_end) {
+    int r = stage->kernel_radius;
+    size_t count = (size_t)stage->width * 3;
+    double norm = 1.0 / (2 * r + 1);
+
+    double* acc = (double*)calloc(count, sizeof(double));
+    if (!acc) {
+        atomic_store(&stage->failed, true);
+        return;
+    }
+
+    for (int i = -r; i <= r; i++) {
+        const float* row = (const float*)stage_slot(stage, (int)y_begin + i);
+        for (size_t k = 0; k < count; k++) {
+            acc[k] += row[k];
+        }
+    }
+
+    for (uint32_t y = y_begin; y < y_end; y++) {
+        float* dst = (float*)stage_out_row(stage, y);
+        for (size_t k = 0; k < count; k++) {
+            dst[k] = (float)(acc[k] * norm);
+        }
+
+        // Сдвиг окна (после последней строки полосы не нужен)
+        if (y + 1 == y_end) break;
+        const float* in = (const float*)stage_slot(stage, (int)y + r + 1);
+        const float* out = (const float*)stage_slot(stage, (int)y - r);
+        for (size_t k = 0; k < count; k++) {
+            acc[k] += (double)in[k] - (double)out[k];
+        }
+    }
+
+    free(acc);
+}
+
+// Выполнение стадий
+
+// Параметры полосы ingest/compute
+typedef struct {
+    StreamStage* stage;
+    Color* in;                  // Новые строки входа (для ingest)
+    uint32_t first;             // Первая строка входа или результата
+} StageBand;
+
+static void stage_ingest_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    StageBand* band = (StageBand*)ctx;
+    StreamStage* stage = band->stage;
+
+    for (uint32_t j = y_begin; j < y_end; j++) {
+        stage->ingest(stage, band->in + (size_t)j * stage->in_width,
+                      stage_slot(stage, (int)(band->first + j)));
+    }
+}
+
+static void stage_compute_band(void* ctx, uint32_t y_begin, uint32_t y_end) {
+    StageBand* band = (StageBand*)ctx;
+    band->stage->compute(band->stage, band->first + y_begin, band->first + y_end);
+}
+
+// Строки изображения [y, y + count), столбцы [image_x, image_x + width)
+static void image_read_rows(StreamStage* stage, uint32_t y, uint32_t count) {
+    const Image* image = stage->image;
+    for (uint32_t j = 0; j < count; j++) {
+        memcpy(stage->out + (size_t)j * stage->width,
+               image->data + (size_t)(y + j) * image->width + stage->image_x,
+               stage->width * sizeof(Color));
+    }
+}
+
+// Строки результата [y, y + count) стадии
+//  Указатель действителен до следующего запроса, строки можно менять на месте
+static Color* stage_pull(StreamStage* stage, uint32_t y, uint32_t count) {
+    // Чтение источника (копия: следующие стадии меняют строки на месте)
+    if (!stage->input) {
+        if (stage->image) {
+            image_read_rows(stage, y, count);
+            return stage->out;
+        }
+        if (!bmp_stream_read(stage->source, y, count, stage->out)) {
+            return NULL;
+        }
+        return stage->out;
+    }
+
+    // Поточечная стадия работает прямо в полосе предыдущей
+    if (stage->radius == 0) {
+        Color* rows = stage_pull(stage->input, y, count);
+        if (rows) {
+            stage->point(stage, rows, count);
+        }
+        return rows;
+    }
+
+    // Нужные строки входа: полоса плюс ореол
+    int r = stage->radius;
+    uint32_t need_begin = y > (uint32_t)r ? y - (uint32_t)r : 0;
+    uint32_t need_end = y + count + (uint32_t)r;
+    if (need_end > stage->in_height) need_end = stage->in_height;
+
+    // Окно не пересекается с нужными строками (первый запрос плитки)
+    if (need_begin >= stage->win_end) {
+        stage->win_begin = stage->win_end = need_begin;
+    }
+
+    // Сдвиг окна: строки выше need_begin больше не понадобятся
+    if (need_begin > stage->win_begin) {
+        uint32_t keep = stage->win_end - need_begin;
+        memmove(stage->window, stage_slot(stage, (int)need_begin),
+                (size_t)keep * stage->slot_size);
+        stage->win_begin = need_begin;
+    }
+
+    // Дочитывание новых строк
+    if (need_end > stage->win_end) {
+        uint32_t first = stage->win_end;
+        uint32_t fresh = need_end - first;
+
+        Color* in = stage_pull(stage->input, first, fresh);
+        if (!in) {
+            return NULL;
+        }
+
+        stage->win_end = need_end;
+        StageBand band = { stage, in, first };
+        parallel_for_rows(fresh, stage_ingest_band, &band);
+    }
+
+    // Вычисление полосы
+    stage->out_y = y;
+    if (stage->sequential) {
+        stage->compute(stage, y, y + count);
+    } else {
+        StageBand band = { stage, NULL, y };
+        parallel_for_rows(count, stage_compute_band, &band);
+    }
+
+    if (atomic_load(&stage->failed)) {
+        fprintf(stderr, "Ошибка выделения памяти в стадии %s\n", stage->name);
+        return NULL;
+    }
+    return stage->out;
+}
+
+// Построение стадий
+
+static void stage_free(StreamStage* stage) {
+    if (!stage) return;
+    if (stage->source) {
+        bmp_stream_close(stage->source);
+    }
+    free(stage->window);
+    free(stage->out);
+    free(stage->kernel);
+    median_state_free(stage->median);
+    free(stage->median_out);
+    free(stage);
+}
+
+// Новая стадия после input (размеры результата равны размерам входа)
+static StreamStage* stage_create(StreamStage* input, const char* name) {
+    StreamStage* stage = (StreamStage*)calloc(1, sizeof(StreamStage));
+    if (!stage) {
+        fprintf(stderr, "Ошибка выделения памяти для стадии %s\n", name);
+        return NULL;
+    }
+
+    stage->name = name;
+    stage->input = input;
+    if (input) {
+        stage->in_width = stage->width = input->width;
+        stage->in_height = stage->height = input->height;
+    }
+    atomic_init(&stage->failed, false);
+    return stage;
+}
+
+static void stage_set_neighborhood(StreamStage* stage, int radius, size_t slot_size,
+                                   StageIngestFunc ingest, StageComputeFunc compute) {
+    stage->radius = radius;
+    stage->slot_size = slot_size;
+    stage->ingest = ingest;
+    stage->compute = compute;
+}
+
+// Ядра 3x3, как в filter_sharpen и filter_edge_detection
+static const float SHARPEN_KERNEL[9] = {
+    0.0f, -1.0f,  0.0f,
+   -1.0f,  5.0f, -1.0f,
+    0.0f, -1.0f,  0.0f
+};
+
+static const float EDGE_KERNEL[9] = {
+    0.0f, -1.0f,  0.0f,
+   -1.0f,  4.0f, -1.0f,
+    0.0f, -1.0f,  0.0f
+};
+
+// Добавление стадий для одного фильтра после *last
+//  Фильтр может дать ноль стадий (медиана 1) или несколько (три бокса)
+static bool stage_append(StreamStage** last, const FilterParams* filter, int* count) {
+    StreamStage* input = *last;
+    StreamStage* stage = NULL;
+    const char* name = filter_type_to_name(filter->type);
+
+    switch (filter->type) {
+        case FILTER_CROP: {
+            uint32_t width = filter->values.width;
+            uint32_t height = filter->values.height;
+            if (width == 0 || height == 0) {
+                fprintf(stderr, "Ошибка: неверные размеры для crop: %ux%u\n", width, height);
+                return false;
+            }
+            if (!(stage = stage_create(input, name))) return false;
+            if (width < stage->width) stage->width = width;
+            if (height < stage->height) stage->height = height;
+            stage->point = crop_rows;
+            break;
+        }
+
+        case FILTER_GRAYSCALE:
+            if (!(stage = stage_create(input, name))) return false;
+            stage->point = grayscale_rows;
+            break;
+
+        case FILTER_NEGATIVE:
+            if (!(stage = stage_create(input, name))) return false;
+            stage->point = negative_rows;
+            break;
+
+        case FILTER_SHARPEN:
+            if (!(stage = stage_create(input, name))) return false;
+            memcpy(stage->conv_kernel, SHARPEN_KERNEL, sizeof(SHARPEN_KERNEL));
+            stage_set_neighborhood(stage, 1, (size_t)(stage->in_width + 2) * 3 * sizeof(float),
+                                   planes_ingest, sharpen_compute);
+            break;
+
+        case FILTER_EDGE: {
+            float threshold = filter->values.value;
+            if (threshold < 0.0f || threshold > 1.0f) {
+                fprintf(stderr, "Ошибка: некорректный порог %.2f (должен быть 0.0-1.0)\n",
+                        threshold);
+                return false;
+            }
+            if (!(stage = stage_create(input, name))) return false;
+            memcpy(stage->conv_kernel, EDGE_KERNEL, sizeof(EDGE_KERNEL));
+            stage->threshold = threshold;
+            stage_set_neighborhood(stage, 1, (size_t)(stage->in_width + 2) * sizeof(float),
+                                   edge_ingest, edge_compute);
+            break;
+        }
+
+        case FILTER_MEDIAN: {
+            int window = filter->values.size;
+            if (window <= 0 || window % 2 == 0) {
+                fprintf(stderr, "Ошибка: размер окна должен быть положительным нечетным числом\n");
+                return false;
+            }
+            if (window == 1) {
+                return true;  // Фильтрация не требуется
+            }
+            if (!(stage = stage_create(input, name))) return false;
+            // Сдвиг гистограмм после строки y читает строку y + r + 1
+            stage_set_neighborhood(stage, window / 2 + 1, (size_t)stage->in_width * 3,
+                                   median_ingest, median_compute);
+            stage->sequential = true;
+            stage->median = median_state_create(stage->in_width, window);
+            if (!stage->median) {
+                fprintf(stderr, "Ошибка выделения памяти для медианного фильтра\n");
+                stage_free(stage);
+                return false;
+            }
+            break;
+        }
+
+        case FILTER_BLUR: {
+            float sigma = filter->values.value;
+            if (sigma <= 0.0f) {
+                fprintf(stderr, "Ошибка: sigma должен быть положительным (%.2f)\n", sigma);
+                return false;
+            }
+            if (!(stage = stage_create(input, name))) return false;
+            stage->kernel = gaussian_kernel_create(sigma, &stage->kernel_radius);
+            if (!stage->kernel) {
+                fprintf(stderr, "Ошибка выделения памяти для гауссова ядра\n");
+                stage_free(stage);
+                return false;
+            }
+            stage_set_neighborhood(stage, stage->kernel_radius,
+                                   (size_t)stage->in_width * sizeof(Color),
+                                   blur_ingest, blur_compute);
+            break;
+        }
+
+        case FILTER_BLUR_FAST: {
+            float sigma = filter->values.value;
+            if (sigma <= 0.0f) {
+                fprintf(stderr, "Ошибка: sigma должен быть положительным (%.2f)\n", sigma);
+                return false;
+            }
+            int sizes[3];
+            box_sizes_for_gauss(sigma, sizes);
+
+            // Каждый бокс - отдельная стадия со своим окном
+            for (int i = 0; i < 3; i++) {
+                int r = (sizes[i] - 1) / 2;
+                if (r <= 0) continue;
+
+                StreamStage* box = stage_create(*last, name);
+                if (!box) return false;
+                box->kernel_radius = r;
+                stage_set_neighborhood(box, r, (size_t)box->in_width * sizeof(Color),
+                                       box_ingest, box_compute);
+                *last = box;
+                (*count)++;
+            }
+            return true;
+        }
+
+        default:
+            fprintf(stderr, "Ошибка: фильтр %s не поддерживает потоковую обработку\n", name);
+            return false;
+    }
+
+    *last = stage;
+    (*count)++;
+    return true;
+}
+
+// Выделение буферов от последней стадии к первой
+//  Стадия с ореолом r при первом запросе читает до 2r строк сверх
+//  полосы (плитка начинается не с первой строки), окно вмещает полосу
+//  и ореол с обеих сторон
+static bool stages_allocate(StreamStage* last, size_t* total_bytes) {
+    uint32_t capacity = STREAM_STRIP_ROWS;
+    *total_bytes = 0;
+
+    for (StreamStage* stage = last; stage; stage = stage->input) {
+        if (capacity > stage->height) capacity = stage->height;
+        stage->capacity = capacity;
+
+        if (!stage->input || stage->radius > 0) {
+            size_t out_bytes = (size_t)capacity * stage->width * sizeof(Color);
+            stage->out = (Color*)malloc(out_bytes);
+            if (!stage->out) return false;
+            *total_bytes += out_bytes;
+        }
+
+        if (stage->radius > 0) {
+            size_t window_rows = (size_t)capacity + 2 * (size_t)stage->radius;
+            if (window_rows > stage->in_height) window_rows = stage->in_height;
+            stage->window = (uint8_t*)malloc(window_rows * stage->slot_size);
+            if (!stage->window) return false;
+            *total_bytes += window_rows * stage->slot_size;
+
+            if (stage->median) {
+                stage->median_out = (uint8_t*)malloc((size_t)capacity * stage->width * 3);
+                if (!stage->median_out) return false;
+                *total_bytes += (size_t)capacity * stage->width * 3;
+            }
+
+            capacity += 2 * (uint32_t)stage->radius;
+        }
+    }
+
+    return true;
+}
+
+// Сброс окон перед плиткой: в них строки других столбцов
+static void stages_reset(StreamStage* last) {
+    for (StreamStage* stage = last; stage; stage = stage->input) {
+        stage->win_begin = stage->win_end = 0;
+        median_state_reset(stage->median);
+    }
+}
+
+static void stages_free(StreamStage* last) {
+    while (last) {
+        StreamStage* input = last->input;
+        stage_free(last);
+        last = input;
+    }
+}
+
+// Печать стадий от первой к последней
+static void stages_print(const StreamStage* stage, int* index) {
+    if (!stage->input) return;
+    stages_print(stage->input, index);
+
+    printf("%d. %s", ++(*index), stage->name);
+    if (stage->radius > 0) {
+        printf(" (ореол %d строк)", stage->radius);
+    }
+    if (stage->width != stage->in_width || stage->height != stage->in_height) {
+        printf(" %ux%u -> %ux%u", stage->in_width, stage->in_height,
+               stage->width, stage->height);
+    }
+    printf("\n");
+}
+
+// Проверка поддержки
+
+bool stream_supports_filter(FilterType type) {
+    switch (type) {
+        case FILTER_CROP:
+        case FILTER_GRAYSCALE:
+        case FILTER_NEGATIVE:
+        case FILTER_SHARPEN:
+        case FILTER_EDGE:
+        case FILTER_MEDIAN:
+        case FILTER_BLUR:
+        case FILTER_BLUR_FAST:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool stream_supported(const FilterPipeline* pipeline) {
+    if (!pipeline) return false;
+
+    // Медиана квантует вход в 8 бит: точна, только пока значения на сетке
+    // k/255 - после чтения BMP, -crop и -med
+    bool on_grid = true;
+    for (FilterParams* current = pipeline->first; current; current = current->next) {
+        if (!stream_supports_filter(current->type) ||
+            (current->type == FILTER_MEDIAN && !on_grid)) {
+            return false;
+        }
+        on_grid = on_grid && (current->type == FILTER_CROP || current->type == FILTER_MEDIAN);
+    }
+    return true;
+}
+
+// Потоковая обработка
+
+bool stream_run(const FilterPipeline* pipeline, const char* input_file,
+                const char* output_file) {
+    if (!pipeline || !input_file || !output_file) {
+        fprintf(stderr, "Ошибка: некорректные параметры потоковой обработки\n");
+        return false;
+    }
+
+    // Запись обрезала бы вход до чтения первой полосы
+    if (file_same(input_file, output_file)) {
+        fprintf(stderr, "Ошибка: потоковая запись в исходный файл '%s' невозможна\n",
+                output_file);
+        return false;
+    }
+
+    // 1. Источник
+    StreamStage* last = stage_create(NULL, "BMP");
+    if (!last) return false;
+
+    last->source = bmp_stream_open(input_file);
+    if (!last->source) {
+        stage_free(last);
+        return false;
+    }
+    last->width = last->source->width;
+    last->height = last->source->height;
+
+    printf("✅ Открыто BMP: %s (%ux%u, 24-бит, потоковое чтение)\n",
+           input_file, last->width, last->height);
+
+    // 2. Стадии фильтров
+    int stage_count = 0;
+    for (FilterParams* current = pipeline->first; current; current = current->next) {
+        if (!stage_append(&last, current, &stage_count)) {
+            stages_free(last);
+            return false;
+        }
+    }
+
+    size_t buffer_bytes = 0;
+    if (!stages_allocate(last, &buffer_bytes)) {
+        fprintf(stderr, "Ошибка выделения памяти для буферов потоковой обработки\n");
+        stages_free(last);
+        return false;
+    }
+
+    printf("\nПотоковая обработка: стадий %d, полоса %d строк, буферы %.1f МБ\n",
+           stage_count, STREAM_STRIP_ROWS, buffer_bytes / (1024.0 * 1024.0));
+    printf("========================================\n");
+    int index = 0;
+    stages_print(last, &index);
+
+    // 3. Запись результата полосами
+    uint32_t width = last->width;
+    uint32_t height = last->height;
+
+    BMPStream* output = bmp_stream_create(output_file, width, height);
+    if (!output) {
+        stages_free(last);
+        return false;
+    }
+
+    bool ok = true;
+    for (uint32_t y = 0; y < height && ok; y += STREAM_STRIP_ROWS) {
+        uint32_t count = height - y < STREAM_STRIP_ROWS ? height - y : STREAM_STRIP_ROWS;
+
+        Color* rows = stage_pull(last, y, count);
+        ok = rows && bmp_stream_write(output, y, count, rows);
+    }
+
+    if (!bmp_stream_close(output)) {
+        fprintf(stderr, "Ошибка закрытия файла '%s'\n", output_file);
+        ok = false;
+    }
+
+    stages_free(last);
+
+    if (!ok) {
+        fprintf(stderr, "Ошибка потоковой обработки\n");
+        return false;
+    }
+
+    printf("========================================\n");
+    printf("✅ Сохранено BMP: %s (%ux%u, потоковая запись)\n", output_file, width, height);
+    return true;
+}
+
+// Выполнение плитками в памяти
+
+// Параметры выполнения плитками
+typedef struct {
+    const FilterParams* first;  // Цепочка фильтров
+    int count;
+    const Image* source;        // Вход (только чтение)
+    Image* target;              // Результат того же размера
+    StreamTiles tiles;          // Разбиение на плитки
+    uint32_t strip_width;       // Ширина входа плитки с ореолом
+    atomic_bool failed;         // Ошибка в одной из плиток
+} TileJob;
+
+// Стадии одной плитки: источник - полоса столбцов изображения
+static StreamStage* tile_stages_create(const TileJob* job) {
+    StreamStage* last = stage_create(NULL, "Image");
+    if (!last) return NULL;
+
+    last->image = job->source;
+    last->width = job->strip_width;
+    last->height = job->source->height;
+
+    const FilterParams* filter = job->first;
+    int stage_count = 0;
+    for (int i = 0; i < job->count && filter; i++, filter = filter->next) {
+        if (!stage_append(&last, filter, &stage_count)) {
+            stages_free(last);
+            return NULL;
+        }
+    }
+
+    size_t buffer_bytes = 0;
+    if (!stages_allocate(last, &buffer_bytes)) {
+        fprintf(stderr, "Ошибка выделения памяти для буферов плитки\n");
+        stages_free(last);
+        return NULL;
+    }
+    return last;
+}
+
+// Одна плитка: столбцы входа выбираются так, чтобы ореол внутренних
+// сторон лежал в пределах изображения, у краев изображения ореол не нужен
+static bool tile_run(const TileJob* job, StreamStage* last, uint32_t tile) {
+    const StreamTiles* tiles = &job->tiles;
+    uint32_t width = job->source->width;
+    uint32_t height = job->source->height;
+
+    uint32_t x_begin = (tile % tiles->columns) * tiles->tile_width;
+    uint32_t x_end = x_begin + tiles->tile_width < width ? x_begin + tiles->tile_width : width;
+    uint32_t y_begin = (tile / tiles->columns) * tiles->tile_height;
+    uint32_t y_end = y_begin + tiles->tile_height < height ? y_begin + tiles->tile_height : height;
+
+    uint32_t strip_x = x_begin > (uint32_t)tiles->halo ? x_begin - (uint32_t)tiles->halo : 0;
+    if (strip_x > width - job->strip_width) strip_x = width - job->strip_width;
+
+    StreamStage* source = last;
+    while (source->input) source = source->input;
+    source->image_x = strip_x;
+    stages_reset(last);
+
+    for (uint32_t y = y_begin; y < y_end; y += STREAM_STRIP_ROWS) {
+        uint32_t count = y_end - y < STREAM_STRIP_ROWS ? y_end - y : STREAM_STRIP_ROWS;
+
+        Color* rows = stage_pull(last, y, count);
+        if (!rows) return false;
+
+        for (uint32_t j = 0; j < count; j++) {
+            memcpy(job->target->data + (size_t)(y + j) * width + x_begin,
+                   rows + (size_t)j * job->strip_width + (x_begin - strip_x),
+                   (x_end - x_begin) * sizeof(Color));
+        }
+    }
+    return true;
+}
+
+// Полоса плиток [begin, end): стадии строятся один раз на полосу
+static void tile_band(void* ctx, uint32_t begin, uint32_t end) {
+    TileJob* job = (TileJob*)ctx;
+
+    StreamStage* last = tile_stages_create(job);
+    if (!last) {
+        atomic_store(&job->failed, true);
+        return;
+    }
+
+    for (uint32_t tile = begin; tile < end && !atomic_load(&job->failed); tile++) {
+        if (!tile_run(job, last, tile)) {
+            atomic_store(&job->failed, true);
+        }
+    }
+
+    stages_free(last);
+}
+
+bool stream_supports_tiles(FilterType type) {
+    // Обрезка меняет ширину полосы столбцов; скользящая сумма боксов -fblur
+    // в строке плитки начинается не с нулевого столбца и округляется иначе
+    return type != FILTER_CROP && type != FILTER_BLUR_FAST && stream_supports_filter(type);
+}
+
+bool stream_apply_tiled(const FilterParams* first, int count, int halo,
+                        Image* image, StreamTiles* info) {
+    if (!first || count <= 0 || halo < 0 || !image || !image->data) {
+        fprintf(stderr, "Ошибка: некорректные параметры выполнения плитками\n");
+        return false;
+    }
+
+    const FilterParams* filter = first;
+    for (int i = 0; i < count; i++, filter = filter->next) {
+        if (!filter || !stream_supports_tiles(filter->type)) {
+            fprintf(stderr, "Ошибка: фильтр не поддерживает выполнение плитками\n");
+            return false;
+        }
+    }
+
+    // Ореол не больше четверти плитки: иначе лишняя работа на краях
+    // плиток становится заметной
+    StreamTiles tiles;
+    tiles.halo = halo;
+    tiles.tile_width = STREAM_TILE_WIDTH;
+    if ((uint64_t)halo * 4 > tiles.tile_width) tiles.tile_width = (uint32_t)halo * 4;
+    tiles.tile_height = STREAM_TILE_HEIGHT;
+    tiles.columns = (image->width + tiles.tile_width - 1) / tiles.tile_width;
+    tiles.rows = (image->height + tiles.tile_height - 1) / tiles.tile_height;
+
+    uint64_t strip_width = (uint64_t)tiles.tile_width + 2 * (uint64_t)halo;
+
+    TileJob job = {
+        .first = first,
+        .count = count,
+        .source = image,
+        .tiles = tiles,
+        .strip_width = strip_width < image->width ? (uint32_t)strip_width : image->width,
+    };
+    atomic_init(&job.failed, false);
+
+    job.target = image_create_uninit(image->width, image->height);
+    if (!job.target) {
+        return false;
+    }
+
+    parallel_for_rows(tiles.columns * tiles.rows, tile_band, &job);
+
+    if (atomic_load(&job.failed)) {
+        fprintf(stderr, "Ошибка выполнения фильтров плитками\n");
+        image_free(job.target);
+        return false;
+    }
+
+    image_replace(image, job.target);
+    if (info) *info = tiles;
+    return true;
+}
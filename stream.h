@@ -0,0 +1,56 @@
+// Потоковая обработка изображения полосами строк
+//  Изображение не загружается в память целиком: каждая стадия конвейера
+//  хранит только окно строк входа (полоса плюс ореол радиуса ядра),
+//  результат пишется в BMP полоса за полосой.
+//  Память: O(ширина * (полоса + сумма радиусов)), а не O(ширина * высота).
+//  Поддерживаются поточечные фильтры (-crop, -gs, -neg) и фильтры
+//  с ограниченным радиусом (-sharp, -edge, -med, -blur, -fblur);
+//  результат совпадает с обработкой в памяти.
+//  Те же стадии выполняют цепочку фильтров над изображением в памяти
+//  плитками (stream_apply_tiled): плитка с накопленным ореолом проходит
+//  все фильтры цепочки, пока ее полосы лежат в кэше, и в память
+//  записывается только итог. Ореол по вертикали не пересчитывается
+//  внутри плитки (окна сдвигаются), по горизонтали и на границах плиток
+//  пересчитывается сумма радиусов фильтров цепочки.
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "pipeline.h"
+#include <stdbool.h>
+
+#define STREAM_TILE_WIDTH 256      // Столбцов результата в плитке (не меньше 4 ореолов)
+#define STREAM_TILE_HEIGHT 512     // Строк результата в плитке
+
+// Разбиение изображения на плитки
+typedef struct {
+    uint32_t tile_width;       // Размер плитки результата
+    uint32_t tile_height;
+    uint32_t columns;          // Плиток по горизонтали и вертикали
+    uint32_t rows;
+    int halo;                  // Ореол: сумма радиусов фильтров цепочки
+} StreamTiles;
+
+// Поддержка фильтра потоковой обработкой
+bool stream_supports_filter(FilterType type);
+
+// Поддерживается ли потоковой обработкой вся цепочка фильтров
+// (-med - только до фильтров, уводящих значения с сетки k/255)
+bool stream_supported(const FilterPipeline* pipeline);
+
+// Потоковая обработка: чтение input_file, фильтры, запись output_file
+bool stream_run(const FilterPipeline* pipeline, const char* input_file,
+                const char* output_file);
+
+// Поддержка фильтра выполнением плитками (все, кроме -crop и -fblur)
+// Медиана в серии - только в начале: ее вход должен быть на сетке k/255
+bool stream_supports_tiles(FilterType type);
+
+// Выполнение count фильтров цепочки с first над изображением плитками
+//  halo - сумма радиусов фильтров (область, которую каждый читает вокруг
+//  пикселя). Плитки выполняются параллельно, результат совпадает
+//  с последовательным применением фильтров. info - разбиение (может быть NULL)
+bool stream_apply_tiled(const FilterParams* first, int count, int halo,
+                        Image* image, StreamTiles* info);
+
+#endif
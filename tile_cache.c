@@ -0,0 +1,317 @@
+#include "tile_cache.h"
+#include "utils.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Формат файла кэша
+//  [заголовок][путь к файлу плиток][пиксели][средние][подписи][порядок k-d][оси k-d]
+//  Разделы выровнены по TILE_CACHE_ALIGN, числа в порядке байт машины
+
+#define TILE_CACHE_MAGIC "ICTILES"
+#define TILE_CACHE_VERSION 2
+#define TILE_CACHE_ALIGN 64
+
+typedef struct {
+    char magic[8];             // "ICTILES\0"
+    uint32_t version;          // Версия формата
+    uint32_t tile_size;        // Размер плитки
+    uint32_t count;            // Количество плиток
+    uint32_t kd_count;         // Плиток в k-d дереве
+    uint32_t signature_size;   // Сторона сетки подблоков подписи
+    uint32_t reserved;
+    int64_t mtime_sec;         // mtime файла плиток
+    int64_t mtime_nsec;
+    uint64_t source_size;      // Размер файла плиток
+    uint64_t path_offset;      // Абсолютный путь к файлу плиток
+    uint64_t path_length;
+    uint64_t pixels_offset;    // Color[count * tile_size²]
+    uint64_t averages_offset;  // Color[count]
+    uint64_t signatures_offset;// Color[count * signature_size²]
+    uint64_t kd_order_offset;  // int[count]
+    uint64_t kd_axis_offset;   // uint8_t[count]
+    uint64_t file_size;        // Полный размер файла
+} TileCacheHeader;
+
+// Ключ кэша для файла плиток
+typedef struct {
+    char source[PATH_MAX];     // Абсолютный путь к файлу плиток
+    char path[PATH_MAX];       // Путь к файлу кэша
+    int64_t mtime_sec;
+    int64_t mtime_nsec;
+    uint64_t source_size;
+} TileCacheKey;
+
+// Вспомогательные функции
+
+static uint64_t align_up(uint64_t value) {
+    return (value + TILE_CACHE_ALIGN - 1) & ~(uint64_t)(TILE_CACHE_ALIGN - 1);
+}
+
+// FNV-1a: имя файла кэша по пути к файлу плиток
+static uint64_t hash_string(const char* s) {
+    uint64_t hash = 1469598103934665603ULL;
+    for (; *s; s++) {
+        hash ^= (uint8_t)*s;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Каталог кэша (создается при create = true)
+static bool cache_directory(char* dir, size_t size, bool create) {
+    const char* env = getenv("IMAGECRAFT_CACHE_DIR");
+    if (env && strcmp(env, "off") == 0) {
+        return false;
+    }
+
+    if (env && *env) {
+        snprintf(dir, size, "%s", env);
+    } else {
+        const char* xdg = getenv("XDG_CACHE_HOME");
+        const char* home = getenv("HOME");
+        char base[PATH_MAX];
+
+        if (xdg && *xdg) {
+            snprintf(base, sizeof(base), "%s", xdg);
+        } else if (home && *home) {
+            snprintf(base, sizeof(base), "%s/.cache", home);
+        } else {
+            return false;
+        }
+
+        int n = snprintf(dir, size, "%s/imagecraft", base);
+        if (n < 0 || (size_t)n >= size) {
+            return false;
+        }
+    }
+
+    return !create || directory_create(dir);
+}
+
+static bool cache_key(const char* tile_file, int tile_size, TileCacheKey* key, bool create) {
+    struct stat st;
+    if (!realpath(tile_file, key->source) || stat(key->source, &st) != 0) {
+        return false;
+    }
+
+    char dir[PATH_MAX];
+    if (!cache_directory(dir, sizeof(dir), create)) {
+        return false;
+    }
+
+    int n = snprintf(key->path, sizeof(key->path), "%s/tiles-%016llx-%d.bin", dir,
+                     (unsigned long long)hash_string(key->source), tile_size);
+    if (n < 0 || (size_t)n >= sizeof(key->path)) {
+        return false;
+    }
+
+    key->mtime_sec = (int64_t)st.st_mtim.tv_sec;
+    key->mtime_nsec = (int64_t)st.st_mtim.tv_nsec;
+    key->source_size = (uint64_t)st.st_size;
+    return true;
+}
+
+// Раздел [offset, offset + length) внутри файла и выровнен
+static bool section_valid(uint64_t offset, uint64_t length, uint64_t file_size) {
+    return offset % TILE_CACHE_ALIGN == 0 && offset <= file_size &&
+           length <= file_size - offset;
+}
+
+static bool write_at(int fd, const void* data, size_t length, uint64_t offset) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (length > 0) {
+        ssize_t n = pwrite(fd, p, length, (off_t)offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        p += n;
+        length -= (size_t)n;
+        offset += (uint64_t)n;
+    }
+    return true;
+}
+
+// Загрузка
+
+TileSet* tile_cache_load(const char* tile_file, int tile_size) {
+    TileCacheKey key;
+    if (!tile_file || tile_size <= 0 || !cache_key(tile_file, tile_size, &key, false)) {
+        return NULL;
+    }
+
+    int fd = open(key.path, O_RDONLY);
+    if (fd < 0) {
+        return NULL;  // Кэша еще нет
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TileCacheHeader)) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t length = (size_t)st.st_size;
+    void* map = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return NULL;
+    }
+
+    // Проверка ключа и границ разделов
+    const TileCacheHeader* header = (const TileCacheHeader*)map;
+    const uint8_t* base = (const uint8_t*)map;
+    uint64_t count = header->count;
+    uint64_t tile_pixels = (uint64_t)header->tile_size * header->tile_size;
+    uint64_t blocks = (uint64_t)header->signature_size * header->signature_size;
+    size_t source_length = strlen(key.source);
+
+    bool valid =
+        memcmp(header->magic, TILE_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+        header->version == TILE_CACHE_VERSION &&
+        header->tile_size == (uint32_t)tile_size &&
+        count > 0 && count <= INT_MAX && header->kd_count == count &&
+        header->signature_size > 0 && header->signature_size <= TILE_SIGNATURE_SIZE &&
+        header->signature_size <= header->tile_size &&
+        header->mtime_sec == key.mtime_sec &&
+        header->mtime_nsec == key.mtime_nsec &&
+        header->source_size == key.source_size &&
+        header->file_size == length &&
+        header->path_length == source_length &&
+        header->path_offset <= length &&
+        header->path_length <= length - header->path_offset &&
+        memcmp(base + header->path_offset, key.source, source_length) == 0 &&
+        section_valid(header->pixels_offset, count * tile_pixels * sizeof(Color), length) &&
+        section_valid(header->averages_offset, count * sizeof(Color), length) &&
+        section_valid(header->signatures_offset, count * blocks * sizeof(Color), length) &&
+        section_valid(header->kd_order_offset, count * sizeof(int), length) &&
+        section_valid(header->kd_axis_offset, count, length);
+
+    // Индексы дерева должны указывать на плитки
+    if (valid) {
+        const int* order = (const int*)(base + header->kd_order_offset);
+        const uint8_t* axis = base + header->kd_axis_offset;
+        for (uint64_t i = 0; i < count && valid; i++) {
+            valid = order[i] >= 0 && (uint64_t)order[i] < count && axis[i] < 4;
+        }
+    }
+
+    if (!valid) {
+        munmap(map, length);
+        return NULL;
+    }
+
+    TileSet* tile_set = (TileSet*)calloc(1, sizeof(TileSet));
+    Image* tiles = (Image*)malloc(count * sizeof(Image));
+    if (!tile_set || !tiles) {
+        free(tile_set);
+        free(tiles);
+        munmap(map, length);
+        return NULL;
+    }
+
+    // Данные используются прямо из отображения (только чтение)
+    tile_set->tiles = tiles;
+    tile_set->count = (int)count;
+    tile_set->tile_size = tile_size;
+    tile_set->pixels = (Color*)(base + header->pixels_offset);
+    tile_set->averages = (Color*)(base + header->averages_offset);
+    tile_set->signatures = (Color*)(base + header->signatures_offset);
+    tile_set->signature_size = (int)header->signature_size;
+    tile_set->kd_order = (int*)(base + header->kd_order_offset);
+    tile_set->kd_axis = (uint8_t*)(base + header->kd_axis_offset);
+    tile_set->kd_count = (int)header->kd_count;
+    tile_set->cache_map = map;
+    tile_set->cache_length = length;
+    tile_set_bind_tiles(tile_set);
+
+    return tile_set;
+}
+
+void tile_cache_unmap(TileSet* tile_set) {
+    if (tile_set && tile_set->cache_map) {
+        munmap(tile_set->cache_map, tile_set->cache_length);
+        tile_set->cache_map = NULL;
+    }
+}
+
+// Сохранение
+
+bool tile_cache_store(const TileSet* tile_set, const char* tile_file) {
+    if (!tile_set || !tile_file || tile_set->cache_map ||
+        !tile_set->averages || !tile_set->signatures || 
+        !tile_set->kd_order || !tile_set->kd_axis) {
+        return false;
+    }
+
+    TileCacheKey key;
+    if (!cache_key(tile_file, tile_set->tile_size, &key, true)) {
+        return false;
+    }
+
+    // Разметка файла
+    uint64_t count = (uint64_t)tile_set->count;
+    uint64_t tile_pixels = (uint64_t)tile_set->tile_size * tile_set->tile_size;
+    uint64_t blocks = (uint64_t)tile_set->signature_size * tile_set->signature_size;
+    size_t path_length = strlen(key.source);
+
+    TileCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, TILE_CACHE_MAGIC, sizeof(TILE_CACHE_MAGIC));
+    header.version = TILE_CACHE_VERSION;
+    header.tile_size = (uint32_t)tile_set->tile_size;
+    header.count = (uint32_t)count;
+    header.kd_count = (uint32_t)tile_set->kd_count;
+    header.signature_size = (uint32_t)tile_set->signature_size;
+    header.mtime_sec = key.mtime_sec;
+    header.mtime_nsec = key.mtime_nsec;
+    header.source_size = key.source_size;
+    header.path_offset = sizeof(TileCacheHeader);
+    header.path_length = path_length;
+    header.pixels_offset = align_up(header.path_offset + path_length);
+    header.averages_offset = align_up(header.pixels_offset + count * tile_pixels * sizeof(Color));
+    header.signatures_offset = align_up(header.averages_offset + count * sizeof(Color));
+    header.kd_order_offset = align_up(header.signatures_offset + 
+                                      count * blocks * sizeof(Color));
+    header.kd_axis_offset = align_up(header.kd_order_offset + count * sizeof(int));
+    header.file_size = header.kd_axis_offset + count;
+
+    // Временный файл рядом с кэшем, затем атомарная замена
+    char temp_path[PATH_MAX + 8];
+    snprintf(temp_path, sizeof(temp_path), "%s.XXXXXX", key.path);
+    int fd = mkstemp(temp_path);
+    if (fd < 0) {
+        fprintf(stderr, "Предупреждение: не удалось создать кэш плиток '%s': %s\n",
+                key.path, strerror(errno));
+        return false;
+    }
+
+    bool ok = ftruncate(fd, (off_t)header.file_size) == 0 &&
+              write_at(fd, &header, sizeof(header), 0) &&
+              write_at(fd, key.source, path_length, header.path_offset) &&
+              write_at(fd, tile_set->pixels, count * tile_pixels * sizeof(Color),
+                       header.pixels_offset) &&
+              write_at(fd, tile_set->averages, count * sizeof(Color), header.averages_offset) &&
+              write_at(fd, tile_set->signatures, count * blocks * sizeof(Color),
+                       header.signatures_offset) &&
+              write_at(fd, tile_set->kd_order, count * sizeof(int), header.kd_order_offset) &&
+              write_at(fd, tile_set->kd_axis, count, header.kd_axis_offset);
+
+    if (close(fd) != 0) ok = false;
+    if (ok && rename(temp_path, key.path) != 0) ok = false;
+
+    if (!ok) {
+        fprintf(stderr, "Предупреждение: не удалось записать кэш плиток '%s': %s\n",
+                key.path, strerror(errno));
+        unlink(temp_path);
+        return false;
+    }
+
+    printf("💾 Набор плиток сохранен в кэш: %s\n", key.path);
+    return true;
+}
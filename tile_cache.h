@@ -0,0 +1,25 @@
+// Кэш наборов плиток для мозаики
+//  Разобранный набор (пиксели плиток подряд, средние цвета, подписи, k-d дерево)
+//  хранится в бинарном файле, который отображается в память без разбора:
+//  повторный запуск не читает BMP, а процессы делят страницы кэша.
+//  Ключ - абсолютный путь к файлу плиток, его mtime и размер, размер плитки.
+//  Каталог кэша: $IMAGECRAFT_CACHE_DIR, иначе $XDG_CACHE_HOME/imagecraft
+//  или ~/.cache/imagecraft; IMAGECRAFT_CACHE_DIR=off отключает кэш.
+
+#ifndef TILE_CACHE_H
+#define TILE_CACHE_H
+
+#include "bonus_mosaic.h"
+#include <stdbool.h>
+
+// Набор плиток из кэша или NULL, если кэша нет или он устарел
+TileSet* tile_cache_load(const char* tile_file, int tile_size);
+
+// Сохранение набора в кэш (атомарно: временный файл и rename)
+// Ошибка записи не критична: выводится предупреждение
+bool tile_cache_store(const TileSet* tile_set, const char* tile_file);
+
+// Снятие отображения кэша (вызывается из free_tile_set)
+void tile_cache_unmap(TileSet* tile_set);
+
+#endif
@@ -6,6 +6,8 @@
 #include <sys/stat.h>
 #include <stdarg.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 // Текущий уровень логирования
 static int current_log_level = LOG_INFO;
@@ -53,6 +55,77 @@ size_t file_size(const char* filename) {
     return 0;
 }
 
+bool file_same(const char* first, const char* second) {
+    if (!first || !second) return false;
+    
+    struct stat a, b;
+    if (stat(first, &a) != 0 || stat(second, &b) != 0) {
+        return false;
+    }
+    
+    return a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+}
+
+bool file_regular_or_missing(const char* path) {
+    if (!path) return false;
+    
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        return errno == ENOENT;
+    }
+    
+    return S_ISREG(st.st_mode);
+}
+
+bool directory_create(const char* path) {
+    if (!path || !*path) return false;
+    
+    char buffer[4096];
+    int n = snprintf(buffer, sizeof(buffer), "%s", path);
+    if (n <= 0 || (size_t)n >= sizeof(buffer)) {
+        return false;
+    }
+    
+    // Родительские каталоги создаются по очереди
+    for (char* p = buffer + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) return false;
+            *p = '/';
+        }
+    }
+    
+    if (mkdir(buffer, 0755) == 0) return true;
+    
+    struct stat st;
+    return errno == EEXIST && stat(buffer, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+// Подавление вывода
+
+int stdout_suppress(void) {
+    fflush(stdout);
+    
+    int saved = dup(STDOUT_FILENO);
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (saved < 0 || null_fd < 0 || dup2(null_fd, STDOUT_FILENO) < 0) {
+        if (saved >= 0) close(saved);
+        if (null_fd >= 0) close(null_fd);
+        return -1;
+    }
+    
+    close(null_fd);
+    return saved;
+}
+
+void stdout_restore(int saved) {
+    if (saved < 0) return;
+    
+    fflush(stdout);
+    dup2(saved, STDOUT_FILENO);
+    close(saved);
+}
+
 // Функции работы со строками
 
 char* string_duplicate(const char* src) {
@@ -180,6 +253,23 @@ float lerp(float a, float b, float t) {
     return a + (b - a) * t;
 }
 
+// Перемешивание битов (lowbias32)
+static uint32_t hash_mix(uint32_t h) {
+    h ^= h >> 16;
+    h *= 0x7feb352dU;
+    h ^= h >> 15;
+    h *= 0x846ca68bU;
+    h ^= h >> 16;
+    return h;
+}
+
+uint32_t hash_u32(uint32_t seed, uint32_t x, uint32_t y, uint32_t stream) {
+    uint32_t h = hash_mix(seed + 0x9e3779b9U);
+    h = hash_mix(h ^ x);
+    h = hash_mix(h ^ y);
+    return hash_mix(h ^ stream);
+}
+
 float degrees_to_radians(float degrees) {
     return degrees * 3.14159265358979323846f / 180.0f;
 }
@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 
 // Функции работы с файлами
 
@@ -15,6 +16,24 @@ bool file_writable(const char* filename);
 // Получение размера файла в байтах
 size_t file_size(const char* filename);
 
+// Один и тот же файл (в том числе через ссылку): совпадают устройство и inode
+bool file_same(const char* first, const char* second);
+
+// Путь - обычный файл или еще не существует (/dev/stdout, канал - нет)
+bool file_regular_or_missing(const char* path);
+
+// Создание каталога вместе с родительскими (существующий каталог - успех)
+bool directory_create(const char* path);
+
+// Подавление вывода
+
+// Перенаправление stdout в /dev/null (подробный журнал фильтров)
+// Возвращает дескриптор исходного stdout для stdout_restore или -1
+int stdout_suppress(void);
+
+// Возврат stdout, сохраненного stdout_suppress
+void stdout_restore(int saved);
+
 // Функции работы со строками
 
 // Копирование строки с выделением памяти
@@ -56,6 +75,11 @@ float clamp_float(float value, float min, float max);
 // t коэффициент интерполяции [0, 1]
 float lerp(float a, float b, float t);
 
+// Счетчиковый генератор: псевдослучайное число, зависящее только от
+// seed и координат (x, y, stream) - без состояния, одинаково в любом потоке
+// и в любом порядке вызова
+uint32_t hash_u32(uint32_t seed, uint32_t x, uint32_t y, uint32_t stream);
+
 //Преобразование градусов в радианы
 float degrees_to_radians(float degrees);
 